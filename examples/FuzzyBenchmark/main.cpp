@@ -0,0 +1,1154 @@
+/***
+  * Benchmarks of FuzzyLogic library
+  *
+  * Measures the evaluation cost (nanoseconds per call) of the building blocks of
+  * the library on the host computer. Build it from this folder with, for example:
+  *
+  *    g++ -O3 -I../../src main.cpp ../../src/FuzzyLogic.cpp ../../src/FuzzyType2.cpp ../../src/FuzzyRelation.cpp ../../src/FuzzyQuantized.cpp ../../src/FuzzyCache.cpp ../../src/FuzzyParallel.cpp ../../src/FuzzyProfile.cpp ../../src/FuzzyRuleStore.cpp ../../src/FuzzyIndex.cpp ../../src/FuzzyMinimize.cpp ../../src/FuzzyTrainer.cpp ../../src/FuzzyBuilder.cpp ../../src/FuzzyTuner.cpp ../../src/FuzzyWangMendel.cpp ../../src/FuzzyCMeans.cpp ../../src/FuzzyBatch.cpp ../../src/FuzzyPool.cpp ../../src/FuzzyInstances.cpp -pthread -o FuzzyBenchmark
+  *
+  * and add -DFUZZY_FAST_EXP to make FuzzySet use the fast approximations (they are
+  * only faster in a vectorized loop, as in the array rows of the smooth functions).
+***/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <math.h>
+#include "FuzzyLogic.h"
+#include "FuzzyType2.h"
+#include "FuzzyRelation.h"
+#include "FuzzyQuantized.h"
+#include "FuzzyCache.h"
+#include "FuzzyParallel.h"
+#include "FuzzyProfile.h"
+#include "FuzzyRuleStore.h"
+#include "FuzzyIndex.h"
+#include "FuzzyMinimize.h"
+#include "FuzzyTrainer.h"
+#include "FuzzyTuner.h"
+#include "FuzzyWangMendel.h"
+#include "FuzzyCMeans.h"
+#include "FuzzyBatch.h"
+#include "FuzzyInstances.h"
+
+using namespace std;
+
+#define N_SAMPLES       (1 << 20)
+
+// Keeps the compiler from removing the benchmarked computation
+static volatile float sink;
+
+static double now_ns(void)
+{
+    return (double)chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void report(const char* name, double elapsed_ns, double calls)
+{
+    cout << "  " << left << setw(44) << name << right << setw(10)
+         << fixed << setprecision(2) << elapsed_ns / calls << " ns/call" << endl;
+}
+
+/* MEMBERSHIP FUNCTIONS */
+//
+static void bench_membership(const vector<float>& xs)
+{
+    cout << "FuzzySet::mu_func" << endl;
+
+    struct { const char* name; FS_type type; float t1, t2, t3, t4; } shapes[] = {
+        {"TRP_L",   TRP_L,   30.0F, 60.0F,  0.0F,  0.0F},
+        {"TRP_C",   TRP_C,   10.0F, 30.0F, 50.0F, 70.0F},
+        {"TRP_R",   TRP_R,   30.0F, 60.0F,  0.0F,  0.0F},
+        {"TRI",     TRI,     25.0F, 50.0F, 75.0F,  0.0F},
+        {"SINGLE",  SINGLE,  50.0F,  0.0F,  0.0F,  0.0F},
+        {"GAUSS",   GAUSS,   50.0F, 15.0F,  0.0F,  0.0F},
+        {"GBELL",   GBELL,   20.0F,  2.5F, 50.0F,  0.0F},
+        {"SIGMOID", SIGMOID,  0.2F, 50.0F,  0.0F,  0.0F},
+    };
+    for (u_int s=0; s<sizeof(shapes)/sizeof(shapes[0]); s++)
+    {
+        FuzzySet set;
+        set.set_up(shapes[s].type, shapes[s].t1, shapes[s].t2, shapes[s].t3, shapes[s].t4);
+        float acc = 0.0F;
+        double t0 = now_ns();
+        for (u_int i=0; i<xs.size(); i++) {acc = acc + set.mu_func(xs[i]);}
+        double t1 = now_ns();
+        sink = acc;
+        report(shapes[s].name, t1 - t0, xs.size());
+
+        // The linear shapes again, as breakpoints with precomputed slopes
+        if (shapes[s].type != TRP_L && shapes[s].type != TRP_C && shapes[s].type != TRP_R && shapes[s].type != TRI) {continue;}
+        FS_pwl breaks;
+        set.set_pwl(&breaks);
+        acc = 0.0F;
+        t0 = now_ns();
+        for (u_int i=0; i<xs.size(); i++) {acc = acc + set.mu_func(xs[i]);}
+        t1 = now_ns();
+        sink = acc;
+        char name[32];
+        snprintf(name, sizeof(name), "%s (breakpoints)", shapes[s].name);
+        report(name, t1 - t0, xs.size());
+    }
+
+    // Piecewise linear set with PWL_SIZE breakpoints (worst case of the segment search)
+    float pwl_x[PWL_SIZE], pwl_mu[PWL_SIZE];
+    for (u_int i=0; i<PWL_SIZE; i++)
+    {
+        pwl_x[i] = 100.0F * i / (PWL_SIZE - 1);
+        pwl_mu[i] = (i % 2 == 0) ? 0.0F : 1.0F;
+    }
+    FS_pwl breaks;
+    FuzzySet set;
+    set.set_pwl(&breaks);
+    set.set_up(pwl_x, pwl_mu, PWL_SIZE);
+    float acc = 0.0F;
+    double t0 = now_ns();
+    for (u_int i=0; i<xs.size(); i++) {acc = acc + set.mu_func(xs[i]);}
+    double t1 = now_ns();
+    sink = acc;
+    report("PWL (PWL_SIZE breakpoints)", t1 - t0, xs.size());
+}
+
+template <class Func>
+static void fill_array(const float* __restrict xs, float* __restrict out, u_int n, Func func)
+{
+    for (u_int i=0; i<n; i++) {out[i] = func(xs[i]);}
+}
+
+template <class Func>
+static void bench_array(const char* name, const vector<float>& xs, vector<float>& out, Func func)
+{
+    double t0 = now_ns();
+    fill_array(xs.data(), out.data(), xs.size(), func);
+    double t1 = now_ns();
+    sink = out[xs.size() / 2];
+    report(name, t1 - t0, xs.size());
+}
+
+static float max_abs_error(const vector<float>& a, const vector<float>& b)
+{
+    float result = 0.0F;
+    for (u_int i=0; i<a.size(); i++) {result = maximum(result, fabsf(a[i] - b[i]));}
+    return result;
+}
+
+static void bench_smooth(const vector<float>& xs)
+{
+    cout << "Smooth membership functions over an array (exact vs fast)" << endl;
+    vector<float> exact(xs.size()), fast(xs.size());
+
+    bench_array("gaussian", xs, exact, [](float x) {return gaussian(50.0F, 15.0F, x);});
+    bench_array("gaussian_fast", xs, fast, [](float x) {return gaussian_fast(50.0F, 15.0F, x);});
+    cout << "    max abs error: " << scientific << max_abs_error(exact, fast) << endl;
+
+    bench_array("generalized_bell", xs, exact, [](float x) {return generalized_bell(20.0F, 2.5F, 50.0F, x);});
+    bench_array("generalized_bell_fast", xs, fast, [](float x) {return generalized_bell_fast(20.0F, 2.5F, 50.0F, x);});
+    cout << "    max abs error: " << scientific << max_abs_error(exact, fast) << endl;
+
+    bench_array("sigmoid", xs, exact, [](float x) {return sigmoid(0.2F, 50.0F, x);});
+    bench_array("sigmoid_fast", xs, fast, [](float x) {return sigmoid_fast(0.2F, 50.0F, x);});
+    cout << "    max abs error: " << scientific << max_abs_error(exact, fast) << endl;
+}
+
+/* REGULAR PARTITION */
+//
+static void bench_partition(const vector<float>& xs)
+{
+    cout << "FuzzyFrame fuzzification of 7 triangular terms" << endl;
+    FuzzySet sets[7];
+    FuzzyFrame frame;
+    frame.Frame_SetUp(sets, 7, 0.0, 100.0, INPUT);
+    frame.Partition_SetUp(10.0, 80.0F / 6.0F, false);
+
+    float acc = 0.0F;
+    double t0 = now_ns();
+    for (u_int i=0; i<xs.size(); i++)
+    {
+        for (u_int k=0; k<7; k++) {acc = acc + sets[k].mu_func(xs[i]);}
+    }
+    double t1 = now_ns();
+    sink = acc;
+    report("every FuzzySet::mu_func", t1 - t0, xs.size());
+
+    u_int idx[2];
+    float mu[2];
+    t0 = now_ns();
+    for (u_int i=0; i<xs.size(); i++)
+    {
+        frame.get_active_terms(xs[i], idx, mu);
+        acc = acc + mu[0] * idx[0] + mu[1] * idx[1];
+    }
+    t1 = now_ns();
+    sink = acc;
+    report("get_active_terms", t1 - t0, xs.size());
+
+    float all[7];
+    t0 = now_ns();
+    for (u_int i=0; i<xs.size(); i++)
+    {
+        frame.Fuzzify(xs[i], all);
+        for (u_int k=0; k<7; k++) {acc = acc + all[k];}
+    }
+    t1 = now_ns();
+    sink = acc;
+    report("Fuzzify, the FuzzySets around x", t1 - t0, xs.size());
+}
+
+/* LOOKUP TABLE */
+// Gaussian terms interpolated from tables of increasing resolution
+static void bench_table(const vector<float>& xs)
+{
+    cout << "FuzzyFrame fuzzification of 5 gaussian terms (sets vs lookup table)" << endl;
+    FuzzySet sets[5];
+    FuzzyFrame frame;
+    static float table[4097 * 5];
+    frame.Frame_SetUp(sets, 5, 0.0, 100.0, INPUT);
+    for (u_int k=0; k<5; k++) {frame.Set_SetUp(k, GAUSS, 25.0F * k, 10.0F);}
+
+    float mu[5];
+    float acc = 0.0F;
+    double t0 = now_ns();
+    for (u_int i=0; i<xs.size(); i++) {frame.Fuzzify(xs[i], mu); acc = acc + mu[2];}
+    double t1 = now_ns();
+    sink = acc;
+    report("Fuzzify, every FuzzySet::mu_func", t1 - t0, xs.size());
+
+    const float errors[] = {1e-2F, 1e-3F, 1e-4F};
+    for (u_int e=0; e<3; e++)
+    {
+        frame.Table_SetUp(table, frame.Table_Points(errors[e], 4097));
+        frame.Frame_Refresh();
+        t0 = now_ns();
+        for (u_int i=0; i<xs.size(); i++) {frame.Fuzzify(xs[i], mu); acc = acc + mu[2];}
+        t1 = now_ns();
+        sink = acc;
+        char name[64];
+        snprintf(name, sizeof(name), "Fuzzify, table of %u points", frame.get_table_points());
+        report(name, t1 - t0, xs.size());
+        cout << "    max interpolation error: " << scientific << frame.get_table_error() << fixed << endl;
+    }
+}
+
+/* WHOLE SYSTEM */
+// Same system as examples/FuzzyLogic2
+FuzzySet Temperature[3];
+FuzzySet Humidity[2];
+FuzzySet Heat[3];
+FuzzyFrame FramesInput[2];
+FuzzyFrame FramesOutput[1];
+FuzzyRule myRule[6];
+u_int input_rules[6][2] = {{0, 0}, {0, 1}, {1, 0}, {1, 1}, {2, 0}, {2, 1}};
+u_int output_rules[6][1] = {{1}, {2}, {1}, {2}, {0}, {0}};
+FuzzySystem mySystem(myRule, 6);
+
+static void setup(void)
+{
+    FramesInput[0].Frame_SetUp(Temperature, 3, 0.0, 100.0, INPUT);
+    FramesInput[1].Frame_SetUp(Humidity, 2, 0.0, 100.0, INPUT);
+    FramesInput[0].Set_SetUp(0, TRP_L, 10.0, 30.0);
+    FramesInput[0].Set_SetUp(1, TRP_C, 10.0, 30.0, 50.0, 70.0);
+    FramesInput[0].Set_SetUp(2, TRP_R, 50.0, 70.0);
+    FramesInput[1].Set_SetUp(0, TRP_L, 30.0, 60.0);
+    FramesInput[1].Set_SetUp(1, TRP_R, 30.0, 60.0);
+
+    FramesOutput[0].Frame_SetUp(Heat, 3, 0.0, 10.0, OUTPUT);
+    FramesOutput[0].Set_SetUp(0, TRP_L, 2.5, 5.0);
+    FramesOutput[0].Set_SetUp(1, TRI, 2.5, 5.0, 7.5);
+    FramesOutput[0].Set_SetUp(2, TRP_R, 5.0, 7.5);
+
+    for (u_int r=0; r<6; r++)
+    {
+        myRule[r].Rule_SetUp(FramesInput, input_rules[r], 2, FramesOutput, output_rules[r], 1);
+    }
+}
+
+static void bench_system(const vector<float>& xs)
+{
+    cout << "FuzzySystem::Defuzzyfication (6 rules, 2 inputs)" << endl;
+    const u_int n = xs.size() / 16;
+    float acc = 0.0F;
+    float input[2];
+
+    double t0 = now_ns();
+    for (u_int i=0; i<n; i++)
+    {
+        input[0] = xs[i]; input[1] = xs[n + i];
+        acc = acc + mySystem.Defuzzyfication(input, 0);
+    }
+    double t1 = now_ns();
+    sink = acc;
+    report("min / max / Mamdani", t1 - t0, n);
+
+    t0 = now_ns();
+    for (u_int i=0; i<n; i++)
+    {
+        input[0] = xs[i]; input[1] = xs[n + i];
+        acc = acc + mySystem.Defuzzyfication<TNormProduct, SNormProbSum, ImpLarsen>(input, 0);
+    }
+    t1 = now_ns();
+    sink = acc;
+    report("product / probabilistic sum / Larsen", t1 - t0, n);
+
+    // Gradient over the 2 inputs: central finite difference against the analytic one
+    float grad[2];
+    const float h = 0.01F;
+    t0 = now_ns();
+    for (u_int i=0; i<n; i++)
+    {
+        input[0] = xs[i]; input[1] = xs[n + i];
+        acc = acc + mySystem.Defuzzyfication(input, 0);
+        for (u_int k=0; k<2; k++)
+        {
+            float x = input[k];
+            input[k] = x + h;
+            float up = mySystem.Defuzzyfication(input, 0);
+            input[k] = x - h;
+            float down = mySystem.Defuzzyfication(input, 0);
+            input[k] = x;
+            grad[k] = (up - down) / (2.0F * h);
+        }
+        acc = acc + grad[0] + grad[1];
+    }
+    t1 = now_ns();
+    sink = acc;
+    report("output + gradient, finite difference", t1 - t0, n);
+
+    t0 = now_ns();
+    for (u_int i=0; i<n; i++)
+    {
+        input[0] = xs[i]; input[1] = xs[n + i];
+        acc = acc + mySystem.Defuzzyfication(input, 0, grad);
+        acc = acc + grad[0] + grad[1];
+    }
+    t1 = now_ns();
+    sink = acc;
+    report("output + gradient, analytic", t1 - t0, n);
+}
+
+/* INTERVAL TYPE-2 */
+// Same rules as above, with a Footprint Of Uncertainty of +-5 on the input sets
+FuzzySet2 Temperature2[3];
+FuzzySet2 Humidity2[2];
+FuzzySet2 Heat2[3];
+FuzzyFrame2 FramesInput2[2];
+FuzzyFrame2 FramesOutput2[1];
+FuzzyRule2 myRule2[6];
+FuzzySystem2 mySystem2(myRule2, 6, TR_EKM);
+
+static void setup_type2(void)
+{
+    const float b = 5.0;
+    FramesInput2[0].Frame_SetUp(Temperature2, 3, 0.0, 100.0, INPUT);
+    FramesInput2[1].Frame_SetUp(Humidity2, 2, 0.0, 100.0, INPUT);
+    FramesInput2[0].upper(0).set_up(TRP_L, 10.0 + b, 30.0 + b);
+    FramesInput2[0].lower(0).set_up(TRP_L, 10.0 - b, 30.0 - b);
+    FramesInput2[0].upper(1).set_up(TRP_C, 10.0 - b, 30.0 - b, 50.0 + b, 70.0 + b);
+    FramesInput2[0].lower(1).set_up(TRP_C, 10.0 + b, 30.0 + b, 50.0 - b, 70.0 - b);
+    FramesInput2[0].upper(2).set_up(TRP_R, 50.0 - b, 70.0 - b);
+    FramesInput2[0].lower(2).set_up(TRP_R, 50.0 + b, 70.0 + b);
+    FramesInput2[1].upper(0).set_up(TRP_L, 30.0 + b, 60.0 + b);
+    FramesInput2[1].lower(0).set_up(TRP_L, 30.0 - b, 60.0 - b);
+    FramesInput2[1].upper(1).set_up(TRP_R, 30.0 - b, 60.0 - b);
+    FramesInput2[1].lower(1).set_up(TRP_R, 30.0 + b, 60.0 + b);
+
+    FramesOutput2[0].Frame_SetUp(Heat2, 3, 0.0, 10.0, OUTPUT);
+    FramesOutput2[0].upper(0).set_up(TRP_L, 2.5, 5.0);
+    FramesOutput2[0].lower(0).set_up(TRP_L, 2.5, 5.0);
+    FramesOutput2[0].upper(1).set_up(TRI, 2.5, 5.0, 7.5);
+    FramesOutput2[0].lower(1).set_up(TRI, 2.5, 5.0, 7.5);
+    FramesOutput2[0].upper(2).set_up(TRP_R, 5.0, 7.5);
+    FramesOutput2[0].lower(2).set_up(TRP_R, 5.0, 7.5);
+
+    for (u_int r=0; r<6; r++)
+    {
+        myRule2[r].Rule_SetUp(FramesInput2, input_rules[r], 2, FramesOutput2, output_rules[r], 1);
+    }
+}
+
+static void bench_type2(const vector<float>& xs)
+{
+    cout << "FuzzySystem2::Defuzzyfication (interval type-2, 6 rules, 2 inputs)" << endl;
+    const u_int n = xs.size() / 16;
+    float input[2];
+    struct { const char* name; TR_type reducer; } reducers[] = {
+        {"Enhanced Karnik-Mendel", TR_EKM},
+        {"Nie-Tan", TR_NIE_TAN},
+        {"Wu-Mendel uncertainty bounds", TR_WU_MENDEL},
+    };
+    for (u_int r=0; r<3; r++)
+    {
+        mySystem2.TypeReducer_SetUp(reducers[r].reducer);
+        float acc = 0.0F;
+        double t0 = now_ns();
+        for (u_int i=0; i<n; i++)
+        {
+            input[0] = xs[i]; input[1] = xs[n + i];
+            acc = acc + mySystem2.Defuzzyfication(input, 0);
+        }
+        double t1 = now_ns();
+        sink = acc;
+        report(reducers[r].name, t1 - t0, n);
+    }
+}
+
+/* RELATION MATRIX */
+// The same system compiled into a relation matrix over a grid of step 1 on each input
+static void bench_relation(const vector<float>& xs)
+{
+    FramesInput[0].domainSetUp(0.0, 100.0, 1.0);
+    FramesInput[1].domainSetUp(0.0, 100.0, 1.0);
+    FuzzyRelation relation;
+    double t0 = now_ns();
+    bool built = relation.Relation_SetUp(&mySystem, 0);
+    double t1 = now_ns();
+    FramesInput[0].domainSetUp(0.0, 100.0, 100.0 / (DISC_SIZE - 1));
+    FramesInput[1].domainSetUp(0.0, 100.0, 100.0 / (DISC_SIZE - 1));
+    if (!built) {return;}
+    cout << "FuzzyRelation (" << relation.get_rows() << " x " << relation.get_columns() << " matrix, "
+         << relation.get_matrix_size() / 1024 << " KiB, built in " << (t1 - t0) / 1e6 << " ms)" << endl;
+
+    const u_int n = xs.size() / 16;
+    float acc = 0.0F;
+    vector<float> outputs(n);
+    t0 = now_ns();
+    relation.Defuzzyfication(&xs[0], n / 2, &outputs[0]);
+    t1 = now_ns();
+    for (u_int i=0; i<n/2; i++) {acc = acc + outputs[i];}
+    sink = acc;
+    report("crisp inputs (row lookup + centroid)", t1 - t0, n / 2);
+
+    // Fuzzy inputs: triangles of half width 3 around each input
+    const u_int length = relation.get_input_length();
+    const u_int columns = relation.get_columns();
+    const u_int queries = 1024;
+    vector<float> fuzzy_in((size_t)queries * length, 0.0F);
+    vector<float> fuzzy_out((size_t)queries * columns);
+    for (u_int q=0; q<queries; q++)
+    {
+        u_int base = 0;
+        for (u_int i=0; i<2; i++)
+        {
+            float x = xs[2*q + i];
+            for (u_int k=0; k<relation.get_grid_size(i); k++)
+            {
+                float d = 1.0F - fabsf((float)k - x) / 3.0F;
+                fuzzy_in[(size_t)q * length + base + k] = (d > 0.0F) ? d : 0.0F;
+            }
+            base = base + relation.get_grid_size(i);
+        }
+    }
+    const u_int batches[] = {1, 16, 64};
+    for (u_int b=0; b<3; b++)
+    {
+        t0 = now_ns();
+        for (u_int q=0; q<queries; q=q+batches[b])
+        {
+            relation.Compose(&fuzzy_in[(size_t)q * length], batches[b], &fuzzy_out[(size_t)q * columns]);
+        }
+        t1 = now_ns();
+        sink = fuzzy_out[queries * columns - 1];
+        char name[64];
+        snprintf(name, sizeof(name), "fuzzy inputs, max-min, batch of %u", batches[b]);
+        report(name, t1 - t0, queries);
+    }
+}
+
+/* QUANTIZED INFERENCE */
+// The same system on 10-bit and 8-bit ADC codes over [0, 100]
+static void bench_quantized(const vector<float>& xs)
+{
+    const u_int bits[2] = {10, 8};
+    const float gain[2] = {100.0F / 1023.0F, 100.0F / 255.0F};
+    FuzzyQuantized quantized;
+    if (!quantized.Quantized_SetUp(&mySystem, 0, bits, 0, gain)) {return;}
+    cout << "FuzzyQuantized (10-bit and 8-bit codes, " << quantized.get_table_size() / 1024 << " KiB of tables)" << endl;
+
+    const u_int n = xs.size() / 16;
+    vector<u_int> codes(2 * n);
+    vector<float> outputs(n);
+    for (u_int i=0; i<n; i++)
+    {
+        codes[2*i] = (u_int)(xs[2*i] / gain[0]);
+        codes[2*i + 1] = (u_int)(xs[2*i + 1] / gain[1]);
+    }
+    double t0 = now_ns();
+    quantized.Defuzzyfication(&codes[0], n, &outputs[0]);
+    double t1 = now_ns();
+    report("Defuzzyfication on codes (uint8)", t1 - t0, n);
+
+    float error = 0.0F;
+    float input[2];
+    for (u_int i=0; i<n; i=i+64)
+    {
+        input[0] = gain[0] * (float)codes[2*i];
+        input[1] = gain[1] * (float)codes[2*i + 1];
+        float d = fabsf(outputs[i] - mySystem.Defuzzyfication(input, 0));
+        error = (d > error) ? d : error;
+    }
+    cout << "  max error against float                     " << setw(10) << setprecision(5) << error << endl;
+}
+
+/* MEMOIZATION */
+// Inputs rounded to multiples of 8 (as in examples/FuzzyLogic_Testing): 13 x 13 distinct vectors
+static void bench_cache(const vector<float>& xs)
+{
+    const u_int n = xs.size() / 16;
+    vector<float> inputs(2 * n);
+    vector<float> outputs(n);
+    for (u_int i=0; i<2*n; i++) {inputs[i] = 8.0F * floorf(xs[i] / 8.0F);}
+    const u_int capacities[] = {64, 256};
+    for (u_int c=0; c<2; c++)
+    {
+        FuzzyCache cache;
+        if (!cache.Cache_SetUp(&mySystem, capacities[c], 0)) {return;}
+        double t0 = now_ns();
+        cache.Defuzzyfication(&inputs[0], 0, n, &outputs[0]);
+        double t1 = now_ns();
+        sink = outputs[n - 1];
+        cout << "FuzzyCache (" << capacities[c] << " entries, exact keys): hit rate " << setprecision(1)
+             << 100.0 * cache.get_hits() / (cache.get_hits() + cache.get_misses()) << " %" << endl;
+        report("Defuzzyfication through the cache", t1 - t0, n);
+    }
+}
+
+/* LARGE RULE BASE */
+static float xs_spread(u_int q, u_int i)
+{
+    // Deterministic values spread over [0, 100]
+    return (float)((q * 37U + i * 53U) % 101U);
+}
+
+// 20000 random rules over 8 inputs of 3 triangular terms, 101 output samples
+static void bench_parallel(void)
+{
+    const u_int n_inputs = 8;
+    const u_int n_rules = 20000;
+    static FuzzySet in_sets[n_inputs][3];
+    static FuzzySet out_sets[5];
+    static FuzzyFrame in_frames[n_inputs];
+    static FuzzyFrame out_frames[1];
+    vector<FuzzyRule> rules(n_rules);
+    vector<u_int> antecedents(n_rules * n_inputs);
+    vector<u_int> consequents(n_rules);
+    for (u_int i=0; i<n_inputs; i++)
+    {
+        in_frames[i].Frame_SetUp(in_sets[i], 3, 0.0, 100.0, INPUT);
+        in_frames[i].Partition_SetUp(10.0, 40.0, false);
+    }
+    out_frames[0].Frame_SetUp(out_sets, 5, 0.0, 10.0, OUTPUT);
+    out_frames[0].domainSetUp(0.0, 10.0, 0.1);
+    out_frames[0].Partition_SetUp(1.0, 2.0, false);
+    uint32_t seed = 777;
+    for (u_int r=0; r<n_rules; r++)
+    {
+        for (u_int i=0; i<n_inputs; i++)
+        {
+            seed = seed * 1664525U + 1013904223U;
+            antecedents[r*n_inputs + i] = (seed >> 8) % 3;
+        }
+        seed = seed * 1664525U + 1013904223U;
+        consequents[r] = (seed >> 8) % 5;
+        rules[r].Rule_SetUp(in_frames, &antecedents[r*n_inputs], n_inputs, out_frames, &consequents[r], 1);
+    }
+    FuzzySystem big(&rules[0], n_rules);
+    cout << "Large rule base (" << n_rules << " rules, " << n_inputs << " inputs)" << endl;
+
+    float input[n_inputs];
+    for (u_int i=0; i<n_inputs; i++) {input[i] = 10.0F + 9.0F * i;}
+    double t0 = now_ns();
+    float expected = big.Defuzzyfication(input, 0);
+    double t1 = now_ns();
+    report("FuzzySystem::Defuzzyfication", t1 - t0, 1);
+
+    // Traffic where the first inputs stay low: their high values never fire
+    FuzzyProfile profile;
+    if (profile.Profile_SetUp(&big))
+    {
+        vector<float> traffic(256 * n_inputs);
+        for (u_int q=0; q<256; q++)
+        {
+            for (u_int i=0; i<n_inputs; i++) {traffic[q*n_inputs + i] = (i < 4) ? 0.2F * (q % 100) : xs_spread(q, i);}
+        }
+        profile.Record(&traffic[0], 256);
+        float natural_evaluations = profile.get_evaluations();
+        profile.Apply();
+        profile.Reset();
+        profile.Record(&traffic[0], 256);
+        t0 = now_ns();
+        float output = big.Defuzzyfication(&traffic[0], 0);
+        t1 = now_ns();
+        profile.Remove();
+        double t2 = now_ns();
+        float natural = big.Defuzzyfication(&traffic[0], 0);
+        double t3 = now_ns();
+        report("  on the traffic, natural order", t3 - t2, 1);
+        report((output == natural) ? "  on the traffic, profiled order" : "  profiled order (DIFFERENT)", t1 - t0, 1);
+        cout << "    membership evaluations per rule, counted on the traffic: " << setprecision(3) << natural_evaluations
+             << " -> " << profile.get_evaluations() << endl;
+    }
+
+    const u_int threads[] = {1, 2, 4};
+    for (u_int k=0; k<3; k++)
+    {
+        FuzzyParallel parallel;
+        if (!parallel.Parallel_SetUp(&big, threads[k])) {return;}
+        float output = 0.0F;
+        const u_int queries = 200;
+        t0 = now_ns();
+        for (u_int q=0; q<queries; q++) {output = parallel.Defuzzyfication(input, 0);}
+        t1 = now_ns();
+        char name[64];
+        snprintf(name, sizeof(name), "FuzzyParallel, %u thread(s)%s", threads[k], (output == expected) ? "" : " (DIFFERENT)");
+        report(name, t1 - t0, queries);
+    }
+}
+
+/* SPARSE RULE BASE */
+// 20000 random rules over 6 inputs of 9 triangular terms: few rules fire
+static void bench_index(void)
+{
+    const u_int n_inputs = 6;
+    const u_int n_rules = 20000;
+    static FuzzySet in_sets[n_inputs][9];
+    static FuzzySet out_sets[5];
+    static FuzzyFrame in_frames[n_inputs];
+    static FuzzyFrame out_frames[1];
+    vector<FuzzyRule> rules(n_rules);
+    vector<u_int> antecedents(n_rules * n_inputs);
+    vector<u_int> consequents(n_rules);
+    for (u_int i=0; i<n_inputs; i++)
+    {
+        in_frames[i].Frame_SetUp(in_sets[i], 9, 0.0, 100.0, INPUT);
+        in_frames[i].Partition_SetUp(0.0, 12.5, false);
+    }
+    out_frames[0].Frame_SetUp(out_sets, 5, 0.0, 10.0, OUTPUT);
+    out_frames[0].domainSetUp(0.0, 10.0, 0.1);
+    out_frames[0].Partition_SetUp(1.0, 2.0, false);
+    uint32_t seed = 4242;
+    for (u_int r=0; r<n_rules; r++)
+    {
+        for (u_int i=0; i<n_inputs; i++)
+        {
+            seed = seed * 1664525U + 1013904223U;
+            antecedents[r*n_inputs + i] = (seed >> 8) % 9;
+        }
+        seed = seed * 1664525U + 1013904223U;
+        consequents[r] = (seed >> 8) % 5;
+        rules[r].Rule_SetUp(in_frames, &antecedents[r*n_inputs], n_inputs, out_frames, &consequents[r], 1);
+    }
+    FuzzySystem sparse(&rules[0], n_rules);
+    cout << "Sparse rule base (" << n_rules << " rules, " << n_inputs << " inputs)" << endl;
+
+    FuzzyIndex index;
+    double t0 = now_ns();
+    if (!index.Index_SetUp(&sparse)) {return;}
+    double t1 = now_ns();
+    report("FuzzyIndex::Index_SetUp", t1 - t0, 1);
+
+    const u_int queries = 2000;
+    vector<float> inputs(queries * n_inputs);
+    for (u_int q=0; q<queries; q++)
+    {
+        for (u_int i=0; i<n_inputs; i++) {inputs[q*n_inputs + i] = xs_spread(q, i);}
+    }
+    t0 = now_ns();
+    float expected = sparse.Defuzzyfication(&inputs[0], 0);
+    t1 = now_ns();
+    report("FuzzySystem::Defuzzyfication", t1 - t0, 1);
+
+    bool same = index.Defuzzyfication(&inputs[0], 0) == expected;
+    double found = 0.0;
+    float acc = 0.0F;
+    t0 = now_ns();
+    for (u_int q=0; q<queries; q++)
+    {
+        acc = acc + index.Defuzzyfication(&inputs[q*n_inputs], 0);
+        found = found + index.get_candidates();
+    }
+    t1 = now_ns();
+    sink = acc;
+    report(same ? "FuzzyIndex::Defuzzyfication" : "FuzzyIndex::Defuzzyfication (DIFFERENT)", t1 - t0, queries);
+    cout << "    rules found per query: " << setprecision(1) << found / queries << " of " << n_rules
+         << " (" << index.get_nodes() << " nodes)" << endl;
+}
+
+/* RULE BASE MINIMIZATION */
+// 5000 random rules over 3 inputs of 5 terms and a wider "LOW" term, as a
+// generator that repeats itself would produce
+static void bench_minimize(void)
+{
+    const u_int n_inputs = 3;
+    const u_int n_rules = 5000;
+    static FuzzySet in_sets[n_inputs][6];
+    static FuzzySet out_sets[5];
+    static FuzzyFrame in_frames[n_inputs];
+    static FuzzyFrame out_frames[1];
+    vector<FuzzyRule> rules(n_rules);
+    vector<FuzzyRule> kept_rules(n_rules);
+    vector<u_int> antecedents(n_rules * n_inputs);
+    vector<u_int> consequents(n_rules);
+    for (u_int i=0; i<n_inputs; i++)
+    {
+        in_frames[i].Frame_SetUp(in_sets[i], 6, 0.0, 100.0, INPUT);
+        in_frames[i].Set_SetUp(0, TRP_L, 0.0, 25.0);
+        in_frames[i].Set_SetUp(1, TRI, 0.0, 25.0, 50.0);
+        in_frames[i].Set_SetUp(2, TRI, 25.0, 50.0, 75.0);
+        in_frames[i].Set_SetUp(3, TRI, 50.0, 75.0, 100.0);
+        in_frames[i].Set_SetUp(4, TRP_R, 75.0, 100.0);
+        in_frames[i].Set_SetUp(5, TRP_L, 50.0, 60.0);          // LOW: 1 wherever 0 and 1 are not 0
+    }
+    out_frames[0].Frame_SetUp(out_sets, 5, 0.0, 10.0, OUTPUT);
+    out_frames[0].domainSetUp(0.0, 10.0, 0.1);
+    out_frames[0].Partition_SetUp(1.0, 2.0, false);
+    uint32_t seed = 99;
+    for (u_int r=0; r<n_rules; r++)
+    {
+        for (u_int i=0; i<n_inputs; i++)
+        {
+            seed = seed * 1664525U + 1013904223U;
+            antecedents[r*n_inputs + i] = (seed >> 8) % 6;
+        }
+        seed = seed * 1664525U + 1013904223U;
+        consequents[r] = (seed >> 8) % 5;
+        rules[r].Rule_SetUp(in_frames, &antecedents[r*n_inputs], n_inputs, out_frames, &consequents[r], 1);
+    }
+    FuzzySystem generated(&rules[0], n_rules);
+
+    FuzzyMinimizer minimizer;
+    double t0 = now_ns();
+    u_int kept = minimizer.Minimize(&generated, &kept_rules[0]);
+    double t1 = now_ns();
+    if (kept == 0) {return;}
+    FuzzySystem minimized(&kept_rules[0], kept);
+    cout << "Rule base minimization (" << n_rules << " rules -> " << kept << ": " << minimizer.get_duplicates()
+         << " duplicates, " << minimizer.get_covered() << " covered)" << endl;
+    report("FuzzyMinimizer::Minimize", t1 - t0, 1);
+
+    const u_int queries = 200;
+    vector<float> inputs(queries * n_inputs);
+    for (u_int q=0; q<queries; q++)
+    {
+        for (u_int i=0; i<n_inputs; i++) {inputs[q*n_inputs + i] = xs_spread(q, i);}
+    }
+    vector<float> expected(queries);
+    t0 = now_ns();
+    for (u_int q=0; q<queries; q++) {expected[q] = generated.Defuzzyfication(&inputs[q*n_inputs], 0);}
+    t1 = now_ns();
+    report("Defuzzyfication, generated rules", t1 - t0, queries);
+    bool same = true;
+    t0 = now_ns();
+    for (u_int q=0; q<queries; q++) {same = (minimized.Defuzzyfication(&inputs[q*n_inputs], 0) == expected[q]) && same;}
+    t1 = now_ns();
+    report(same ? "Defuzzyfication, minimized rules" : "Defuzzyfication, minimized (DIFFERENT)", t1 - t0, queries);
+}
+
+/* TRAINING */
+
+static void bench_train(void)
+{
+    // A teacher system gives the targets, a student with moved thresholds is fitted to them
+    const size_t n_samples = 100000;
+    static FuzzySet teacher_sets[2][3], student_sets[2][3], teacher_out[3], student_out[3];
+    static FuzzyFrame teacher_in[2], student_in[2], teacher_frame[1], student_frame[1];
+    static FuzzyRule teacher_rules[9], student_rules[9];
+    static u_int antecedents[9][2], consequents[9];
+    for (u_int k=0; k<2; k++)
+    {
+        float shift = (k == 0) ? 0.0F : 8.0F;
+        FuzzySet (*sets)[3] = (k == 0) ? teacher_sets : student_sets;
+        FuzzyFrame* in = (k == 0) ? teacher_in : student_in;
+        FuzzyFrame* out = (k == 0) ? teacher_frame : student_frame;
+        for (u_int i=0; i<2; i++)
+        {
+            in[i].Frame_SetUp(sets[i], 3, 0.0, 100.0, INPUT);
+            in[i].Set_SetUp(0, TRP_L, 20.0 + shift, 45.0 + shift);
+            in[i].Set_SetUp(1, TRI, 20.0 - shift, 50.0 + shift, 80.0 - shift);
+            in[i].Set_SetUp(2, TRP_R, 55.0 - shift, 80.0 + shift);
+        }
+        out[0].Frame_SetUp((k == 0) ? teacher_out : student_out, 3, 0.0, 10.0, OUTPUT);
+        out[0].domainSetUp(0.0, 10.0, 0.1);
+        out[0].Set_SetUp(0, TRP_L, 2.0 + shift / 10, 5.0);
+        out[0].Set_SetUp(1, TRI, 2.5, 5.0 + shift / 10, 7.5);
+        out[0].Set_SetUp(2, GAUSS, 8.0 - shift / 10, 1.5);
+        for (u_int r=0; r<9; r++)
+        {
+            antecedents[r][0] = r / 3;
+            antecedents[r][1] = r % 3;
+            consequents[r] = (r / 3 + r % 3) / 2;
+            FuzzyRule* rule = (k == 0) ? &teacher_rules[r] : &student_rules[r];
+            rule->Rule_SetUp(in, antecedents[r], 2, out, &consequents[r], 1);
+        }
+    }
+    FuzzySystem teacher(teacher_rules, 9);
+    FuzzySystem student(student_rules, 9);
+    vector<float> inputs(n_samples * 2);
+    vector<float> targets(n_samples);
+    for (size_t q=0; q<n_samples; q++)
+    {
+        inputs[q*2] = xs_spread((u_int)q, 0);
+        inputs[q*2 + 1] = xs_spread((u_int)q, 1);
+        targets[q] = teacher.Defuzzyfication(&inputs[q*2], 0);
+    }
+
+    FuzzyTrainer trainer;
+    if (!trainer.Trainer_SetUp(&student, 0, 0)) {return;}
+    float before = trainer.Error(&inputs[0], &targets[0], n_samples);
+    const u_int epochs = 5;
+    double t0 = now_ns();
+    trainer.Train(&inputs[0], &targets[0], n_samples, epochs, 1024, 0.05);
+    double t1 = now_ns();
+    float after = trainer.Error(&inputs[0], &targets[0], n_samples);
+    cout << "Training of " << trainer.get_parameters() << " thresholds (" << trainer.get_threads() << " threads, mean squared error "
+         << scientific << setprecision(2) << before << " -> " << after << ", " << fixed << (size_t)trainer.get_samples_per_second() << " samples/s)" << endl;
+    report("FuzzyTrainer::Train, per sample", t1 - t0, n_samples * epochs);
+}
+
+/* EVOLUTIONARY TUNING */
+
+struct TuneData
+{
+    vector<float> inputs;
+    vector<float> targets;
+};
+
+static float tune_cost(FuzzySystem* system, u_int worker, void* user)
+{
+    // Mean squared error over the samples (any cost works, it needs no gradient)
+    (void)worker;
+    TuneData* data = (TuneData*)user;
+    double error = 0.0;
+    for (size_t q=0; q<data->targets.size(); q++)
+    {
+        double e = system->Defuzzyfication(&data->inputs[q*2], 0) - data->targets[q];
+        error = error + e * e;
+    }
+    return (float)(error / data->targets.size());
+}
+
+static void bench_tune(void)
+{
+    // A teacher system gives the targets, a student with moved thresholds and
+    // shuffled consequents is tuned to them
+    const size_t n_samples = 200;
+    static FuzzySet teacher_sets[2][3], student_sets[2][3], teacher_out[3], student_out[3];
+    static FuzzyFrame teacher_in[2], student_in[2], teacher_frame[1], student_frame[1];
+    static FuzzyRule teacher_rules[9], student_rules[9];
+    static u_int antecedents[9][2], teacher_consequents[9], student_consequents[9];
+    for (u_int k=0; k<2; k++)
+    {
+        float shift = (k == 0) ? 0.0F : 8.0F;
+        FuzzySet (*sets)[3] = (k == 0) ? teacher_sets : student_sets;
+        FuzzyFrame* in = (k == 0) ? teacher_in : student_in;
+        FuzzyFrame* out = (k == 0) ? teacher_frame : student_frame;
+        for (u_int i=0; i<2; i++)
+        {
+            in[i].Frame_SetUp(sets[i], 3, 0.0, 100.0, INPUT);
+            in[i].Set_SetUp(0, TRP_L, 20.0 + shift, 45.0 + shift);
+            in[i].Set_SetUp(1, TRI, 20.0 - shift, 50.0 + shift, 80.0 - shift);
+            in[i].Set_SetUp(2, TRP_R, 55.0 - shift, 80.0 + shift);
+        }
+        out[0].Frame_SetUp((k == 0) ? teacher_out : student_out, 3, 0.0, 10.0, OUTPUT);
+        out[0].domainSetUp(0.0, 10.0, 0.1);
+        out[0].Set_SetUp(0, TRP_L, 2.0 + shift / 10, 5.0);
+        out[0].Set_SetUp(1, TRI, 2.5, 5.0 + shift / 10, 7.5);
+        out[0].Set_SetUp(2, GAUSS, 8.0 - shift / 10, 1.5);
+        for (u_int r=0; r<9; r++)
+        {
+            antecedents[r][0] = r / 3;
+            antecedents[r][1] = r % 3;
+            teacher_consequents[r] = (r / 3 + r % 3) / 2;
+            student_consequents[r] = (r * 7) % 3;
+            FuzzyRule* rule = (k == 0) ? &teacher_rules[r] : &student_rules[r];
+            u_int* consequent = (k == 0) ? &teacher_consequents[r] : &student_consequents[r];
+            rule->Rule_SetUp(in, antecedents[r], 2, out, consequent, 1);
+        }
+    }
+    FuzzySystem teacher(teacher_rules, 9);
+    FuzzySystem student(student_rules, 9);
+    TuneData data;
+    data.inputs.resize(n_samples * 2);
+    data.targets.resize(n_samples);
+    for (size_t q=0; q<n_samples; q++)
+    {
+        data.inputs[q*2] = xs_spread((u_int)q, 0);
+        data.inputs[q*2 + 1] = xs_spread((u_int)q, 1);
+        data.targets[q] = teacher.Defuzzyfication(&data.inputs[q*2], 0);
+    }
+
+    FuzzyTuner tuner;
+    if (!tuner.Tuner_SetUp(&student, 32, 0, true)) {return;}
+    float before = tune_cost(&student, 0, &data);
+    double t0 = now_ns();
+    float after = tuner.Tune(tune_cost, &data, 50);
+    double t1 = now_ns();
+    cout << "Evolutionary tuning of " << tuner.get_genes() << " genes (" << tuner.get_threads() << " threads, cost "
+         << scientific << setprecision(2) << before << " -> " << after << ", " << fixed
+         << (size_t)tuner.get_evaluations_per_second() << " evaluations/s)" << endl;
+    report("FuzzyTuner::Tune, per evaluation", t1 - t0, (double)tuner.get_evaluations());
+}
+
+/* RULE GENERATION FROM DATA */
+
+static void bench_wang_mendel(void)
+{
+    // A CSV file of samples of y = mean of 6 inputs, read by Wang-Mendel
+    const u_int n_inputs = 6;
+    const size_t n_samples = 500000;
+    const char* path = "FuzzyBenchmark.csv";
+    static FuzzySet in_sets[n_inputs][5];
+    static FuzzySet out_sets[5];
+    static FuzzyFrame in_frames[n_inputs];
+    static FuzzyFrame out_frames[1];
+    for (u_int i=0; i<n_inputs; i++)
+    {
+        in_frames[i].Frame_SetUp(in_sets[i], 5, 0.0, 100.0, INPUT);
+        in_frames[i].Partition_SetUp(0.0, 25.0, false);
+    }
+    out_frames[0].Frame_SetUp(out_sets, 5, 0.0, 10.0, OUTPUT);
+    out_frames[0].domainSetUp(0.0, 10.0, 0.1);
+    out_frames[0].Partition_SetUp(0.0, 2.5, false);
+
+    FILE* file = fopen(path, "w");
+    if (file == 0) {return;}
+    fprintf(file, "x1,x2,x3,x4,x5,x6,y\n");
+    uint32_t seed = 2024;
+    for (size_t q=0; q<n_samples; q++)
+    {
+        float sum = 0.0;
+        for (u_int i=0; i<n_inputs; i++)
+        {
+            seed = seed * 1664525U + 1013904223U;
+            float x = (seed >> 8) * (100.0F / 16777216.0F);
+            sum = sum + x;
+            fprintf(file, "%.4f,", x);
+        }
+        fprintf(file, "%.4f\n", sum / (10.0 * n_inputs));
+    }
+    long bytes = ftell(file);
+    fclose(file);
+
+    FuzzyWangMendel generator;
+    if (!generator.WangMendel_SetUp(in_frames, n_inputs, out_frames, 1, 100000, 0)) {return;}
+    double t0 = now_ns();
+    generator.Read_CSV(path, true);
+    double t1 = now_ns();
+    remove(path);
+    vector<FuzzyRule> rules(generator.get_total_rules());
+    u_int total_rules = generator.Rules_SetUp(&rules[0]);
+    cout << "Wang-Mendel rule generation (" << n_samples << " samples of " << n_inputs << " inputs -> " << total_rules << " rules, "
+         << generator.get_threads() << " threads, " << (size_t)(bytes / ((t1 - t0) * 1e-3)) << " MB/s)" << endl;
+    report("FuzzyWangMendel::Read_CSV, per sample", t1 - t0, n_samples);
+}
+
+/* MEMBERSHIP FUNCTIONS FROM CLUSTERS */
+// 1000000 samples of 3 inputs around 4 centers, clustered by fuzzy c-means
+// and projected onto the FuzzySets of the first input
+static void bench_cmeans(void)
+{
+    const u_int n_dimensions = 3;
+    const u_int n_clusters = 4;
+    const size_t n_samples = 1000000;
+    const float centers[n_clusters][n_dimensions] = {{10.0F, 20.0F, 30.0F}, {60.0F, 20.0F, 50.0F},
+                                                     {30.0F, 80.0F, 10.0F}, {80.0F, 70.0F, 90.0F}};
+    vector<float> samples(n_samples * n_dimensions);
+    uint32_t seed = 99;
+    for (size_t q=0; q<n_samples; q++)
+    {
+        for (u_int i=0; i<n_dimensions; i++)
+        {
+            // Sum of 4 uniform values, close enough to a normal spread
+            float noise = 0.0;
+            for (u_int j=0; j<4; j++)
+            {
+                seed = seed * 1664525U + 1013904223U;
+                noise = noise + (seed >> 8) * (1.0F / 16777216.0F) - 0.5F;
+            }
+            samples[q * n_dimensions + i] = centers[q % n_clusters][i] + 8.0F * noise;
+        }
+    }
+
+    FuzzyCMeans cmeans;
+    if (!cmeans.CMeans_SetUp(n_dimensions, n_clusters, 2.0, 0)) {return;}
+    double t0 = now_ns();
+    u_int iterations = cmeans.Cluster(&samples[0], n_samples, 100, 1e-3F);
+    double t1 = now_ns();
+    static FuzzySet sets[n_clusters];
+    FuzzyFrame frame;
+    frame.Frame_SetUp(sets, n_clusters, 0.0, 100.0, INPUT);
+    cmeans.Project(&frame, 0, CM_TRIANGLE);
+    cout << "Fuzzy c-means of " << n_samples << " samples (" << n_dimensions << " inputs, " << n_clusters << " clusters, "
+         << iterations << " iterations, " << cmeans.get_threads() << " threads), centers on input 1:";
+    for (u_int k=0; k<n_clusters; k++) {cout << " " << setprecision(2) << cmeans.get_centers()[k * n_dimensions];}
+    cout << endl;
+    // Every iteration is one pass, plus the pass of the spreads
+    report("FuzzyCMeans::Cluster, per sample and pass", t1 - t0, (double)n_samples * (iterations + 1));
+}
+
+/* BATCHES */
+// The system of bench_system, evaluated by FuzzyBatch on batches of queries
+static void bench_batch(const vector<float>& xs)
+{
+    const u_int n = xs.size() / 16;
+    vector<float> inputs(2 * (size_t)n);
+    vector<float> outputs(n);
+    for (u_int i=0; i<n; i++)
+    {
+        inputs[2 * (size_t)i] = xs[i];
+        inputs[2 * (size_t)i + 1] = xs[n + i];
+    }
+    FuzzyBatch batch;
+    if (!batch.Batch_SetUp(&mySystem, 0)) {return;}
+    double t0 = now_ns();
+    batch.Defuzzyfication(&inputs[0], n, &outputs[0]);
+    double t1 = now_ns();
+    float max_error = 0.0;
+    for (u_int i=0; i<n; i++)
+    {
+        float error = fabsf(outputs[i] - mySystem.Defuzzyfication(&inputs[2 * (size_t)i], 0));
+        max_error = (error > max_error) ? error : max_error;
+    }
+    cout << "FuzzyBatch::Defuzzyfication (6 rules, 2 inputs, " << batch.get_threads() << " threads, max error " << max_error << ")" << endl;
+    report("batch of 65536, per query", t1 - t0, n);
+}
+
+/* INSTANCES */
+// 4096 heaters with the rules of mySystem, each one with its own
+// thresholds, evaluated in one tick
+static void bench_instances(const vector<float>& xs)
+{
+    const u_int n = 4096;
+    vector<float> inputs(2 * (size_t)n);
+    vector<float> outputs(n);
+    vector<float> expected(n);
+    FuzzyInstances heaters;
+    if (!heaters.Instances_SetUp(&mySystem, n)) {return;}
+    for (u_int i=0; i<n; i++)
+    {
+        // Comfort band and medium heat of each heater moved by up to 5 and 1
+        float shift = 10.0F * xs[2 * n + i] / 100.0F - 5.0F;
+        inputs[2 * (size_t)i] = xs[i];
+        inputs[2 * (size_t)i + 1] = xs[n + i];
+        FramesInput[0].Set_SetUp(1, TRP_C, 10.0F + shift, 30.0F + shift, 50.0F + shift, 70.0F + shift);
+        FramesOutput[0].Set_SetUp(1, TRI, 2.5F, 5.0F + shift / 5.0F, 7.5F);
+        heaters.Instance_SetUp(i, &mySystem);
+        expected[i] = mySystem.Defuzzyfication(&inputs[2 * (size_t)i], 0);
+    }
+    setup();
+    double t0 = now_ns();
+    heaters.Defuzzyfication(&inputs[0], &outputs[0]);
+    double t1 = now_ns();
+    float max_error = 0.0;
+    for (u_int i=0; i<n; i++)
+    {
+        float error = fabsf(outputs[i] - expected[i]);
+        max_error = (error > max_error) ? error : max_error;
+    }
+    cout << "FuzzyInstances::Defuzzyfication (6 rules, 2 inputs, max error " << max_error << ")" << endl;
+    report("tick of 4096 instances, per instance", t1 - t0, n);
+}
+
+/* RULE BASE ON DISK */
+// 1000000 random rules over 8 inputs of 3 terms, written to a file and
+// evaluated from it by batches
+static void bench_store(void)
+{
+    const u_int n_inputs = 8;
+    const u_int n_rules = 1000000;
+    const char* path = "FuzzyBenchmark.fzr";
+    static FuzzySet in_sets[n_inputs][3];
+    static FuzzySet out_sets[5];
+    static FuzzyFrame in_frames[n_inputs];
+    static FuzzyFrame out_frames[1];
+    for (u_int i=0; i<n_inputs; i++)
+    {
+        in_frames[i].Frame_SetUp(in_sets[i], 3, 0.0, 100.0, INPUT);
+        in_frames[i].Partition_SetUp(10.0, 40.0, false);
+    }
+    out_frames[0].Frame_SetUp(out_sets, 5, 0.0, 10.0, OUTPUT);
+    out_frames[0].domainSetUp(0.0, 10.0, 0.1);
+    out_frames[0].Partition_SetUp(1.0, 2.0, false);
+
+    FuzzyRuleWriter writer;
+    if (!writer.Writer_SetUp(path, in_frames, n_inputs, out_frames, 1, 65536)) {return;}
+    uint32_t seed = 777;
+    u_int antecedent[n_inputs];
+    u_int consequent[1];
+    for (u_int r=0; r<n_rules; r++)
+    {
+        for (u_int i=0; i<n_inputs; i++)
+        {
+            seed = seed * 1664525U + 1013904223U;
+            antecedent[i] = (seed >> 8) % 3;
+        }
+        seed = seed * 1664525U + 1013904223U;
+        consequent[0] = (seed >> 8) % 5;
+        writer.Add_Rule(antecedent, consequent);
+    }
+    writer.Close();
+    cout << "Rule base on disk (" << n_rules << " rules, " << n_inputs << " inputs)" << endl;
+
+    const u_int max_batch = 1024;
+    vector<float> inputs(max_batch * n_inputs);
+    vector<float> outputs(max_batch);
+    for (u_int q=0; q<max_batch; q++)
+    {
+        for (u_int i=0; i<n_inputs; i++) {inputs[q*n_inputs + i] = xs_spread(q, i);}
+    }
+    const u_int batches[] = {1, 64, 1024};
+    for (u_int m=0; m<2; m++)
+    {
+        float first = 0.0F;
+        for (u_int k=0; k<3; k++)
+        {
+            FuzzyRuleStore store;
+            if (!store.Store_SetUp(path, in_frames, n_inputs, out_frames, 1, m == 1)) {break;}
+            double t0 = now_ns();
+            bool ok = store.Defuzzyfication(&inputs[0], batches[k], 0, &outputs[0]);
+            double t1 = now_ns();
+            if (k == 0) {first = outputs[0];}
+            char name[64];
+            snprintf(name, sizeof(name), "%s, batch of %u%s", (m == 1) ? "mmap" : "fread", batches[k], (ok && outputs[0] == first) ? "" : " (DIFFERENT)");
+            report(name, t1 - t0, batches[k]);
+            cout << "    bytes read per inference: " << setprecision(1) << store.get_bytes_per_inference()
+                 << ", inferences per second: " << (size_t)store.get_inferences_per_second() << endl;
+        }
+    }
+    remove(path);
+}
+
+int main()
+{
+    // Inputs spread over [0, 100] in a shuffled order
+    vector<float> xs(N_SAMPLES);
+    uint32_t seed = 12345;
+    for (u_int i=0; i<xs.size(); i++)
+    {
+        seed = seed * 1664525U + 1013904223U;
+        xs[i] = (float)(seed >> 8) * (100.0F / 16777216.0F);
+    }
+    setup();
+    setup_type2();
+
+    bench_membership(xs);
+    bench_smooth(xs);
+    bench_partition(xs);
+    bench_table(xs);
+    bench_system(xs);
+    bench_type2(xs);
+    bench_relation(xs);
+    bench_quantized(xs);
+    bench_cache(xs);
+    bench_parallel();
+    bench_index();
+    bench_minimize();
+    bench_train();
+    bench_tune();
+    bench_wang_mendel();
+    bench_cmeans();
+    bench_batch(xs);
+    bench_instances(xs);
+    bench_store();
+    return 0;
+}
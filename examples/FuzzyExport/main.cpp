@@ -0,0 +1,115 @@
+/***
+  * Export of the heater system of examples/FuzzyLogic2 as standalone C source,
+  * and round-trip check of the generated function against the library.
+  *
+  * 1. Built without FUZZY_GENERATED, it writes FuzzyHeater.c
+  * 2. Built with -DFUZZY_GENERATED, it includes FuzzyHeater.c and compares
+  *    heater_power() with FuzzySystem::Defuzzyfication over a grid of inputs
+***/
+
+#include <stdio.h>
+#include "FuzzyLogic.h"
+#include "FuzzyExport.h"
+
+#ifdef FUZZY_GENERATED
+#include "FuzzyHeater.c"
+#endif
+
+// Linguistic Value of Temperature
+#define COLD        0
+#define COOL        1
+#define HOT         2
+
+// Linguistic Value of Humidity
+#define DRY         0
+#define WET         1
+
+// Linguistic Variables of Inputs
+#define TEMP        0
+#define HUM         1
+
+// Linguistic Value of Output
+#define LOW         0
+#define MED         1
+#define HIGH        2
+
+FuzzySet Temperature[3];
+FuzzySet Humidity[2];
+FuzzySet Heat[3];
+FuzzyFrame FramesInput[2];
+FuzzyFrame FramesOutput[1];
+FuzzyRule myRule[6];
+u_int input_rules[6][2];
+u_int output_rules[6][1];
+FuzzySystem mySystem(myRule, 6);
+
+static void setup(void)
+{
+    FramesInput[TEMP].Frame_SetUp(Temperature, 3, 0.0, 100.0, INPUT);
+    FramesInput[HUM].Frame_SetUp(Humidity, 2, 0.0, 100.0, INPUT);
+    FramesInput[TEMP].Set_SetUp(COLD, TRP_L, 10.0, 30.0);
+    FramesInput[TEMP].Set_SetUp(COOL, TRP_C, 10.0, 30.0, 50.0, 70.0);
+    FramesInput[TEMP].Set_SetUp(HOT, TRP_R, 50.0, 70.0);
+    FramesInput[HUM].Set_SetUp(DRY, TRP_L, 30.0, 60.0);
+    FramesInput[HUM].Set_SetUp(WET, TRP_R, 30.0, 60.0);
+
+    FramesOutput[0].Frame_SetUp(Heat, 3, 0.0, 10.0, OUTPUT);
+    FramesOutput[0].Set_SetUp(LOW, TRP_L, 2.5, 5.0);
+    FramesOutput[0].Set_SetUp(MED, TRI, 2.5, 5.0, 7.5);
+    FramesOutput[0].Set_SetUp(HIGH, TRP_R, 5.0, 7.5);
+
+    u_int antecedent[6][2] = {{COLD, DRY}, {COLD, WET}, {COOL, DRY}, {COOL, WET}, {HOT, DRY}, {HOT, WET}};
+    u_int consequent[6] = {MED, HIGH, MED, HIGH, LOW, LOW};
+    for (u_int r=0; r<6; r++)
+    {
+        input_rules[r][TEMP] = antecedent[r][TEMP];
+        input_rules[r][HUM] = antecedent[r][HUM];
+        output_rules[r][0] = consequent[r];
+        myRule[r].Rule_SetUp(FramesInput, input_rules[r], 2, FramesOutput, output_rules[r], 1);
+    }
+}
+
+int main()
+{
+    setup();
+
+#ifndef FUZZY_GENERATED
+    FuzzyExporter exporter(&mySystem);
+    FILE* file = fopen("FuzzyHeater.c", "w");
+    bool done = (file != 0) && exporter.Export(file, "heater_power", 0);
+    if (file != 0) {fclose(file);}
+    if (!done)
+    {
+        printf("Export failed\n");
+        return 1;
+    }
+    printf("FuzzyHeater.c written: %u rules removed (%u dead, %u duplicate), %u output samples\n",
+           exporter.get_removed_rules(), exporter.get_dead_rules(), exporter.get_duplicate_rules(), exporter.get_samples());
+    return 0;
+#else
+    // Round trip, including inputs outside of the universe of discourse
+    float inputs[2];
+    float max_error = 0.0;
+    u_int count = 0;
+    for (float t = -20.0F; t <= 120.0F; t = t + 0.25F)
+    {
+        for (float h = -20.0F; h <= 120.0F; h = h + 0.25F)
+        {
+            inputs[TEMP] = t;
+            inputs[HUM] = h;
+            float error = heater_power(inputs) - mySystem.Defuzzyfication(inputs, 0);
+            if (error < 0.0F) {error = -error;}
+            if (error > max_error) {max_error = error;}
+            count++;
+        }
+    }
+    printf("%u inputs, maximum difference with the library: %g\n", count, max_error);
+    if (max_error > 1e-5F)
+    {
+        printf("FAILED\n");
+        return 1;
+    }
+    printf("PASSED\n");
+    return 0;
+#endif
+}
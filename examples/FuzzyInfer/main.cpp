@@ -0,0 +1,368 @@
+/***
+  * Streaming inference of a Fuzzy System read from a definition file
+  *
+  * Reads input vectors from a file or from the standard input, as CSV lines or
+  * as records of little endian floats, evaluates them by batches with
+  * FuzzyBatch and writes the crisp outputs in the same format. Build it from
+  * this folder with:
+  *
+  *    g++ -O3 -I../../src main.cpp ../../src/FuzzyLogic.cpp ../../src/FuzzyBuilder.cpp ../../src/FuzzyDefinition.cpp ../../src/FuzzyBatch.cpp ../../src/FuzzyPool.cpp -pthread -o FuzzyInfer
+***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <chrono>
+#include "FuzzyLogic.h"
+#include "FuzzyDefinition.h"
+#include "FuzzyBatch.h"
+#include "FuzzyCSV.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define INFER_HAS_MMAP
+#endif
+
+#define INFER_BLOCK_SIZE        (4 << 20)       // Bytes read at once when the input is not mapped
+#define INFER_TEXT_SIZE         (1 << 20)       // Bytes of CSV written at once
+
+struct Stream
+{
+    FuzzyBatch* batch;
+    u_int input_size, output_size;
+    size_t rows;                                // per batch
+    float* input;                               // rows of input_size values waiting for the batch
+    float* output;                              // rows of output_size values
+    size_t filled;
+    bool binary;
+    bool swap;                                  // the host is big endian
+    FILE* file;                                 // output
+    char* text;                                 // CSV not written yet
+    size_t text_used;
+    uint64_t line;                              // lines read
+    uint64_t total;                             // rows evaluated
+    uint64_t bytes;                             // bytes read
+};
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: FuzzyInfer [options] system.fzs [input]\n"
+            "  input        CSV lines or float records (default: standard input)\n"
+            "  -o path      output file (default: standard output)\n"
+            "  -f csv|bin   format of the input and of the output (default: csv)\n"
+            "  -H           the CSV input starts with a header line, a header is written\n"
+            "  -t threads   0: one per core (default: 0)\n"
+            "  -b rows      rows per batch (default: 65536)\n"
+            "  -v           statistics on the standard error\n");
+}
+
+static void swap_floats(float* values, size_t count)
+{
+    // Little endian records on a big endian host
+    uint8_t* b = (uint8_t*)values;
+    for (size_t k=0; k<count; k++, b += 4)
+    {
+        uint8_t t0 = b[0], t1 = b[1];
+        b[0] = b[3]; b[1] = b[2]; b[2] = t1; b[3] = t0;
+    }
+}
+
+static bool write_text(Stream* s, bool force)
+{
+    if (s->text_used == 0 || (!force && s->text_used < INFER_TEXT_SIZE / 2)) {return true;}
+    bool ok = (fwrite(s->text, 1, s->text_used, s->file) == s->text_used);
+    s->text_used = 0;
+    return ok;
+}
+
+static bool evaluate(Stream* s, const float* input, size_t rows)
+{
+    // One batch, written in the format of the input
+    s->batch->Defuzzyfication(input, rows, s->output);
+    s->total = s->total + rows;
+    size_t values = rows * s->output_size;
+    if (s->binary)
+    {
+        if (s->swap) {swap_floats(s->output, values);}
+        return fwrite(s->output, sizeof(float), values, s->file) == values;
+    }
+    for (size_t q=0; q<rows; q++)
+    {
+        // A row is at most output_size numbers of 16 characters
+        if (s->text_used + (size_t)s->output_size * 16 + 1 > INFER_TEXT_SIZE && !write_text(s, true)) {return false;}
+        for (u_int o=0; o<s->output_size; o++)
+        {
+            int n = snprintf(&s->text[s->text_used], 16, "%.9g", s->output[q * s->output_size + o]);
+            s->text_used = s->text_used + (size_t)n;
+            s->text[s->text_used++] = (o + 1 < s->output_size) ? ',' : '\n';
+        }
+    }
+    return write_text(s, false);
+}
+
+static bool parse_lines(Stream* s, const char* p, const char* end)
+{
+    // Complete lines of CSV into the rows of the batch
+    while (p < end)
+    {
+        const char* eol = (const char*)memchr(p, '\n', (size_t)(end - p));
+        if (eol == 0) {eol = end;}
+        s->line++;
+        const char* q = p;
+        while (q < eol && (*q == ' ' || *q == '\t' || *q == '\r')) {q++;}
+        if (q < eol)
+        {
+            int n = csv_parse_line(p, eol, &s->input[s->filled * s->input_size], s->input_size);
+            if (n != (int)s->input_size)
+            {
+                fprintf(stderr, "line %llu: %u numbers expected\n", (unsigned long long)s->line, s->input_size);
+                return false;
+            }
+            if (++s->filled == s->rows)
+            {
+                if (!evaluate(s, s->input, s->filled)) {return false;}
+                s->filled = 0;
+            }
+        }
+        p = eol + 1;
+    }
+    return true;
+}
+
+#ifdef INFER_HAS_MMAP
+static const char* map_file(FILE* in, size_t* size)
+{
+    // The whole input when it is a regular file, 0 for a pipe or a terminal
+    struct stat info;
+    if (fstat(fileno(in), &info) != 0 || !S_ISREG(info.st_mode) || info.st_size <= 0) {return 0;}
+    void* address = mmap(0, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fileno(in), 0);
+    if (address == MAP_FAILED) {return 0;}
+    madvise(address, (size_t)info.st_size, MADV_SEQUENTIAL);
+    *size = (size_t)info.st_size;
+    return (const char*)address;
+}
+#endif
+
+static bool read_csv(Stream* s, FILE* in, bool header)
+{
+#ifdef INFER_HAS_MMAP
+    size_t size = 0;
+    const char* map = map_file(in, &size);
+    if (map != 0)
+    {
+        // Parsed in place
+        const char* p = map;
+        const char* end = map + size;
+        if (header)
+        {
+            const char* eol = (const char*)memchr(p, '\n', size);
+            p = (eol != 0) ? eol + 1 : end;
+            s->line++;
+        }
+        bool ok = parse_lines(s, p, end);
+        munmap((void*)map, size);
+        s->bytes = size;
+        return ok;
+    }
+#endif
+    char* block = (char*)malloc(INFER_BLOCK_SIZE);
+    if (block == 0) {return false;}
+    size_t kept = 0;                    // bytes of an unfinished line at the beginning of the block
+    bool skip = header;                 // the text up to the next '\n' is skipped
+    bool ok = true;
+    while (ok)
+    {
+        size_t n = fread(block + kept, 1, INFER_BLOCK_SIZE - kept, in);
+        s->bytes = s->bytes + n;
+        size_t total = kept + n;
+        if (total == 0) {break;}
+        size_t start = 0;
+        if (skip)
+        {
+            const char* eol = (const char*)memchr(block, '\n', total);
+            if (eol == 0)
+            {
+                kept = 0;
+                if (n == 0) {break;}
+                continue;
+            }
+            start = (size_t)(eol - block) + 1;
+            s->line++;
+            skip = false;
+        }
+        size_t end = total;
+        if (n > 0)
+        {
+            // More may follow: stop after the last complete line
+            while (end > start && block[end - 1] != '\n') {end--;}
+            if (end == start && total == INFER_BLOCK_SIZE)
+            {
+                fprintf(stderr, "line %llu: longer than %u bytes\n", (unsigned long long)s->line + 1, (u_int)INFER_BLOCK_SIZE);
+                ok = false;
+                break;
+            }
+        }
+        ok = parse_lines(s, block + start, block + end);
+        kept = total - end;
+        memmove(block, block + end, kept);
+        if (n == 0) {break;}
+    }
+    free(block);
+    return ok && !ferror(in);
+}
+
+static bool read_binary(Stream* s, FILE* in)
+{
+    size_t record = (size_t)s->input_size * sizeof(float);
+#ifdef INFER_HAS_MMAP
+    size_t size = 0;
+    const char* map = s->swap ? 0 : map_file(in, &size);
+    if (map != 0)
+    {
+        // Evaluated in place, the records are aligned in the mapping. As when
+        // reading, the complete records are evaluated before a truncated one
+        // is reported
+        bool ok = true;
+        size_t records = size / record;
+        for (size_t q=0; q<records && ok; q += s->rows)
+        {
+            size_t n = (records - q < s->rows) ? records - q : s->rows;
+            ok = evaluate(s, (const float*)(map + q * record), n);
+        }
+        munmap((void*)map, size);
+        s->bytes = size;
+        if (!ok) {return false;}
+        if (size % record != 0) {fprintf(stderr, "truncated record at the end of the input\n");}
+        return size % record == 0;
+    }
+#endif
+    size_t capacity = s->rows * record;
+    size_t kept = 0;                    // bytes of an unfinished record
+    for (;;)
+    {
+        size_t n = fread((char*)s->input + kept, 1, capacity - kept, in);
+        s->bytes = s->bytes + n;
+        size_t total = kept + n;
+        size_t records = total / record;
+        if (records > 0)
+        {
+            if (s->swap) {swap_floats(s->input, records * s->input_size);}
+            if (!evaluate(s, s->input, records)) {return false;}
+        }
+        kept = total - records * record;
+        memmove(s->input, (char*)s->input + records * record, kept);
+        if (n == 0) {break;}
+    }
+    if (kept != 0) {fprintf(stderr, "truncated record at the end of the input\n");}
+    return kept == 0 && !ferror(in);
+}
+
+int main(int argc, char** argv)
+{
+    const char* definition_path = 0;
+    const char* input_path = 0;
+    const char* output_path = 0;
+    bool binary = false, header = false, verbose = false;
+    u_int threads = 0;
+    size_t rows = 65536;
+    for (int a=1; a<argc; a++)
+    {
+        const char* arg = argv[a];
+        bool has_value = (a + 1 < argc);
+        if (strcmp(arg, "-o") == 0 && has_value)        {output_path = argv[++a];}
+        else if (strcmp(arg, "-f") == 0 && has_value)   {binary = (strcmp(argv[++a], "bin") == 0); if (!binary && strcmp(argv[a], "csv") != 0) {usage(); return 2;}}
+        else if (strcmp(arg, "-t") == 0 && has_value)   {threads = (u_int)strtoul(argv[++a], 0, 10);}
+        else if (strcmp(arg, "-b") == 0 && has_value)   {rows = (size_t)strtoul(argv[++a], 0, 10);}
+        else if (strcmp(arg, "-H") == 0)                {header = true;}
+        else if (strcmp(arg, "-v") == 0)                {verbose = true;}
+        else if (arg[0] == '-' && arg[1] != 0)          {usage(); return 2;}
+        else if (definition_path == 0)                  {definition_path = arg;}
+        else if (input_path == 0)                       {input_path = arg;}
+        else                                            {usage(); return 2;}
+    }
+    if (definition_path == 0 || rows == 0)
+    {
+        usage();
+        return 2;
+    }
+
+    FuzzyDefinition definition;
+    if (!definition.Load(definition_path))
+    {
+        fprintf(stderr, "%s:%u: %s\n", definition_path, definition.get_error_line(), definition.get_error());
+        return 1;
+    }
+    FuzzyBatch batch;
+    if (!batch.Batch_SetUp(&definition.get_model()->system(), threads))
+    {
+        fprintf(stderr, "%s: the system can not be evaluated by batches\n", definition_path);
+        return 1;
+    }
+
+    FILE* in = (input_path == 0 || strcmp(input_path, "-") == 0) ? stdin : fopen(input_path, "rb");
+    if (in == 0)
+    {
+        fprintf(stderr, "can not open %s\n", input_path);
+        return 1;
+    }
+    FILE* out = (output_path == 0) ? stdout : fopen(output_path, "wb");
+    if (out == 0)
+    {
+        fprintf(stderr, "can not create %s\n", output_path);
+        return 1;
+    }
+
+    Stream s;
+    uint32_t one = 1;
+    s.batch = &batch;
+    s.input_size = batch.get_input_size();
+    s.output_size = batch.get_output_size();
+    s.rows = rows;
+    s.input = (float*)malloc(rows * s.input_size * sizeof(float));
+    s.output = (float*)malloc(rows * s.output_size * sizeof(float));
+    s.text = (char*)malloc(INFER_TEXT_SIZE);
+    s.filled = 0;
+    s.binary = binary;
+    s.swap = (*(uint8_t*)&one == 0);
+    s.file = out;
+    s.text_used = 0;
+    s.line = 0;
+    s.total = 0;
+    s.bytes = 0;
+    if (s.input == 0 || s.output == 0 || s.text == 0)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    bool ok = true;
+    if (binary) {ok = read_binary(&s, in);}
+    else
+    {
+        if (header)
+        {
+            for (u_int o=0; o<s.output_size; o++) {fprintf(out, "%s%c", definition.get_output_name(o), (o + 1 < s.output_size) ? ',' : '\n');}
+        }
+        ok = read_csv(&s, in, header);
+        if (ok && s.filled > 0) {ok = evaluate(&s, s.input, s.filled);}
+        ok = write_text(&s, true) && ok;
+    }
+    ok = (fflush(out) == 0) && ok;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (verbose)
+    {
+        fprintf(stderr, "%llu rows, %u threads, %.3f s, %.0f rows/s, %.1f MB/s\n", (unsigned long long)s.total, batch.get_threads(),
+                seconds, s.total / seconds, s.bytes / seconds * 1e-6);
+    }
+
+    free(s.input);
+    free(s.output);
+    free(s.text);
+    if (in != stdin) {fclose(in);}
+    if (out != stdout) {ok = (fclose(out) == 0) && ok;}
+    return ok ? 0 : 1;
+}
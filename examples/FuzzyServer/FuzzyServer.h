@@ -0,0 +1,137 @@
+/***
+  * Protocol of FuzzyServer and the latency histogram of the server and of the
+  * load generator.
+  *
+  * The socket is local (AF_UNIX), so every field is in the byte order of the
+  * host. On connection the server sends a ServerHello, then the input_size
+  * pairs (low, high) of the universes of discourse of the inputs as floats.
+  * Then the client sends requests and the server answers them in order:
+  *
+  *    SERVER_INFER : RequestHeader, input_size floats
+  *                   -> ResponseHeader, output_size floats
+  *    SERVER_STATS : RequestHeader
+  *                   -> ResponseHeader, uint32_t length, length bytes of text
+  *
+  * A request of an unknown operation is answered with SERVER_ERROR and the
+  * connection is closed. The sizes do not change while a connection is open:
+  * the server only reloads a system with the same inputs and outputs.
+***/
+
+#ifndef FUZZYSERVER_H_
+#define FUZZYSERVER_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define SERVER_MAGIC            0x56535A46U     // "FZSV"
+#define SERVER_VERSION          1
+
+#define SERVER_INFER            0
+#define SERVER_STATS            1
+
+#define SERVER_OK               0
+#define SERVER_ERROR            1
+
+struct ServerHello
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t input_size;
+    uint32_t output_size;
+};
+
+struct RequestHeader
+{
+    uint32_t id;                                // given back in the response
+    uint32_t op;
+};
+
+struct ResponseHeader
+{
+    uint32_t id;
+    uint32_t status;
+};
+
+#define HISTOGRAM_BUCKETS       256             // 4 per power of 2 of nanoseconds
+
+class LatencyHistogram
+{
+private:
+    uint64_t _buckets[HISTOGRAM_BUCKETS];
+    uint64_t _count, _sum, _max;
+
+    static unsigned int bucket(uint64_t ns)
+    {
+        // Below 4 ns one bucket per value, then the power of 2 and the 2
+        // bits after the leading one
+        if (ns < 4) {return (unsigned int)ns;}
+        unsigned int e = 63 - (unsigned int)__builtin_clzll(ns);
+        return 4 * (e - 1) + (unsigned int)((ns >> (e - 2)) & 3);
+    }
+    static uint64_t upper(unsigned int b)
+    {
+        // Highest value of a bucket
+        if (b < 4) {return b;}
+        unsigned int e = b / 4 + 1;
+        return ((uint64_t)(4 + b % 4 + 1) << (e - 2)) - 1;
+    }
+public:
+    LatencyHistogram() {this->Clear();}
+
+    void Clear(void)
+    {
+        for (unsigned int b=0; b<HISTOGRAM_BUCKETS; b++) {this->_buckets[b] = 0;}
+        this->_count = 0;
+        this->_sum = 0;
+        this->_max = 0;
+    }
+    void Record(uint64_t ns)
+    {
+        this->_buckets[bucket(ns)]++;
+        this->_count++;
+        this->_sum = this->_sum + ns;
+        this->_max = (ns > this->_max) ? ns : this->_max;
+    }
+    void Merge(const LatencyHistogram& other)
+    {
+        for (unsigned int b=0; b<HISTOGRAM_BUCKETS; b++) {this->_buckets[b] = this->_buckets[b] + other._buckets[b];}
+        this->_count = this->_count + other._count;
+        this->_sum = this->_sum + other._sum;
+        this->_max = (other._max > this->_max) ? other._max : this->_max;
+    }
+    // Upper bound of the bucket of the q-th quantile (0 < q <= 1), within 25%
+    uint64_t Percentile(double q)
+    {
+        if (this->_count == 0) {return 0;}
+        uint64_t rank = (uint64_t)(q * (double)this->_count + 0.5);
+        rank = (rank == 0) ? 1 : rank;
+        uint64_t seen = 0;
+        for (unsigned int b=0; b<HISTOGRAM_BUCKETS; b++)
+        {
+            seen = seen + this->_buckets[b];
+            if (seen >= rank) {return (upper(b) < this->_max) ? upper(b) : this->_max;}
+        }
+        return this->_max;
+    }
+    // Percentiles, then one line per bucket that is not empty; returns the
+    // length as snprintf
+    int Print(char* text, size_t size, const char* title)
+    {
+        int n = snprintf(text, size, "%s: %llu, mean %.1f us, p50 %.1f us, p90 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us\n",
+                         title, (unsigned long long)this->_count, this->_count ? this->_sum * 1e-3 / this->_count : 0.0,
+                         this->Percentile(0.5) * 1e-3, this->Percentile(0.9) * 1e-3, this->Percentile(0.99) * 1e-3,
+                         this->Percentile(0.999) * 1e-3, this->_max * 1e-3);
+        for (unsigned int b=0; b<HISTOGRAM_BUCKETS; b++)
+        {
+            if (this->_buckets[b] == 0) {continue;}
+            size_t used = (n > 0 && (size_t)n < size) ? (size_t)n : size;
+            n = n + snprintf(text + used, size - used, "  <= %10.1f us %12llu\n", upper(b) * 1e-3, (unsigned long long)this->_buckets[b]);
+        }
+        return n;
+    }
+
+    uint64_t get_count(void) {return this->_count;}
+    uint64_t get_max(void) {return this->_max;}
+};
+
+#endif // FUZZYSERVER_H_
@@ -0,0 +1,242 @@
+/***
+  * Load generator of FuzzyServer
+  *
+  * Opens several connections to the server, each one on its own thread with a
+  * number of requests in flight, sends random inputs within the universes of
+  * discourse given by the server and measures the round trip of every request.
+  * At the end it prints the round trips and the statistics of the server.
+***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "FuzzyServer.h"
+
+#define LOAD_MAX_CONNECTIONS    256
+
+struct Client
+{
+    const char* path;
+    uint32_t requests;                          // to send
+    uint32_t depth;                             // in flight
+    uint32_t seed;
+    LatencyHistogram round_trip;
+    uint64_t done;
+    bool failed;
+};
+
+static uint64_t now_ns(void)
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int connect_to(const char* path)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+static bool read_all(int fd, void* data, size_t size)
+{
+    char* p = (char*)data;
+    while (size > 0)
+    {
+        ssize_t n = recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR) {continue;}
+        if (n <= 0) {return false;}
+        p = p + n;
+        size = size - (size_t)n;
+    }
+    return true;
+}
+
+static bool write_all(int fd, const void* data, size_t size)
+{
+    const char* p = (const char*)data;
+    while (size > 0)
+    {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {continue;}
+        if (n <= 0) {return false;}
+        p = p + n;
+        size = size - (size_t)n;
+    }
+    return true;
+}
+
+static bool read_hello(int fd, ServerHello* hello, std::vector<float>& domains)
+{
+    if (!read_all(fd, hello, sizeof(*hello)) || hello->magic != SERVER_MAGIC || hello->version != SERVER_VERSION) {return false;}
+    domains.resize((size_t)hello->input_size * 2);
+    return read_all(fd, &domains[0], domains.size() * sizeof(float));
+}
+
+static void run_client(Client* client)
+{
+    client->failed = true;
+    client->done = 0;
+    int fd = connect_to(client->path);
+    if (fd < 0) {return;}
+    ServerHello hello;
+    std::vector<float> domains;
+    if (!read_hello(fd, &hello, domains))
+    {
+        close(fd);
+        return;
+    }
+    size_t request_size = sizeof(RequestHeader) + hello.input_size * sizeof(float);
+    size_t response_size = sizeof(ResponseHeader) + hello.output_size * sizeof(float);
+    std::vector<char> requests(request_size * client->depth);
+    std::vector<char> responses(response_size * client->depth);
+    std::vector<uint64_t> sent(client->depth);
+    uint32_t seed = client->seed;
+    uint32_t next = 0;                          // id of the next request
+    uint32_t expected = 0;                      // id of the next response
+
+    bool ok = true;
+    while (ok && expected < client->requests)
+    {
+        // Fill the window of requests in flight, in one write
+        size_t bytes = 0;
+        uint64_t now = now_ns();
+        while (next < client->requests && next - expected < client->depth)
+        {
+            RequestHeader header = {next, SERVER_INFER};
+            char* p = &requests[bytes];
+            memcpy(p, &header, sizeof(header));
+            for (uint32_t i=0; i<hello.input_size; i++)
+            {
+                seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+                float x = domains[2 * i] + (seed >> 8) * (1.0F / 16777216.0F) * (domains[2 * i + 1] - domains[2 * i]);
+                memcpy(p + sizeof(header) + i * sizeof(float), &x, sizeof(float));
+            }
+            sent[next % client->depth] = now;
+            bytes = bytes + request_size;
+            next++;
+        }
+        if (bytes > 0) {ok = write_all(fd, &requests[0], bytes);}
+
+        // Then take what has arrived, at least one response
+        ok = ok && read_all(fd, &responses[0], response_size);
+        size_t received = response_size;
+        if (ok)
+        {
+            ssize_t n = recv(fd, &responses[received], responses.size() - received, MSG_DONTWAIT);
+            if (n > 0) {received = received + (size_t)n;}
+            size_t rest = received % response_size;
+            if (rest != 0) {ok = read_all(fd, &responses[received], response_size - rest); received = received + response_size - rest;}
+        }
+        now = now_ns();
+        for (size_t k=0; ok && k<received / response_size; k++)
+        {
+            ResponseHeader header;
+            memcpy(&header, &responses[k * response_size], sizeof(header));
+            if (header.id != expected || header.status != SERVER_OK) {ok = false; break;}
+            client->round_trip.Record(now - sent[expected % client->depth]);
+            expected++;
+        }
+    }
+    close(fd);
+    client->done = expected;
+    client->failed = !ok;
+}
+
+static bool print_server_stats(const char* path)
+{
+    int fd = connect_to(path);
+    if (fd < 0) {return false;}
+    ServerHello hello;
+    std::vector<float> domains;
+    RequestHeader request = {0, SERVER_STATS};
+    ResponseHeader response;
+    uint32_t length = 0;
+    bool ok = read_hello(fd, &hello, domains) && write_all(fd, &request, sizeof(request))
+           && read_all(fd, &response, sizeof(response)) && response.status == SERVER_OK && read_all(fd, &length, sizeof(length));
+    std::vector<char> text(length + 1, 0);
+    ok = ok && read_all(fd, &text[0], length);
+    close(fd);
+    if (ok) {printf("server %s", &text[0]);}
+    return ok;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: FuzzyServerLoad [options] socket\n"
+            "  -c connections  (default: 4)\n"
+            "  -d depth        requests in flight per connection (default: 16)\n"
+            "  -n requests     per connection (default: 100000)\n");
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = 0;
+    unsigned int connections = 4;
+    uint32_t depth = 16;
+    uint32_t requests = 100000;
+    for (int a=1; a<argc; a++)
+    {
+        const char* arg = argv[a];
+        bool has_value = (a + 1 < argc);
+        if (strcmp(arg, "-c") == 0 && has_value)        {connections = (unsigned int)strtoul(argv[++a], 0, 10);}
+        else if (strcmp(arg, "-d") == 0 && has_value)   {depth = (uint32_t)strtoul(argv[++a], 0, 10);}
+        else if (strcmp(arg, "-n") == 0 && has_value)   {requests = (uint32_t)strtoul(argv[++a], 0, 10);}
+        else if (arg[0] == '-')                         {usage(); return 2;}
+        else if (path == 0)                             {path = arg;}
+        else                                            {usage(); return 2;}
+    }
+    if (path == 0 || connections == 0 || connections > LOAD_MAX_CONNECTIONS || depth == 0)
+    {
+        usage();
+        return 2;
+    }
+
+    static Client clients[LOAD_MAX_CONNECTIONS];
+    std::thread threads[LOAD_MAX_CONNECTIONS];
+    uint64_t t0 = now_ns();
+    for (unsigned int k=0; k<connections; k++)
+    {
+        clients[k].path = path;
+        clients[k].requests = requests;
+        clients[k].depth = depth;
+        clients[k].seed = 2463534242U + k * 7919U;
+        threads[k] = std::thread(run_client, &clients[k]);
+    }
+    LatencyHistogram total;
+    uint64_t done = 0;
+    unsigned int failed = 0;
+    for (unsigned int k=0; k<connections; k++)
+    {
+        threads[k].join();
+        total.Merge(clients[k].round_trip);
+        done = done + clients[k].done;
+        failed = failed + (clients[k].failed ? 1 : 0);
+    }
+    double seconds = (now_ns() - t0) * 1e-9;
+
+    static char text[32 << 10];
+    printf("%u connections, %u in flight each: %llu requests in %.3f s, %.0f requests/s, %u connections failed\n",
+           connections, depth, (unsigned long long)done, seconds, done / seconds, failed);
+    total.Print(text, sizeof(text), "round trip");
+    fputs(text, stdout);
+    if (!print_server_stats(path)) {printf("no statistics from the server\n");}
+    return (failed == 0) ? 0 : 1;
+}
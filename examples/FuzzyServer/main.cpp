@@ -0,0 +1,579 @@
+/***
+  * Local inference server of a Fuzzy System over a Unix domain socket
+  *
+  * Loads a system from a definition file (see src/FuzzyDefinition.h) and
+  * answers fixed size binary requests (see FuzzyServer.h) with one epoll loop.
+  * The requests that arrive together, from every client, are evaluated as one
+  * batch by FuzzyBatch; with -w the server also waits up to that many
+  * microseconds for more requests once one is pending. SIGHUP reloads the
+  * definition file without dropping the clients, SIGINT and SIGTERM stop the
+  * server. Linux only. Build it from this folder with:
+  *
+  *    g++ -O3 -I../../src main.cpp ../../src/FuzzyLogic.cpp ../../src/FuzzyBuilder.cpp ../../src/FuzzyDefinition.cpp ../../src/FuzzyBatch.cpp ../../src/FuzzyPool.cpp -pthread -o FuzzyServer
+  *    g++ -O3 -I../../src load.cpp -pthread -o FuzzyServerLoad
+***/
+
+#ifndef __linux__
+#error "FuzzyServer needs Linux (epoll and signalfd)"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <chrono>
+#include "FuzzyLogic.h"
+#include "FuzzyDefinition.h"
+#include "FuzzyBatch.h"
+#include "FuzzyServer.h"
+
+#ifndef SERVER_MAX_CONNECTIONS
+#define SERVER_MAX_CONNECTIONS  1024
+#endif
+
+#define SERVER_INPUT_SIZE       (64 << 10)      // Bytes of requests read at once from a client
+#define SERVER_OUTPUT_LIMIT     (1 << 20)       // Bytes of responses not yet read by a client before it is not read anymore
+#define SERVER_STATS_SIZE       (32 << 10)      // Bytes of the text of SERVER_STATS
+#define LISTEN_SLOT             SERVER_MAX_CONNECTIONS
+#define SIGNAL_SLOT             (SERVER_MAX_CONNECTIONS + 1)
+#define TIMER_SLOT              (SERVER_MAX_CONNECTIONS + 2)
+
+struct Connection
+{
+    int fd;                                     // -1 if the slot is free
+    uint32_t generation;                        // changes when the slot is reused
+    char* input;                                // SERVER_INPUT_SIZE bytes
+    size_t input_used;
+    char* output;
+    size_t output_used, output_sent, output_capacity;
+    bool writing;                               // waits for EPOLLOUT
+    bool reading;                               // waits for EPOLLIN
+    bool touched;                               // has responses of the current batch
+};
+
+// A request of the pending batch
+struct Pending
+{
+    u_int slot;
+    uint32_t generation;
+    uint32_t id;
+    uint64_t arrival;                           // ns
+};
+
+struct Server
+{
+    int epoll, listener, signals, timer;
+    Connection connections[SERVER_MAX_CONNECTIONS];
+    u_int open, peak;
+
+    // The system and the spare one for reloading
+    const char* path;
+    u_int threads;
+    FuzzyDefinition definitions[2];
+    FuzzyBatch engines[2];
+    u_int current;
+    u_int input_size, output_size;
+    float* domains;                             // low and high of every input
+    size_t request_size, response_size;
+
+    // The pending batch
+    size_t max_batch;
+    uint64_t window;                            // ns to wait for more requests
+    float* inputs;
+    float* outputs;
+    Pending* pending;
+    size_t count;
+    uint64_t deadline;                          // ns
+
+    // Statistics
+    LatencyHistogram latency;                   // from the read of a request to the write of its response
+    LatencyHistogram batch_time;                // of FuzzyBatch::Defuzzyfication
+    uint64_t requests, batches, max_count, reloads, failed_reloads;
+    char* stats;
+};
+
+static uint64_t now_ns(void)
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void watch(Server* s, u_int slot)
+{
+    Connection* c = &s->connections[slot];
+    struct epoll_event event;
+    event.events = (c->reading ? (uint32_t)EPOLLIN : 0U) | (c->writing ? (uint32_t)EPOLLOUT : 0U);
+    event.data.u32 = slot;
+    epoll_ctl(s->epoll, EPOLL_CTL_MOD, c->fd, &event);
+}
+
+static void close_connection(Server* s, u_int slot)
+{
+    // Responses of pending requests of this slot are dropped by the generation
+    Connection* c = &s->connections[slot];
+    epoll_ctl(s->epoll, EPOLL_CTL_DEL, c->fd, 0);
+    close(c->fd);
+    c->fd = -1;
+    c->generation++;
+    c->input_used = 0;
+    c->output_used = 0;
+    c->output_sent = 0;
+    s->open--;
+}
+
+static bool reserve(Connection* c, size_t bytes)
+{
+    if (c->output_used + bytes <= c->output_capacity) {return true;}
+    size_t capacity = c->output_capacity * 2;
+    while (capacity < c->output_used + bytes) {capacity = capacity * 2;}
+    char* output = (char*)realloc(c->output, capacity);
+    if (output == 0) {return false;}
+    c->output = output;
+    c->output_capacity = capacity;
+    return true;
+}
+
+static bool send_output(Server* s, u_int slot)
+{
+    // Writes what the socket takes; returns false if the connection is closed
+    Connection* c = &s->connections[slot];
+    while (c->output_sent < c->output_used)
+    {
+        ssize_t n = send(c->fd, c->output + c->output_sent, c->output_used - c->output_sent, MSG_NOSIGNAL);
+        if (n > 0) {c->output_sent = c->output_sent + (size_t)n; continue;}
+        if (n < 0 && errno == EINTR) {continue;}
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {break;}
+        close_connection(s, slot);
+        return false;
+    }
+    if (c->output_sent == c->output_used)
+    {
+        c->output_sent = 0;
+        c->output_used = 0;
+    }
+    bool writing = (c->output_used > 0);
+    bool reading = (c->output_used - c->output_sent < SERVER_OUTPUT_LIMIT);
+    if (writing != c->writing || reading != c->reading)
+    {
+        c->writing = writing;
+        c->reading = reading;
+        watch(s, slot);
+    }
+    return true;
+}
+
+static void arm_timer(Server* s, uint64_t deadline)
+{
+    // The timerfd wakes the loop at the end of the window (steady_clock is CLOCK_MONOTONIC)
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = (time_t)(deadline / 1000000000);
+    spec.it_value.tv_nsec = (long)(deadline % 1000000000);
+    timerfd_settime(s->timer, TFD_TIMER_ABSTIME, &spec, 0);
+    s->deadline = deadline;
+}
+
+static void run_batch(Server* s)
+{
+    // The pending requests as one batch, then the responses to every client
+    if (s->count == 0) {return;}
+    FuzzyBatch* batch = &s->engines[s->current];
+    uint64_t t0 = now_ns();
+    batch->Defuzzyfication(s->inputs, s->count, s->outputs);
+    uint64_t t1 = now_ns();
+    s->batch_time.Record(t1 - t0);
+    s->batches++;
+    s->max_count = (s->count > s->max_count) ? s->count : s->max_count;
+
+    u_int touched[SERVER_MAX_CONNECTIONS];
+    u_int n_touched = 0;
+    for (size_t q=0; q<s->count; q++)
+    {
+        const Pending* p = &s->pending[q];
+        Connection* c = &s->connections[p->slot];
+        if (c->fd < 0 || c->generation != p->generation) {continue;}
+        if (!reserve(c, s->response_size)) {continue;}
+        ResponseHeader header = {p->id, SERVER_OK};
+        memcpy(c->output + c->output_used, &header, sizeof(header));
+        memcpy(c->output + c->output_used + sizeof(header), &s->outputs[q * s->output_size], s->output_size * sizeof(float));
+        c->output_used = c->output_used + s->response_size;
+        if (!c->touched)
+        {
+            c->touched = true;
+            touched[n_touched++] = p->slot;
+        }
+    }
+    for (u_int k=0; k<n_touched; k++)
+    {
+        s->connections[touched[k]].touched = false;
+        send_output(s, touched[k]);
+    }
+    uint64_t t2 = now_ns();
+    for (size_t q=0; q<s->count; q++) {s->latency.Record(t2 - s->pending[q].arrival);}
+    s->count = 0;
+}
+
+static int print_stats(Server* s, char* text, size_t size)
+{
+    int n = snprintf(text, size, "requests %llu, batches %llu, mean batch %.1f, max batch %llu, connections %u (peak %u), reloads %llu (%llu failed)\n",
+                     (unsigned long long)s->requests, (unsigned long long)s->batches, s->batches ? (double)s->requests / s->batches : 0.0,
+                     (unsigned long long)s->max_count, s->open, s->peak, (unsigned long long)s->reloads, (unsigned long long)s->failed_reloads);
+    if (n < 0 || (size_t)n >= size) {return n;}
+    n = n + s->latency.Print(text + n, size - (size_t)n, "latency");
+    if ((size_t)n >= size) {return n;}
+    return n + s->batch_time.Print(text + n, size - (size_t)n, "batch time");
+}
+
+static bool read_requests(Server* s, u_int slot)
+{
+    // Reads and parses what has arrived; returns false if the connection is closed
+    Connection* c = &s->connections[slot];
+    while (c->reading)
+    {
+        ssize_t n = recv(c->fd, c->input + c->input_used, SERVER_INPUT_SIZE - c->input_used, 0);
+        if (n < 0 && errno == EINTR) {continue;}
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {break;}
+        if (n <= 0)
+        {
+            close_connection(s, slot);
+            return false;
+        }
+        c->input_used = c->input_used + (size_t)n;
+        uint64_t arrival = now_ns();
+
+        size_t start = 0;
+        while (c->input_used - start >= sizeof(RequestHeader))
+        {
+            RequestHeader header;
+            memcpy(&header, c->input + start, sizeof(header));
+            if (header.op == SERVER_INFER)
+            {
+                if (c->input_used - start < s->request_size) {break;}
+                if (s->count == 0 && s->window > 0) {arm_timer(s, arrival + s->window);}
+                Pending* p = &s->pending[s->count];
+                p->slot = slot;
+                p->generation = c->generation;
+                p->id = header.id;
+                p->arrival = arrival;
+                memcpy(&s->inputs[s->count * s->input_size], c->input + start + sizeof(header), s->input_size * sizeof(float));
+                start = start + s->request_size;
+                s->requests++;
+                if (++s->count == s->max_batch) {run_batch(s);}
+                if (c->fd < 0) {return false;}
+            }
+            else if (header.op == SERVER_STATS)
+            {
+                // Answered after the pending requests, in order
+                run_batch(s);
+                if (c->fd < 0) {return false;}
+                int length = print_stats(s, s->stats, SERVER_STATS_SIZE);
+                uint32_t size = (length < 0) ? 0 : ((size_t)length >= SERVER_STATS_SIZE ? SERVER_STATS_SIZE - 1 : (uint32_t)length);
+                ResponseHeader response = {header.id, SERVER_OK};
+                if (!reserve(c, sizeof(response) + sizeof(size) + size))
+                {
+                    // The requests before are queued already: they must not be
+                    // parsed again, the connection is dropped with them
+                    close_connection(s, slot);
+                    return false;
+                }
+                memcpy(c->output + c->output_used, &response, sizeof(response));
+                memcpy(c->output + c->output_used + sizeof(response), &size, sizeof(size));
+                memcpy(c->output + c->output_used + sizeof(response) + sizeof(size), s->stats, size);
+                c->output_used = c->output_used + sizeof(response) + sizeof(size) + size;
+                start = start + sizeof(header);
+            }
+            else
+            {
+                run_batch(s);
+                if (c->fd < 0) {return false;}
+                ResponseHeader response = {header.id, SERVER_ERROR};
+                if (reserve(c, sizeof(response)))
+                {
+                    memcpy(c->output + c->output_used, &response, sizeof(response));
+                    c->output_used = c->output_used + sizeof(response);
+                }
+                send_output(s, slot);
+                if (c->fd >= 0) {close_connection(s, slot);}
+                return false;
+            }
+        }
+        c->input_used = c->input_used - start;
+        memmove(c->input, c->input + start, c->input_used);
+        if (c->output_used > 0 && !send_output(s, slot)) {return false;}
+    }
+    return true;
+}
+
+static void accept_connections(Server* s)
+{
+    for (;;)
+    {
+        int fd = accept4(s->listener, 0, 0, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {return;}
+        u_int slot = 0;
+        while (slot < SERVER_MAX_CONNECTIONS && s->connections[slot].fd >= 0) {slot++;}
+        if (slot == SERVER_MAX_CONNECTIONS)
+        {
+            close(fd);
+            continue;
+        }
+        Connection* c = &s->connections[slot];
+        c->fd = fd;
+        c->input_used = 0;
+        c->output_used = 0;
+        c->output_sent = 0;
+        c->reading = true;
+        c->writing = false;
+        c->touched = false;
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u32 = slot;
+        epoll_ctl(s->epoll, EPOLL_CTL_ADD, fd, &event);
+        s->open++;
+        s->peak = (s->open > s->peak) ? s->open : s->peak;
+
+        ServerHello hello = {SERVER_MAGIC, SERVER_VERSION, s->input_size, s->output_size};
+        size_t domains = (size_t)s->input_size * 2 * sizeof(float);
+        if (!reserve(c, sizeof(hello) + domains))
+        {
+            close_connection(s, slot);
+            continue;
+        }
+        memcpy(c->output, &hello, sizeof(hello));
+        memcpy(c->output + sizeof(hello), s->domains, domains);
+        c->output_used = sizeof(hello) + domains;
+        send_output(s, slot);
+    }
+}
+
+static bool load(Server* s, u_int which)
+{
+    // Definition and batch engine of the slot which; the sizes must not change
+    // once clients are connected
+    FuzzyDefinition* definition = &s->definitions[which];
+    if (!definition->Load(s->path))
+    {
+        fprintf(stderr, "%s:%u: %s\n", s->path, definition->get_error_line(), definition->get_error());
+        return false;
+    }
+    FuzzyModel* model = definition->get_model();
+    if (sizeof(RequestHeader) + (size_t)model->get_input_size() * sizeof(float) > SERVER_INPUT_SIZE)
+    {
+        // A request must fit in the input buffer of a connection, otherwise a
+        // part of one fills it and the next read has no room
+        fprintf(stderr, "%s: too many inputs for a request of %u bytes\n", s->path, (u_int)SERVER_INPUT_SIZE);
+        return false;
+    }
+    if (s->input_size != 0 && (model->get_input_size() != s->input_size || model->get_output_size() != s->output_size))
+    {
+        fprintf(stderr, "%s: the inputs and outputs have changed, the system is not reloaded\n", s->path);
+        return false;
+    }
+    if (!s->engines[which].Batch_SetUp(&model->system(), s->threads))
+    {
+        fprintf(stderr, "%s: the system can not be evaluated by batches\n", s->path);
+        return false;
+    }
+    return true;
+}
+
+static void set_domains(Server* s)
+{
+    // Universes of the inputs of the current system, sent with hello
+    FuzzyModel* model = s->definitions[s->current].get_model();
+    for (u_int i=0; i<s->input_size; i++)
+    {
+        UnivDisc domain = model->input(i).get_domain();
+        s->domains[2 * i] = domain.low_bond;
+        s->domains[2 * i + 1] = domain.up_bond;
+    }
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: FuzzyServer [options] system.fzs socket\n"
+            "  -t threads   of the batch engine, 0: one per core (default: 1)\n"
+            "  -b requests  maximum size of a batch (default: 4096)\n"
+            "  -w us        wait for more requests once one is pending (default: 0)\n");
+}
+
+int main(int argc, char** argv)
+{
+    static Server server;
+    Server* s = &server;
+    const char* socket_path = 0;
+    s->path = 0;
+    s->threads = 1;
+    s->max_batch = 4096;
+    s->window = 0;
+    for (int a=1; a<argc; a++)
+    {
+        const char* arg = argv[a];
+        bool has_value = (a + 1 < argc);
+        if (strcmp(arg, "-t") == 0 && has_value)        {s->threads = (u_int)strtoul(argv[++a], 0, 10);}
+        else if (strcmp(arg, "-b") == 0 && has_value)   {s->max_batch = (size_t)strtoul(argv[++a], 0, 10);}
+        else if (strcmp(arg, "-w") == 0 && has_value)   {s->window = (uint64_t)strtoul(argv[++a], 0, 10) * 1000;}
+        else if (arg[0] == '-')                         {usage(); return 2;}
+        else if (s->path == 0)                          {s->path = arg;}
+        else if (socket_path == 0)                      {socket_path = arg;}
+        else                                            {usage(); return 2;}
+    }
+    if (s->path == 0 || socket_path == 0 || s->max_batch == 0)
+    {
+        usage();
+        return 2;
+    }
+
+    // Blocked before the threads of the batch engine start, so that no thread
+    // takes the signals instead of the signalfd
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGHUP);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, 0);
+
+    s->current = 0;
+    s->input_size = 0;
+    s->output_size = 0;
+    if (!load(s, 0)) {return 1;}
+    FuzzyModel* model = s->definitions[0].get_model();
+    s->input_size = model->get_input_size();
+    s->output_size = model->get_output_size();
+    s->request_size = sizeof(RequestHeader) + s->input_size * sizeof(float);
+    s->response_size = sizeof(ResponseHeader) + s->output_size * sizeof(float);
+    s->domains = (float*)malloc(s->input_size * 2 * sizeof(float));
+    s->inputs = (float*)malloc(s->max_batch * s->input_size * sizeof(float));
+    s->outputs = (float*)malloc(s->max_batch * s->output_size * sizeof(float));
+    s->pending = (Pending*)malloc(s->max_batch * sizeof(Pending));
+    s->stats = (char*)malloc(SERVER_STATS_SIZE);
+    if (s->domains == 0 || s->inputs == 0 || s->outputs == 0 || s->pending == 0 || s->stats == 0)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    set_domains(s);
+    for (u_int k=0; k<SERVER_MAX_CONNECTIONS; k++)
+    {
+        Connection* c = &s->connections[k];
+        c->fd = -1;
+        c->generation = 0;
+        c->input = (char*)malloc(SERVER_INPUT_SIZE);
+        c->output_capacity = 4096;
+        c->output = (char*)malloc(c->output_capacity);
+        if (c->input == 0 || c->output == 0)
+        {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+    s->open = 0;
+    s->peak = 0;
+    s->count = 0;
+    s->deadline = 0;
+    s->requests = 0;
+    s->batches = 0;
+    s->max_count = 0;
+    s->reloads = 0;
+    s->failed_reloads = 0;
+
+    // Socket, signals and the epoll set
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "socket path too long\n");
+        return 1;
+    }
+    strcpy(address.sun_path, socket_path);
+    unlink(socket_path);
+    s->listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (s->listener < 0 || bind(s->listener, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(s->listener, 128) != 0)
+    {
+        fprintf(stderr, "can not listen on %s: %s\n", socket_path, strerror(errno));
+        return 1;
+    }
+    s->signals = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    s->epoll = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = LISTEN_SLOT;
+    epoll_ctl(s->epoll, EPOLL_CTL_ADD, s->listener, &event);
+    event.data.u32 = SIGNAL_SLOT;
+    epoll_ctl(s->epoll, EPOLL_CTL_ADD, s->signals, &event);
+    s->timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    event.data.u32 = TIMER_SLOT;
+    epoll_ctl(s->epoll, EPOLL_CTL_ADD, s->timer, &event);
+    fprintf(stderr, "%s: %u inputs, %u outputs, %u rules, %u threads, listening on %s\n", s->path, s->input_size, s->output_size,
+            model->get_total_rules(), s->engines[0].get_threads(), socket_path);
+
+    struct epoll_event events[256];
+    bool running = true;
+    while (running)
+    {
+        int n = epoll_wait(s->epoll, events, 256, -1);
+        if (n < 0 && errno != EINTR) {break;}
+        bool reload = false;
+        for (int k=0; k<n; k++)
+        {
+            u_int slot = events[k].data.u32;
+            if (slot == LISTEN_SLOT) {accept_connections(s);}
+            else if (slot == TIMER_SLOT)
+            {
+                uint64_t expirations;
+                while (read(s->timer, &expirations, sizeof(expirations)) == (ssize_t)sizeof(expirations)) {}
+            }
+            else if (slot == SIGNAL_SLOT)
+            {
+                struct signalfd_siginfo info;
+                while (read(s->signals, &info, sizeof(info)) == (ssize_t)sizeof(info))
+                {
+                    if (info.ssi_signo == SIGHUP) {reload = true;}
+                    else {running = false;}
+                }
+            }
+            else if (s->connections[slot].fd >= 0)
+            {
+                if ((events[k].events & EPOLLOUT) && !send_output(s, slot)) {continue;}
+                if (events[k].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {read_requests(s, slot);}
+            }
+        }
+        // Every request that has arrived together is one batch, unless the
+        // window leaves time for more
+        if (s->count > 0 && (s->window == 0 || now_ns() >= s->deadline || !running)) {run_batch(s);}
+        if (reload)
+        {
+            run_batch(s);
+            u_int spare = 1 - s->current;
+            if (load(s, spare))
+            {
+                s->current = spare;
+                set_domains(s);
+                s->reloads++;
+                fprintf(stderr, "%s: reloaded, %u rules\n", s->path, s->definitions[spare].get_model()->get_total_rules());
+            }
+            else {s->failed_reloads++;}
+        }
+    }
+
+    run_batch(s);
+    print_stats(s, s->stats, SERVER_STATS_SIZE);
+    fputs(s->stats, stderr);
+    for (u_int k=0; k<SERVER_MAX_CONNECTIONS; k++)
+    {
+        if (s->connections[k].fd >= 0) {close_connection(s, k);}
+    }
+    close(s->listener);
+    unlink(socket_path);
+    return 0;
+}
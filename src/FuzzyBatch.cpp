@@ -0,0 +1,234 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Implementation of FuzzyBatch (see FuzzyBatch.h)
+***/
+
+#include <stdlib.h>
+#include "FuzzyBatch.h"
+
+FuzzyBatch::FuzzyBatch()
+{
+    this->_system = 0;
+    this->_input_size = 0;
+    this->_output_size = 0;
+    this->_total_rules = 0;
+    this->_arena = 0;
+    this->_input_terms = 0;
+    this->_output_terms = 0;
+    this->_max_samples = 0;
+    this->_worker_size = 0;
+    this->_workers = 0;
+    this->_input = 0;
+    this->_output = 0;
+    this->_batch = 0;
+}
+
+FuzzyBatch::~FuzzyBatch()
+{
+    this->release();
+}
+
+void FuzzyBatch::release(void)
+{
+    // Stop and join the pool before freeing what the workers read
+    this->_pool.Release();
+    free(this->_arena);
+    this->_arena = 0;
+    this->_total_rules = 0;
+}
+
+bool FuzzyBatch::Batch_SetUp(FuzzySystem* system, u_int threads)
+{
+    this->release();
+    FlatSystem flat;
+    if (!flat_system(system, &flat)) {return false;}
+    FuzzyRule* rules = flat.rules;
+    u_int total_rules = flat.total_rules;
+    u_int input_size = flat.input_size;
+    u_int output_size = flat.output_size;
+    FuzzyFrame* input_frames = flat.input_frames;
+    FuzzyFrame* output_frames = flat.output_frames;
+    if (input_size > BATCH_MAX_INPUT || output_size == 0 || output_size > BATCH_MAX_OUTPUT) {return false;}
+    threads = FuzzyPool::thread_count(threads, BATCH_MAX_THREADS);
+
+    // Sizes of the input terms, of the consequents and of the output samples
+    u_int input_terms = 0;
+    for (u_int i=0; i<input_size; i++)
+    {
+        this->_input_offset[i] = input_terms;
+        input_terms = input_terms + input_frames[i].get_size();
+    }
+    u_int output_terms = 0;
+    u_int total_samples = 0;
+    u_int total_mu = 0;
+    u_int max_samples = 0;
+    for (u_int o=0; o<output_size; o++)
+    {
+        u_int samples = domain_samples(output_frames[o].get_domain());
+        if (samples == 0) {return false;}
+        this->_samples[o] = samples;
+        this->_terms[o] = output_frames[o].get_size();
+        this->_term_offset[o] = output_terms;
+        this->_sample_offset[o] = total_samples;
+        this->_mu_offset[o] = total_mu;
+        output_terms = output_terms + this->_terms[o];
+        total_samples = total_samples + samples;
+        total_mu = total_mu + this->_terms[o] * samples;
+        max_samples = (samples > max_samples) ? samples : max_samples;
+    }
+
+    // Per worker: fuzzified inputs (and a final 0), maxima of the consequents
+    // (and one for the consequents out of their frame), fuzzy output
+    size_t worker_size = ((size_t)(input_terms + 1) + (output_terms + 1) + max_samples) * sizeof(float);
+    worker_size = (worker_size + 63) & ~(size_t)63;
+    size_t size = (size_t)total_rules * input_size * sizeof(u_int)
+                + (size_t)total_rules * output_size * sizeof(u_int)
+                + (size_t)total_samples * sizeof(float)
+                + (size_t)total_mu * sizeof(float)
+                + 64 + (size_t)threads * worker_size;
+    char* p = (char*)malloc(size);
+    if (p == 0) {return false;}
+    this->_arena = p;
+    this->_antecedent = (u_int*)p;      p = p + (size_t)total_rules * input_size * sizeof(u_int);
+    this->_consequent = (u_int*)p;      p = p + (size_t)total_rules * output_size * sizeof(u_int);
+    this->_ys = (float*)p;              p = p + (size_t)total_samples * sizeof(float);
+    this->_mu_output = (float*)p;       p = p + (size_t)total_mu * sizeof(float);
+    p = (char*)(((uintptr_t)p + 63) & ~(uintptr_t)63);
+    this->_workers = p;
+
+    // Rules as indexes; an antecedent out of its frame points to the final 0
+    // and a consequent out of its frame to a maximum that is never read
+    for (u_int r=0; r<total_rules; r++)
+    {
+        const u_int* antecedent = rules[r].get_input_rules();
+        const u_int* consequent = rules[r].get_output_rules();
+        for (u_int i=0; i<input_size; i++)
+        {
+            bool valid = antecedent[i] < (u_int)input_frames[i].get_size();
+            this->_antecedent[(size_t)r * input_size + i] = valid ? this->_input_offset[i] + antecedent[i] : input_terms;
+        }
+        for (u_int o=0; o<output_size; o++)
+        {
+            bool valid = consequent[o] < this->_terms[o];
+            this->_consequent[(size_t)r * output_size + o] = valid ? this->_term_offset[o] + consequent[o] : output_terms;
+        }
+    }
+
+    // Output samples (the same float values as Defuzzyfication) and consequents
+    for (u_int o=0; o<output_size; o++)
+    {
+        UnivDisc domain = output_frames[o].get_domain();
+        float* ys = &this->_ys[this->_sample_offset[o]];
+        float* mu = &this->_mu_output[this->_mu_offset[o]];
+        u_int s = 0;
+        for (float y = domain.low_bond; y <= domain.up_bond && s < this->_samples[o]; y = y+domain.interval) {ys[s++] = y;}
+        for (u_int t=0; t<this->_terms[o]; t++)
+        {
+            for (s=0; s<this->_samples[o]; s++) {mu[(size_t)t * this->_samples[o] + s] = output_frames[o].get_muvalue(t, ys[s]);}
+        }
+    }
+
+    this->_system = system;
+    this->_input_size = input_size;
+    this->_output_size = output_size;
+    this->_total_rules = total_rules;
+    this->_input_terms = input_terms;
+    this->_output_terms = output_terms;
+    this->_max_samples = max_samples;
+    this->_worker_size = worker_size;
+    this->_pool.Pool_SetUp(threads);
+    return true;
+}
+
+void FuzzyBatch::run_share(void* owner, u_int worker, u_int threads)
+{
+    // Share of one worker of the running batch
+    FuzzyBatch* self = (FuzzyBatch*)owner;
+    self->run(worker, self->_batch * worker / threads, self->_batch * (worker + 1) / threads);
+}
+
+void FuzzyBatch::run(u_int worker, size_t first, size_t last)
+{
+    // Queries first .. last-1 of the running batch
+    const u_int input_size = this->_input_size;
+    const u_int output_size = this->_output_size;
+    const u_int total_rules = this->_total_rules;
+    float* mu_input = (float*)(this->_workers + (size_t)worker * this->_worker_size);
+    float* w = mu_input + this->_input_terms + 1;
+    float* agg = w + this->_output_terms + 1;
+    FuzzyFrame* frames = this->_system->get_rules()[0].get_input_frames();
+    mu_input[this->_input_terms] = 0.0F;
+
+    for (size_t q=first; q<last; q++)
+    {
+        const float* input = &this->_input[q * input_size];
+        float* output = &this->_output[q * output_size];
+        for (u_int i=0; i<input_size; i++) {frames[i].Fuzzify(input[i], &mu_input[this->_input_offset[i]]);}
+
+        // Degree of fulfillment of every rule, once for all outputs
+        for (u_int c=0; c<=this->_output_terms; c++) {w[c] = 0.0F;}
+        const u_int* antecedent = this->_antecedent;
+        const u_int* consequent = this->_consequent;
+        for (u_int r=0; r<total_rules; r++, antecedent += input_size, consequent += output_size)
+        {
+            float alpha = 1.0F;
+            for (u_int i=0; i<input_size && alpha != 0.0F; i++) {alpha = TNormMin::apply(mu_input[antecedent[i]], alpha);}
+            if (alpha == 0.0F) {continue;}
+            for (u_int o=0; o<output_size; o++) {w[consequent[o]] = SNormMax::apply(w[consequent[o]], alpha);}
+        }
+
+        // Sweep of every output, then the centroid as Defuzzyfication
+        for (u_int o=0; o<output_size; o++)
+        {
+            const u_int samples = this->_samples[o];
+            const float* ys = &this->_ys[this->_sample_offset[o]];
+            for (u_int s=0; s<samples; s++) {agg[s] = 0.0F;}
+            for (u_int t=0; t<this->_terms[o]; t++)
+            {
+                const float wt = w[this->_term_offset[o] + t];
+                if (wt == 0.0F) {continue;}
+                const float* __restrict mu = &this->_mu_output[this->_mu_offset[o] + (size_t)t * samples];
+                float* __restrict out = agg;
+                for (u_int s=0; s<samples; s++)
+                {
+                    float m = (wt < mu[s]) ? wt : mu[s];
+                    out[s] = (out[s] > m) ? out[s] : m;
+                }
+            }
+            float weight = 0.0F;
+            float weight_avg = 0.0F;
+            for (u_int s=0; s<samples; s++)
+            {
+                weight = weight + agg[s];
+                weight_avg = weight_avg + agg[s] * ys[s];
+            }
+            if (weight == 0.0F) {weight = 1.0F;}
+            output[o] = weight_avg / weight;
+        }
+    }
+}
+
+void FuzzyBatch::Defuzzyfication(const float* input, size_t batch, float* output)
+{
+    if (this->_total_rules == 0 || batch == 0) {return;}
+    this->_input = input;
+    this->_output = output;
+    this->_batch = batch;
+    this->_pool.Run(&FuzzyBatch::run_share, this, (batch < BATCH_MIN_SPLIT) ? 1 : this->_pool.get_threads());
+}
+
+u_int FuzzyBatch::get_input_size(void)
+{
+    return this->_input_size;
+}
+
+u_int FuzzyBatch::get_output_size(void)
+{
+    return this->_output_size;
+}
+
+u_int FuzzyBatch::get_threads(void)
+{
+    return this->_pool.get_threads();
+}
@@ -0,0 +1,109 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Evaluation of batches of queries of a FuzzySystem, every output at once.
+  *
+  * FuzzySystem::Defuzzyfication(input, output_id) evaluates every rule again
+  * for every output sample and for every output. FuzzyBatch takes a batch of
+  * input vectors and gives every output of each one, with the default
+  * operators (minimum, maximum, Mamdani) and the same result as
+  * Defuzzyfication:
+  *
+  *    1. every FuzzySet of the input frames is evaluated once per query
+  *    2. the degree of fulfillment of a rule is computed once per query and
+  *       shared by all outputs; the rules with the same consequent share one
+  *       maximum, w[consequent] = max over rules of min(antecedents)
+  *    3. every output is swept once, mu(y) = max over consequents of
+  *       min(w, mu_consequent(y)), with the consequents at the output samples
+  *       computed in Batch_SetUp, then the centroid is taken
+  *
+  * The queries of a batch are split between a pool of threads (the calling
+  * thread included); small batches are run by the calling thread only.
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    FuzzyBatch batch;
+  *    batch.Batch_SetUp(&mySystem, 0);                    // one thread per core
+  *    batch.Defuzzyfication(inputs, 4096, outputs);       // 4096 rows of input_size values -> 4096 rows of output_size values
+  *    ```
+  *
+  * A FuzzyBatch runs one batch at a time, and the FuzzySystem must not change
+  * after Batch_SetUp.
+***/
+
+#ifndef FUZZYBATCH_H_
+#define FUZZYBATCH_H_
+
+#include <stddef.h>
+#include "FuzzyLogic.h"
+#include "FuzzyPool.h"
+
+#ifndef BATCH_MAX_THREADS
+#define BATCH_MAX_THREADS       64      // Maximum number of threads of the pool
+#endif
+
+#ifndef BATCH_MAX_INPUT
+#define BATCH_MAX_INPUT         32      // Maximum number of inputs
+#endif
+
+#ifndef BATCH_MAX_OUTPUT
+#define BATCH_MAX_OUTPUT        8       // Maximum number of outputs
+#endif
+
+#ifndef BATCH_MIN_SPLIT
+#define BATCH_MIN_SPLIT         64      // Queries below which a batch is not split between threads
+#endif
+
+class FuzzyBatch
+{
+private:
+    FuzzySystem* _system;
+    u_int _input_size, _output_size, _total_rules;
+    void* _arena;                                   // every array below, one allocation
+    u_int* _antecedent;                             // per rule, index of each antecedent in the fuzzified inputs
+    u_int* _consequent;                             // per rule, index of each consequent in the maxima
+    float* _ys;                                     // output samples of every output
+    float* _mu_output;                              // consequents at the output samples
+    u_int _input_offset[BATCH_MAX_INPUT];
+    u_int _input_terms, _output_terms;
+    u_int _samples[BATCH_MAX_OUTPUT];
+    u_int _terms[BATCH_MAX_OUTPUT];
+    u_int _term_offset[BATCH_MAX_OUTPUT];
+    u_int _sample_offset[BATCH_MAX_OUTPUT];
+    u_int _mu_offset[BATCH_MAX_OUTPUT];
+    u_int _max_samples;
+    size_t _worker_size;                            // bytes of one worker
+    char* _workers;                                 // per thread: fuzzified inputs, maxima and fuzzy output
+
+    // The running batch
+    const float* _input;
+    float* _output;
+    size_t _batch;
+    FuzzyPool _pool;
+
+    void release(void);
+    static void run_share(void* owner, u_int worker, u_int threads);
+    void run(u_int worker, size_t first, size_t last);
+
+    FuzzyBatch(const FuzzyBatch&);                  // not copyable, owns its threads
+    FuzzyBatch& operator=(const FuzzyBatch&);
+public:
+    FuzzyBatch();
+    ~FuzzyBatch();
+
+    // Returns false if the system has no rule, rules with different frames,
+    // too many inputs or outputs, an empty output domain or if the allocation
+    // fails
+    bool Batch_SetUp(FuzzySystem* system, u_int threads);
+
+    // batch queries of input_size values each; output gets batch rows of
+    // output_size values
+    void Defuzzyfication(const float* input, size_t batch, float* output);
+
+    u_int get_input_size(void);
+    u_int get_output_size(void);
+    u_int get_threads(void);
+};
+
+#endif // FUZZYBATCH_H_
@@ -0,0 +1,196 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Implementation of FuzzySystemBuilder and FuzzyModel (see FuzzyBuilder.h)
+***/
+
+#include <stdlib.h>
+#include <new>
+#include "FuzzyBuilder.h"
+
+static size_t align_up(size_t offset, size_t alignment)
+{
+    // Round offset up to the next multiple of alignment
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+static size_t sum_terms(const u_int* terms, u_int size)
+{
+    size_t total = 0;
+    for (u_int i=0; i<size; i++) {total = total + terms[i];}
+    return total;
+}
+
+
+/* FUZZY MODEL */
+//
+FuzzyModel::FuzzyModel(FuzzyRule* rules, u_int total_rules) : _system(rules, total_rules)
+{
+    this->_rules = rules;
+    this->_total_rules = total_rules;
+}
+
+void FuzzyModel::operator delete(void* ptr)
+{
+    // The model sits at the beginning of the arena, so its address is the arena address
+    free(ptr);
+}
+
+void FuzzyModel::Frame_SetUp(FrameType FF_type, u_int frame_id, float x_left, float x_right)
+{
+    // The FuzzySets of the frame has been assigned by the builder,
+    // only the universe of discourse is left to the user
+    FuzzyFrame* frame = (FF_type == INPUT) ? &this->_input_frames[frame_id] : &this->_output_frames[frame_id];
+    frame->Frame_SetUp(frame->getFSAddress(), frame->get_size(), x_left, x_right, FF_type);
+}
+
+void FuzzyModel::Rule_SetUp(u_int rule_id, const u_int* input_rules, const u_int* output_rules)
+{
+    // Copy the indexes of linguistic values into the arena
+    u_int* antecedent = &this->_antecedent_rules[(size_t)rule_id * this->_input_size];
+    u_int* consequent = &this->_consequent_rules[(size_t)rule_id * this->_output_size];
+    for (u_int i=0; i<this->_input_size; i++) {antecedent[i] = input_rules[i];}
+    for (u_int i=0; i<this->_output_size; i++) {consequent[i] = output_rules[i];}
+}
+
+FuzzyFrame& FuzzyModel::input(u_int frame_id)
+{
+    return this->_input_frames[frame_id];
+}
+
+FuzzyFrame& FuzzyModel::output(u_int frame_id)
+{
+    return this->_output_frames[frame_id];
+}
+
+FuzzyRule& FuzzyModel::rule(u_int rule_id)
+{
+    return this->_rules[rule_id];
+}
+
+FuzzySystem& FuzzyModel::system(void)
+{
+    return this->_system;
+}
+
+float FuzzyModel::Defuzzyfication(float* input, u_int output_id)
+{
+    return this->_system.Defuzzyfication(input, output_id);
+}
+
+float FuzzyModel::Defuzzyfication(float* input, u_int output_id, float* grad)
+{
+    return this->_system.Defuzzyfication(input, output_id, grad);
+}
+
+u_int FuzzyModel::get_input_size(void)
+{
+    return this->_input_size;
+}
+u_int FuzzyModel::get_output_size(void)
+{
+    return this->_output_size;
+}
+u_int FuzzyModel::get_total_rules(void)
+{
+    return this->_total_rules;
+}
+size_t FuzzyModel::get_arena_size(void)
+{
+    return this->_arena_size;
+}
+
+
+/* FUZZY SYSTEM BUILDER */
+//
+FuzzySystemBuilder::FuzzySystemBuilder(u_int input_size, const u_int* input_terms, u_int output_size, const u_int* output_terms, u_int total_rules)
+{
+    this->_input_size = input_size;
+    this->_input_terms = input_terms;
+    this->_output_size = output_size;
+    this->_output_terms = output_terms;
+    this->_total_rules = total_rules;
+
+    // Layout of the arena, in the order the objects are visited by FuzzySystem::Evaluate
+    size_t offset = sizeof(FuzzyModel);
+    this->_off_rules = align_up(offset, alignof(FuzzyRule));
+    offset = this->_off_rules + (size_t)total_rules * sizeof(FuzzyRule);
+    this->_off_antecedent = align_up(offset, alignof(u_int));
+    offset = this->_off_antecedent + (size_t)total_rules * input_size * sizeof(u_int);
+    this->_off_consequent = offset;
+    offset = this->_off_consequent + (size_t)total_rules * output_size * sizeof(u_int);
+    this->_off_input_frames = align_up(offset, alignof(FuzzyFrame));
+    offset = this->_off_input_frames + (size_t)input_size * sizeof(FuzzyFrame);
+    this->_off_output_frames = offset;
+    offset = this->_off_output_frames + (size_t)output_size * sizeof(FuzzyFrame);
+    this->_off_input_sets = align_up(offset, alignof(FuzzySet));
+    offset = this->_off_input_sets + sum_terms(input_terms, input_size) * sizeof(FuzzySet);
+    this->_off_output_sets = offset;
+    offset = this->_off_output_sets + sum_terms(output_terms, output_size) * sizeof(FuzzySet);
+    this->_total_size = offset;
+}
+
+size_t FuzzySystemBuilder::arena_size(void)
+{
+    return this->_total_size;
+}
+
+FuzzyModel* FuzzySystemBuilder::Build(void)
+{
+    void* arena = malloc(this->_total_size);
+    if (arena == 0) {return 0;}
+    return this->Place(arena);
+}
+
+FuzzyModel* FuzzySystemBuilder::Build(void* buffer, size_t size)
+{
+    if (buffer == 0 || size < this->_total_size) {return 0;}
+    if (reinterpret_cast<size_t>(buffer) % alignof(FuzzyModel) != 0) {return 0;}
+    return this->Place(buffer);
+}
+
+FuzzyModel* FuzzySystemBuilder::Place(void* arena)
+{
+    char* base = static_cast<char*>(arena);
+    FuzzyRule* rules = reinterpret_cast<FuzzyRule*>(base + this->_off_rules);
+    FuzzyModel* model = new (base) FuzzyModel(rules, this->_total_rules);
+
+    model->_antecedent_rules = reinterpret_cast<u_int*>(base + this->_off_antecedent);
+    model->_consequent_rules = reinterpret_cast<u_int*>(base + this->_off_consequent);
+    model->_input_frames = reinterpret_cast<FuzzyFrame*>(base + this->_off_input_frames);
+    model->_output_frames = reinterpret_cast<FuzzyFrame*>(base + this->_off_output_frames);
+    model->_input_size = this->_input_size;
+    model->_output_size = this->_output_size;
+    model->_arena_size = this->_total_size;
+
+    // Frames with their FuzzySets
+    FuzzySet* sets = reinterpret_cast<FuzzySet*>(base + this->_off_input_sets);
+    for (u_int i=0; i<this->_input_size; i++)
+    {
+        for (u_int t=0; t<this->_input_terms[i]; t++) {new (&sets[t]) FuzzySet();}
+        new (&model->_input_frames[i]) FuzzyFrame();
+        model->_input_frames[i].Frame_SetUp(sets, this->_input_terms[i], 0.0, 0.0, INPUT);
+        sets = sets + this->_input_terms[i];
+    }
+    sets = reinterpret_cast<FuzzySet*>(base + this->_off_output_sets);
+    for (u_int o=0; o<this->_output_size; o++)
+    {
+        for (u_int t=0; t<this->_output_terms[o]; t++) {new (&sets[t]) FuzzySet();}
+        new (&model->_output_frames[o]) FuzzyFrame();
+        model->_output_frames[o].Frame_SetUp(sets, this->_output_terms[o], 0.0, 0.0, OUTPUT);
+        sets = sets + this->_output_terms[o];
+    }
+
+    // Rules pointing to their own rows of the index arrays
+    for (u_int r=0; r<this->_total_rules; r++)
+    {
+        u_int* antecedent = &model->_antecedent_rules[(size_t)r * this->_input_size];
+        u_int* consequent = &model->_consequent_rules[(size_t)r * this->_output_size];
+        for (u_int i=0; i<this->_input_size; i++) {antecedent[i] = 0;}
+        for (u_int o=0; o<this->_output_size; o++) {consequent[o] = 0;}
+        new (&rules[r]) FuzzyRule();
+        rules[r].Rule_SetUp(model->_input_frames, antecedent, this->_input_size,
+                            model->_output_frames, consequent, this->_output_size);
+    }
+    return model;
+}
@@ -0,0 +1,113 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Library-owned storage for a complete Fuzzy System.
+  *
+  * FuzzyLogic.h asks the user to declare every array (FuzzySet Temperature[3],
+  * u_int input_rules[6][2], etc) and to link them together by pointers. The
+  * FuzzySystemBuilder does the same work for the user: given the number of
+  * linguistic values of each frame and the number of rules, it reserves ONE
+  * block of memory (the arena) and places every FuzzySet, FuzzyFrame, FuzzyRule
+  * and rule index array inside it, in the order they are read during inference.
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    u_int input_terms[2]  = {3, 2};              // Temperature has 3 values, Humidity has 2
+  *    u_int output_terms[1] = {3};                 // Heater has 3 values
+  *    FuzzySystemBuilder builder(2, input_terms, 1, output_terms, 6);
+  *    FuzzyModel* model = builder.Build();         // The only allocation
+  *
+  *    model->Frame_SetUp(INPUT, TEMP, 0.0, 100.0);
+  *    model->input(TEMP).Set_SetUp(COLD, TRP_L, 10.0, 30.0);
+  *    ...
+  *    u_int antecedent[2] = {COLD, DRY};
+  *    u_int consequent[1] = {MED};
+  *    model->Rule_SetUp(0, antecedent, consequent);
+  *    ...
+  *    output = model->Defuzzyfication(inputs, 0);
+  *    delete model;                                // Releases the whole arena
+  *    ```
+  *
+  * For targets without heap, Build(buffer, size) places the model inside a
+  * buffer given by the user (see arena_size()). Such model must not be deleted.
+***/
+
+#ifndef FUZZYBUILDER_H_
+#define FUZZYBUILDER_H_
+
+#include <stddef.h>
+#include "FuzzyLogic.h"
+
+class FuzzySystemBuilder;
+
+class FuzzyModel
+{
+/***
+ * [Self-contained Fuzzy System living at the beginning of its own arena]
+ *
+ * Arena layout (each part aligned for its type):
+ *    | FuzzyModel | FuzzyRule[rules] | antecedent u_int[rules][inputs] | consequent u_int[rules][outputs]
+ *    | FuzzyFrame[inputs] | FuzzyFrame[outputs] | FuzzySet[terms of all inputs] | FuzzySet[terms of all outputs] |
+***/
+private:
+    FuzzySystem _system;
+    FuzzyRule* _rules;
+    u_int* _antecedent_rules;
+    u_int* _consequent_rules;
+    FuzzyFrame* _input_frames;
+    FuzzyFrame* _output_frames;
+
+    u_int _input_size;
+    u_int _output_size;
+    u_int _total_rules;
+    size_t _arena_size;
+
+    FuzzyModel(FuzzyRule* rules, u_int total_rules);
+    friend class FuzzySystemBuilder;
+public:
+    // The model is freed together with its arena (only for models made by Build(void))
+    static void operator delete(void* ptr);
+
+    void Frame_SetUp(FrameType FF_type, u_int frame_id, float x_left, float x_right);
+    void Rule_SetUp(u_int rule_id, const u_int* input_rules, const u_int* output_rules);
+
+    FuzzyFrame& input(u_int frame_id);
+    FuzzyFrame& output(u_int frame_id);
+    FuzzyRule& rule(u_int rule_id);
+    FuzzySystem& system(void);
+
+    float Defuzzyfication(float* input, u_int output_id);
+    float Defuzzyfication(float* input, u_int output_id, float* grad);
+
+    u_int get_input_size(void);
+    u_int get_output_size(void);
+    u_int get_total_rules(void);
+    size_t get_arena_size(void);
+};
+
+class FuzzySystemBuilder
+{
+private:
+    u_int _input_size;
+    const u_int* _input_terms;
+    u_int _output_size;
+    const u_int* _output_terms;
+    u_int _total_rules;
+
+    // Offsets of each part inside the arena
+    size_t _off_rules, _off_antecedent, _off_consequent;
+    size_t _off_input_frames, _off_output_frames;
+    size_t _off_input_sets, _off_output_sets;
+    size_t _total_size;
+
+    FuzzyModel* Place(void* arena);
+public:
+    FuzzySystemBuilder(u_int input_size, const u_int* input_terms, u_int output_size, const u_int* output_terms, u_int total_rules);
+
+    size_t arena_size(void);
+    FuzzyModel* Build(void);                        // returns 0 if allocation fails
+    FuzzyModel* Build(void* buffer, size_t size);   // returns 0 if buffer is too small
+};
+
+#endif // FUZZYBUILDER_H_
@@ -0,0 +1,398 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Implementation of FuzzyCMeans (see FuzzyCMeans.h)
+***/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "FuzzyCMeans.h"
+
+#define CMEANS_TINY     1e-30F      // added to the distances, so a sample on a center is not 0/0
+
+static void squared_distance(float* __restrict dist, const float* __restrict block, const float* center, u_int dimensions, u_int count)
+{
+    // dist[b] = |x_b - center|^2 over the rows of the block (one per dimension)
+    for (u_int b=0; b<count; b++) {dist[b] = CMEANS_TINY;}
+    for (u_int i=0; i<dimensions; i++)
+    {
+        const float* __restrict row = &block[(size_t)i * CMEANS_BLOCK];
+        float c = center[i];
+        for (u_int b=0; b<count; b++)
+        {
+            float t = row[b] - c;
+            dist[b] = dist[b] + t * t;
+        }
+    }
+}
+
+static float weighted_sum(const float* __restrict weight, const float* __restrict row, u_int count)
+{
+    // Sum of weight[b] * row[b] in 8 lanes, so that it is vectorized without -ffast-math
+    float lane[8] = {0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F};
+    u_int b = 0;
+    for (; b + 8 <= count; b = b + 8)
+    {
+        for (u_int j=0; j<8; j++) {lane[j] = lane[j] + weight[b + j] * row[b + j];}
+    }
+    float sum = ((lane[0] + lane[1]) + (lane[2] + lane[3])) + ((lane[4] + lane[5]) + (lane[6] + lane[7]));
+    for (; b<count; b++) {sum = sum + weight[b] * row[b];}
+    return sum;
+}
+
+static float block_sum(const float* __restrict row, u_int count)
+{
+    float lane[8] = {0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F};
+    u_int b = 0;
+    for (; b + 8 <= count; b = b + 8)
+    {
+        for (u_int j=0; j<8; j++) {lane[j] = lane[j] + row[b + j];}
+    }
+    float sum = ((lane[0] + lane[1]) + (lane[2] + lane[3])) + ((lane[4] + lane[5]) + (lane[6] + lane[7]));
+    for (; b<count; b++) {sum = sum + row[b];}
+    return sum;
+}
+
+
+FuzzyCMeans::FuzzyCMeans()
+{
+    this->_dimensions = 0;
+    this->_clusters = 0;
+    this->_fuzziness = 2.0;
+    this->_threads = 0;
+    this->_arena = 0;
+    this->_worker_size = 0;
+    this->_objective = 0.0;
+    this->_iterations = 0;
+    this->_samples = 0;
+    this->_count = 0;
+    this->_spread = false;
+}
+
+FuzzyCMeans::~FuzzyCMeans()
+{
+    this->release();
+}
+
+void FuzzyCMeans::release(void)
+{
+    // Stop and join the pool before freeing what the workers read
+    this->_pool.Release();
+    free(this->_arena);
+    this->_arena = 0;
+    this->_clusters = 0;
+    this->_threads = 0;
+}
+
+bool FuzzyCMeans::CMeans_SetUp(u_int dimensions, u_int clusters, float fuzziness, u_int threads)
+{
+    this->release();
+    if (dimensions == 0 || clusters < 2 || !(fuzziness > 1.0F)) {return false;}
+    threads = FuzzyPool::thread_count(threads, CMEANS_MAX_THREADS);
+
+    // Worker: block | distances | weights | nearest | 1/sum of weights | sums (double): num | den | var | objective
+    size_t floats = (size_t)(dimensions + 2 * clusters + 2) * CMEANS_BLOCK;
+    size_t doubles = (size_t)clusters * (2 * dimensions + 1) + 1;
+    size_t worker_size = align_64(floats * sizeof(float) + doubles * sizeof(double));
+    size_t size = (size_t)clusters * dimensions * 2 * sizeof(float) + (size_t)clusters * sizeof(u_int)
+                + 64 + (size_t)threads * worker_size;
+    char* p = (char*)malloc(size);
+    if (p == 0) {return false;}
+    this->_arena = p;
+    this->_centers = (float*)p;             p = p + (size_t)clusters * dimensions * sizeof(float);
+    this->_spreads = (float*)p;             p = p + (size_t)clusters * dimensions * sizeof(float);
+    this->_order = (u_int*)p;               p = p + (size_t)clusters * sizeof(u_int);
+    p = p + (64 - (size_t)p % 64) % 64;
+    this->_workers = p;
+    this->_dimensions = dimensions;
+    this->_clusters = clusters;
+    this->_fuzziness = fuzziness;
+    this->_threads = threads;
+    this->_worker_size = worker_size;
+    this->_objective = 0.0;
+    this->_iterations = 0;
+    for (size_t k=0; k<(size_t)clusters * dimensions; k++) {this->_centers[k] = 0.0F; this->_spreads[k] = 0.0F;}
+    this->_pool.Pool_SetUp(threads);
+    return true;
+}
+
+double* FuzzyCMeans::worker_sums(u_int worker)
+{
+    char* base = this->_workers + (size_t)worker * this->_worker_size;
+    return (double*)(base + (size_t)(this->_dimensions + 2 * this->_clusters + 2) * CMEANS_BLOCK * sizeof(float));
+}
+
+void FuzzyCMeans::run_block(u_int worker, const float* samples, u_int count, bool spread)
+{
+    /*
+    One block of count samples: memberships with the current centers, then
+    the sums of u^m x (or of u^m (x - v)^2 with spread) and of u^m
+    */
+    u_int d = this->_dimensions, c = this->_clusters;
+    float* block = (float*)(this->_workers + (size_t)worker * this->_worker_size);
+    float* dist = block + (size_t)d * CMEANS_BLOCK;
+    float* weight = dist + (size_t)c * CMEANS_BLOCK;
+    float* nearest = weight + (size_t)c * CMEANS_BLOCK;
+    float* inv_sum = nearest + CMEANS_BLOCK;
+    double* num = this->worker_sums(worker);
+    double* den = num + (size_t)c * d;
+    double* var = den + c;
+    double* objective = var + (size_t)c * d;
+    bool square = (this->_fuzziness == 2.0F);
+    float exponent = 1.0F / (this->_fuzziness - 1.0F);
+
+    // One row per dimension
+    for (u_int i=0; i<d; i++)
+    {
+        float* __restrict row = &block[(size_t)i * CMEANS_BLOCK];
+        const float* __restrict x = samples + i;
+        for (u_int b=0; b<count; b++) {row[b] = x[(size_t)b * d];}
+    }
+    // u_k = w_k / sum_j w_j with w_k = (nearest / dist_k)^(1/(m-1)), which is
+    // at most 1 and so does not overflow for any m
+    for (u_int k=0; k<c; k++)
+    {
+        float* dk = &dist[(size_t)k * CMEANS_BLOCK];
+        squared_distance(dk, block, &this->_centers[(size_t)k * d], d, count);
+        if (k == 0) {for (u_int b=0; b<count; b++) {nearest[b] = dk[b];}}
+        else {for (u_int b=0; b<count; b++) {nearest[b] = (dk[b] < nearest[b]) ? dk[b] : nearest[b];}}
+    }
+    for (u_int b=0; b<count; b++) {inv_sum[b] = 0.0F;}
+    for (u_int k=0; k<c; k++)
+    {
+        float* dk = &dist[(size_t)k * CMEANS_BLOCK];
+        float* wk = &weight[(size_t)k * CMEANS_BLOCK];
+        if (square) {for (u_int b=0; b<count; b++) {wk[b] = nearest[b] / dk[b];}}
+        else {for (u_int b=0; b<count; b++) {wk[b] = fuzzy_pow(nearest[b] / dk[b], exponent);}}
+        for (u_int b=0; b<count; b++) {inv_sum[b] = inv_sum[b] + wk[b];}
+    }
+    for (u_int b=0; b<count; b++) {inv_sum[b] = 1.0F / inv_sum[b];}
+    for (u_int k=0; k<c; k++)
+    {
+        float* dk = &dist[(size_t)k * CMEANS_BLOCK];
+        float* wk = &weight[(size_t)k * CMEANS_BLOCK];
+        if (square) {for (u_int b=0; b<count; b++) {float u = wk[b] * inv_sum[b]; wk[b] = u * u;}}
+        else {for (u_int b=0; b<count; b++) {wk[b] = fuzzy_pow(wk[b] * inv_sum[b], this->_fuzziness);}}
+        float sum_um = block_sum(wk, count);
+        float sum_obj = weighted_sum(wk, dk, count);
+        den[k] = den[k] + sum_um;
+        *objective = *objective + sum_obj;
+        const float* center = &this->_centers[(size_t)k * d];
+        for (u_int i=0; i<d; i++)
+        {
+            float* row = &block[(size_t)i * CMEANS_BLOCK];
+            if (spread)
+            {
+                // (x - v)^2 into the distances, which are not needed anymore
+                for (u_int b=0; b<count; b++) {float t = row[b] - center[i]; dk[b] = t * t;}
+                var[(size_t)k * d + i] = var[(size_t)k * d + i] + weighted_sum(wk, dk, count);
+            }
+            else {num[(size_t)k * d + i] = num[(size_t)k * d + i] + weighted_sum(wk, row, count);}
+        }
+    }
+}
+
+void FuzzyCMeans::run_shard(void* owner, u_int worker, u_int threads)
+{
+    // Share of worker of the running pass, into its own sums
+    FuzzyCMeans* self = (FuzzyCMeans*)owner;
+    size_t first = self->_count * worker / threads;
+    size_t last = self->_count * (worker + 1) / threads;
+    double* sums = self->worker_sums(worker);
+    size_t doubles = (size_t)self->_clusters * (2 * self->_dimensions + 1) + 1;
+    for (size_t j=0; j<doubles; j++) {sums[j] = 0.0;}
+    for (size_t n=first; n<last; n=n+CMEANS_BLOCK)
+    {
+        u_int count = (last - n < CMEANS_BLOCK) ? (u_int)(last - n) : CMEANS_BLOCK;
+        self->run_block(worker, &self->_samples[n * self->_dimensions], count, self->_spread);
+    }
+}
+
+void FuzzyCMeans::run(const float* samples, size_t count, bool spread)
+{
+    // One pass over the samples, one shard per thread, sums into worker 0
+    u_int threads = this->_threads;
+    if (count < (size_t)threads * CMEANS_BLOCK) {threads = 1;}
+    this->_samples = samples;
+    this->_count = count;
+    this->_spread = spread;
+    this->_pool.Run(&FuzzyCMeans::run_shard, this, threads);
+    double* sums = this->worker_sums(0);
+    size_t doubles = (size_t)this->_clusters * (2 * this->_dimensions + 1) + 1;
+    for (u_int w=1; w<threads; w++)
+    {
+        const double* other = this->worker_sums(w);
+        for (size_t j=0; j<doubles; j++) {sums[j] = sums[j] + other[j];}
+    }
+}
+
+void FuzzyCMeans::seed(const float* samples, size_t count)
+{
+    /*
+    k-means++ on at most 4096 samples taken evenly: the first center is the
+    first of them, every next one is drawn with a probability proportional to
+    the squared distance to the nearest center already chosen
+    */
+    u_int d = this->_dimensions, c = this->_clusters;
+    u_int picks = (count < 4096) ? (u_int)count : 4096;
+    u_int room = (d + 2 * c + 2) * CMEANS_BLOCK;    // floats of worker 0, used as scratch
+    picks = (picks < room) ? picks : room;
+    float* nearest = (float*)this->_workers;
+    uint64_t random = 0x9E3779B97F4A7C15ULL;
+    memcpy(this->_centers, samples, d * sizeof(float));
+    for (u_int j=0; j<picks; j++) {nearest[j] = 3.4e38F;}
+    for (u_int k=1; k<c; k++)
+    {
+        const float* last = &this->_centers[(size_t)(k - 1) * d];
+        double total = 0.0;
+        for (u_int j=0; j<picks; j++)
+        {
+            const float* x = &samples[(size_t)j * count / picks * d];
+            float dist = 0.0F;
+            for (u_int i=0; i<d; i++) {float t = x[i] - last[i]; dist = dist + t * t;}
+            nearest[j] = (dist < nearest[j]) ? dist : nearest[j];
+            total = total + nearest[j];
+        }
+        random ^= random >> 12; random ^= random << 25; random ^= random >> 27;
+        double target = (double)((random * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0) * total;
+        u_int pick = 0;
+        for (double sum = nearest[0]; pick + 1 < picks && sum <= target; ) {pick++; sum = sum + nearest[pick];}
+        memcpy(&this->_centers[(size_t)k * d], &samples[(size_t)pick * count / picks * d], d * sizeof(float));
+    }
+}
+
+u_int FuzzyCMeans::Cluster(const float* samples, size_t count, u_int max_iterations, float tolerance)
+{
+    u_int d = this->_dimensions, c = this->_clusters;
+    if (c == 0 || count < c) {return 0;}
+    this->seed(samples, count);
+    double* sums = this->worker_sums(0);
+    u_int it = 0;
+    while (it < max_iterations)
+    {
+        this->run(samples, count, false);
+        it++;
+        const double* num = sums;
+        const double* den = sums + (size_t)c * d;
+        this->_objective = sums[(size_t)c * (2 * d + 1)];
+        float moved = 0.0F;
+        for (u_int k=0; k<c; k++)
+        {
+            if (!(den[k] > 0.0)) {continue;}
+            for (u_int i=0; i<d; i++)
+            {
+                float v = (float)(num[(size_t)k * d + i] / den[k]);
+                float move = fabsf(v - this->_centers[(size_t)k * d + i]);
+                moved = (move > moved) ? move : moved;
+                this->_centers[(size_t)k * d + i] = v;
+            }
+        }
+        if (moved <= tolerance) {break;}
+    }
+    // Spreads around the final centers
+    this->run(samples, count, true);
+    const double* den = sums + (size_t)c * d;
+    const double* var = den + c;
+    for (u_int k=0; k<c; k++)
+    {
+        for (u_int i=0; i<d; i++)
+        {
+            this->_spreads[(size_t)k * d + i] = (den[k] > 0.0) ? (float)sqrt(var[(size_t)k * d + i] / den[k]) : 0.0F;
+        }
+    }
+    this->_iterations = it;
+    return it;
+}
+
+void FuzzyCMeans::Membership(const float* sample, float* mu)
+{
+    // As in run_block, relative to the nearest center
+    u_int d = this->_dimensions, c = this->_clusters;
+    float exponent = 1.0F / (this->_fuzziness - 1.0F);
+    float nearest = 0.0F;
+    for (u_int k=0; k<c; k++)
+    {
+        float dist = CMEANS_TINY;
+        for (u_int i=0; i<d; i++) {float t = sample[i] - this->_centers[(size_t)k * d + i]; dist = dist + t * t;}
+        mu[k] = dist;
+        nearest = (k == 0 || dist < nearest) ? dist : nearest;
+    }
+    float sum = 0.0F;
+    for (u_int k=0; k<c; k++)
+    {
+        mu[k] = (this->_fuzziness == 2.0F) ? nearest / mu[k] : fuzzy_pow(nearest / mu[k], exponent);
+        sum = sum + mu[k];
+    }
+    for (u_int k=0; k<c; k++) {mu[k] = mu[k] / sum;}
+}
+
+bool FuzzyCMeans::Project(FuzzyFrame* frame, u_int dimension, CM_Shape shape)
+{
+    u_int d = this->_dimensions, c = this->_clusters;
+    if (c == 0 || dimension >= d || (u_int)frame->get_size() != c) {return false;}
+    UnivDisc domain = frame->get_domain();
+    float width = domain.up_bond - domain.low_bond;
+    float gap = 1e-6F * ((width > 0.0F) ? width : 1.0F);
+    float least_spread = 1e-3F * ((width > 0.0F) ? width : 1.0F);
+
+    // Clusters in ascending order of their center along dimension
+    for (u_int k=0; k<c; k++)
+    {
+        u_int j = k;
+        float v = this->_centers[(size_t)k * d + dimension];
+        for (; j>0 && this->_centers[(size_t)this->_order[j - 1] * d + dimension] > v; j--) {this->_order[j] = this->_order[j - 1];}
+        this->_order[j] = k;
+    }
+    float previous = 0.0F;
+    for (u_int t=0; t<c; t++)
+    {
+        // Centers strictly ascending, so no segment of a set is vertical
+        float v = this->_centers[(size_t)this->_order[t] * d + dimension];
+        v = (t > 0 && v < previous + gap) ? previous + gap : v;
+        float s = this->_spreads[(size_t)this->_order[t] * d + dimension];
+        s = (s > least_spread) ? s : least_spread;
+        float next = (t + 1 < c) ? this->_centers[(size_t)this->_order[t + 1] * d + dimension] : v;
+        next = (next < v + gap) ? v + gap : next;
+        switch (shape)
+        {
+        case CM_TRIANGLE:
+            if (t == 0) {frame->Set_SetUp(t, TRP_L, v, next);}
+            else if (t == c - 1) {frame->Set_SetUp(t, TRP_R, previous, v);}
+            else {frame->Set_SetUp(t, TRI, previous, v, next);}
+            break;
+        case CM_TRAPEZOID:
+            if (t == 0) {frame->Set_SetUp(t, TRP_L, v + 0.5F * s, v + 2.0F * s);}
+            else if (t == c - 1) {frame->Set_SetUp(t, TRP_R, v - 2.0F * s, v - 0.5F * s);}
+            else {frame->Set_SetUp(t, TRP_C, v - 2.0F * s, v - 0.5F * s, v + 0.5F * s, v + 2.0F * s);}
+            break;
+        default:
+            frame->Set_SetUp(t, GAUSS, v, s);
+            break;
+        }
+        previous = v;
+    }
+    frame->Frame_Refresh();
+    return true;
+}
+
+const float* FuzzyCMeans::get_centers(void)
+{
+    return this->_centers;
+}
+const float* FuzzyCMeans::get_spreads(void)
+{
+    return this->_spreads;
+}
+double FuzzyCMeans::get_objective(void)
+{
+    return this->_objective;
+}
+u_int FuzzyCMeans::get_iterations(void)
+{
+    return this->_iterations;
+}
+u_int FuzzyCMeans::get_threads(void)
+{
+    return this->_threads;
+}
@@ -0,0 +1,118 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Fuzzy c-means clustering, and membership functions taken from it.
+  *
+  * Instead of placing the linguistic values by hand, they can be taken from
+  * the clusters of calibration data. Fuzzy c-means finds c centers v_k that
+  * minimize sum over samples and clusters of u_nk^m |x_n - v_k|^2, where
+  *
+  *    u_nk = 1 / sum_j (|x_n - v_k|^2 / |x_n - v_j|^2)^(1/(m-1))
+  *    v_k  = sum_n u_nk^m x_n / sum_n u_nk^m
+  *
+  * and m > 1 is the fuzziness (2 is the usual value). Each cluster can then be
+  * projected onto one input, with its center and its spread along that input
+  * (sqrt of sum_n u_nk^m (x_ni - v_ki)^2 / sum_n u_nk^m), as the FuzzySets of
+  * a FuzzyFrame:
+  *
+  *    - CM_TRIANGLE : a partition, TRI between the neighbour centers and
+  *                    TRP_L / TRP_R on the sides
+  *    - CM_TRAPEZOID: TRP_C, 1 within half a spread from the center and 0
+  *                    beyond two spreads (TRP_L / TRP_R on the sides)
+  *    - CM_GAUSS    : GAUSS of the center and the spread
+  *
+  * The FuzzySets are given in ascending order of the centers.
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    FuzzyCMeans cmeans;
+  *    cmeans.CMeans_SetUp(2, 5, 2.0, 0);                  // 2 dimensions, 5 clusters, m = 2, one thread per core
+  *    cmeans.Cluster(samples, 1000000, 100, 1e-4);        // 2 values per sample, at most 100 iterations
+  *    myFrames[0].Frame_SetUp(Temperature, 5, 0.0, 100.0, INPUT);
+  *    cmeans.Project(&myFrames[0], 0, CM_TRIANGLE);        // 5 FuzzySets from dimension 0
+  *    ```
+  *
+  * The samples are processed in blocks of CMEANS_BLOCK, split between the
+  * threads. A block is transposed into one row per dimension, so the loops
+  * over the samples of the distances, the memberships and the sums are
+  * vectorized by the compiler (-O3, or -O2 -ftree-vectorize) and run in the
+  * cache. m = 2 needs no power function; other values use fuzzy_pow. The
+  * samples are not copied, and nothing is allocated after CMeans_SetUp.
+***/
+
+#ifndef FUZZYCMEANS_H_
+#define FUZZYCMEANS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "FuzzyLogic.h"
+#include "FuzzyPool.h"
+
+#ifndef CMEANS_MAX_THREADS
+#define CMEANS_MAX_THREADS      64      // Maximum number of threads
+#endif
+
+#ifndef CMEANS_BLOCK
+#define CMEANS_BLOCK            256     // Samples processed at once by a thread
+#endif
+
+enum CM_Shape {CM_TRIANGLE, CM_TRAPEZOID, CM_GAUSS};
+
+class FuzzyCMeans
+{
+private:
+    u_int _dimensions, _clusters;
+    float _fuzziness;
+    u_int _threads;
+    void* _arena;                                   // every array below, one allocation
+    float* _centers;                                // _clusters rows of _dimensions
+    float* _spreads;
+    u_int* _order;                                  // scratch of Project
+    size_t _worker_size;                            // bytes of one worker
+    char* _workers;                                 // per thread: block, distances, weights and sums
+    double _objective;
+    u_int _iterations;
+    FuzzyPool _pool;
+
+    // The running pass
+    const float* _samples;
+    size_t _count;
+    bool _spread;
+
+    void release(void);
+    double* worker_sums(u_int worker);
+    void run_block(u_int worker, const float* samples, u_int count, bool spread);
+    static void run_shard(void* owner, u_int worker, u_int threads);
+    void run(const float* samples, size_t count, bool spread);
+    void seed(const float* samples, size_t count);
+
+    FuzzyCMeans(const FuzzyCMeans&);                // not copyable
+    FuzzyCMeans& operator=(const FuzzyCMeans&);
+public:
+    FuzzyCMeans();
+    ~FuzzyCMeans();
+
+    // Returns false without dimension, with less than 2 clusters, fuzziness
+    // not above 1 or if the allocation fails
+    bool CMeans_SetUp(u_int dimensions, u_int clusters, float fuzziness, u_int threads);
+
+    // count samples of dimensions values. Stops when no coordinate of a center
+    // moves by more than tolerance. Returns the number of iterations, 0 if
+    // there are fewer samples than clusters
+    u_int Cluster(const float* samples, size_t count, u_int max_iterations, float tolerance);
+    // Degrees of membership of one sample to every cluster
+    void Membership(const float* sample, float* mu);
+
+    // Sets up the FuzzySets of frame (it must have one per cluster) from the
+    // projection of the clusters onto dimension
+    bool Project(FuzzyFrame* frame, u_int dimension, CM_Shape shape);
+
+    const float* get_centers(void);                 // clusters rows of dimensions values
+    const float* get_spreads(void);
+    double get_objective(void);                     // sum of u^m |x - v|^2 of the last iteration
+    u_int get_iterations(void);
+    u_int get_threads(void);
+};
+
+#endif // FUZZYCMEANS_H_
@@ -0,0 +1,102 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Locale independent parsing of numbers in text files.
+  *
+  * strtof and sscanf follow the locale of the program, so "0.5" is not read
+  * the same way everywhere (a comma is the decimal separator in many locales),
+  * and they are slow for files of gigabytes. These functions always read a
+  * point as the decimal separator and take the separators of CSV files:
+  *
+  *    [spaces] [+|-] digits [. digits] [e|E [+|-] digits] [spaces]
+  *
+  * then one of ',', ';', tab or space between the values of a line.
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    float values[4];
+  *    const char* end_of_line = ...;
+  *    int n = csv_parse_line(line, end_of_line, values, 4);   // -1 if a value is not a number
+  *    ```
+  *
+  * The result is within one rounding of the exact float (the mantissa is read
+  * as an integer of up to 19 digits, then scaled once in double precision).
+***/
+
+#ifndef FUZZYCSV_H_
+#define FUZZYCSV_H_
+
+#include <stdint.h>
+#include <math.h>
+
+inline const char* csv_parse_float(const char* p, const char* end, float* value)
+{
+    // Returns the first character after the number, or 0 if there is no number
+    static const double power[23] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                     1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    while (p < end && (*p == ' ' || *p == '\t')) {p++;}
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {negative = (*p == '-'); p++;}
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    unsigned int digits = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, digits++)
+    {
+        if (mantissa < 1000000000000000000ULL) {mantissa = mantissa * 10 + (uint64_t)(*p - '0');}
+        else {exponent++;}                          // digits beyond 19 only scale
+    }
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++)
+        {
+            if (mantissa < 1000000000000000000ULL) {mantissa = mantissa * 10 + (uint64_t)(*p - '0'); exponent--;}
+        }
+    }
+    if (digits == 0) {return 0;}
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char* q = p + 1;
+        bool minus = false;
+        if (q < end && (*q == '-' || *q == '+')) {minus = (*q == '-'); q++;}
+        int e = 0;
+        const char* first = q;
+        for (; q < end && *q >= '0' && *q <= '9'; q++) {e = (e < 10000) ? e * 10 + (*q - '0') : e;}
+        if (q > first)
+        {
+            exponent = minus ? exponent - e : exponent + e;
+            p = q;
+        }
+    }
+    double x = (double)mantissa;
+    if (exponent >= 0 && exponent <= 22) {x = x * power[exponent];}
+    else if (exponent < 0 && exponent >= -22) {x = x / power[-exponent];}
+    else if (mantissa != 0) {x = x * pow(10.0, (double)exponent);}
+    *value = negative ? -(float)x : (float)x;
+    while (p < end && (*p == ' ' || *p == '\t')) {p++;}
+    return p;
+}
+
+inline int csv_parse_line(const char* p, const char* end, float* values, unsigned int max_values)
+{
+    // Values of one line (end excluded, without its '\n'). Returns their
+    // number, or -1 if a value is not a number or there are more than max_values
+    if (end > p && end[-1] == '\r') {end--;}
+    unsigned int n = 0;
+    while (p < end)
+    {
+        if (n == max_values) {return -1;}
+        p = csv_parse_float(p, end, &values[n]);
+        if (p == 0) {return -1;}
+        n++;
+        if (p < end)
+        {
+            // A ',' or ';', or the spaces already skipped after the number
+            if (*p == ',' || *p == ';') {p++;}
+            else if (p[-1] != ' ' && p[-1] != '\t') {return -1;}
+        }
+    }
+    return (int)n;
+}
+
+#endif // FUZZYCSV_H_
@@ -0,0 +1,326 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Implementation of FuzzyCache and FuzzyShardedCache (see FuzzyCache.h)
+***/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "FuzzyCache.h"
+
+static uint32_t hash_words(const uint32_t* key, u_int n)
+{
+    // FNV-1a over the words, then the final mix of MurmurHash3 so that every
+    // bit of the key reaches the bucket index and the shard index
+    uint32_t h = 2166136261U;
+    for (u_int i=0; i<n; i++) {h = (h ^ key[i]) * 16777619U;}
+    h = h ^ (h >> 16);
+    h = h * 0x85EBCA6BU;
+    h = h ^ (h >> 13);
+    h = h * 0xC2B2AE35U;
+    h = h ^ (h >> 16);
+    return h;
+}
+
+
+FuzzyCache::FuzzyCache()
+{
+    this->_system = 0;
+    this->_arena = 0;
+    this->_keys = 0;
+    this->_hashes = 0;
+    this->_values = 0;
+    this->_next = 0;
+    this->_buckets = 0;
+    this->_reference = 0;
+    this->_key_length = 0;
+    this->_input_size = 0;
+    this->_capacity = 0;
+    this->_count = 0;
+    this->_hand = 0;
+    this->_bucket_mask = 0;
+    this->_hits = 0;
+    this->_misses = 0;
+}
+
+FuzzyCache::~FuzzyCache()
+{
+    this->release();
+}
+
+void FuzzyCache::release(void)
+{
+    free(this->_arena);
+    this->_arena = 0;
+    this->_capacity = 0;
+    this->_count = 0;
+}
+
+bool FuzzyCache::Cache_SetUp(FuzzySystem* system, u_int capacity, const float* grid)
+{
+    this->release();
+    if (system->get_total_rules() == 0 || capacity == 0) {return false;}
+    u_int input_size = system->get_rules()[0].get_input_size();
+    if (input_size > CACHE_MAX_INPUT) {return false;}
+
+    // At least as many buckets as entries, a power of two
+    u_int buckets = 1;
+    while (buckets < capacity) {buckets = buckets * 2;}
+    u_int key_length = input_size + 1;
+
+    size_t size = (size_t)capacity * key_length * sizeof(uint32_t)   // keys
+                + (size_t)capacity * sizeof(uint32_t)                // hashes
+                + (size_t)capacity * sizeof(float)                   // values
+                + (size_t)capacity * sizeof(int32_t)                 // next
+                + (size_t)buckets * sizeof(int32_t)                  // buckets
+                + (size_t)capacity;                                  // reference bits
+    char* p = (char*)malloc(size);
+    if (p == 0) {return false;}
+    this->_arena = p;
+    this->_keys = (uint32_t*)p;         p = p + (size_t)capacity * key_length * sizeof(uint32_t);
+    this->_hashes = (uint32_t*)p;       p = p + (size_t)capacity * sizeof(uint32_t);
+    this->_values = (float*)p;          p = p + (size_t)capacity * sizeof(float);
+    this->_next = (int32_t*)p;          p = p + (size_t)capacity * sizeof(int32_t);
+    this->_buckets = (int32_t*)p;       p = p + (size_t)buckets * sizeof(int32_t);
+    this->_reference = (uint8_t*)p;
+
+    this->_system = system;
+    this->_key_length = key_length;
+    this->_input_size = input_size;
+    this->_capacity = capacity;
+    this->_bucket_mask = buckets - 1;
+    for (u_int i=0; i<input_size; i++) {this->_grid[i] = (grid == 0) ? 0.0F : grid[i];}
+    this->Clear();
+    return true;
+}
+
+void FuzzyCache::Clear(void)
+{
+    for (u_int b=0; b<=this->_bucket_mask && this->_arena != 0; b++) {this->_buckets[b] = -1;}
+    this->_count = 0;
+    this->_hand = 0;
+    this->_hits = 0;
+    this->_misses = 0;
+}
+
+uint32_t FuzzyCache::make_key(const float* input, u_int output_id, uint32_t* key, float* point)
+{
+    for (u_int i=0; i<this->_input_size; i++)
+    {
+        float x = input[i];
+        float step = this->_grid[i];
+        if (step > 0.0F)
+        {
+            // Index of the nearest grid point, the output is computed there.
+            // The index is clamped to the range of int32_t (the point follows
+            // it) and NaN gets a key of its own, INT32_MIN, that no index has
+            float q = floorf(x / step + 0.5F);
+            bool nan = (q != q);
+            q = (q > -2147483520.0F) ? q : -2147483520.0F;     // largest floats below 2^31
+            q = (q < 2147483520.0F) ? q : 2147483520.0F;
+            x = nan ? x : q * step;
+            key[i] = nan ? 0x80000000U : (uint32_t)(int32_t)q;
+        }
+        else
+        {
+            x = (x == 0.0F) ? 0.0F : x;                 // -0 and +0 share one entry
+            memcpy(&key[i], &x, sizeof(uint32_t));
+        }
+        point[i] = x;
+    }
+    key[this->_input_size] = output_id;
+    return hash_words(key, this->_key_length);
+}
+
+int32_t FuzzyCache::find(const uint32_t* key, uint32_t hash)
+{
+    size_t bytes = this->_key_length * sizeof(uint32_t);
+    for (int32_t e = this->_buckets[hash & this->_bucket_mask]; e >= 0; e = this->_next[e])
+    {
+        if (this->_hashes[e] == hash && memcmp(&this->_keys[(size_t)e * this->_key_length], key, bytes) == 0) {return e;}
+    }
+    return -1;
+}
+
+void FuzzyCache::insert(const uint32_t* key, uint32_t hash, float value)
+{
+    int32_t e;
+    if (this->_count < this->_capacity)
+    {
+        e = (int32_t)this->_count++;
+    }
+    else
+    {
+        // CLOCK: give a second chance to the entries used since the last pass
+        while (this->_reference[this->_hand])
+        {
+            this->_reference[this->_hand] = 0;
+            this->_hand = (this->_hand + 1 == this->_capacity) ? 0 : this->_hand + 1;
+        }
+        e = (int32_t)this->_hand;
+        this->_hand = (this->_hand + 1 == this->_capacity) ? 0 : this->_hand + 1;
+
+        // Unlink the victim from its bucket
+        int32_t* link = &this->_buckets[this->_hashes[e] & this->_bucket_mask];
+        while (*link != e) {link = &this->_next[*link];}
+        *link = this->_next[e];
+    }
+    memcpy(&this->_keys[(size_t)e * this->_key_length], key, this->_key_length * sizeof(uint32_t));
+    this->_hashes[e] = hash;
+    this->_values[e] = value;
+    this->_reference[e] = 0;
+    int32_t* bucket = &this->_buckets[hash & this->_bucket_mask];
+    this->_next[e] = *bucket;
+    *bucket = e;
+}
+
+float FuzzyCache::Defuzzyfication(const float* input, u_int output_id)
+{
+    uint32_t key[CACHE_MAX_INPUT + 1];
+    float point[CACHE_MAX_INPUT];
+    uint32_t hash = this->make_key(input, output_id, key, point);
+    int32_t e = this->find(key, hash);
+    if (e >= 0)
+    {
+        this->_hits++;
+        this->_reference[e] = 1;
+        return this->_values[e];
+    }
+    this->_misses++;
+    float value = this->_system->Defuzzyfication(point, output_id);
+    this->insert(key, hash, value);
+    return value;
+}
+
+void FuzzyCache::Defuzzyfication(const float* input, u_int output_id, u_int batch, float* output)
+{
+    for (u_int q=0; q<batch; q++) {output[q] = this->Defuzzyfication(&input[(size_t)q * this->_input_size], output_id);}
+}
+
+uint64_t FuzzyCache::get_hits(void)
+{
+    return this->_hits;
+}
+
+uint64_t FuzzyCache::get_misses(void)
+{
+    return this->_misses;
+}
+
+u_int FuzzyCache::get_count(void)
+{
+    return this->_count;
+}
+
+u_int FuzzyCache::get_capacity(void)
+{
+    return this->_capacity;
+}
+
+
+FuzzyShardedCache::FuzzyShardedCache()
+{
+    this->_shard_count = 0;
+}
+
+bool FuzzyShardedCache::Cache_SetUp(FuzzySystem* system, u_int capacity, const float* grid, u_int shards)
+{
+    this->_shard_count = 0;
+    if (shards == 0 || shards > CACHE_MAX_SHARDS) {return false;}
+    u_int per_shard = (capacity + shards - 1) / shards;
+    for (u_int s=0; s<shards; s++)
+    {
+        std::lock_guard<std::mutex> lock(this->_locks[s]);
+        if (!this->_shards[s].Cache_SetUp(system, per_shard, grid)) {return false;}
+    }
+
+    // The shards evaluate the system from several threads, so the tables of
+    // its frames have to be filled first
+    FuzzyRule* rules = system->get_rules();
+    for (u_int r=0; r<system->get_total_rules(); r++)
+    {
+        for (u_int i=0; i<rules[r].get_input_size(); i++) {rules[r].get_input_frames()[i].Frame_Refresh();}
+        for (u_int o=0; o<rules[r].get_output_size(); o++) {rules[r].get_output_frames()[o].Frame_Refresh();}
+    }
+    this->_shard_count = shards;
+    return true;
+}
+
+void FuzzyShardedCache::Clear(void)
+{
+    for (u_int s=0; s<this->_shard_count; s++)
+    {
+        std::lock_guard<std::mutex> lock(this->_locks[s]);
+        this->_shards[s].Clear();
+    }
+}
+
+float FuzzyShardedCache::Defuzzyfication(const float* input, u_int output_id)
+{
+    uint32_t key[CACHE_MAX_INPUT + 1];
+    float point[CACHE_MAX_INPUT];
+    FuzzyCache* first = &this->_shards[0];
+    uint32_t hash = first->make_key(input, output_id, key, point);
+
+    // The high bits choose the shard, the low bits the bucket inside it
+    u_int s = (u_int)(((uint64_t)hash * this->_shard_count) >> 32);
+    FuzzyCache* shard = &this->_shards[s];
+    {
+        std::lock_guard<std::mutex> lock(this->_locks[s]);
+        int32_t e = shard->find(key, hash);
+        if (e >= 0)
+        {
+            shard->_hits++;
+            shard->_reference[e] = 1;
+            return shard->_values[e];
+        }
+        shard->_misses++;
+    }
+
+    // Evaluated without the lock; another thread may have inserted the same
+    // key meanwhile, then its entry is kept
+    float value = shard->_system->Defuzzyfication(point, output_id);
+    std::lock_guard<std::mutex> lock(this->_locks[s]);
+    if (shard->find(key, hash) < 0) {shard->insert(key, hash, value);}
+    return value;
+}
+
+void FuzzyShardedCache::Defuzzyfication(const float* input, u_int output_id, u_int batch, float* output)
+{
+    u_int input_size = this->_shards[0]._input_size;
+    for (u_int q=0; q<batch; q++) {output[q] = this->Defuzzyfication(&input[(size_t)q * input_size], output_id);}
+}
+
+uint64_t FuzzyShardedCache::get_hits(void)
+{
+    uint64_t hits = 0;
+    for (u_int s=0; s<this->_shard_count; s++)
+    {
+        std::lock_guard<std::mutex> lock(this->_locks[s]);
+        hits = hits + this->_shards[s]._hits;
+    }
+    return hits;
+}
+
+uint64_t FuzzyShardedCache::get_misses(void)
+{
+    uint64_t misses = 0;
+    for (u_int s=0; s<this->_shard_count; s++)
+    {
+        std::lock_guard<std::mutex> lock(this->_locks[s]);
+        misses = misses + this->_shards[s]._misses;
+    }
+    return misses;
+}
+
+u_int FuzzyShardedCache::get_count(void)
+{
+    u_int count = 0;
+    for (u_int s=0; s<this->_shard_count; s++)
+    {
+        std::lock_guard<std::mutex> lock(this->_locks[s]);
+        count = count + this->_shards[s]._count;
+    }
+    return count;
+}
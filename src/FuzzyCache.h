@@ -0,0 +1,132 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Bounded memoization of FuzzySystem::Defuzzyfication.
+  *
+  * Inputs that repeat exactly are common: saturated sensors, a joystick at
+  * rest, integer inputs like the multiples of 8 of examples/FuzzyLogic_Testing.
+  * A FuzzyCache sits in front of Defuzzyfication and keeps the last outputs
+  * keyed by the input vector (and output_id), so a repeated vector costs one
+  * hash lookup instead of a complete inference.
+  *
+  * The key is either the exact input (bit pattern of each float) or the input
+  * rounded to a grid, one grid step per input (0 for an exact input). With a
+  * grid, the output is computed at the grid point itself, so the result does
+  * not depend on which input of the cell came first.
+  *
+  * The cache holds at most capacity entries. When it is full, the entry to
+  * replace is chosen with the CLOCK algorithm (an approximation of least
+  * recently used): every hit sets the reference bit of the entry, and the
+  * clock hand replaces the first entry whose bit is clear, clearing the bits
+  * it passes.
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    FuzzyCache cache;
+  *    cache.Cache_SetUp(&mySystem, 1024, 0);               // 1024 entries, exact keys
+  *    output = cache.Defuzzyfication(inputs, 0);           // instead of mySystem.Defuzzyfication(inputs, 0)
+  *
+  *    float grid[2] = {0.5, 1.0};                          // or rounded keys
+  *    cache.Cache_SetUp(&mySystem, 1024, grid);
+  *
+  *    FuzzyShardedCache shared;                            // for several threads
+  *    shared.Cache_SetUp(&mySystem, 65536, 0, 16);         // 16 shards of 4096 entries
+  *    shared.Defuzzyfication(inputs, 0, 64, outputs);      // 64 queries of input_size values
+  *    ```
+  *
+  * FuzzyCache is not thread safe. FuzzyShardedCache splits the entries into
+  * shards chosen by the hash of the key, each one with its own lock, and
+  * evaluates a miss outside of the lock, so threads only wait for each other
+  * on the same shard. The cached FuzzySystem must not change while a cache is
+  * in use (Cache_SetUp or Clear after changing it).
+***/
+
+#ifndef FUZZYCACHE_H_
+#define FUZZYCACHE_H_
+
+#include <mutex>
+#include "FuzzyLogic.h"
+
+#ifndef CACHE_MAX_INPUT
+#define CACHE_MAX_INPUT         16      // Maximum number of inputs of the cached system
+#endif
+
+#ifndef CACHE_MAX_SHARDS
+#define CACHE_MAX_SHARDS        64      // Maximum number of shards of FuzzyShardedCache
+#endif
+
+class FuzzyShardedCache;
+
+class FuzzyCache
+{
+private:
+    FuzzySystem* _system;
+    void* _arena;                   // every array below, one allocation
+    uint32_t* _keys;                // _key_length words per entry
+    uint32_t* _hashes;
+    float* _values;
+    int32_t* _next;                 // next entry of the same bucket, -1 at the end
+    int32_t* _buckets;              // first entry of each bucket, -1 if empty
+    uint8_t* _reference;            // CLOCK reference bit
+    u_int _key_length;              // inputs + output_id
+    u_int _input_size;
+    u_int _capacity, _count, _hand;
+    uint32_t _bucket_mask;
+    float _grid[CACHE_MAX_INPUT];
+    uint64_t _hits, _misses;
+
+    void release(void);
+    int32_t find(const uint32_t* key, uint32_t hash);
+    void insert(const uint32_t* key, uint32_t hash, float value);
+    FuzzyCache(const FuzzyCache&);                      // not copyable, owns its entries
+    FuzzyCache& operator=(const FuzzyCache&);
+    friend class FuzzyShardedCache;
+public:
+    FuzzyCache();
+    ~FuzzyCache();
+
+    // grid: one step per input (0: exact), or 0 for exact keys everywhere.
+    // Returns false if the system has no rule, too many inputs or if the
+    // allocation fails
+    bool Cache_SetUp(FuzzySystem* system, u_int capacity, const float* grid);
+    void Clear(void);
+
+    float Defuzzyfication(const float* input, u_int output_id);
+    void Defuzzyfication(const float* input, u_int output_id, u_int batch, float* output);
+
+    // Key of an input and the point where its output is computed
+    uint32_t make_key(const float* input, u_int output_id, uint32_t* key, float* point);
+
+    uint64_t get_hits(void);
+    uint64_t get_misses(void);
+    u_int get_count(void);
+    u_int get_capacity(void);
+};
+
+class FuzzyShardedCache
+{
+private:
+    FuzzyCache _shards[CACHE_MAX_SHARDS];
+    std::mutex _locks[CACHE_MAX_SHARDS];
+    u_int _shard_count;
+
+    FuzzyShardedCache(const FuzzyShardedCache&);
+    FuzzyShardedCache& operator=(const FuzzyShardedCache&);
+public:
+    FuzzyShardedCache();
+
+    // capacity is split evenly between the shards
+    bool Cache_SetUp(FuzzySystem* system, u_int capacity, const float* grid, u_int shards);
+    void Clear(void);
+
+    float Defuzzyfication(const float* input, u_int output_id);
+    void Defuzzyfication(const float* input, u_int output_id, u_int batch, float* output);
+
+    // Sums over the shards
+    uint64_t get_hits(void);
+    uint64_t get_misses(void);
+    u_int get_count(void);
+};
+
+#endif // FUZZYCACHE_H_
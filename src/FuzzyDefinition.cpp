@@ -0,0 +1,338 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Implementation of FuzzyDefinition (see FuzzyDefinition.h)
+***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FuzzyDefinition.h"
+#include "FuzzyCSV.h"
+
+#define DEFINITION_MAX_TOKENS   (DEFINITION_MAX_INPUT + DEFINITION_MAX_OUTPUT + 2)
+
+struct DefinitionToken
+{
+    const char* text;
+    u_int length;
+};
+
+static const char* split_line(const char* p, const char* end, DefinitionToken* tokens, u_int* count)
+{
+    // Tokens of the line starting at p, without its comment. Returns the start
+    // of the next line; count is DEFINITION_MAX_TOKENS + 1 if there are too many
+    const char* eol = (const char*)memchr(p, '\n', (size_t)(end - p));
+    if (eol == 0) {eol = end;}
+    const char* hash = (const char*)memchr(p, '#', (size_t)(eol - p));
+    const char* stop = (hash != 0) ? hash : eol;
+    u_int n = 0;
+    while (p < stop)
+    {
+        while (p < stop && (*p == ' ' || *p == '\t' || *p == '\r')) {p++;}
+        if (p == stop) {break;}
+        const char* start = p;
+        while (p < stop && *p != ' ' && *p != '\t' && *p != '\r') {p++;}
+        if (n == DEFINITION_MAX_TOKENS) {n++; break;}
+        tokens[n].text = start;
+        tokens[n].length = (u_int)(p - start);
+        n++;
+    }
+    *count = n;
+    return (eol < end) ? eol + 1 : end;
+}
+
+static bool is_token(const DefinitionToken& token, const char* word)
+{
+    return strlen(word) == token.length && memcmp(token.text, word, token.length) == 0;
+}
+
+static bool read_number(const DefinitionToken& token, float* value)
+{
+    const char* end = token.text + token.length;
+    return csv_parse_float(token.text, end, value) == end;
+}
+
+static int set_type(const DefinitionToken& token, u_int* thresholds)
+{
+    // FS_type of a name and its number of thresholds (0 for PWL), -1 if unknown
+    static const char* names[] = {"TRP_L", "TRP_C", "TRP_R", "TRI", "SINGLE", "GAUSS", "GBELL", "SIGMOID", "PWL"};
+    static const FS_type types[] = {TRP_L, TRP_C, TRP_R, TRI, SINGLE, GAUSS, GBELL, SIGMOID, PWL};
+    static const u_int counts[] = {2, 4, 2, 3, 1, 2, 3, 2, 0};
+    for (u_int k=0; k<sizeof(types)/sizeof(types[0]); k++)
+    {
+        if (is_token(token, names[k]))
+        {
+            *thresholds = counts[k];
+            return (int)types[k];
+        }
+    }
+    return -1;
+}
+
+FuzzyDefinition::FuzzyDefinition()
+{
+    this->_model = 0;
+    this->_pwl = 0;
+    this->_error_line = 0;
+    this->_error = "";
+    for (u_int i=0; i<DEFINITION_MAX_INPUT; i++) {this->_input_names[i][0] = 0;}
+    for (u_int o=0; o<DEFINITION_MAX_OUTPUT; o++) {this->_output_names[o][0] = 0;}
+}
+
+FuzzyDefinition::~FuzzyDefinition()
+{
+    this->release();
+}
+
+void FuzzyDefinition::release(void)
+{
+    delete this->_model;
+    this->_model = 0;
+    free(this->_pwl);
+    this->_pwl = 0;
+}
+
+bool FuzzyDefinition::fail(u_int line, const char* error)
+{
+    this->release();
+    this->_error_line = line;
+    this->_error = error;
+    return false;
+}
+
+bool FuzzyDefinition::Load(const char* path)
+{
+    this->release();
+    FILE* file = fopen(path, "rb");
+    if (file == 0) {return this->fail(0, "can not open the file");}
+    long size = (fseek(file, 0, SEEK_END) == 0) ? ftell(file) : -1;
+    if (size < 0 || fseek(file, 0, SEEK_SET) != 0)
+    {
+        fclose(file);
+        return this->fail(0, "can not read the file");
+    }
+    char* text = (char*)malloc((size_t)size + 1);
+    if (text == 0)
+    {
+        fclose(file);
+        return this->fail(0, "out of memory");
+    }
+    bool ok = (fread(text, 1, (size_t)size, file) == (size_t)size);
+    fclose(file);
+    if (ok) {ok = this->Parse(text, (size_t)size);}
+    else {this->fail(0, "can not read the file");}
+    free(text);
+    return ok;
+}
+
+bool FuzzyDefinition::Parse(const char* text, size_t size)
+{
+    this->release();
+    this->_error_line = 0;
+    this->_error = "";
+    const char* end = text + size;
+    DefinitionToken tokens[DEFINITION_MAX_TOKENS];
+    u_int count = 0;
+
+    // First pass: check every line and count the frames, sets and rules
+    u_int input_size = 0, output_size = 0, total_rules = 0;
+    u_int input_terms[DEFINITION_MAX_INPUT];
+    u_int output_terms[DEFINITION_MAX_OUTPUT];
+    u_int* terms = 0;                               // of the current frame
+    u_int line = 0;
+    for (const char* p = text; p < end; )
+    {
+        p = split_line(p, end, tokens, &count);
+        line++;
+        if (count == 0) {continue;}
+        if (count > DEFINITION_MAX_TOKENS) {return this->fail(line, "too many values");}
+        bool input = is_token(tokens[0], "input");
+        if (input || is_token(tokens[0], "output"))
+        {
+            if (total_rules > 0) {return this->fail(line, "frame after the rules");}
+            if (count != 4 && (input || count != 5)) {return this->fail(line, "a frame is: input|output name low high [interval]");}
+            float v[3] = {0.0F, 0.0F, 1.0F};
+            for (u_int k=2; k<count; k++)
+            {
+                if (!read_number(tokens[k], &v[k - 2])) {return this->fail(line, "not a number");}
+            }
+            if (!(v[0] < v[1]) || !(v[2] > 0.0F)) {return this->fail(line, "empty universe of discourse");}
+            if (tokens[1].length >= DEFINITION_MAX_NAME) {return this->fail(line, "name too long");}
+            if (input)
+            {
+                if (input_size == DEFINITION_MAX_INPUT) {return this->fail(line, "too many inputs");}
+                terms = &input_terms[input_size++];
+            }
+            else
+            {
+                if (output_size == DEFINITION_MAX_OUTPUT) {return this->fail(line, "too many outputs");}
+                terms = &output_terms[output_size++];
+            }
+            *terms = 0;
+        }
+        else if (is_token(tokens[0], "set"))
+        {
+            if (terms == 0 || total_rules > 0) {return this->fail(line, "set out of a frame");}
+            u_int thresholds = 0;
+            if (count < 3 || set_type(tokens[2], &thresholds) < 0) {return this->fail(line, "a set is: set name type thresholds");}
+            u_int values = count - 3;
+            if (thresholds > 0 && values != thresholds) {return this->fail(line, "wrong number of thresholds");}
+            if (thresholds == 0 && (values % 2 != 0 || values < 4 || values > 2 * PWL_SIZE)) {return this->fail(line, "wrong number of breakpoints");}
+            for (u_int k=3; k<count; k++)
+            {
+                float v;
+                if (!read_number(tokens[k], &v)) {return this->fail(line, "not a number");}
+            }
+            (*terms)++;
+        }
+        else if (is_token(tokens[0], "rule"))
+        {
+            u_int values = count - 1;
+            if (values > input_size && is_token(tokens[1 + input_size], "->")) {values--;}
+            if (values != input_size + output_size) {return this->fail(line, "a rule has one value per input and per output");}
+            total_rules++;
+        }
+        else {return this->fail(line, "unknown keyword");}
+    }
+    if (input_size == 0 || output_size == 0) {return this->fail(0, "no input or no output");}
+    for (u_int i=0; i<input_size; i++)
+    {
+        if (input_terms[i] == 0) {return this->fail(0, "frame without set");}
+    }
+    for (u_int o=0; o<output_size; o++)
+    {
+        if (output_terms[o] == 0) {return this->fail(0, "frame without set");}
+    }
+    if (total_rules == 0) {return this->fail(0, "no rule");}
+
+    // Second pass: set up the model, keeping the names of the sets for the rules
+    FuzzySystemBuilder builder(input_size, input_terms, output_size, output_terms, total_rules);
+    FuzzyModel* model = builder.Build();
+    if (model == 0) {return this->fail(0, "out of memory");}
+    this->_model = model;
+    u_int total_terms = 0;
+    u_int name_offset[DEFINITION_MAX_INPUT + DEFINITION_MAX_OUTPUT];
+    for (u_int i=0; i<input_size; i++) {name_offset[i] = total_terms; total_terms = total_terms + input_terms[i];}
+    for (u_int o=0; o<output_size; o++) {name_offset[input_size + o] = total_terms; total_terms = total_terms + output_terms[o];}
+    this->_pwl = (FS_pwl*)malloc((size_t)total_terms * sizeof(FS_pwl));
+    if (this->_pwl == 0) {return this->fail(0, "out of memory");}
+    DefinitionToken* names = (DefinitionToken*)malloc((size_t)total_terms * sizeof(DefinitionToken));
+    if (names == 0) {return this->fail(0, "out of memory");}
+
+    u_int inputs = 0, outputs = 0, rule_id = 0;
+    u_int field = 0, set_id = 0;                    // frame of the sets (inputs then outputs) and next set
+    FuzzyFrame* frame = 0;
+    const char* error = 0;
+    line = 0;
+    for (const char* p = text; p < end && error == 0; )
+    {
+        p = split_line(p, end, tokens, &count);
+        line++;
+        if (count == 0) {continue;}
+        if (is_token(tokens[0], "input") || is_token(tokens[0], "output"))
+        {
+            bool input = is_token(tokens[0], "input");
+            float v[3] = {0.0F, 0.0F, 1.0F};
+            for (u_int k=2; k<count; k++) {read_number(tokens[k], &v[k - 2]);}
+            FrameType type = input ? INPUT : OUTPUT;
+            u_int id = input ? inputs++ : outputs++;
+            model->Frame_SetUp(type, id, v[0], v[1]);
+            frame = input ? &model->input(id) : &model->output(id);
+            if (count == 5) {frame->domainSetUp(v[0], v[1], v[2]);}
+            frame->Pwl_SetUp(&this->_pwl[name_offset[input ? id : input_size + id]]);
+            char* name = input ? this->_input_names[id] : this->_output_names[id];
+            memcpy(name, tokens[1].text, tokens[1].length);
+            name[tokens[1].length] = 0;
+            field = input ? id : input_size + id;
+            set_id = 0;
+        }
+        else if (is_token(tokens[0], "set"))
+        {
+            DefinitionToken* frame_names = &names[name_offset[field]];
+            for (u_int t=0; t<set_id; t++)
+            {
+                if (frame_names[t].length == tokens[1].length && memcmp(frame_names[t].text, tokens[1].text, tokens[1].length) == 0) {error = "set defined twice";}
+            }
+            frame_names[set_id] = tokens[1];
+            u_int thresholds = 0;
+            FS_type type = (FS_type)set_type(tokens[2], &thresholds);
+            float v[2 * PWL_SIZE];
+            u_int values = count - 3;
+            for (u_int k=0; k<values; k++) {read_number(tokens[3 + k], &v[k]);}
+            switch (values)
+            {
+            case 1: frame->Set_SetUp(set_id, type, v[0]); break;
+            case 2: frame->Set_SetUp(set_id, type, v[0], v[1]); break;
+            case 3: frame->Set_SetUp(set_id, type, v[0], v[1], v[2]); break;
+            case 4:
+                if (type != PWL) {frame->Set_SetUp(set_id, type, v[0], v[1], v[2], v[3]); break;}
+                // fall through
+            default:
+            {
+                float x[PWL_SIZE], mu[PWL_SIZE];
+                for (u_int k=0; k<values/2; k++) {x[k] = v[2 * k]; mu[k] = v[2 * k + 1];}
+                frame->Set_SetUp(set_id, x, mu, values/2);
+            }
+            }
+            set_id++;
+        }
+        else
+        {
+            // A rule: the index of every value, by name or by number
+            u_int antecedent[DEFINITION_MAX_INPUT];
+            u_int consequent[DEFINITION_MAX_OUTPUT];
+            u_int k = 1;
+            for (u_int f=0; f<input_size + output_size && error == 0; f++, k++)
+            {
+                if (f == input_size && is_token(tokens[k], "->")) {k++;}
+                u_int size = (f < input_size) ? input_terms[f] : output_terms[f - input_size];
+                const DefinitionToken* frame_names = &names[name_offset[f]];
+                u_int index = size;
+                for (u_int t=0; t<size; t++)
+                {
+                    if (frame_names[t].length == tokens[k].length && memcmp(frame_names[t].text, tokens[k].text, tokens[k].length) == 0) {index = t; break;}
+                }
+                float number = -1.0F;
+                if (index == size && read_number(tokens[k], &number) && number >= 0.0F && number < (float)size && number == (float)(u_int)number)
+                {
+                    index = (u_int)number;
+                }
+                if (index == size) {error = "unknown linguistic value";}
+                if (f < input_size) {antecedent[f] = index;}
+                else {consequent[f - input_size] = index;}
+            }
+            if (error == 0) {model->Rule_SetUp(rule_id++, antecedent, consequent);}
+        }
+    }
+    free(names);
+    if (error != 0) {return this->fail(line, error);}
+    for (u_int f=0; f<input_size; f++) {model->input(f).Frame_Refresh();}          // every set is set up
+    for (u_int f=0; f<output_size; f++) {model->output(f).Frame_Refresh();}
+    return true;
+}
+
+FuzzyModel* FuzzyDefinition::get_model(void)
+{
+    return this->_model;
+}
+
+const char* FuzzyDefinition::get_input_name(u_int frame_id)
+{
+    return (frame_id < DEFINITION_MAX_INPUT) ? this->_input_names[frame_id] : "";
+}
+
+const char* FuzzyDefinition::get_output_name(u_int frame_id)
+{
+    return (frame_id < DEFINITION_MAX_OUTPUT) ? this->_output_names[frame_id] : "";
+}
+
+u_int FuzzyDefinition::get_error_line(void)
+{
+    return this->_error_line;
+}
+
+const char* FuzzyDefinition::get_error(void)
+{
+    return this->_error;
+}
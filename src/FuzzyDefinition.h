@@ -0,0 +1,97 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Fuzzy Systems read from a text definition.
+  *
+  * A program that evaluates a FuzzySystem (a command line tool, a server)
+  * should not have to be compiled again for every system. FuzzyDefinition
+  * reads the frames, the FuzzySets and the rules from a text file and places
+  * them in a FuzzyModel (see FuzzyBuilder.h):
+  *
+  *    # Heater of examples/FuzzyLogic2
+  *    input Temperature 0 100                 # name, universe of discourse
+  *    set COLD TRP_L 10 30                    # name, type, thresholds
+  *    set COOL TRP_C 10 30 50 70
+  *    set HOT  TRP_R 50 70
+  *    input Humidity 0 100
+  *    set DRY TRP_L 30 60
+  *    set WET TRP_R 30 60
+  *    output Heat 0 10 0.1                    # the sampling interval is optional
+  *    set LOW TRP_L 2.5 5
+  *    set MED TRI 2.5 5 7.5
+  *    set HIGH TRP_R 5 7.5
+  *    rule COLD DRY -> MED                    # one value per input, then per output
+  *
+  * A set belongs to the frame above it. The types are the names of FS_type:
+  * TRP_L, TRP_R, GAUSS and SIGMOID take 2 thresholds, TRI and GBELL 3, TRP_C
+  * 4, SINGLE 1, and PWL the x and mu of 2 to PWL_SIZE breakpoints. A value of
+  * a rule is the name of a set of its frame or its index, and the "->" is
+  * optional. Every frame comes before the rules. Numbers are read with a
+  * point as decimal separator whatever the locale (see FuzzyCSV.h).
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    FuzzyDefinition definition;
+  *    if (!definition.Load("heater.fzs"))
+  *    {
+  *        printf("line %u: %s\n", definition.get_error_line(), definition.get_error());
+  *    }
+  *    output = definition.get_model()->Defuzzyfication(inputs, 0);
+  *    ```
+  *
+  * The model belongs to the FuzzyDefinition and is released with it or by the
+  * next Load.
+***/
+
+#ifndef FUZZYDEFINITION_H_
+#define FUZZYDEFINITION_H_
+
+#include <stddef.h>
+#include "FuzzyLogic.h"
+#include "FuzzyBuilder.h"
+
+#ifndef DEFINITION_MAX_INPUT
+#define DEFINITION_MAX_INPUT    32      // Maximum number of inputs
+#endif
+
+#ifndef DEFINITION_MAX_OUTPUT
+#define DEFINITION_MAX_OUTPUT   8       // Maximum number of outputs
+#endif
+
+#ifndef DEFINITION_MAX_NAME
+#define DEFINITION_MAX_NAME     32      // Maximum length of a name of frame, with its final 0
+#endif
+
+class FuzzyDefinition
+{
+private:
+    FuzzyModel* _model;
+    FS_pwl* _pwl;                                   // breakpoints of every set of the model
+    char _input_names[DEFINITION_MAX_INPUT][DEFINITION_MAX_NAME];
+    char _output_names[DEFINITION_MAX_OUTPUT][DEFINITION_MAX_NAME];
+    u_int _error_line;
+    const char* _error;
+
+    void release(void);
+    bool fail(u_int line, const char* error);
+
+    FuzzyDefinition(const FuzzyDefinition&);        // not copyable, owns its model
+    FuzzyDefinition& operator=(const FuzzyDefinition&);
+public:
+    FuzzyDefinition();
+    ~FuzzyDefinition();
+
+    // Returns false if the file can not be read or has an error (see
+    // get_error_line and get_error); the previous model is released anyway
+    bool Load(const char* path);
+    bool Parse(const char* text, size_t size);
+
+    FuzzyModel* get_model(void);                    // 0 until a definition is read
+    const char* get_input_name(u_int frame_id);
+    const char* get_output_name(u_int frame_id);
+    u_int get_error_line(void);                     // 0 if the error is not on a line
+    const char* get_error(void);
+};
+
+#endif // FUZZYDEFINITION_H_
@@ -0,0 +1,136 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Forward-mode dual numbers for the templates of FuzzyLogic.h
+  *
+  * A Dual<T, N> carries a value and its gradient with respect to N inputs.
+  * Evaluating a Fuzzy System of Dual numbers gives the crisp output and its
+  * exact derivative over every input in a single Defuzzyfication, instead of
+  * 2*N extra evaluations with perturbed inputs (finite difference).
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    typedef Dual<float, 2> D2;                   // gradient over 2 inputs
+  *    FuzzySetT<D2> Temperature[3];
+  *    FuzzyFrameT<D2> FramesInput[2];
+  *    FuzzyRuleT<D2> myRules[6];
+  *    FuzzySystemT<D2> mySystem(myRules, 6);
+  *    ...                                          // set up as a float system
+  *    D2 inputs[2] = {D2::variable(28.0, 0), D2::variable(65.0, 1)};
+  *    D2 output = mySystem.Defuzzyfication(inputs, 0);
+  *    // output.val, d(output)/d(Temperature) = output.grad[0], ...
+  *    ```
+  *
+  * Comparisons (min, max, piecewise linear segments) only look at the value,
+  * so at a tie the gradient of the chosen operand is kept (one subgradient).
+***/
+
+#ifndef FUZZYDUAL_H_
+#define FUZZYDUAL_H_
+
+#include "FuzzyLogic.h"
+
+template <typename T, u_int N>
+struct Dual
+{
+    T val;
+    T grad[N];
+
+    Dual() : val(0)
+    {
+        for (u_int i=0; i<N; i++) {grad[i] = T(0);}
+    }
+    Dual(T value) : val(value)
+    {
+        // A constant, its gradient is zero
+        for (u_int i=0; i<N; i++) {grad[i] = T(0);}
+    }
+    static Dual variable(T value, u_int indx)
+    {
+        // The input number indx, its gradient is the unit vector
+        Dual d(value);
+        d.grad[indx] = T(1);
+        return d;
+    }
+
+    // Arithmetic, following the chain rule
+    friend Dual operator+(const Dual& a, const Dual& b)
+    {
+        Dual r(a.val + b.val);
+        for (u_int i=0; i<N; i++) {r.grad[i] = a.grad[i] + b.grad[i];}
+        return r;
+    }
+    friend Dual operator-(const Dual& a, const Dual& b)
+    {
+        Dual r(a.val - b.val);
+        for (u_int i=0; i<N; i++) {r.grad[i] = a.grad[i] - b.grad[i];}
+        return r;
+    }
+    friend Dual operator-(const Dual& a)
+    {
+        Dual r(-a.val);
+        for (u_int i=0; i<N; i++) {r.grad[i] = -a.grad[i];}
+        return r;
+    }
+    friend Dual operator*(const Dual& a, const Dual& b)
+    {
+        Dual r(a.val * b.val);
+        for (u_int i=0; i<N; i++) {r.grad[i] = a.grad[i] * b.val + a.val * b.grad[i];}
+        return r;
+    }
+    friend Dual operator/(const Dual& a, const Dual& b)
+    {
+        Dual r(a.val / b.val);
+        T inv = T(1) / b.val;
+        for (u_int i=0; i<N; i++) {r.grad[i] = (a.grad[i] - r.val * b.grad[i]) * inv;}
+        return r;
+    }
+
+    // Comparison of the values only
+    friend bool operator<(const Dual& a, const Dual& b)  {return a.val < b.val;}
+    friend bool operator>(const Dual& a, const Dual& b)  {return a.val > b.val;}
+    friend bool operator<=(const Dual& a, const Dual& b) {return a.val <= b.val;}
+    friend bool operator>=(const Dual& a, const Dual& b) {return a.val >= b.val;}
+    friend bool operator==(const Dual& a, const Dual& b) {return a.val == b.val;}
+    friend bool operator!=(const Dual& a, const Dual& b) {return a.val != b.val;}
+};
+
+/* SCALAR MATH */
+// Found by argument dependent lookup from the templates of FuzzyLogic.h
+template <typename T, u_int N>
+T fuzzy_value(const Dual<T, N>& x)
+{
+    return x.val;
+}
+
+template <typename T, u_int N>
+Dual<T, N> fuzzy_exp(const Dual<T, N>& x)
+{
+    // d(exp(x)) = exp(x) dx
+    Dual<T, N> r(fuzzy_exp(x.val));
+    for (u_int i=0; i<N; i++) {r.grad[i] = r.val * x.grad[i];}
+    return r;
+}
+
+template <typename T, u_int N>
+Dual<T, N> fuzzy_log(const Dual<T, N>& x)
+{
+    // d(log(x)) = dx / x
+    Dual<T, N> r(fuzzy_log(x.val));
+    for (u_int i=0; i<N; i++) {r.grad[i] = x.grad[i] / x.val;}
+    return r;
+}
+
+template <typename T, u_int N>
+Dual<T, N> fuzzy_pow(const Dual<T, N>& x, const Dual<T, N>& y)
+{
+    // d(x^y) = x^y (y dx / x + log(x) dy), with x^y = 0 and zero gradient at x = 0
+    Dual<T, N> r(fuzzy_pow(x.val, y.val));
+    if (!(x.val > T(0))) {return r;}
+    T log_x = fuzzy_log(x.val);
+    for (u_int i=0; i<N; i++) {r.grad[i] = r.val * (y.val * x.grad[i] / x.val + log_x * y.grad[i]);}
+    return r;
+}
+
+#endif // FUZZYDUAL_H_
@@ -0,0 +1,367 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Implementation of FuzzyExporter (see FuzzyExport.h)
+***/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "FuzzyExport.h"
+
+static bool set_is_zero(FuzzySet* set)
+{
+    // True if the degree of membership is zero for every input
+    FS_type type = set->get_param().mu_type;
+    FS_pwl breaks;
+    set->get_pwl(&breaks);
+    const FS_pwl* pwl = &breaks;
+    if (type != TRP_L && type != TRP_C && type != TRP_R && type != TRI && type != PWL) {return false;}
+    if (pwl->n < 1) {return false;}
+    for (u_int i=0; i<pwl->n; i++)
+    {
+        if (pwl->mu[i] != 0.0F) {return false;}
+    }
+    return true;
+}
+
+static bool same_rule(FuzzyRule* r1, FuzzyRule* r2, u_int output_id)
+{
+    const u_int* in1 = r1->get_input_rules();
+    const u_int* in2 = r2->get_input_rules();
+    for (u_int i=0; i<r1->get_input_size(); i++)
+    {
+        if (in1[i] != in2[i]) {return false;}
+    }
+    return r1->get_output_rules()[output_id] == r2->get_output_rules()[output_id];
+}
+
+
+FuzzyExporter::FuzzyExporter(FuzzySystem* system)
+{
+    this->_system = system;
+    this->_dead_rules = 0;
+    this->_duplicate_rules = 0;
+    this->_samples = 0;
+}
+
+void FuzzyExporter::write_float(FILE* file, float value)
+{
+    // Shortest decimal that reads back as the same float, as a float literal
+    char buf[32];
+    if (isnan(value))       {fprintf(file, "NAN"); return;}
+    if (isinf(value))       {fprintf(file, (value > 0.0F) ? "HUGE_VALF" : "(-HUGE_VALF)"); return;}
+    snprintf(buf, sizeof(buf), "%.9g", value);
+    bool has_point = (strpbrk(buf, ".e") != 0);
+    if (value < 0.0F)   {fprintf(file, "(%s%sf)", buf, has_point ? "" : ".0");}
+    else                {fprintf(file, "%s%sf", buf, has_point ? "" : ".0");}
+}
+
+void FuzzyExporter::write_set(FILE* file, FuzzySet* set, const char* x)
+{
+    // Expression of the degree of membership of x, the same arithmetic as FuzzySet::mu_func
+    FS_param param = set->get_param();
+    FS_pwl breaks;
+    set->get_pwl(&breaks);
+    const FS_pwl* pwl = &breaks;
+    switch (param.mu_type)
+    {
+    case TRP_L:
+    case TRP_C:
+    case TRP_R:
+    case TRI:
+    case PWL:
+        if (pwl->n == 0) {fprintf(file, "0.0f"); break;}
+        // Segment k covers (x[k-1], x[k]], anchored at its left breakpoint
+        fprintf(file, "(%s <= ", x);
+        this->write_float(file, pwl->x[0]);
+        fprintf(file, ") ? ");
+        this->write_float(file, pwl->mu[0]);
+        for (u_int k=1; k<pwl->n; k++)
+        {
+            if (!(pwl->x[k] > pwl->x[k-1])) {continue;}         // vertical edge, never selected
+            fprintf(file, "\n        : (%s <= ", x);
+            this->write_float(file, pwl->x[k]);
+            fprintf(file, ") ? ");
+            this->write_float(file, pwl->mu[k-1]);
+            fprintf(file, " + ");
+            this->write_float(file, pwl->slope[k]);
+            fprintf(file, " * (%s - ", x);
+            this->write_float(file, pwl->x[k-1]);
+            fprintf(file, ")");
+        }
+        fprintf(file, "\n        : ");
+        this->write_float(file, pwl->mu[pwl->n - 1]);
+        break;
+    case SINGLE:
+        fprintf(file, "(%s == ", x);
+        this->write_float(file, param.thr1);
+        fprintf(file, ") ? 1.0f : 0.0f");
+        break;
+    case GAUSS:
+        fprintf(file, "fz_gaussian(");
+        this->write_float(file, param.thr1);
+        fprintf(file, ", ");
+        this->write_float(file, param.thr2);
+        fprintf(file, ", %s)", x);
+        break;
+    case GBELL:
+        fprintf(file, "fz_generalized_bell(");
+        this->write_float(file, param.thr1);
+        fprintf(file, ", ");
+        this->write_float(file, param.thr2);
+        fprintf(file, ", ");
+        this->write_float(file, param.thr3);
+        fprintf(file, ", %s)", x);
+        break;
+    case SIGMOID:
+        fprintf(file, "fz_sigmoid(");
+        this->write_float(file, param.thr1);
+        fprintf(file, ", ");
+        this->write_float(file, param.thr2);
+        fprintf(file, ", %s)", x);
+        break;
+    default:
+        fprintf(file, "0.0f");
+    }
+}
+
+void FuzzyExporter::write_table(FILE* file, FuzzyFrame* frame, u_int input)
+{
+    // Lookup table of the frame and the row of x, the same arithmetic as FuzzyFrame::get_muvalue
+    u_int n = frame->get_size();
+    u_int points = frame->get_table_points();
+    const float* table = frame->get_table();
+    UnivDisc domain = frame->get_domain();
+    float step = (domain.up_bond - domain.low_bond) / (float)(points - 1);
+    float inv_step = 1.0F / step;
+    fprintf(file, "    static const float table_%u[%u] = {", input, points * n);
+    for (u_int p=0; p<points; p++)
+    {
+        fprintf(file, "\n       ");
+        for (u_int k=0; k<n; k++)
+        {
+            fprintf(file, " ");
+            this->write_float(file, table[p*n + k]);
+            if (p*n + k + 1 < points * n) {fprintf(file, ",");}
+        }
+    }
+    fprintf(file, "};\n");
+    fprintf(file, "    const float* row_%u = 0;\n    float f_%u = 0.0f;\n", input, input);
+    fprintf(file, "    if (x%u >= ", input);
+    this->write_float(file, domain.low_bond);
+    fprintf(file, " && x%u <= ", input);
+    this->write_float(file, domain.up_bond);
+    fprintf(file, ")\n    {\n        float t = (x%u - ", input);
+    this->write_float(file, domain.low_bond);
+    fprintf(file, ") * ");
+    this->write_float(file, inv_step);
+    fprintf(file, ";\n        unsigned int p = (unsigned int)t;\n");
+    fprintf(file, "        p = (p < %uu) ? p : %uu;\n", points - 1, points - 2);
+    fprintf(file, "        f_%u = t - (float)p;\n        row_%u = &table_%u[p * %uu];\n    }\n", input, input, input, n);
+}
+
+bool FuzzyExporter::Export(FILE* file, const char* function_name, u_int output_id)
+{
+    this->_dead_rules = 0;
+    this->_duplicate_rules = 0;
+    this->_samples = 0;
+
+    FlatSystem flat;
+    if (file == 0 || !flat_system(this->_system, &flat)) {return false;}
+    FuzzyRule* rules = flat.rules;
+    u_int total_rules = flat.total_rules;
+    u_int input_size = flat.input_size;
+    FuzzyFrame* input_frames = flat.input_frames;
+    FuzzyFrame* output_frames = flat.output_frames;
+    if (output_id >= flat.output_size) {return false;}
+
+    // Output samples, the same float values as the loop of Defuzzyfication
+    UnivDisc domain = output_frames[output_id].get_domain();
+    u_int n_samples = domain_samples(domain);
+    if (n_samples == 0) {return false;}
+
+    u_int n_terms = output_frames[output_id].get_size();
+    u_int n_input_terms = 0;
+    for (u_int i=0; i<input_size; i++) {n_input_terms = n_input_terms + input_frames[i].get_size();}
+
+    float* ys = (float*)malloc(n_samples * sizeof(float));
+    float* consequent = (float*)malloc(n_terms * n_samples * sizeof(float) + 1);
+    bool* live = (bool*)calloc(total_rules + 1, sizeof(bool));
+    bool* used_input = (bool*)calloc(n_input_terms + 1, sizeof(bool));
+    bool* used_term = (bool*)calloc(n_terms + 1, sizeof(bool));
+    if (ys == 0 || consequent == 0 || live == 0 || used_input == 0 || used_term == 0)
+    {
+        free(ys); free(consequent); free(live); free(used_input); free(used_term);
+        return false;
+    }
+    u_int s = 0;
+    for (float y = domain.low_bond; y <= domain.up_bond && s < n_samples; y = y+domain.interval) {ys[s++] = y;}
+    for (u_int c=0; c<n_terms; c++)
+    {
+        for (s=0; s<n_samples; s++) {consequent[c*n_samples + s] = output_frames[output_id].get_muvalue(c, ys[s]);}
+    }
+
+    // Rules that can fire, without duplicates
+    for (u_int r=0; r<total_rules; r++)
+    {
+        const u_int* antecedent = rules[r].get_input_rules();
+        u_int term = rules[r].get_output_rules()[output_id];
+        bool dead = (term >= n_terms);
+        for (u_int i=0; i<input_size && !dead; i++)
+        {
+            dead = (antecedent[i] >= (u_int)input_frames[i].get_size())
+                || set_is_zero(&input_frames[i].getFSAddress()[antecedent[i]]);
+        }
+        if (!dead)
+        {
+            dead = true;
+            for (s=0; s<n_samples; s++) {dead = dead && (consequent[term*n_samples + s] == 0.0F);}
+        }
+        if (dead) {this->_dead_rules++; continue;}
+
+        bool duplicate = false;
+        for (u_int q=0; q<r && !duplicate; q++) {duplicate = live[q] && same_rule(&rules[q], &rules[r], output_id);}
+        if (duplicate) {this->_duplicate_rules++; continue;}
+
+        live[r] = true;
+        used_term[term] = true;
+        u_int offset = 0;
+        for (u_int i=0; i<input_size; i++)
+        {
+            used_input[offset + antecedent[i]] = true;
+            offset = offset + input_frames[i].get_size();
+        }
+    }
+
+    // Header and operators
+    fprintf(file, "/* Generated by FuzzyExporter: output %u of a FuzzySystem with %u rules (%u dead, %u duplicate removed),\n",
+            output_id, total_rules, this->_dead_rules, this->_duplicate_rules);
+    fprintf(file, "   %u inputs, centroid over %u output samples. Operators: minimum, maximum, Mamdani implication. */\n\n", input_size, n_samples);
+#ifdef FUZZY_FAST_EXP
+    // The same fast_exp2 and fast_log2 as the library
+    fprintf(file, "#include <stdint.h>\n#include <string.h>\n\n");
+    fprintf(file, "#ifndef FZ_EXPORT_OPERATORS\n#define FZ_EXPORT_OPERATORS\n");
+    fprintf(file, "static inline float fz_exp2(float x)\n{\n");
+    fprintf(file, "    float t, f, p, low = -127.0f, high = 128.0f;\n    int32_t n, bits, bound, keep, under, over;\n");
+    fprintf(file, "    memcpy(&bits, &x, sizeof(bits));\n    memcpy(&bound, &low, sizeof(bound));\n");
+    fprintf(file, "    keep = -(int32_t)(x > low);\n    bits = (bits & keep) | (bound & ~keep);\n    memcpy(&x, &bits, sizeof(x));\n");
+    fprintf(file, "    memcpy(&bound, &high, sizeof(bound));\n");
+    fprintf(file, "    keep = -(int32_t)(x < high);\n    bits = (bits & keep) | (bound & ~keep);\n    memcpy(&x, &bits, sizeof(x));\n");
+    fprintf(file, "    t = x + 12582912.0f;\n    memcpy(&n, &t, sizeof(n));\n    n = n - 0x4B400000;\n    f = x - (t - 12582912.0f);\n");
+    fprintf(file, "    p = 1.5403530e-4f;\n    p = p * f + 1.3333558e-3f;\n    p = p * f + 9.6181291e-3f;\n    p = p * f + 5.5504109e-2f;\n");
+    fprintf(file, "    p = p * f + 2.4022651e-1f;\n    p = p * f + 6.9314718e-1f;\n    p = p * f + 1.0f;\n");
+    fprintf(file, "    memcpy(&bits, &p, sizeof(bits));\n    bits = bits + n * (int32_t)0x00800000;\n");
+    fprintf(file, "    under = -(int32_t)(n < -126);\n    over = -(int32_t)(n > 127);\n");
+    fprintf(file, "    bits = bits & ~under;\n    bits = (bits & ~over) | (over & 0x7F800000);\n");
+    fprintf(file, "    memcpy(&p, &bits, sizeof(p));\n    return p;\n}\n");
+    fprintf(file, "static inline float fz_log2(float x)\n{\n");
+    fprintf(file, "    float m, s, s2, p, result;\n    int32_t bits, zero, big, e;\n");
+    fprintf(file, "    memcpy(&bits, &x, sizeof(bits));\n    zero = -(int32_t)(bits < 0x00800000);\n");
+    fprintf(file, "    big = (int32_t)((bits & 0x007FFFFF) > 0x003504F3);\n    e = ((bits >> 23) & 0xFF) - 127 + big;\n");
+    fprintf(file, "    bits = ((bits & 0x007FFFFF) | 0x3F800000) - big * (int32_t)0x00800000;\n    memcpy(&m, &bits, sizeof(m));\n");
+    fprintf(file, "    s = (m - 1.0f) / (m + 1.0f);\n    s2 = s * s;\n");
+    fprintf(file, "    p = 0.14285714f;\n    p = p * s2 + 0.2f;\n    p = p * s2 + 0.33333333f;\n    p = p * s2 + 1.0f;\n");
+    fprintf(file, "    result = (float)e + 2.88539008f * s * p;\n    memcpy(&bits, &result, sizeof(bits));\n");
+    fprintf(file, "    bits = (bits & ~zero) | (zero & (int32_t)0xFF800000);\n    memcpy(&result, &bits, sizeof(result));\n    return result;\n}\n");
+    fprintf(file, "static inline float fz_exp(float x) {return fz_exp2(x * 1.44269504f);}\n");
+    fprintf(file, "static inline float fz_pow(float x, float y) {return fz_exp2(y * fz_log2(x));}\n");
+#else
+    fprintf(file, "#include <math.h>\n\n");
+    fprintf(file, "#ifndef FZ_EXPORT_OPERATORS\n#define FZ_EXPORT_OPERATORS\n");
+    fprintf(file, "static inline float fz_exp(float x) {return expf(x);}\n");
+    fprintf(file, "static inline float fz_pow(float x, float y) {return powf(x, y);}\n");
+#endif
+    fprintf(file, "static inline float fz_min(float a, float b) {return (a < b) ? a : b;}\n");
+    fprintf(file, "static inline float fz_max(float a, float b) {return (a > b) ? a : b;}\n");
+    fprintf(file, "static inline float fz_gaussian(float c, float sigma, float x) {float u = (x - c) / sigma; return fz_exp(-0.5f * u * u);}\n");
+    fprintf(file, "static inline float fz_generalized_bell(float a, float b, float c, float x) {float u = (x - c) / a; return 1.0f / (1.0f + fz_pow(u * u, b));}\n");
+    fprintf(file, "static inline float fz_sigmoid(float a, float c, float x) {return 1.0f / (1.0f + fz_exp(-a * (x - c)));}\n");
+    fprintf(file, "#endif\n\n");
+    fprintf(file, "float %s(const float* input)\n{\n", function_name);
+
+    // Degree of membership of every antecedent used by a rule
+    u_int offset = 0;
+    for (u_int i=0; i<input_size; i++)
+    {
+        char x[32];
+        snprintf(x, sizeof(x), "x%u", i);
+        bool used = false;
+        for (u_int t=0; t<(u_int)input_frames[i].get_size(); t++) {used = used || used_input[offset + t];}
+        if (used) {fprintf(file, "    const float %s = input[%u];\n", x, i);}
+        bool table = used && input_frames[i].get_table() != 0;
+        if (table) {this->write_table(file, &input_frames[i], i);}
+        u_int n = input_frames[i].get_size();
+        for (u_int t=0; t<n; t++)
+        {
+            if (!used_input[offset + t]) {continue;}
+            fprintf(file, "    const float mu_%u_%u = ", i, t);
+            if (table) {fprintf(file, "(row_%u != 0) ? row_%u[%u] + f_%u * (row_%u[%u] - row_%u[%u])\n        : (", i, i, t, i, i, n + t, i, t);}
+            this->write_set(file, &input_frames[i].getFSAddress()[t], x);
+            if (table) {fprintf(file, ")");}
+            fprintf(file, ";\n");
+        }
+        offset = offset + input_frames[i].get_size();
+    }
+
+    // Degree of fulfillment of the rules, one maximum per consequent
+    fprintf(file, "\n");
+    for (u_int c=0; c<n_terms; c++)
+    {
+        if (!used_term[c]) {continue;}
+        fprintf(file, "    float alpha_%u = 0.0f;\n", c);
+        for (u_int r=0; r<total_rules; r++)
+        {
+            if (!live[r] || rules[r].get_output_rules()[output_id] != c) {continue;}
+            const u_int* antecedent = rules[r].get_input_rules();
+            fprintf(file, "    alpha_%u = fz_max(alpha_%u, ", c, c);
+            for (u_int i=input_size; i>0; i--) {fprintf(file, "fz_min(mu_%u_%u, ", i-1, antecedent[i-1]);}
+            fprintf(file, "1.0f");
+            for (u_int i=0; i<input_size; i++) {fprintf(file, ")");}
+            fprintf(file, ");       /* rule %u */\n", r);
+        }
+    }
+
+    // Output sweep and centroid
+    fprintf(file, "\n    float mu;\n    float weight = 0.0f;\n    float weight_avg = 0.0f;\n");
+    for (s=0; s<n_samples; s++)
+    {
+        bool active = false;
+        for (u_int c=0; c<n_terms; c++) {active = active || (used_term[c] && consequent[c*n_samples + s] != 0.0F);}
+        if (!active) {continue;}
+        this->_samples++;
+        fprintf(file, "    mu = 0.0f;");
+        for (u_int c=0; c<n_terms; c++)
+        {
+            if (!used_term[c] || consequent[c*n_samples + s] == 0.0F) {continue;}
+            fprintf(file, " mu = fz_max(mu, fz_min(alpha_%u, ", c);
+            this->write_float(file, consequent[c*n_samples + s]);
+            fprintf(file, "));");
+        }
+        fprintf(file, "\n    weight = weight + mu;  weight_avg = weight_avg + mu * ");
+        this->write_float(file, ys[s]);
+        fprintf(file, ";\n");
+    }
+    fprintf(file, "    if (weight == 0.0f) {weight = 1.0f;}\n");
+    fprintf(file, "    return weight_avg / weight;\n}\n");
+
+    free(ys); free(consequent); free(live); free(used_input); free(used_term);
+    return ferror(file) == 0;
+}
+
+u_int FuzzyExporter::get_removed_rules(void)
+{
+    return this->_dead_rules + this->_duplicate_rules;
+}
+u_int FuzzyExporter::get_dead_rules(void)
+{
+    return this->_dead_rules;
+}
+u_int FuzzyExporter::get_duplicate_rules(void)
+{
+    return this->_duplicate_rules;
+}
+u_int FuzzyExporter::get_samples(void)
+{
+    return this->_samples;
+}
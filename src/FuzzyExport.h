@@ -0,0 +1,73 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Export of a configured FuzzySystem as standalone C source.
+  *
+  * The FuzzyExporter writes one C function (also valid C++) that computes the
+  * same crisp output as FuzzySystem::Defuzzyfication(input, output_id) for the
+  * default operators (minimum, maximum and Mamdani implication), without the
+  * library and without any interpretation at run time:
+  *
+  *    - every parameter of the FuzzySets is a literal and every piecewise
+  *      linear set is an unrolled chain of comparisons
+  *    - each antecedent FuzzySet is evaluated once, instead of once per rule
+  *      and per output sample
+  *    - dead rules are removed: rules with an antecedent FuzzySet that is zero
+  *      everywhere, rules whose consequent is zero at every output sample and
+  *      duplicates of an earlier rule (same antecedent and consequent)
+  *    - rules with the same consequent share one maximum, since
+  *      max(min(a1, mu), min(a2, mu)) = min(max(a1, a2), mu)
+  *    - the degrees of membership of the consequents at the output samples are
+  *      precomputed, and the output sweep is fully unrolled (samples where no
+  *      consequent is active are skipped)
+  *    - an input frame with a lookup table (Table_SetUp) is written as the
+  *      same table and interpolation, and GAUSS, GBELL and SIGMOID use the
+  *      same fast_exp2/fast_log2 code when the exporter is built with
+  *      FUZZY_FAST_EXP
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    FuzzyExporter exporter(&mySystem);
+  *    FILE* file = fopen("heater.c", "w");
+  *    exporter.Export(file, "heater_power", 0);    // float heater_power(const float* input)
+  *    fclose(file);
+  *    ```
+  *
+  * The sums of the centroid are done in the same order as the library, so the
+  * result is the same as Defuzzyfication when both are compiled with the same
+  * floating point options. examples/FuzzyExport checks it.
+***/
+
+#ifndef FUZZYEXPORT_H_
+#define FUZZYEXPORT_H_
+
+#include <stdio.h>
+#include "FuzzyLogic.h"
+
+class FuzzyExporter
+{
+private:
+    FuzzySystem* _system;
+    u_int _dead_rules;          // never fire
+    u_int _duplicate_rules;     // same antecedent and consequent as an earlier rule
+    u_int _samples;             // output samples written in the sweep
+
+    void write_float(FILE* file, float value);
+    void write_set(FILE* file, FuzzySet* set, const char* x);
+    void write_table(FILE* file, FuzzyFrame* frame, u_int input);
+public:
+    FuzzyExporter(FuzzySystem* system);
+
+    // Returns false if the system can not be exported (no rule, rules with
+    // different frames, empty output domain or an error of the file)
+    bool Export(FILE* file, const char* function_name, u_int output_id);
+
+    // Statistics of the last Export
+    u_int get_removed_rules(void);
+    u_int get_dead_rules(void);
+    u_int get_duplicate_rules(void);
+    u_int get_samples(void);
+};
+
+#endif // FUZZYEXPORT_H_
@@ -0,0 +1,311 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Implementation of FuzzyIndex (see FuzzyIndex.h)
+***/
+
+#include <stdlib.h>
+#include "FuzzyIndex.h"
+
+static int compare_u_int(const void* a, const void* b)
+{
+    u_int x = *(const u_int*)a;
+    u_int y = *(const u_int*)b;
+    return (x > y) - (x < y);
+}
+
+FuzzyIndex::FuzzyIndex()
+{
+    this->_system = 0;
+    this->_input_size = 0;
+    this->_output_size = 0;
+    this->_total_rules = 0;
+    this->_arena = 0;
+    this->_nodes = 0;
+    this->_indexed = 0;
+    this->_candidates = 0;
+}
+
+FuzzyIndex::~FuzzyIndex()
+{
+    this->release();
+}
+
+void FuzzyIndex::release(void)
+{
+    free(this->_arena);
+    this->_arena = 0;
+    this->_total_rules = 0;
+    this->_nodes = 0;
+    this->_indexed = 0;
+    this->_candidates = 0;
+}
+
+bool FuzzyIndex::Index_SetUp(FuzzySystem* system)
+{
+    this->release();
+    FlatSystem flat;
+    if (!flat_system(system, &flat)) {return false;}
+    FuzzyRule* rules = flat.rules;
+    u_int total_rules = flat.total_rules;
+    u_int input_size = flat.input_size;
+    u_int output_size = flat.output_size;
+    FuzzyFrame* input_frames = flat.input_frames;
+    FuzzyFrame* output_frames = flat.output_frames;
+    if (input_size == 0 || input_size > INDEX_MAX_INPUT || output_size == 0 || output_size > INDEX_MAX_OUTPUT) {return false;}
+
+    // Output samples and consequents, as FuzzyParallel
+    u_int total_samples = 0;
+    u_int total_mu = 0;
+    u_int max_samples = 0;
+    for (u_int o=0; o<output_size; o++)
+    {
+        u_int samples = domain_samples(output_frames[o].get_domain());
+        if (samples == 0) {return false;}
+        this->_samples[o] = samples;
+        this->_terms[o] = output_frames[o].get_size();
+        this->_sample_offset[o] = total_samples;
+        this->_mu_offset[o] = total_mu;
+        total_samples = total_samples + samples;
+        total_mu = total_mu + this->_terms[o] * samples;
+        max_samples = (samples > max_samples) ? samples : max_samples;
+    }
+
+    // A median split leaves at most INDEX_LEAF_SIZE rules and at least half
+    // of that in a leaf, so 2 * rules / (INDEX_LEAF_SIZE / 2) nodes are enough
+    u_int max_nodes = 2 * (total_rules / ((INDEX_LEAF_SIZE + 1) / 2) + 1);
+    size_t size = (size_t)total_rules * 2 * input_size * sizeof(float)
+                + (size_t)total_rules * sizeof(u_int)
+                + (size_t)total_rules * sizeof(float)
+                + (size_t)max_nodes * 2 * input_size * sizeof(float)
+                + (size_t)max_nodes * 3 * sizeof(u_int)
+                + (size_t)total_rules * sizeof(u_int)
+                + (size_t)total_samples * sizeof(float)
+                + (size_t)total_mu * sizeof(float)
+                + (size_t)max_samples * sizeof(float);
+    char* p = (char*)malloc(size);
+    if (p == 0) {return false;}
+    this->_arena = p;
+    this->_rule_box = (float*)p;        p = p + (size_t)total_rules * 2 * input_size * sizeof(float);
+    this->_rule_id = (u_int*)p;         p = p + (size_t)total_rules * sizeof(u_int);
+    this->_center = (float*)p;          p = p + (size_t)total_rules * sizeof(float);
+    this->_node_box = (float*)p;        p = p + (size_t)max_nodes * 2 * input_size * sizeof(float);
+    this->_node_first = (u_int*)p;      p = p + (size_t)max_nodes * sizeof(u_int);
+    this->_node_count = (u_int*)p;      p = p + (size_t)max_nodes * sizeof(u_int);
+    this->_node_right = (u_int*)p;      p = p + (size_t)max_nodes * sizeof(u_int);
+    this->_found = (u_int*)p;           p = p + (size_t)total_rules * sizeof(u_int);
+    this->_ys = (float*)p;              p = p + (size_t)total_samples * sizeof(float);
+    this->_mu_output = (float*)p;       p = p + (size_t)total_mu * sizeof(float);
+    this->_out = (float*)p;
+
+    // Box of every rule; a rule with an antecedent out of its frame never
+    // fires and is left out of the tree
+    float widen[INDEX_MAX_INPUT];
+    for (u_int i=0; i<input_size; i++)
+    {
+        UnivDisc domain = input_frames[i].get_domain();
+        u_int points = input_frames[i].get_table_points();
+        widen[i] = (points > 1) ? (domain.up_bond - domain.low_bond) / (float)(points - 1) : 0.0F;
+    }
+    u_int indexed = 0;
+    for (u_int r=0; r<total_rules; r++)
+    {
+        const u_int* antecedent = rules[r].get_input_rules();
+        float* box = &this->_rule_box[(size_t)r * 2 * input_size];
+        bool valid = true;
+        for (u_int i=0; i<input_size && valid; i++)
+        {
+            valid = antecedent[i] < (u_int)input_frames[i].get_size();
+            if (!valid) {break;}
+            input_frames[i].getFSAddress()[antecedent[i]].get_support(&box[i], &box[input_size + i]);
+            box[i] = box[i] - widen[i];
+            box[input_size + i] = box[input_size + i] + widen[i];
+        }
+        if (valid) {this->_rule_id[indexed++] = r;}
+    }
+
+    this->_system = system;
+    this->_input_size = input_size;
+    this->_output_size = output_size;
+    this->_total_rules = total_rules;
+    this->_indexed = indexed;
+    this->_nodes = 0;
+    if (indexed > 0) {this->build(0, indexed, 0);}
+
+    for (u_int o=0; o<output_size; o++)
+    {
+        UnivDisc domain = output_frames[o].get_domain();
+        float* ys = &this->_ys[this->_sample_offset[o]];
+        float* mu = &this->_mu_output[this->_mu_offset[o]];
+        u_int s = 0;
+        for (float y = domain.low_bond; y <= domain.up_bond && s < this->_samples[o]; y = y+domain.interval) {ys[s++] = y;}
+        for (u_int t=0; t<this->_terms[o]; t++)
+        {
+            for (s=0; s<this->_samples[o]; s++) {mu[(size_t)t * this->_samples[o] + s] = output_frames[o].get_muvalue(t, ys[s]);}
+        }
+    }
+    return true;
+}
+
+u_int FuzzyIndex::build(u_int first, u_int count, u_int depth)
+{
+    // Node over _rule_id[first .. first+count-1], returns its index
+    u_int n = this->_input_size;
+    u_int node = this->_nodes++;
+    float* node_box = &this->_node_box[(size_t)node * 2 * n];
+    for (u_int i=0; i<n; i++)
+    {
+        node_box[i] = HUGE_VALF;
+        node_box[n + i] = -HUGE_VALF;
+    }
+    for (u_int k=first; k<first + count; k++)
+    {
+        const float* box = &this->_rule_box[(size_t)this->_rule_id[k] * 2 * n];
+        for (u_int i=0; i<n; i++)
+        {
+            node_box[i] = (box[i] < node_box[i]) ? box[i] : node_box[i];
+            node_box[n + i] = (box[n + i] > node_box[n + i]) ? box[n + i] : node_box[n + i];
+        }
+    }
+    this->_node_first[node] = first;
+    this->_node_count[node] = count;
+    if (count <= INDEX_LEAF_SIZE || depth + 1 >= INDEX_MAX_DEPTH) {return node;}
+
+    // Widest spread of the centers, the infinite bounds clamped to the domain
+    FuzzyFrame* frames = this->_system->get_rules()[0].get_input_frames();
+    u_int axis = 0;
+    float widest = -1.0F;
+    for (u_int i=0; i<n; i++)
+    {
+        UnivDisc domain = frames[i].get_domain();
+        float low = HUGE_VALF;
+        float high = -HUGE_VALF;
+        for (u_int k=first; k<first + count; k++)
+        {
+            const float* box = &this->_rule_box[(size_t)this->_rule_id[k] * 2 * n];
+            float a = (box[i] > domain.low_bond) ? box[i] : domain.low_bond;
+            float b = (box[n + i] < domain.up_bond) ? box[n + i] : domain.up_bond;
+            float c = 0.5F * (a + b);
+            low = (c < low) ? c : low;
+            high = (c > high) ? c : high;
+        }
+        if (high - low > widest)
+        {
+            widest = high - low;
+            axis = i;
+        }
+    }
+    if (!(widest > 0.0F)) {return node;}        // every center is the same, nothing to split
+
+    UnivDisc domain = frames[axis].get_domain();
+    for (u_int k=first; k<first + count; k++)
+    {
+        const float* box = &this->_rule_box[(size_t)this->_rule_id[k] * 2 * n];
+        float a = (box[axis] > domain.low_bond) ? box[axis] : domain.low_bond;
+        float b = (box[n + axis] < domain.up_bond) ? box[n + axis] : domain.up_bond;
+        this->_center[k] = 0.5F * (a + b);
+    }
+    u_int half = count / 2;
+    this->select(first, count, half);
+    this->_node_count[node] = 0;
+    this->build(first, half, depth + 1);
+    this->_node_right[node] = this->build(first + half, count - half, depth + 1);
+    return node;
+}
+
+void FuzzyIndex::select(u_int first, u_int count, u_int nth)
+{
+    /*
+    Quickselect on _center[first ..] (with _rule_id alongside): afterwards the
+    nth element is in its sorted place, the ones before it are not greater
+    and the ones after it are not smaller
+    */
+    long low = first;
+    long high = (long)first + count - 1;
+    long target = (long)first + nth;
+    while (low < high)
+    {
+        float pivot = this->_center[low + (high - low) / 2];
+        long i = low;
+        long j = high;
+        while (i <= j)
+        {
+            while (this->_center[i] < pivot) {i++;}
+            while (this->_center[j] > pivot) {j--;}
+            if (i <= j)
+            {
+                float c = this->_center[i]; this->_center[i] = this->_center[j]; this->_center[j] = c;
+                u_int r = this->_rule_id[i]; this->_rule_id[i] = this->_rule_id[j]; this->_rule_id[j] = r;
+                i++;
+                j--;
+            }
+        }
+        if (target <= j) {high = j;}
+        else if (target >= i) {low = i;}
+        else {break;}
+    }
+}
+
+void FuzzyIndex::search(const float* input)
+{
+    // Depth first over the nodes whose box contains input
+    u_int n = this->_input_size;
+    u_int found = 0;
+    u_int stack[INDEX_MAX_DEPTH + 1];
+    u_int top = 0;
+    if (this->_nodes > 0) {stack[top++] = 0;}
+    while (top > 0)
+    {
+        u_int node = stack[--top];
+        const float* box = &this->_node_box[(size_t)node * 2 * n];
+        bool inside = true;
+        for (u_int i=0; i<n && inside; i++) {inside = input[i] >= box[i] && input[i] <= box[n + i];}
+        if (!inside) {continue;}
+        if (this->_node_count[node] == 0)
+        {
+            stack[top++] = this->_node_right[node];
+            stack[top++] = node + 1;
+            continue;
+        }
+        u_int last = this->_node_first[node] + this->_node_count[node];
+        for (u_int k=this->_node_first[node]; k<last; k++)
+        {
+            u_int r = this->_rule_id[k];
+            const float* rule_box = &this->_rule_box[(size_t)r * 2 * n];
+            bool contains = true;
+            for (u_int i=0; i<n && contains; i++) {contains = input[i] >= rule_box[i] && input[i] <= rule_box[n + i];}
+            if (contains) {this->_found[found++] = r;}
+        }
+    }
+    // The S-norms other than maximum depend on the order of the rules
+    if (found > 1) {qsort(this->_found, found, sizeof(u_int), compare_u_int);}
+    this->_candidates = found;
+}
+
+float FuzzyIndex::Defuzzyfication(const float* input, u_int output_id)
+{
+    return this->Defuzzyfication<TNormMin, SNormMax, ImpMamdani>(input, output_id);
+}
+
+u_int FuzzyIndex::Query(const float* input, u_int* rule_ids)
+{
+    if (this->_total_rules == 0) {return 0;}
+    this->search(input);
+    for (u_int k=0; k<this->_candidates; k++) {rule_ids[k] = this->_found[k];}
+    return this->_candidates;
+}
+
+u_int FuzzyIndex::get_candidates(void)
+{
+    return this->_candidates;
+}
+
+u_int FuzzyIndex::get_nodes(void)
+{
+    return this->_nodes;
+}
+
+u_int FuzzyIndex::get_indexed(void)
+{
+    return this->_indexed;
+}
@@ -0,0 +1,153 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Spatial index over the supports of the rules of a sparse FuzzySystem.
+  *
+  * A rule can only fire when every input is inside the support of its
+  * antecedent (the interval outside of which the FuzzySet is 0, see
+  * FuzzySet::get_support), so the support of a rule is a box in the input
+  * space. Rule bases learned from data cover that space sparsely and only a
+  * few boxes contain a given input, but FuzzySystem::Defuzzyfication evaluates
+  * every rule. FuzzyIndex builds, once, a tree of bounding boxes over the
+  * boxes of the rules (split at the median of their centers along the widest
+  * axis, at most INDEX_LEAF_SIZE rules per leaf) and, for every query, visits
+  * only the nodes whose box contains the input. The cost grows with the number
+  * of rules that can fire instead of with the size of the rule base.
+  *
+  * The rules found are evaluated in the order of the system, with the
+  * degrees of membership of the consequents at the output samples computed
+  * once in Index_SetUp. Skipping the other rules is exact: their degree of
+  * fulfillment is 0, the implication gives 0, and 0 is the identity of every
+  * S-norm of the library.
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    FuzzyIndex index;
+  *    index.Index_SetUp(&mySparseSystem);
+  *    output = index.Defuzzyfication(inputs, 0);          // same as mySparseSystem.Defuzzyfication(inputs, 0)
+  *    output = index.Defuzzyfication<TNormProduct, SNormProbSum, ImpLarsen>(inputs, 0);
+  *    u_int found = index.get_candidates();               // rules evaluated by the last query
+  *    ```
+  *
+  * The supports are taken in Index_SetUp: set it up again after changing the
+  * FuzzySets or the rules. An input frame with a lookup table widens the
+  * boxes by one step of the table, where the interpolation is not 0 yet.
+***/
+
+#ifndef FUZZYINDEX_H_
+#define FUZZYINDEX_H_
+
+#include "FuzzyLogic.h"
+
+#ifndef INDEX_MAX_INPUT
+#define INDEX_MAX_INPUT         32      // Maximum number of inputs
+#endif
+
+#ifndef INDEX_MAX_OUTPUT
+#define INDEX_MAX_OUTPUT        8       // Maximum number of outputs
+#endif
+
+#ifndef INDEX_LEAF_SIZE
+#define INDEX_LEAF_SIZE         8       // Maximum number of rules in a leaf
+#endif
+
+#define INDEX_MAX_DEPTH         64      // median splits: 2^64 rules
+
+class FuzzyIndex
+{
+private:
+    FuzzySystem* _system;
+    u_int _input_size, _output_size, _total_rules;
+    void* _arena;                                   // every array below, one allocation
+    float* _rule_box;                               // per rule, input_size lows then input_size highs
+    u_int* _rule_id;                                // rules in the order of the leaves
+    float* _center;                                 // scratch of Index_SetUp, per rule
+    float* _node_box;                               // per node, as _rule_box
+    u_int* _node_first;                             // leaf: first index in _rule_id
+    u_int* _node_count;                             // leaf: number of rules, 0 for an inner node
+    u_int* _node_right;                             // inner node: its right child (the left one follows it)
+    u_int _nodes, _indexed;                         // _indexed: rules that can fire at all
+    u_int* _found;                                  // rules of the current query
+    u_int _candidates;
+    float* _ys;                                     // output samples of every output
+    float* _mu_output;                              // consequents at the output samples
+    float* _out;                                    // fuzzy output of the current query
+    u_int _samples[INDEX_MAX_OUTPUT];
+    u_int _terms[INDEX_MAX_OUTPUT];
+    u_int _sample_offset[INDEX_MAX_OUTPUT];
+    u_int _mu_offset[INDEX_MAX_OUTPUT];
+
+    void release(void);
+    u_int build(u_int first, u_int count, u_int depth);
+    void select(u_int first, u_int count, u_int nth);
+    void search(const float* input);
+
+    FuzzyIndex(const FuzzyIndex&);                  // not copyable
+    FuzzyIndex& operator=(const FuzzyIndex&);
+public:
+    FuzzyIndex();
+    ~FuzzyIndex();
+
+    // Returns false if the system has no rule, rules with different frames,
+    // too many inputs or outputs, an empty output domain or if the allocation
+    // fails
+    bool Index_SetUp(FuzzySystem* system);
+
+    float Defuzzyfication(const float* input, u_int output_id);
+    template <class TNorm, class SNorm, class Implication>
+    float Defuzzyfication(const float* input, u_int output_id);
+
+    // Rules whose support contains input, in the order of the system;
+    // rule_ids must hold get_total_rules() values. Returns their number
+    u_int Query(const float* input, u_int* rule_ids);
+
+    u_int get_candidates(void);                     // rules found by the last query
+    u_int get_nodes(void);
+    u_int get_indexed(void);
+};
+
+
+/* TEMPLATE METHODS */
+template <class TNorm, class SNorm, class Implication>
+float FuzzyIndex::Defuzzyfication(const float* input, u_int output_id)
+{
+    if (this->_total_rules == 0 || output_id >= this->_output_size) {return 0.0F;}
+    this->search(input);
+
+    FuzzyRule* rules = this->_system->get_rules();
+    FuzzyFrame* frames = rules[0].get_input_frames();
+    u_int samples = this->_samples[output_id];
+    const float* ys = &this->_ys[this->_sample_offset[output_id]];
+    const float* mu_output = &this->_mu_output[this->_mu_offset[output_id]];
+    float* out = this->_out;
+    for (u_int s=0; s<samples; s++) {out[s] = 0.0F;}
+    for (u_int k=0; k<this->_candidates; k++)
+    {
+        // Same degree of fulfillment as FuzzyRule::Evaluate (natural order)
+        u_int r = this->_found[k];
+        const u_int* antecedent = rules[r].get_input_rules();
+        float alpha = 1.0F;
+        for (u_int i=0; i<this->_input_size && alpha != 0.0F; i++)
+        {
+            alpha = TNorm::apply(frames[i].get_muvalue(antecedent[i], input[i]), alpha);
+        }
+        u_int term = rules[r].get_output_rules()[output_id];
+        if (alpha == 0.0F || term >= this->_terms[output_id]) {continue;}
+        const float* mu = &mu_output[(size_t)term * samples];
+        for (u_int s=0; s<samples; s++) {out[s] = SNorm::apply(out[s], Implication::apply(alpha, mu[s]));}
+    }
+
+    // Centroid as Defuzzyfication
+    float weight = 0.0F;
+    float weight_avg = 0.0F;
+    for (u_int s=0; s<samples; s++)
+    {
+        weight = weight + out[s];
+        weight_avg = weight_avg + out[s] * ys[s];
+    }
+    if (weight == 0.0F) {weight = 1.0F;}
+    return weight_avg / weight;
+}
+
+#endif // FUZZYINDEX_H_
@@ -0,0 +1,490 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Implementation of FuzzyInstances (see FuzzyInstances.h)
+***/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "FuzzyInstances.h"
+
+static bool is_piecewise(FS_type type)
+{
+    return type == TRP_L || type == TRP_C || type == TRP_R || type == TRI || type == PWL;
+}
+
+static u_int param_columns(FS_type type)
+{
+    // Columns of a set that is not piecewise linear
+    switch (type)
+    {
+    case SINGLE:    return 1;
+    case GAUSS:     return 2;
+    case GBELL:     return 3;
+    case SIGMOID:   return 2;
+    default:        return 0;
+    }
+}
+
+FuzzyInstances::FuzzyInstances()
+{
+    this->_instances = 0;
+    this->_stride = 0;
+    this->_input_size = 0;
+    this->_output_size = 0;
+    this->_total_rules = 0;
+    this->_arena = 0;
+    this->_input_terms = 0;
+    this->_output_terms = 0;
+}
+
+FuzzyInstances::~FuzzyInstances()
+{
+    this->release();
+}
+
+void FuzzyInstances::release(void)
+{
+    free(this->_arena);
+    this->_arena = 0;
+    this->_instances = 0;
+    this->_total_rules = 0;
+}
+
+FuzzySet* FuzzyInstances::find_set(FuzzyFrame* input_frames, FuzzyFrame* output_frames, u_int set)
+{
+    // Set of the given frames at an index of the columns
+    if (set < this->_input_terms)
+    {
+        u_int i = 0;
+        while (i + 1 < this->_input_size && this->_input_offset[i + 1] <= set) {i++;}
+        return &input_frames[i].getFSAddress()[set - this->_input_offset[i]];
+    }
+    set = set - this->_input_terms;
+    u_int o = 0;
+    while (o + 1 < this->_output_size && this->_term_offset[o + 1] <= set) {o++;}
+    return &output_frames[o].getFSAddress()[set - this->_term_offset[o]];
+}
+
+bool FuzzyInstances::Instances_SetUp(FuzzySystem* system, u_int instances)
+{
+    this->release();
+    FlatSystem flat;
+    if (!flat_system(system, &flat) || instances == 0) {return false;}
+    FuzzyRule* rules = flat.rules;
+    u_int total_rules = flat.total_rules;
+    u_int input_size = flat.input_size;
+    u_int output_size = flat.output_size;
+    FuzzyFrame* input_frames = flat.input_frames;
+    FuzzyFrame* output_frames = flat.output_frames;
+    if (input_size > INSTANCES_MAX_INPUT || output_size == 0 || output_size > INSTANCES_MAX_OUTPUT) {return false;}
+    // The instances evaluate the sets themselves, where the template would
+    // interpolate the lookup table of the frame
+    for (u_int i=0; i<input_size; i++)
+    {
+        if (input_frames[i].get_table() != 0) {return false;}
+    }
+
+    // Sets, output terms and output samples
+    u_int input_terms = 0;
+    for (u_int i=0; i<input_size; i++)
+    {
+        this->_input_offset[i] = input_terms;
+        input_terms = input_terms + input_frames[i].get_size();
+    }
+    u_int output_terms = 0;
+    u_int total_samples = 0;
+    u_int max_samples = 0;
+    for (u_int o=0; o<output_size; o++)
+    {
+        u_int samples = domain_samples(output_frames[o].get_domain());
+        if (samples == 0) {return false;}
+        this->_samples[o] = samples;
+        this->_terms[o] = output_frames[o].get_size();
+        this->_term_offset[o] = output_terms;
+        this->_sample_offset[o] = total_samples;
+        output_terms = output_terms + this->_terms[o];
+        total_samples = total_samples + samples;
+        max_samples = (samples > max_samples) ? samples : max_samples;
+    }
+    this->_input_size = input_size;
+    this->_output_size = output_size;
+    this->_input_terms = input_terms;
+    this->_output_terms = output_terms;
+
+    // Columns of every set: breakpoints, degrees and slopes of a piecewise
+    // linear set, its parameters otherwise
+    u_int total_sets = input_terms + output_terms;
+    u_int total_columns = 0;
+    for (u_int s=0; s<total_sets; s++)
+    {
+        FuzzySet* set = this->find_set(input_frames, output_frames, s);
+        FS_type type = set->get_param().mu_type;
+        FS_pwl breaks;
+        set->get_pwl(&breaks);
+        total_columns = total_columns + (is_piecewise(type) ? 3 * breaks.n : param_columns(type));
+    }
+
+    // The columns are padded to whole blocks, so that a block never checks
+    // the number of instances. The scratch has one row of a block for every
+    // input, fuzzified input (and a final 0), maximum (and one for the
+    // consequents out of their frame), the 5 rows of the rules and of the
+    // sweep and one row per sample of the largest output
+    u_int stride = (instances + INSTANCES_BLOCK - 1) / INSTANCES_BLOCK * INSTANCES_BLOCK;
+    size_t rows = (size_t)input_size + (input_terms + 1) + (output_terms + 1) + 5 + max_samples;
+    size_t size = 64 + (size_t)total_columns * stride * sizeof(float)
+                + rows * INSTANCES_BLOCK * sizeof(float)
+                + (size_t)total_sets * sizeof(FS_type)
+                + (size_t)total_sets * sizeof(u_int)
+                + (size_t)(total_sets + 1) * sizeof(u_int)
+                + (size_t)total_rules * input_size * sizeof(u_int)
+                + (size_t)total_rules * output_size * sizeof(u_int)
+                + (size_t)total_samples * sizeof(float);
+    char* p = (char*)malloc(size);
+    if (p == 0) {return false;}
+    this->_arena = p;
+    p = (char*)(((uintptr_t)p + 63) & ~(uintptr_t)63);
+    this->_columns = (float*)p;         p = p + (size_t)total_columns * stride * sizeof(float);
+    this->_scratch = (float*)p;         p = p + rows * INSTANCES_BLOCK * sizeof(float);
+    this->_type = (FS_type*)p;          p = p + (size_t)total_sets * sizeof(FS_type);
+    this->_points = (u_int*)p;          p = p + (size_t)total_sets * sizeof(u_int);
+    this->_column = (u_int*)p;          p = p + (size_t)(total_sets + 1) * sizeof(u_int);
+    this->_antecedent = (u_int*)p;      p = p + (size_t)total_rules * input_size * sizeof(u_int);
+    this->_consequent = (u_int*)p;      p = p + (size_t)total_rules * output_size * sizeof(u_int);
+    this->_ys = (float*)p;
+    this->_instances = instances;
+    this->_stride = stride;
+    this->_total_rules = total_rules;
+
+    // The template in instance 0, then in the rest of every column (the
+    // padding included)
+    u_int column = 0;
+    for (u_int s=0; s<total_sets; s++)
+    {
+        FuzzySet* set = this->find_set(input_frames, output_frames, s);
+        FS_pwl breaks;
+        set->get_pwl(&breaks);
+        this->_type[s] = set->get_param().mu_type;
+        this->_points[s] = is_piecewise(this->_type[s]) ? breaks.n : 0;
+        this->_column[s] = column;
+        column = column + (is_piecewise(this->_type[s]) ? 3 * this->_points[s] : param_columns(this->_type[s]));
+        this->store(0, s, set);
+    }
+    this->_column[total_sets] = column;
+    for (u_int c=0; c<total_columns; c++)
+    {
+        float* values = &this->_columns[(size_t)c * stride];
+        for (u_int n=1; n<stride; n++) {values[n] = values[0];}
+    }
+
+    // Rules as indexes; an antecedent out of its frame points to the final 0
+    // and a consequent out of its frame to a maximum that is never read
+    for (u_int r=0; r<total_rules; r++)
+    {
+        const u_int* antecedent = rules[r].get_input_rules();
+        const u_int* consequent = rules[r].get_output_rules();
+        for (u_int i=0; i<input_size; i++)
+        {
+            bool valid = antecedent[i] < (u_int)input_frames[i].get_size();
+            this->_antecedent[(size_t)r * input_size + i] = valid ? this->_input_offset[i] + antecedent[i] : input_terms;
+        }
+        for (u_int o=0; o<output_size; o++)
+        {
+            bool valid = consequent[o] < this->_terms[o];
+            this->_consequent[(size_t)r * output_size + o] = valid ? this->_term_offset[o] + consequent[o] : output_terms;
+        }
+    }
+
+    // Output samples, the same float values as Defuzzyfication
+    for (u_int o=0; o<output_size; o++)
+    {
+        UnivDisc domain = output_frames[o].get_domain();
+        float* ys = &this->_ys[this->_sample_offset[o]];
+        u_int s = 0;
+        for (float y = domain.low_bond; y <= domain.up_bond && s < this->_samples[o]; y = y+domain.interval) {ys[s++] = y;}
+    }
+
+    float* zero = &this->_scratch[((size_t)input_size + input_terms) * INSTANCES_BLOCK];
+    for (u_int b=0; b<INSTANCES_BLOCK; b++) {zero[b] = 0.0F;}
+    return true;
+}
+
+u_int FuzzyInstances::set_index(FrameType type, u_int frame_id, u_int indx)
+{
+    // Index of a set in the columns, the number of sets if there is no such set
+    u_int none = this->_input_terms + this->_output_terms;
+    if (type == INPUT)
+    {
+        if (frame_id >= this->_input_size) {return none;}
+        u_int end = (frame_id + 1 < this->_input_size) ? this->_input_offset[frame_id + 1] : this->_input_terms;
+        return (indx < end - this->_input_offset[frame_id]) ? this->_input_offset[frame_id] + indx : none;
+    }
+    if (frame_id >= this->_output_size || indx >= this->_terms[frame_id]) {return none;}
+    return this->_input_terms + this->_term_offset[frame_id] + indx;
+}
+
+bool FuzzyInstances::fits(u_int set, FuzzySet* source)
+{
+    // Same type, and same number of breakpoints for a piecewise linear set
+    FS_type type = source->get_param().mu_type;
+    if (type != this->_type[set]) {return false;}
+    FS_pwl breaks;
+    source->get_pwl(&breaks);
+    return !is_piecewise(type) || breaks.n == this->_points[set];
+}
+
+void FuzzyInstances::store(u_int instance, u_int set, FuzzySet* source)
+{
+    // Parameters of a set that fits, in the columns of one instance
+    const size_t stride = this->_stride;
+    float* column = &this->_columns[(size_t)this->_column[set] * stride + instance];
+    FS_param param = source->get_param();
+    if (is_piecewise(param.mu_type))
+    {
+        FS_pwl breaks;
+        source->get_pwl(&breaks);
+        const FS_pwl* pwl = &breaks;
+        u_int n = this->_points[set];
+        for (u_int k=0; k<n; k++)
+        {
+            column[k * stride] = pwl->x[k];
+            column[(n + k) * stride] = pwl->mu[k];
+            column[(2 * n + k) * stride] = pwl->slope[k + 1];     // slope on the right of breakpoint k
+        }
+        return;
+    }
+    float thr[3] = {param.thr1, param.thr2, param.thr3};
+    for (u_int k=0; k<param_columns(param.mu_type); k++) {column[k * stride] = thr[k];}
+}
+
+bool FuzzyInstances::Instance_SetUp(u_int instance, FuzzySystem* system)
+{
+    if (instance >= this->_instances || system->get_total_rules() == 0) {return false;}
+    FuzzyRule* rules = system->get_rules();
+    if (rules[0].get_input_size() != this->_input_size || rules[0].get_output_size() != this->_output_size) {return false;}
+    FuzzyFrame* input_frames = rules[0].get_input_frames();
+    FuzzyFrame* output_frames = rules[0].get_output_frames();
+    for (u_int i=0; i<this->_input_size; i++)
+    {
+        u_int end = (i + 1 < this->_input_size) ? this->_input_offset[i + 1] : this->_input_terms;
+        if ((u_int)input_frames[i].get_size() != end - this->_input_offset[i] || input_frames[i].get_table() != 0) {return false;}
+    }
+    for (u_int o=0; o<this->_output_size; o++)
+    {
+        if ((u_int)output_frames[o].get_size() != this->_terms[o]) {return false;}
+    }
+
+    // Every set is checked before the instance changes
+    u_int total_sets = this->_input_terms + this->_output_terms;
+    for (u_int s=0; s<total_sets; s++)
+    {
+        if (!this->fits(s, this->find_set(input_frames, output_frames, s))) {return false;}
+    }
+    for (u_int s=0; s<total_sets; s++) {this->store(instance, s, this->find_set(input_frames, output_frames, s));}
+    return true;
+}
+
+bool FuzzyInstances::Set_SetUp(u_int instance, FrameType type, u_int frame_id, u_int indx, FS_param param)
+{
+    u_int set = this->set_index(type, frame_id, indx);
+    if (instance >= this->_instances || set == this->_input_terms + this->_output_terms) {return false;}
+    FuzzySet source;
+    source.set_up(param.mu_type, param.thr1, param.thr2, param.thr3, param.thr4);
+    if (!this->fits(set, &source)) {return false;}
+    this->store(instance, set, &source);
+    return true;
+}
+
+bool FuzzyInstances::Set_SetUp(u_int instance, FrameType type, u_int frame_id, u_int indx, const float* x, const float* mu, u_int n)
+{
+    u_int set = this->set_index(type, frame_id, indx);
+    if (instance >= this->_instances || set == this->_input_terms + this->_output_terms) {return false;}
+    FuzzySet source;
+    FS_pwl breaks;
+    source.set_pwl(&breaks);
+    source.set_up(x, mu, n);
+    if (!this->fits(set, &source)) {return false;}
+    this->store(instance, set, &source);
+    return true;
+}
+
+FS_param FuzzyInstances::get_param(u_int instance, FrameType type, u_int frame_id, u_int indx)
+{
+    // The thresholds of TRP_L, TRP_C, TRP_R and TRI are their breakpoints,
+    // the first columns of the set
+    FS_param param = {0.0F, 0.0F, 0.0F, 0.0F, PWL};
+    u_int set = this->set_index(type, frame_id, indx);
+    if (instance >= this->_instances || set == this->_input_terms + this->_output_terms) {return param;}
+    param.mu_type = this->_type[set];
+    if (param.mu_type == PWL) {return param;}
+    const float* column = &this->_columns[(size_t)this->_column[set] * this->_stride + instance];
+    u_int n = is_piecewise(param.mu_type) ? this->_points[set] : param_columns(param.mu_type);
+    float thr[4] = {0.0F, 0.0F, 0.0F, 0.0F};
+    for (u_int k=0; k<n && k<4; k++) {thr[k] = column[(size_t)k * this->_stride];}
+    param.thr1 = thr[0];
+    param.thr2 = thr[1];
+    param.thr3 = thr[2];
+    param.thr4 = thr[3];
+    return param;
+}
+
+void FuzzyInstances::membership(u_int set, u_int first, const float* x, float* mu)
+{
+    // Degree of membership of INSTANCES_BLOCK instances from first, each one
+    // at its own x
+    const size_t stride = this->_stride;
+    const float* column = &this->_columns[(size_t)this->_column[set] * stride + first];
+    float* __restrict out = mu;
+    switch (this->_type[set])
+    {
+    case TRP_L:
+    case TRP_C:
+    case TRP_R:
+    case TRI:
+    case PWL:
+    {
+        // As piecewise_linear: the last breakpoint on the left of x gives
+        // the segment, the first degree is kept on the left of every one
+        const u_int n = this->_points[set];
+        const float* __restrict mu0 = column + n * stride;
+        for (u_int b=0; b<INSTANCES_BLOCK; b++) {out[b] = (n > 0) ? mu0[b] : 0.0F;}
+        for (u_int k=0; k<n; k++)
+        {
+            const float* __restrict bx = column + k * stride;
+            const float* __restrict bmu = column + (n + k) * stride;
+            const float* __restrict slope = column + (2 * n + k) * stride;
+            for (u_int b=0; b<INSTANCES_BLOCK; b++)
+            {
+                float v = bmu[b] + slope[b] * (x[b] - bx[b]);
+                out[b] = (x[b] > bx[b]) ? v : out[b];
+            }
+        }
+        break;
+    }
+    case SINGLE:
+        for (u_int b=0; b<INSTANCES_BLOCK; b++) {out[b] = (x[b] == column[b]) ? 1.0F : 0.0F;}
+        break;
+    case GAUSS:
+        for (u_int b=0; b<INSTANCES_BLOCK; b++) {out[b] = gaussian<float>(column[b], column[stride + b], x[b]);}
+        break;
+    case GBELL:
+        for (u_int b=0; b<INSTANCES_BLOCK; b++) {out[b] = generalized_bell<float>(column[b], column[stride + b], column[2 * stride + b], x[b]);}
+        break;
+    case SIGMOID:
+        for (u_int b=0; b<INSTANCES_BLOCK; b++) {out[b] = sigmoid<float>(column[b], column[stride + b], x[b]);}
+        break;
+    default:
+        for (u_int b=0; b<INSTANCES_BLOCK; b++) {out[b] = 0.0F;}
+    }
+}
+
+void FuzzyInstances::run(const float* input, float* output, u_int first)
+{
+    // One block of instances from first; the lanes after the last instance
+    // are evaluated at 0 and not written
+    const u_int B = INSTANCES_BLOCK;
+    const u_int input_size = this->_input_size;
+    const u_int output_size = this->_output_size;
+    const u_int count = (this->_instances - first < B) ? this->_instances - first : B;
+    float* x = this->_scratch;
+    float* mu_input = x + (size_t)input_size * B;
+    float* w = mu_input + (size_t)(this->_input_terms + 1) * B;
+    float* __restrict alpha = w + (size_t)(this->_output_terms + 1) * B;
+    float* __restrict m = alpha + B;
+    float* __restrict y = m + B;
+    float* __restrict weight = y + B;
+    float* __restrict weight_avg = weight + B;
+    float* agg = weight_avg + B;
+
+    // Inputs as rows of the block, then every input set
+    for (u_int i=0; i<input_size; i++)
+    {
+        float* xi = &x[(size_t)i * B];
+        for (u_int b=0; b<count; b++) {xi[b] = input[(size_t)(first + b) * input_size + i];}
+        for (u_int b=count; b<B; b++) {xi[b] = 0.0F;}
+        u_int end = (i + 1 < input_size) ? this->_input_offset[i + 1] : this->_input_terms;
+        for (u_int s=this->_input_offset[i]; s<end; s++) {this->membership(s, first, xi, &mu_input[(size_t)s * B]);}
+    }
+
+    // Degree of fulfillment of every rule, once for all outputs
+    for (size_t c=0; c<(size_t)(this->_output_terms + 1) * B; c++) {w[c] = 0.0F;}
+    const u_int* antecedent = this->_antecedent;
+    const u_int* consequent = this->_consequent;
+    for (u_int r=0; r<this->_total_rules; r++, antecedent += input_size, consequent += output_size)
+    {
+        for (u_int b=0; b<B; b++) {alpha[b] = 1.0F;}
+        for (u_int i=0; i<input_size; i++)
+        {
+            const float* __restrict mu = &mu_input[(size_t)antecedent[i] * B];
+            for (u_int b=0; b<B; b++) {alpha[b] = TNormMin::apply(mu[b], alpha[b]);}
+        }
+        for (u_int o=0; o<output_size; o++)
+        {
+            float* __restrict wc = &w[(size_t)consequent[o] * B];
+            for (u_int b=0; b<B; b++) {wc[b] = SNormMax::apply(wc[b], alpha[b]);}
+        }
+    }
+
+    // Sweep of every output with the consequents of each instance, one row
+    // of the block per output sample, then the centroid as Defuzzyfication
+    for (u_int o=0; o<output_size; o++)
+    {
+        const u_int samples = this->_samples[o];
+        const float* ys = &this->_ys[this->_sample_offset[o]];
+        for (size_t k=0; k<(size_t)samples * B; k++) {agg[k] = 0.0F;}
+        for (u_int t=0; t<this->_terms[o]; t++)
+        {
+            // A consequent that no rule of the block fires is not evaluated
+            const float* __restrict wt = &w[(size_t)(this->_term_offset[o] + t) * B];
+            float any = 0.0F;
+            for (u_int b=0; b<B; b++) {any = (wt[b] > any) ? wt[b] : any;}
+            if (any == 0.0F) {continue;}
+            for (u_int s=0; s<samples; s++)
+            {
+                float* __restrict out = &agg[(size_t)s * B];
+                for (u_int b=0; b<B; b++) {y[b] = ys[s];}
+                this->membership(this->_input_terms + this->_term_offset[o] + t, first, y, m);
+                for (u_int b=0; b<B; b++)
+                {
+                    float v = (wt[b] < m[b]) ? wt[b] : m[b];
+                    out[b] = (out[b] > v) ? out[b] : v;
+                }
+            }
+        }
+        for (u_int b=0; b<B; b++) {weight[b] = 0.0F; weight_avg[b] = 0.0F;}
+        for (u_int s=0; s<samples; s++)
+        {
+            const float* __restrict out = &agg[(size_t)s * B];
+            for (u_int b=0; b<B; b++)
+            {
+                weight[b] = weight[b] + out[b];
+                weight_avg[b] = weight_avg[b] + out[b] * ys[s];
+            }
+        }
+        for (u_int b=0; b<count; b++)
+        {
+            float wb = (weight[b] == 0.0F) ? 1.0F : weight[b];
+            output[(size_t)(first + b) * output_size + o] = weight_avg[b] / wb;
+        }
+    }
+}
+
+void FuzzyInstances::Defuzzyfication(const float* input, float* output)
+{
+    for (u_int first=0; first<this->_instances; first += INSTANCES_BLOCK) {this->run(input, output, first);}
+}
+
+u_int FuzzyInstances::get_instances(void)
+{
+    return this->_instances;
+}
+
+u_int FuzzyInstances::get_input_size(void)
+{
+    return this->_input_size;
+}
+
+u_int FuzzyInstances::get_output_size(void)
+{
+    return this->_output_size;
+}
@@ -0,0 +1,123 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Many instances of one Fuzzy System, evaluated together.
+  *
+  * A controller per device means thousands of FuzzySystem objects with the
+  * same frames and rules and only their own parameters. FuzzyInstances keeps
+  * the structure once (sizes of the frames, type of every set, rules, output
+  * domains, taken from a template FuzzySystem) and the parameters of every
+  * instance as columns: one array per parameter of a set, one float per
+  * instance. One tick evaluates every instance on its own row of inputs, by
+  * blocks of INSTANCES_BLOCK instances with the instance in the inner loop,
+  * so that every step is a loop over contiguous floats that the compiler
+  * vectorizes:
+  *
+  *    1. every set of the input frames, for the whole block
+  *    2. every rule, w[consequent] = max(w, min(antecedents)) for the block
+  *    3. every output sample, max over consequents of min(w, mu(y)) with the
+  *       consequents of each instance, then the centroid
+  *
+  * TRP_L, TRP_C, TRP_R, TRI and PWL sets are stored as their breakpoints,
+  * degrees and slopes and evaluated as piecewise_linear, the others as their
+  * parameters. The operators are the default ones (minimum, maximum,
+  * Mamdani) and every output is the same as Defuzzyfication of the instance.
+  * The sets are always evaluated exactly, so systems whose input frames have
+  * a lookup table (Table_SetUp) are rejected by Instances_SetUp and
+  * Instance_SetUp.
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    FuzzyInstances devices;
+  *    devices.Instances_SetUp(&mySystem, 5000);           // 5000 copies of mySystem
+  *    devices.Instance_SetUp(17, &tunedSystem);           // every set of device 17 from a system with the same structure
+  *    FS_param p = {10.0F, 20.0F, 30.0F, 0.0F, TRI};
+  *    devices.Set_SetUp(42, INPUT, 0, 1, p);              // one set of device 42 (the type cannot change)
+  *
+  *    devices.Defuzzyfication(inputs, outputs);           // 5000 rows of input_size values -> 5000 rows of output_size values
+  *    ```
+  *
+  * The template FuzzySystem is only read by Instances_SetUp.
+***/
+
+#ifndef FUZZYINSTANCES_H_
+#define FUZZYINSTANCES_H_
+
+#include <stddef.h>
+#include "FuzzyLogic.h"
+
+#ifndef INSTANCES_MAX_INPUT
+#define INSTANCES_MAX_INPUT     32      // Maximum number of inputs
+#endif
+
+#ifndef INSTANCES_MAX_OUTPUT
+#define INSTANCES_MAX_OUTPUT    8       // Maximum number of outputs
+#endif
+
+#ifndef INSTANCES_BLOCK
+#define INSTANCES_BLOCK         64      // Instances evaluated together (the columns are padded to a multiple)
+#endif
+
+class FuzzyInstances
+{
+private:
+    u_int _instances, _stride;                      // stride: floats of one column
+    u_int _input_size, _output_size, _total_rules;
+    void* _arena;                                   // every array below, one allocation
+    float* _columns;                                // parameters, column after column
+    FS_type* _type;                                 // per set
+    u_int* _points;                                 // per set, breakpoints of a piecewise linear set
+    u_int* _column;                                 // per set, its first column
+    u_int* _antecedent;                             // per rule, index of each antecedent in the fuzzified inputs
+    u_int* _consequent;                             // per rule, index of each consequent in the maxima
+    float* _ys;                                     // output samples of every output
+    float* _scratch;                                // one block: inputs, fuzzified inputs, maxima, sweep
+    u_int _input_offset[INSTANCES_MAX_INPUT];
+    u_int _input_terms, _output_terms;
+    u_int _samples[INSTANCES_MAX_OUTPUT];
+    u_int _terms[INSTANCES_MAX_OUTPUT];
+    u_int _term_offset[INSTANCES_MAX_OUTPUT];
+    u_int _sample_offset[INSTANCES_MAX_OUTPUT];
+
+    void release(void);
+    u_int set_index(FrameType type, u_int frame_id, u_int indx);
+    FuzzySet* find_set(FuzzyFrame* input_frames, FuzzyFrame* output_frames, u_int set);
+    bool fits(u_int set, FuzzySet* source);
+    void store(u_int instance, u_int set, FuzzySet* source);
+    void membership(u_int set, u_int first, const float* x, float* mu);
+    void run(const float* input, float* output, u_int first);
+
+    FuzzyInstances(const FuzzyInstances&);          // not copyable, owns its arena
+    FuzzyInstances& operator=(const FuzzyInstances&);
+public:
+    FuzzyInstances();
+    ~FuzzyInstances();
+
+    // Every instance gets the sets of system. Returns false if the system has
+    // no rule, rules with different frames, too many inputs or outputs, an
+    // empty output domain or if the allocation fails
+    bool Instances_SetUp(FuzzySystem* system, u_int instances);
+
+    // Every set of one instance from a system with the same frames and set
+    // types (the rules are not read); false if the structure differs
+    bool Instance_SetUp(u_int instance, FuzzySystem* system);
+
+    // One set of one instance; false if the set does not exist or if its type
+    // (or its number of breakpoints for PWL) is not the one of the template
+    bool Set_SetUp(u_int instance, FrameType type, u_int frame_id, u_int indx, FS_param param);
+    bool Set_SetUp(u_int instance, FrameType type, u_int frame_id, u_int indx, const float* x, const float* mu, u_int n);
+
+    // Parameters of one set of one instance (the thresholds are 0 for PWL)
+    FS_param get_param(u_int instance, FrameType type, u_int frame_id, u_int indx);
+
+    // One tick: input has one row of input_size values per instance, output
+    // gets one row of output_size values per instance
+    void Defuzzyfication(const float* input, float* output);
+
+    u_int get_instances(void);
+    u_int get_input_size(void);
+    u_int get_output_size(void);
+};
+
+#endif // FUZZYINSTANCES_H_
@@ -59,8 +59,26 @@
 #ifndef FUZZYLOGIC_H_
 #define FUZZYLOGIC_H_
 
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
 #define DISC_SIZE               10
 
+#ifndef PWL_SIZE
+#define PWL_SIZE                8       // Maximum number of breakpoints of a piecewise linear Fuzzy Set
+#endif
+
+#ifndef GRAD_MAX_INPUT
+#define GRAD_MAX_INPUT          16      // Maximum number of inputs of FuzzySystem::Defuzzyfication with gradient
+#endif
+
+// Uncomment (or pass -DFUZZY_FAST_EXP to the compiler) to evaluate GAUSS, GBELL and
+// SIGMOID Fuzzy Sets with fast_exp2/fast_log2 instead of expf/powf of <math.h>.
+// It only pays off where the compiler vectorizes the loop (FuzzyInstances,
+// FuzzyCMeans with -O3): a single FuzzySet::mu_func call is faster with <math.h>.
+// #define FUZZY_FAST_EXP
+
 typedef unsigned int u_int;
 
 typedef enum
@@ -70,7 +88,11 @@ typedef enum
     TRP_C,			// Trapezoid Center
     TRP_R,			// Trapezoid Right
     TRI,			// Triangular
-	SINGLE			// Singleton
+	SINGLE,			// Singleton
+	GAUSS,			// Gaussian         (thr1: center, thr2: sigma)
+	GBELL,			// Generalized Bell (thr1: width a, thr2: slope b, thr3: center c)
+	SIGMOID,		// Sigmoid          (thr1: slope a, thr2: center c)
+	PWL				// Piecewise Linear with up to PWL_SIZE breakpoints (needs storage, see FuzzySetT::set_pwl)
 } FS_type;
 
 typedef enum
@@ -79,29 +101,67 @@ typedef enum
     OUTPUT
 } FrameType;
 
-
-typedef struct FS_param
+/* SCALAR TYPE */
+/***
+ * [Every structure, function and class below is a template on the scalar type T]
+ *
+ * The usual names (FS_param, UnivDisc, FuzzySet, FuzzyFrame, FuzzyRule and
+ * FuzzySystem) are the float versions, so existing programs are unchanged.
+ * The other versions are used with the "T" suffix, for example:
+ *
+ *    FuzzySetT<double>     : offline validation of a float system
+ *    FuzzySetT<fuzzy_half> : 16-bit floating point (when the compiler has _Float16)
+ *    FuzzySetT< Dual<float, 2> > : exact gradient of the output over 2 inputs
+ *                                  in one evaluation (see FuzzyDual.h)
+ *
+ * A scalar type only needs the arithmetic and comparison operators, a
+ * constructor from float and the fuzzy_value, fuzzy_exp, fuzzy_log and
+ * fuzzy_pow functions (see SCALAR MATH).
+***/
+template <typename T>
+struct FS_paramT
 {
     // Parameters of Fuzzy Set in which it is characterized by
-    float thr1, thr2, thr3, thr4;
+    T thr1, thr2, thr3, thr4;
     FS_type mu_type;
-} FS_param;
+};
+
+template <typename T>
+struct FS_pwlT
+{
+    // Piecewise linear membership function, precomputed at set_up time, in
+    // storage given to the FuzzySet (set_pwl, FuzzyFrame::Pwl_SetUp).
+    // Segment k covers x in (x[k-1], x[k]]; segment 0 and segment n are flat.
+    T x[PWL_SIZE];                  // breakpoints (ascending)
+    T mu[PWL_SIZE];                 // degree of membership at each breakpoint
+    T slope[PWL_SIZE + 1];          // slope of each segment
+    u_int n;                        // number of breakpoints
+};
 
-typedef struct UnivDisc
+template <typename T>
+struct UnivDiscT
 {
     // Universe of Discourse. Can be used to determine the domain
     // where linguistic variables reside
-    float low_bond, up_bond;
-    float interval;
-} UnivDisc;
+    T low_bond, up_bond;
+    T interval;
+};
+
+typedef FS_paramT<float> FS_param;
+typedef FS_pwlT<float> FS_pwl;
+typedef UnivDiscT<float> UnivDisc;
 
 /* PROTOTYPES */
-// Membership Function Shape
+// Membership Function Shape (float versions, see also TEMPLATE FUNCTIONS)
 float triangular(float thr_left, float thr_center, float thr_right, float x);
 float trapezoid_left(float thr_left, float thr_right, float x);
 float trapezoid_right(float thr_left, float thr_right, float x);
 float trapezoid_center(float thr_left1, float thr_left2, float thr_right1, float thr_right2, float x);
 float singleton(float thr_center, float x);
+float gaussian(float center, float sigma, float x);                     // always expf of <math.h>
+float generalized_bell(float a, float b, float c, float x);             // always powf of <math.h>
+float sigmoid(float a, float c, float x);                               // always expf of <math.h>
+void pwl_set_up(FS_pwl* pwl, const float* x, const float* mu, u_int n);
 
 // Operator for array only
 float minimum(float* array_input, u_int array_size);
@@ -111,45 +171,601 @@ float maximum(float* array_input, u_int array_size);
 float minimum(float x1, float x2);
 float maximum(float x1, float x2);
 
+/* FAST APPROXIMATIONS */
+/***
+ * [Branch-free approximations of 2^x and log2(x) for the smooth membership functions]
+ *
+ * They only use multiply, add, compare-select and integer bit manipulation, so a
+ * loop calling them over an array of inputs can be vectorized by the compiler.
+ * Called one at a time they are slower than expf/powf of <math.h>.
+ * Measured maximum error against the double precision <math.h> functions:
+ *
+ *    fast_exp2(x)  : relative error < 3e-7 for x in [-126, 127], 0 below (and for NaN)
+ *                    and +inf above
+ *    fast_log2(x)  : absolute error < 1e-5 for normal positive x, -inf for zero
+ *    gaussian_fast, generalized_bell_fast, sigmoid_fast : absolute error of the
+ *                    degree of membership < 1e-6
+***/
+inline float fast_exp2(float x)
+{
+    // Out of [-127, 128] the result is 0 or +inf anyway; clamping first keeps
+    // n*2^23 below in int32_t range (NaN and -inf give 0). The clamp selects
+    // bits with masks: with a ?: on floats GCC moves the adds below into the
+    // branches and can not vectorize the loop without -fno-trapping-math.
+    int32_t bits, bound;
+    float low = -127.0F, high = 128.0F;
+    memcpy(&bits, &x, sizeof(bits));
+    memcpy(&bound, &low, sizeof(bound));
+    int32_t keep = -(int32_t)(x > low);
+    bits = (bits & keep) | (bound & ~keep);
+    memcpy(&x, &bits, sizeof(x));
+    memcpy(&bound, &high, sizeof(bound));
+    keep = -(int32_t)(x < high);
+    bits = (bits & keep) | (bound & ~keep);
+    memcpy(&x, &bits, sizeof(x));
+    // 2^x = 2^n * 2^f with n = round(x) and f in [-0.5, 0.5]. Adding 1.5*2^23
+    // rounds x and leaves n in the low bits of the mantissa.
+    float t = x + 12582912.0F;
+    int32_t n;
+    memcpy(&n, &t, sizeof(n));
+    n = n - 0x4B400000;
+    float f = x - (t - 12582912.0F);
+    // Taylor series of 2^f up to 6th degree
+    float p = 1.5403530e-4F;
+    p = p * f + 1.3333558e-3F;
+    p = p * f + 9.6181291e-3F;
+    p = p * f + 5.5504109e-2F;
+    p = p * f + 2.4022651e-1F;
+    p = p * f + 6.9314718e-1F;
+    p = p * f + 1.0F;
+    // Multiply by 2^n by adding n into the exponent bits. Underflow gives 0 and
+    // overflow gives +inf, selected with masks so the compiler sees no branch.
+    memcpy(&bits, &p, sizeof(bits));
+    bits = bits + n * (int32_t)0x00800000;
+    int32_t under = -(int32_t)(n < -126);
+    int32_t over = -(int32_t)(n > 127);
+    bits = bits & ~under;
+    bits = (bits & ~over) | (over & 0x7F800000);
+    memcpy(&p, &bits, sizeof(p));
+    return p;
+}
+
+inline float fast_log2(float x)
+{
+    // log2(x) = e + log2(m) with m in [sqrt(0.5), sqrt(2))
+    int32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    int32_t zero = -(int32_t)(bits < 0x00800000);     // zero (or denormal) gives -inf
+    int32_t big = (int32_t)((bits & 0x007FFFFF) > 0x003504F3);
+    int32_t e = ((bits >> 23) & 0xFF) - 127 + big;
+    bits = ((bits & 0x007FFFFF) | 0x3F800000) - big * (int32_t)0x00800000;
+    float m;
+    memcpy(&m, &bits, sizeof(m));
+    // log(m) = 2*atanh(s) with s = (m-1)/(m+1), |s| < 0.172
+    float s = (m - 1.0F) / (m + 1.0F);
+    float s2 = s * s;
+    float p = 0.14285714F;
+    p = p * s2 + 0.2F;
+    p = p * s2 + 0.33333333F;
+    p = p * s2 + 1.0F;
+    float result = (float)e + 2.88539008F * s * p;    // 2/ln(2) = 2.88539008
+    memcpy(&bits, &result, sizeof(bits));
+    bits = (bits & ~zero) | (zero & (int32_t)0xFF800000);
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+inline float fast_exp(float x)
+{
+    return fast_exp2(x * 1.44269504F);         // log2(e) = 1.44269504
+}
+
+inline float gaussian_fast(float center, float sigma, float x)
+{
+    float u = (x - center) / sigma;
+    return fast_exp(-0.5F * u * u);
+}
+
+inline float generalized_bell_fast(float a, float b, float c, float x)
+{
+    // 1/(1 + |(x-c)/a|^(2b)) with |u|^(2b) = 2^(b*log2(u^2))
+    float u = (x - c) / a;
+    return 1.0F / (1.0F + fast_exp2(b * fast_log2(u * u)));
+}
+
+inline float sigmoid_fast(float a, float c, float x)
+{
+    return 1.0F / (1.0F + fast_exp(-a * (x - c)));
+}
+
+/* SCALAR MATH */
+/***
+ * [Functions needed by the template code for each scalar type]
+ *
+ *    fuzzy_value(x)  : plain value of x (used for indexing and casting to int)
+ *    fuzzy_exp(x), fuzzy_log(x), fuzzy_pow(x, y) : as in <math.h>
+ *
+ * The float versions follow FUZZY_FAST_EXP. fuzzy_half has no <math.h>
+ * functions, so it is evaluated in float and rounded back.
+***/
+inline float fuzzy_value(float x) {return x;}
+inline double fuzzy_value(double x) {return x;}
+
+inline float fuzzy_exp(float x)
+{
+#ifdef FUZZY_FAST_EXP
+    return fast_exp(x);
+#else
+    return expf(x);
+#endif
+}
+inline float fuzzy_log(float x)
+{
+#ifdef FUZZY_FAST_EXP
+    return fast_log2(x) * 0.69314718F;          // ln(2) = 0.69314718
+#else
+    return logf(x);
+#endif
+}
+inline float fuzzy_pow(float x, float y)
+{
+#ifdef FUZZY_FAST_EXP
+    return fast_exp2(y * fast_log2(x));
+#else
+    return powf(x, y);
+#endif
+}
+
+inline double fuzzy_exp(double x) {return exp(x);}
+inline double fuzzy_log(double x) {return log(x);}
+inline double fuzzy_pow(double x, double y) {return pow(x, y);}
+
+#ifdef __FLT16_MAX__
+typedef _Float16 fuzzy_half;
+inline fuzzy_half fuzzy_value(fuzzy_half x) {return x;}
+inline fuzzy_half fuzzy_exp(fuzzy_half x) {return (fuzzy_half)fuzzy_exp((float)x);}
+inline fuzzy_half fuzzy_log(fuzzy_half x) {return (fuzzy_half)fuzzy_log((float)x);}
+inline fuzzy_half fuzzy_pow(fuzzy_half x, fuzzy_half y) {return (fuzzy_half)fuzzy_pow((float)x, (float)y);}
+#endif
+
+/* TEMPLATE FUNCTIONS */
+// Same as the float functions of PROTOTYPES, for any scalar type T.
+// The float functions of PROTOTYPES are kept, so calls with mixed
+// argument types (e.g. triangular(0, 5.0, 10, x)) still compile.
+template <typename T>
+T triangular(T thr_left, T thr_center, T thr_right, T x)
+{
+    /*
+    This function is one of simplest membership function that
+    defines a Fuzzy Set.
+
+    Its shape is a triangular with three threshold (points) that create
+    a shape of triangles. thr_center parameter is argument in which the value
+    of membership function maximum (1.0)
+    */
+    if (x <= thr_left)
+        // Absolutely Zero
+        {return T(0);}
+    else if(x > thr_left && x <= thr_center)
+        // Rising slope
+        {return (x - thr_left)/(thr_center - thr_left);}
+    else if(x > thr_center && x <= thr_right)
+        // Falling slope
+        {return (thr_right - x)/(thr_right - thr_center);}
+    else
+        // Absolutely Zero
+        {return T(0);}
+}
+
+template <typename T>
+T trapezoid_left(T thr_left, T thr_right, T x)
+{
+    /*
+    This function is one of simplest membership function that
+    defines a Fuzzy Set.
+
+    Its shape is a trapezoidal with two threshold (points) that create
+    a shape of trapezoid in which the value of uFunc will be one for x -> -infty
+    and the value of uFunc will be zero for x -> +infty.
+    */
+    if(x <= thr_left)
+        // x is certain belong to the set
+        {return T(1);}
+    else if(x > thr_left && x <= thr_right)
+        // Falling slope
+        {return (thr_right - x)/(thr_right - thr_left);}
+    else
+        // Absolute zero
+        {return T(0);}
+}
+
+template <typename T>
+T trapezoid_right(T thr_left, T thr_right, T x)
+{
+    /*
+    This function is one of simplest membership function that
+    defines a Fuzzy Set.
+
+    Its shape is a trapezoidal with two threshold (points) that create
+    a shape of trapezoid in which the value of uFunc will be one for x -> +infty
+    and the value of uFunc will be zero for x -> -infty.
+    */
+    if(x <= thr_left)
+        // Absolute zero
+        {return T(0);}
+    else if(x > thr_left && x <= thr_right)
+        // Rising Slope
+        {return (x - thr_left)/(thr_right - thr_left);}
+    else
+        // x is certain belong to the set
+        {return T(1);}
+}
+
+template <typename T>
+T trapezoid_center(T thr_left1, T thr_left2, T thr_right1, T thr_right2, T x)
+{
+    /*
+    This function is one of simplest membership function that
+    defines a Fuzzy Set.
+
+    Its shape is a trapezoidal with two threshold (points) that create
+    a shape of trapezoid in which the value of uFunc will be one for x between thr_left2 and thr_right1.
+    Its shape will be a trapesium
+    */
+    if (x <= thr_left1)
+        // Absolutely Zero
+        {return T(0);}
+    else if(x > thr_left1 && x <= thr_left2)
+        // Rising slope
+        {return (x - thr_left1)/(thr_left2 - thr_left1);}
+    else if(x > thr_left2 && x <= thr_right1)
+        // x is certainly belong to the set
+        {return T(1);}
+    else if(x > thr_right1 && x <= thr_right2)
+        // Falling slope
+        {return (thr_right2 - x)/(thr_right2 - thr_right1);}
+    else
+        // Absolutely Zero
+        {return T(0);}
+}
+
+template <typename T>
+T singleton(T thr_center, T x)
+{
+	/*
+    This function is one of simplest membership function that
+    defines a Fuzzy Set.
+
+	It define a Fuzzy Set with membership function that is unity at
+	a single particular point (thr_center) on the universe of discourse and
+	zero in elsewhere
+    */
+	if (thr_center == x)
+		{return T(1);}
+	else
+		{return T(0);}
+}
+
+template <typename T>
+T gaussian(T center, T sigma, T x)
+{
+    /*
+    Smooth bell shaped membership function. It is unity at center
+    and sigma is the standard deviation that controls its width.
+    */
+    T u = (x - center) / sigma;
+    return fuzzy_exp(T(-0.5) * u * u);
+}
+
+template <typename T>
+T generalized_bell(T a, T b, T c, T x)
+{
+    /*
+    Generalized bell membership function 1/(1 + |(x-c)/a|^(2b)).
+    c is the center, a is the half width (where the value is 0.5) and
+    b controls the slope at the crossover points.
+    */
+    T u = (x - c) / a;
+    return T(1) / (T(1) + fuzzy_pow(u * u, b));
+}
+
+template <typename T>
+T sigmoid(T a, T c, T x)
+{
+    /*
+    Sigmoidal membership function 1/(1 + exp(-a*(x-c))). It is open to
+    the right for a > 0 and open to the left for a < 0, c is the crossover
+    point where the value is 0.5.
+    */
+    return T(1) / (T(1) + fuzzy_exp(-a * (x - c)));
+}
+
+template <typename T>
+inline T pwl_slope(T x0, T mu0, T x1, T mu1)
+{
+    // Slope of the segment between two breakpoints. A vertical edge has zero
+    // width and is never selected.
+    T dx = x1 - x0;
+    return (dx > T(0)) ? (mu1 - mu0) / dx : T(0);
+}
+
+template <typename T>
+void pwl_set_up(FS_pwlT<T>* pwl, const T* x, const T* mu, u_int n)
+{
+    /*
+    Copy the breakpoints (x must be ascending) and precompute the slope of
+    every segment, so that no division is needed when the membership
+    function is evaluated. Breakpoints after PWL_SIZE are ignored.
+    */
+    if (n > PWL_SIZE) {n = PWL_SIZE;}
+    pwl->n = n;
+    if (n == 0)
+    {
+        // No breakpoint: 0 everywhere
+        pwl->x[0] = T(0);
+        pwl->mu[0] = T(0);
+    }
+    for (u_int i=0; i<n; i++)
+    {
+        pwl->x[i] = x[i];
+        pwl->mu[i] = mu[i];
+    }
+    // Flat outside of the breakpoints
+    pwl->slope[0] = T(0);
+    pwl->slope[n] = T(0);
+    for (u_int k=1; k<n; k++) {pwl->slope[k] = pwl_slope(x[k-1], mu[k-1], x[k], mu[k]);}
+}
+
+template <typename T>
+inline T piecewise_linear(const FS_pwlT<T>* pwl, T x)
+{
+    /*
+    Evaluate a piecewise linear membership function without division.
+    The segment is found by counting the breakpoints on the left of x
+    (no branch), then one multiply and add give the degree of membership.
+    */
+    u_int k = 0;
+    for (u_int i=0; i < pwl->n; i++) {k = k + (u_int)(x > pwl->x[i]);}
+    u_int j = k - (u_int)(k > 0);               // breakpoint on the left of segment k
+    return pwl->mu[j] + pwl->slope[k] * (x - pwl->x[j]);
+}
+
+template <typename T>
+inline T piecewise_linear(const FS_pwlT<T>* pwl, T x, T* dmu)
+{
+    // Same as above, dmu is the slope of the segment (the left one at a breakpoint)
+    u_int k = 0;
+    for (u_int i=0; i < pwl->n; i++) {k = k + (u_int)(x > pwl->x[i]);}
+    u_int j = k - (u_int)(k > 0);
+    *dmu = pwl->slope[k];
+    return pwl->mu[j] + pwl->slope[k] * (x - pwl->x[j]);
+}
+
+template <typename T>
+T minimum(T* array_input, u_int array_size)
+{
+    // Minimum of an array of membership degree only (1 for an empty array)
+    T result = T(1);
+    for (u_int i=0; i<array_size; i++)
+    {
+        if (result > array_input[i]){result = array_input[i];}
+    }
+    return result;
+}
+
+template <typename T>
+T maximum(T* array_input, u_int array_size)
+{
+    // Maximum of an array of membership degree only (0 for an empty array)
+    T result = T(0);
+    for (u_int i=0; i<array_size; i++)
+    {
+        if (result < array_input[i]){result = array_input[i];}
+    }
+    return result;
+}
+
+template <typename T>
+T minimum(T x1, T x2)
+{
+    if (x1 < x2)    {return x1;}
+    else            {return x2;}
+}
+
+template <typename T>
+T maximum(T x1, T x2)
+{
+    if (x1 > x2)    {return x1;}
+    else            {return x2;}
+}
+
+/* OPERATOR POLICIES */
+/***
+ * [Compile-time choice of the fuzzy operators used by FuzzyRule and FuzzySystem]
+ *
+ * Each policy is a struct with a single static inline apply() function. Passing
+ * the policies as template arguments (for example
+ * mySystem.Defuzzyfication<TNormProduct, SNormProbSum, ImpLarsen>(inputs, 0))
+ * makes the compiler generate a specialized code path for that combination, so
+ * there is no function pointer call per operation.
+ *
+ *    T-Norm (logical AND between antecedents)  : TNormMin, TNormProduct, TNormLukasiewicz
+ *    S-Norm (aggregation of rules, logical OR)  : SNormMax, SNormProbSum, SNormBoundedSum
+ *    Implication (degree of fulfillment->output): ImpMamdani (minimum), ImpLarsen (product)
+ *
+ * The default (non-template) methods use TNormMin, SNormMax and ImpMamdani.
+ * apply() is itself a template, so the same policy works for every scalar type.
+ *
+ * partial(a, b, &da, &db) gives the partial derivatives of apply(a, b) and is
+ * only needed by the gradient methods (Defuzzyfication with grad). min and max
+ * are not differentiable where a == b: the derivative of the operand returned
+ * by apply() is used, which is b.
+***/
+struct TNormMin
+{
+    template <typename T>
+    static inline T apply(T a, T b) {return (a < b) ? a : b;}
+    template <typename T>
+    static inline void partial(T a, T b, T* da, T* db) {*da = (a < b) ? T(1) : T(0); *db = T(1) - *da;}
+};
+struct TNormProduct
+{
+    template <typename T>
+    static inline T apply(T a, T b) {return a * b;}
+    template <typename T>
+    static inline void partial(T a, T b, T* da, T* db) {*da = b; *db = a;}
+};
+struct TNormLukasiewicz
+{
+    template <typename T>
+    static inline T apply(T a, T b)
+    {
+        T r = a + b - T(1);
+        return (r > T(0)) ? r : T(0);
+    }
+    template <typename T>
+    static inline void partial(T a, T b, T* da, T* db)
+    {
+        *da = (a + b - T(1) > T(0)) ? T(1) : T(0);
+        *db = *da;
+    }
+};
+
+struct SNormMax
+{
+    template <typename T>
+    static inline T apply(T a, T b) {return (a > b) ? a : b;}
+    template <typename T>
+    static inline void partial(T a, T b, T* da, T* db) {*da = (a > b) ? T(1) : T(0); *db = T(1) - *da;}
+};
+struct SNormProbSum
+{
+    template <typename T>
+    static inline T apply(T a, T b) {return a + b - a * b;}
+    template <typename T>
+    static inline void partial(T a, T b, T* da, T* db) {*da = T(1) - b; *db = T(1) - a;}
+};
+struct SNormBoundedSum
+{
+    template <typename T>
+    static inline T apply(T a, T b)
+    {
+        T r = a + b;
+        return (r < T(1)) ? r : T(1);
+    }
+    template <typename T>
+    static inline void partial(T a, T b, T* da, T* db)
+    {
+        *da = (a + b < T(1)) ? T(1) : T(0);
+        *db = *da;
+    }
+};
+
+struct ImpMamdani
+{
+    template <typename T>
+    static inline T apply(T alpha, T mu) {return (alpha < mu) ? alpha : mu;}
+    template <typename T>
+    static inline void partial(T alpha, T mu, T* dalpha, T* dmu) {*dalpha = (alpha < mu) ? T(1) : T(0); *dmu = T(1) - *dalpha;}
+};
+struct ImpLarsen
+{
+    template <typename T>
+    static inline T apply(T alpha, T mu) {return alpha * mu;}
+    template <typename T>
+    static inline void partial(T alpha, T mu, T* dalpha, T* dmu) {*dalpha = mu; *dmu = alpha;}
+};
+
 // Classes
-class FuzzySet
+template <typename T>
+class FuzzySetT
 {
 private:
-    FS_param _param;
+    FS_paramT<T> _param;
+    FS_pwlT<T>* _pwl;       // breakpoints with their slopes, 0: no storage (see set_pwl)
+    T _slope[2];            // slopes of the edges of TRP_L, TRP_C, TRP_R and TRI
+    u_int breakpoints(T* x, T* mu);
+    void pwl_from_param(void);
+    void slopes_from_param(void);
+    T linear_shape(T x, T* dmu);
 public:
+    FuzzySetT();
+
     // Initialization
-	void set_up(FS_type the_type, float thr_1);
-    void set_up(FS_type the_type, float thr_1, float thr_2);
-    void set_up(FS_type the_type, float thr_1, float thr_2, float thr_3);
-    void set_up(FS_type the_type, float thr_1, float thr_2, float thr_3, float thr_4);
+    void set_pwl(FS_pwlT<T>* pwl);                                     // storage of the breakpoints, 0 to remove
+	void set_up(FS_type the_type, T thr_1);
+    void set_up(FS_type the_type, T thr_1, T thr_2);
+    void set_up(FS_type the_type, T thr_1, T thr_2, T thr_3);
+    void set_up(FS_type the_type, T thr_1, T thr_2, T thr_3, T thr_4);
+    void set_up(const T* x, const T* mu, u_int n);                     // PWL
 
     // Membership Function
-    float mu_func(int x);
-    float mu_func(float x);
+    T mu_func(int x);
+    T mu_func(T x);
+    T mu_func(T x, T* dmu);                 // dmu: derivative over x
+
+    FS_paramT<T> get_param(void);
+    void get_pwl(FS_pwlT<T>* pwl);          // breakpoints of TRP_L, TRP_C, TRP_R, TRI and PWL (n = 0 for the others)
+    void get_support(T* low, T* high);      // mu is 0 below low and above high
 };
 
-class FuzzyFrame
+template <typename T>
+class FuzzyFrameT
 {
 private:
-    FuzzySet* _ling_sets;
+    FuzzySetT<T>* _ling_sets;
     u_int _ling_size;
-    UnivDisc _domain;
+    UnivDiscT<T> _domain;
     FrameType _type;
+
+    // Regular strong (Ruspini) partition, see Partition_SetUp
+    T _part_origin;             // first breakpoint
+    T _part_inv_step;           // 1/(distance between breakpoints)
+    u_int _part_intervals;      // number of intervals between breakpoints
+    u_int _part_stride;         // 0: not regular, 1: triangles only, 2: with plateaus
+    bool _part_detect;          // Set_SetUp changed a FuzzySet since the last detection
+    void detect_partition(void);
+    void active_terms(T x, u_int* indx, T* mu);
+    bool part_window(T x, u_int* first, u_int* last);
+
+    // Lookup table of every FuzzySet over the domain, see Table_SetUp
+    T* _table;                  // _table_points rows of _ling_size values, 0: no table
+    u_int _table_points;
+    T _table_inv_step;
+    T _table_error;             // maximum interpolation error
+    bool _stale;                // a FuzzySet or the domain changed since the last Frame_Refresh
+    void fill_table(void);
+    T table_error(u_int points);
+    u_int table_row(T x, T* f);
 public:
-    void Frame_SetUp(FuzzySet* sets, u_int _ling_size, float x_left, float x_right, FrameType FF_type);
-    void domainSetUp(float x_left, float x_right, float interval);
-	void Set_SetUp(u_int indx, FS_type the_type, float thr_1);
-    void Set_SetUp(u_int indx, FS_type the_type, float thr_1, float thr_2);
-    void Set_SetUp(u_int indx, FS_type the_type, float thr_1, float thr_2, float thr_3);
-    void Set_SetUp(u_int indx, FS_type the_type, float thr_1, float thr_2, float thr_3, float thr_4);
-
-    float get_muvalue(u_int indx, float x);
-    FuzzySet* getFSAddress(void);
+    void Frame_SetUp(FuzzySetT<T>* sets, u_int _ling_size, T x_left, T x_right, FrameType FF_type);
+    void domainSetUp(T x_left, T x_right, T interval);
+    void Partition_SetUp(T first_break, T step, bool plateau);
+    void Pwl_SetUp(FS_pwlT<T>* pwl);
+    bool Table_SetUp(T* table, u_int points);
+    u_int Table_Points(T max_error, u_int max_points);
+    void Frame_Refresh(void);
+	void Set_SetUp(u_int indx, FS_type the_type, T thr_1);
+    void Set_SetUp(u_int indx, FS_type the_type, T thr_1, T thr_2);
+    void Set_SetUp(u_int indx, FS_type the_type, T thr_1, T thr_2, T thr_3);
+    void Set_SetUp(u_int indx, FS_type the_type, T thr_1, T thr_2, T thr_3, T thr_4);
+    void Set_SetUp(u_int indx, const T* x, const T* mu, u_int n);
+
+    T get_muvalue(u_int indx, T x);
+    T get_muvalue(u_int indx, T x, T* dmu);
+    bool is_partition(void);
+    bool get_active_terms(T x, u_int* indx, T* mu);
+    void Fuzzify(T x, T* mu);
+    FuzzySetT<T>* getFSAddress(void);
     int get_size(void);
-    UnivDisc get_domain(void);
+    UnivDiscT<T> get_domain(void);
+    u_int get_table_points(void);
+    const T* get_table(void);
+    T get_table_error(void);
 };
 
-class FuzzyRule
+template <typename T>
+class FuzzyRuleT
 {
 /***
  * [Consist of Combination of antecedent and consequent
@@ -186,30 +802,1202 @@ class FuzzyRule
  *        have declare before
 ***/
 private:
-    FuzzyFrame* _antecedent_frames;
-    FuzzyFrame* _consequent_frames;
+    FuzzyFrameT<T>* _antecedent_frames;
+    FuzzyFrameT<T>* _consequent_frames;
     u_int* _antecedent_rules;
     u_int* _consequent_rules;
 
     u_int _input_frame_size;
     u_int _output_frame_size;
 
+    // Order of evaluation of the antecedents, see Order_SetUp
+    const u_int* _order;
+    T _check_low, _check_high;      // support of the first antecedent evaluated
+    template <class TNorm>
+    T fulfillment(const T* input, u_int* evaluated);
+
 public:
-    void Rule_SetUp(FuzzyFrame* input_frames, u_int* input_rules, u_int FR_input_size, FuzzyFrame* output_frames, u_int* output_rules, u_int FR_output_size);
-    float Evaluate(float* input, float output, u_int output_id);
-    UnivDisc get_output_domain(u_int output_id);
+    void Rule_SetUp(FuzzyFrameT<T>* input_frames, u_int* input_rules, u_int FR_input_size, FuzzyFrameT<T>* output_frames, u_int* output_rules, u_int FR_output_size);
+    void Order_SetUp(const u_int* order);
+    T Evaluate(T* input, T output, u_int output_id);
+    template <class TNorm, class Implication>
+    T Evaluate(T* input, T output, u_int output_id);
+    // Same as above, grad receives the derivative over each input
+    T Evaluate(T* input, T output, u_int output_id, T* grad);
+    template <class TNorm, class Implication>
+    T Evaluate(T* input, T output, u_int output_id, T* grad);
+    UnivDiscT<T> get_output_domain(u_int output_id);
+    u_int get_input_size(void);
+    u_int get_output_size(void);
+    FuzzyFrameT<T>* get_input_frames(void);
+    FuzzyFrameT<T>* get_output_frames(void);
+    const u_int* get_input_rules(void);
+    const u_int* get_output_rules(void);
+    u_int get_evaluations(const T* input);  // membership functions of the antecedents Evaluate computes for input
 };
 
-class FuzzySystem
+template <typename T>
+class FuzzySystemT
 {
 private:
-    FuzzyRule* _rules;
+    FuzzyRuleT<T>* _rules;
     u_int _total_rules;
 public:
-    FuzzySystem(FuzzyRule* Rules, u_int total_rules);
-    float Evaluate(float* input, float output, u_int output_id);
-    float Defuzzyfication(float* input, u_int output_id);
+    FuzzySystemT(FuzzyRuleT<T>* Rules, u_int total_rules);
+    FuzzyRuleT<T>* get_rules(void);
+    u_int get_total_rules(void);
+    T Evaluate(T* input, T output, u_int output_id);
+    T Defuzzyfication(T* input, u_int output_id);
+
+    // Same as above, but with operators chosen at compile time (see OPERATOR POLICIES)
+    template <class TNorm, class SNorm, class Implication>
+    T Evaluate(T* input, T output, u_int output_id);
+    template <class TNorm, class SNorm, class Implication>
+    T Defuzzyfication(T* input, u_int output_id);
+
+    // Crisp output and its gradient over the inputs in one pass (see GRADIENT METHODS)
+    T Evaluate(T* input, T output, u_int output_id, T* grad);
+    T Defuzzyfication(T* input, u_int output_id, T* grad);
+    template <class TNorm, class SNorm, class Implication>
+    T Evaluate(T* input, T output, u_int output_id, T* grad);
+    template <class TNorm, class SNorm, class Implication>
+    T Defuzzyfication(T* input, u_int output_id, T* grad);
 };
 
+typedef FuzzySetT<float> FuzzySet;
+typedef FuzzyFrameT<float> FuzzyFrame;
+typedef FuzzyRuleT<float> FuzzyRule;
+typedef FuzzySystemT<float> FuzzySystem;
+
+// The float classes are compiled once, in FuzzyLogic.cpp
+extern template class FuzzySetT<float>;
+extern template class FuzzyFrameT<float>;
+extern template class FuzzyRuleT<float>;
+extern template class FuzzySystemT<float>;
+
+/* FLATTENED SYSTEMS */
+// The host side modules (FuzzyParallel, FuzzyBatch, FuzzyIndex, FuzzyTrainer,
+// ...) turn a FuzzySystem into arrays of indexes, which needs every rule to
+// use the same frames and sizes
+struct FlatSystem
+{
+    FuzzyRule* rules;
+    u_int total_rules;
+    u_int input_size;
+    u_int output_size;
+    FuzzyFrame* input_frames;
+    FuzzyFrame* output_frames;
+};
+
+// Frames and sizes of the rules of system, and every frame refreshed
+// (Frame_Refresh) so that the modules use its partition and table; false if
+// the system has no rule or rules with different frames or sizes
+bool flat_system(FuzzySystem* system, FlatSystem* flat);
+
+// Number of samples of a domain, the same float loop as Defuzzyfication; 0 if
+// the interval is not positive
+u_int domain_samples(UnivDisc domain);
+
+// Thresholds of a FuzzySet that the modules fit (TRP_L, TRP_R, TRI, TRP_C
+// and GAUSS, 0 for the other types)
+u_int param_count(FS_type type);
+
+// Size rounded up to a multiple of a cache line (64 bytes)
+size_t align_64(size_t size);
+
+
+/* TEMPLATE METHODS */
+// They have to be visible to the compiler in every translation unit that
+// instantiates them, so they are defined here instead of in FuzzyLogic.cpp
+template <typename T>
+FuzzySetT<T>::FuzzySetT()
+{
+    FS_paramT<T> none = {T(0), T(0), T(0), T(0), TRP_L};
+    this->_param = none;
+    this->_pwl = 0;
+    this->_slope[0] = T(0);
+    this->_slope[1] = T(0);
+}
+
+template <typename T>
+void FuzzySetT<T>::set_pwl(FS_pwlT<T>* pwl)
+{
+    /*
+    Storage of the breakpoints (provided by the caller like the FuzzySets
+    themselves), which a PWL set needs. A TRP_L, TRP_C, TRP_R or TRI set
+    with storage is converted into breakpoints, one without storage finds
+    the segment of x from its thresholds and the slopes kept in the set.
+    Both are evaluated without division and give the same result. The
+    breakpoints of a PWL set are moved to the new storage.
+    */
+    FS_pwlT<T>* old = this->_pwl;
+    this->_pwl = pwl;
+    if (pwl == 0 || pwl == old) {return;}
+    if (this->_param.mu_type != PWL)    {this->pwl_from_param();}
+    else if (old != 0)                  {*pwl = *old;}
+    else                                {pwl_set_up(pwl, (const T*)0, (const T*)0, 0);}
+}
+
+template <typename T>
+void FuzzySetT<T>::set_up(FS_type the_type, T thr_1)
+{
+	_param.mu_type = the_type;
+	_param.thr1 = thr_1;
+	this->slopes_from_param();
+	this->pwl_from_param();
+}
+
+template <typename T>
+void FuzzySetT<T>::set_up(FS_type the_type, T thr_1, T thr_2)
+{
+    _param.mu_type = the_type;
+    _param.thr1 = thr_1;
+    _param.thr2 = thr_2;
+    this->slopes_from_param();
+    this->pwl_from_param();
+}
+
+template <typename T>
+void FuzzySetT<T>::set_up(FS_type the_type, T thr_1, T thr_2, T thr_3)
+{
+    _param.mu_type = the_type;
+    _param.thr1 = thr_1;
+    _param.thr2 = thr_2;
+    _param.thr3 = thr_3;
+    this->slopes_from_param();
+    this->pwl_from_param();
+}
+template <typename T>
+void FuzzySetT<T>::set_up(FS_type the_type, T thr_1, T thr_2, T thr_3, T thr_4)
+{
+    _param.mu_type = the_type;
+    _param.thr1 = thr_1;
+    _param.thr2 = thr_2;
+    _param.thr3 = thr_3;
+    _param.thr4 = thr_4;
+    this->slopes_from_param();
+    this->pwl_from_param();
+}
+template <typename T>
+void FuzzySetT<T>::set_up(const T* x, const T* mu, u_int n)
+{
+    _param.mu_type = PWL;
+    if (this->_pwl != 0) {pwl_set_up(this->_pwl, x, mu, n);}
+}
+
+template <typename T>
+u_int FuzzySetT<T>::breakpoints(T* x, T* mu)
+{
+    // Express the trapezoids and the triangle as breakpoints (0 for the other types)
+    switch (this->_param.mu_type)
+    {
+    case TRP_L:
+        x[0] = _param.thr1;     mu[0] = T(1);
+        x[1] = _param.thr2;     mu[1] = T(0);
+        return 2;
+    case TRP_C:
+        x[0] = _param.thr1;     mu[0] = T(0);
+        x[1] = _param.thr2;     mu[1] = T(1);
+        x[2] = _param.thr3;     mu[2] = T(1);
+        x[3] = _param.thr4;     mu[3] = T(0);
+        return 4;
+    case TRP_R:
+        x[0] = _param.thr1;     mu[0] = T(0);
+        x[1] = _param.thr2;     mu[1] = T(1);
+        return 2;
+    case TRI:
+        x[0] = _param.thr1;     mu[0] = T(0);
+        x[1] = _param.thr2;     mu[1] = T(1);
+        x[2] = _param.thr3;     mu[2] = T(0);
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+template <typename T>
+void FuzzySetT<T>::pwl_from_param(void)
+{
+    if (this->_pwl == 0) {return;}
+    T x[4] = {T(0), T(0), T(0), T(0)};
+    T mu[4] = {T(0), T(0), T(0), T(0)};
+    u_int n = this->breakpoints(x, mu);
+    pwl_set_up(this->_pwl, x, mu, n);
+}
+
+template <typename T>
+void FuzzySetT<T>::slopes_from_param(void)
+{
+    // Slopes of the rising and falling edges, the same as pwl_set_up over the
+    // breakpoints of the thresholds, so that linear_shape needs no division
+    T a = this->_param.thr1, b = this->_param.thr2, c = this->_param.thr3, d = this->_param.thr4;
+    this->_slope[0] = T(0);
+    this->_slope[1] = T(0);
+    switch (this->_param.mu_type)
+    {
+    case TRP_L:
+        this->_slope[0] = pwl_slope(a, T(1), b, T(0));
+        break;
+    case TRP_C:
+        this->_slope[0] = pwl_slope(a, T(0), b, T(1));
+        this->_slope[1] = pwl_slope(c, T(1), d, T(0));
+        break;
+    case TRP_R:
+        this->_slope[0] = pwl_slope(a, T(0), b, T(1));
+        break;
+    case TRI:
+        this->_slope[0] = pwl_slope(a, T(0), b, T(1));
+        this->_slope[1] = pwl_slope(b, T(1), c, T(0));
+        break;
+    default:
+        break;
+    }
+}
+
+template <typename T>
+T FuzzySetT<T>::linear_shape(T x, T* dmu)
+{
+    // piecewise_linear over the breakpoints of the thresholds, built here with
+    // the slopes kept in the set, for a set without storage (same result)
+    T bx[4] = {T(0), T(0), T(0), T(0)};
+    T bmu[4] = {T(0), T(0), T(0), T(0)};
+    T slope[5] = {T(0), T(0), T(0), T(0), T(0)};
+    u_int n = this->breakpoints(bx, bmu);
+    slope[1] = this->_slope[0];
+    if (n > 2) {slope[n-1] = this->_slope[1];}          // falling edge of TRP_C and TRI
+    u_int k = 0;
+    for (u_int i=0; i<n; i++) {k = k + (u_int)(x > bx[i]);}
+    u_int j = k - (u_int)(k > 0);
+    *dmu = slope[k];
+    return bmu[j] + slope[k] * (x - bx[j]);
+}
+
+template <typename T>
+T FuzzySetT<T>::mu_func(int x)
+{
+    // Calculate degree of membership
+    return this->mu_func(T(x));
+}
+
+template <typename T>
+T FuzzySetT<T>::mu_func(T x)
+{
+    // Calculate degree of membership
+    T _val = x;
+    T slope;
+    switch (this->_param.mu_type)
+    {
+    case TRP_L:
+    case TRP_C:
+    case TRP_R:
+    case TRI:
+    case PWL:
+        // The slopes were precomputed in set_up, no division here
+        if (this->_pwl != 0)    {_val = piecewise_linear(this->_pwl, _val);}
+        else                    {_val = this->linear_shape(_val, &slope);}
+        break;
+	case SINGLE:
+		_val = singleton<T>(this->_param.thr1, _val);
+		break;
+    // fuzzy_exp and fuzzy_pow follow FUZZY_FAST_EXP for float
+    case GAUSS:
+        _val = gaussian<T>(this->_param.thr1, this->_param.thr2, _val);
+        break;
+    case GBELL:
+        _val = generalized_bell<T>(this->_param.thr1, this->_param.thr2, this->_param.thr3, _val);
+        break;
+    case SIGMOID:
+        _val = sigmoid<T>(this->_param.thr1, this->_param.thr2, _val);
+        break;
+    default:
+        _val = T(0);
+    }
+    return _val;
+}
+
+template <typename T>
+T FuzzySetT<T>::mu_func(T x, T* dmu)
+{
+    // Degree of membership and its derivative over x
+    T _val;
+    T u;
+    switch (this->_param.mu_type)
+    {
+    case TRP_L:
+    case TRP_C:
+    case TRP_R:
+    case TRI:
+    case PWL:
+        if (this->_pwl != 0)    {_val = piecewise_linear(this->_pwl, x, dmu);}
+        else                    {_val = this->linear_shape(x, dmu);}
+        break;
+    case GAUSS:
+        // -(x-c)/sigma^2 * mu
+        _val = gaussian<T>(this->_param.thr1, this->_param.thr2, x);
+        u = (x - this->_param.thr1) / this->_param.thr2;
+        *dmu = -u / this->_param.thr2 * _val;
+        break;
+    case GBELL:
+        // -2b/(x-c) * mu * (1-mu), zero at the center
+        _val = generalized_bell<T>(this->_param.thr1, this->_param.thr2, this->_param.thr3, x);
+        u = x - this->_param.thr3;
+        *dmu = (u == T(0)) ? T(0) : T(-2) * this->_param.thr2 / u * _val * (T(1) - _val);
+        break;
+    case SIGMOID:
+        // a * mu * (1-mu)
+        _val = sigmoid<T>(this->_param.thr1, this->_param.thr2, x);
+        *dmu = this->_param.thr1 * _val * (T(1) - _val);
+        break;
+    default:
+        // SINGLE is flat everywhere but at its point
+        _val = this->mu_func(x);
+        *dmu = T(0);
+    }
+    return _val;
+}
+
+template <typename T>
+FS_paramT<T> FuzzySetT<T>::get_param(void)
+{
+    return this->_param;
+}
+
+template <typename T>
+void FuzzySetT<T>::get_pwl(FS_pwlT<T>* pwl)
+{
+    if (this->_pwl != 0)
+    {
+        *pwl = *this->_pwl;
+        return;
+    }
+    T x[4] = {T(0), T(0), T(0), T(0)};
+    T mu[4] = {T(0), T(0), T(0), T(0)};
+    u_int n = this->breakpoints(x, mu);
+    pwl_set_up(pwl, x, mu, n);
+}
+
+template <typename T>
+void FuzzySetT<T>::get_support(T* low, T* high)
+{
+    // Smallest interval outside of which the degree of membership is 0
+    *low = T(-HUGE_VALF);
+    *high = T(HUGE_VALF);
+    FS_pwlT<T> breaks;
+    this->get_pwl(&breaks);
+    const FS_pwlT<T>* pwl = &breaks;
+    switch (this->_param.mu_type)
+    {
+    case TRP_L:
+    case TRP_C:
+    case TRP_R:
+    case TRI:
+    case PWL:
+        // Constant beyond the end points, so only leading and trailing zeros count
+        if (pwl->n == 0) {break;}
+        if (pwl->mu[0] == T(0))
+        {
+            u_int j = 0;
+            while (j + 1 < pwl->n && pwl->mu[j + 1] == T(0)) {j++;}
+            *low = pwl->x[j];
+        }
+        if (pwl->mu[pwl->n - 1] == T(0))
+        {
+            u_int j = pwl->n - 1;
+            while (j > 0 && pwl->mu[j - 1] == T(0)) {j--;}
+            *high = pwl->x[j];
+        }
+        break;
+    case SINGLE:
+        *low = this->_param.thr1;
+        *high = this->_param.thr1;
+        break;
+    default:
+        // GAUSS, GBELL and SIGMOID are never 0
+        break;
+    }
+}
+
+template <typename T>
+void FuzzyFrameT<T>::Frame_SetUp(FuzzySetT<T>* sets, u_int _ling_size, T x_left, T x_right, FrameType FF_type)
+{
+    this->_domain.low_bond = x_left;
+    this->_domain.up_bond = x_right;
+    this->_domain.interval = (x_right - x_left)/T(DISC_SIZE - 1);
+    this->_ling_sets = sets;
+    this->_ling_size = _ling_size;
+    this->_type = FF_type;
+    this->_part_stride = 0;
+    this->_part_detect = false;
+    this->_table = 0;
+    this->_table_points = 0;
+    this->_table_error = T(0);
+    this->_stale = false;
+}
+template <typename T>
+void FuzzyFrameT<T>::domainSetUp(T x_left, T x_right, T interval)
+{
+    this->_domain.low_bond = x_left;
+    this->_domain.up_bond = x_right;
+    this->_domain.interval = interval;
+    this->_stale = true;
+}
+template <typename T>
+void FuzzyFrameT<T>::Set_SetUp(u_int indx, FS_type the_type, T thr_1)
+{
+	this->_ling_sets[indx].set_up(the_type, thr_1);
+	this->_part_detect = true;
+	this->_stale = true;
+}
+template <typename T>
+void FuzzyFrameT<T>::Set_SetUp(u_int indx, FS_type the_type, T thr_1, T thr_2)
+{
+    this->_ling_sets[indx].set_up(the_type, thr_1, thr_2);
+    this->_part_detect = true;
+    this->_stale = true;
+}
+template <typename T>
+void FuzzyFrameT<T>::Set_SetUp(u_int indx, FS_type the_type, T thr_1, T thr_2, T thr_3)
+{
+    this->_ling_sets[indx].set_up(the_type, thr_1, thr_2, thr_3);
+    this->_part_detect = true;
+    this->_stale = true;
+}
+template <typename T>
+void FuzzyFrameT<T>::Set_SetUp(u_int indx, FS_type the_type, T thr_1, T thr_2, T thr_3, T thr_4)
+{
+    this->_ling_sets[indx].set_up(the_type, thr_1, thr_2, thr_3, thr_4);
+    this->_part_detect = true;
+    this->_stale = true;
+}
+template <typename T>
+void FuzzyFrameT<T>::Set_SetUp(u_int indx, const T* x, const T* mu, u_int n)
+{
+    this->_ling_sets[indx].set_up(x, mu, n);
+    this->_part_detect = true;
+    this->_stale = true;
+}
+
+template <typename T>
+void FuzzyFrameT<T>::Pwl_SetUp(FS_pwlT<T>* pwl)
+{
+    /*
+    Storage of the breakpoints of every FuzzySet of the frame (one FS_pwl
+    per set, provided by the caller like the FuzzySets themselves), see
+    FuzzySetT::set_pwl. Call it after Frame_SetUp and before setting up
+    PWL sets; Pwl_SetUp(0) removes it.
+    */
+    for (u_int k=0; k<this->_ling_size; k++) {this->_ling_sets[k].set_pwl((pwl != 0) ? &pwl[k] : 0);}
+    this->_part_detect = true;
+    this->_stale = true;
+}
+
+template <typename T>
+void FuzzyFrameT<T>::Partition_SetUp(T first_break, T step, bool plateau)
+{
+    /*
+    Set up every FuzzySet of the frame as a regular strong (Ruspini) partition
+    with breakpoints first_break + k*step. The first and last sets are
+    shoulders (TRP_L and TRP_R). Without plateau the sets in between are
+    triangles peaking at each breakpoint; with plateau they are trapezoids
+    whose top covers one step, e.g. Partition_SetUp(10, 20, true) on three
+    sets gives TRP_L(10,30), TRP_C(10,30,50,70) and TRP_R(50,70).
+    */
+    u_int n = this->_ling_size;
+    if (n < 2) {return;}
+    T b = first_break;
+    if (plateau)
+    {
+        this->_ling_sets[0].set_up(TRP_L, b, b + step);
+        for (u_int k=1; k<n-1; k++)
+        {
+            this->_ling_sets[k].set_up(TRP_C, b, b + step, b + T(2)*step, b + T(3)*step);
+            b = b + T(2)*step;
+        }
+        this->_ling_sets[n-1].set_up(TRP_R, b, b + step);
+    }
+    else
+    {
+        this->_ling_sets[0].set_up(TRP_L, b, b + step);
+        for (u_int k=1; k<n-1; k++)
+        {
+            this->_ling_sets[k].set_up(TRI, b, b + step, b + T(2)*step);
+            b = b + step;
+        }
+        this->_ling_sets[n-1].set_up(TRP_R, b, b + step);
+    }
+    this->_part_origin = first_break;
+    this->_part_inv_step = T(1) / step;
+    this->_part_intervals = plateau ? 2*(n-1) - 1 : n - 1;
+    this->_part_stride = plateau ? 2 : 1;
+    this->_part_detect = false;
+    this->_stale = true;
+}
+
+template <typename T>
+bool FuzzyFrameT<T>::Table_SetUp(T* table, u_int points)
+{
+    /*
+    Precompute the degree of membership of every FuzzySet of the frame at
+    points evenly spaced values from low_bond to up_bond of the domain, into
+    table (points * number of FuzzySets values, provided by the caller like
+    the FuzzySets themselves). get_muvalue and Fuzzify then interpolate
+    linearly between two rows of the table instead of evaluating the sets;
+    outside of the domain they still evaluate the sets. The table is filled
+    by Frame_Refresh, so it can be set up before the FuzzySets; until then,
+    and after every change of the FuzzySets (Set_SetUp, Partition_SetUp), of
+    the domain or of the table, the sets are evaluated instead. Table_SetUp(0, 0)
+    removes it.
+    */
+    this->_table = 0;
+    this->_table_points = 0;
+    this->_table_error = T(0);
+    if (table == 0) {return points == 0;}
+    if (points < 2 || !(this->_domain.up_bond > this->_domain.low_bond)) {return false;}
+    this->_table = table;
+    this->_table_points = points;
+    this->_stale = true;
+    return true;
+}
+
+template <typename T>
+u_int FuzzyFrameT<T>::Table_Points(T max_error, u_int max_points)
+{
+    // Smallest number of points (2^k + 1, k >= 1) whose interpolation error
+    // is at most max_error, or 0 if max_points are not enough
+    for (u_int points=3; points<=max_points; points=2*points - 1)
+    {
+        if (!(this->table_error(points) > max_error)) {return points;}
+        if (points > max_points / 2) {break;}
+    }
+    return 0;
+}
+
+template <typename T>
+void FuzzyFrameT<T>::Frame_Refresh(void)
+{
+    /*
+    Detect a partition again if Set_SetUp changed a FuzzySet, and fill the
+    table again if the FuzzySets, the domain or the table changed; call it
+    once every FuzzySet is set up. Until then get_muvalue and Fuzzify
+    evaluate the FuzzySets, and get_active_terms and is_partition report no
+    partition: the reads never change the frame, so threads can share it.
+    The flags are cleared last, so that the partition and the table are only
+    used once they are complete.
+    */
+    if (!this->_stale) {return;}
+    if (this->_part_detect) {this->detect_partition();}
+    this->fill_table();
+    this->_part_detect = false;
+    this->_stale = false;
+}
+
+template <typename T>
+void FuzzyFrameT<T>::fill_table(void)
+{
+    if (this->_table == 0) {return;}
+    u_int n = this->_ling_size;
+    u_int points = this->_table_points;
+    T low = this->_domain.low_bond;
+    T step = (this->_domain.up_bond - low) / T(points - 1);
+    this->_table_inv_step = T(1) / step;
+    for (u_int p=0; p<points; p++)
+    {
+        T x = (p == points - 1) ? this->_domain.up_bond : low + step * T(p);
+        for (u_int k=0; k<n; k++) {this->_table[p*n + k] = this->_ling_sets[k].mu_func(x);}
+    }
+    this->_table_error = this->table_error(points);
+}
+
+template <typename T>
+T FuzzyFrameT<T>::table_error(u_int points)
+{
+    /*
+    Maximum difference between the sets and the linear interpolation of
+    points samples: measured at the quarters of every interval and at the
+    breakpoints of the piecewise linear sets, where the error of a piecewise
+    linear set is the largest (so it is exact for them).
+    */
+    T low = this->_domain.low_bond;
+    T high = this->_domain.up_bond;
+    T step = (high - low) / T(points - 1);
+    T error = T(0);
+    for (u_int k=0; k<this->_ling_size; k++)
+    {
+        FuzzySetT<T>* set = &this->_ling_sets[k];
+        FS_pwlT<T> breaks;
+        set->get_pwl(&breaks);
+        const FS_pwlT<T>* pwl = &breaks;
+        u_int n_breaks = pwl->n;
+        for (u_int j=0; j<(points - 1)*3 + n_breaks; j++)
+        {
+            T x = (j < (points - 1)*3) ? low + step * (T(j/3) + T(0.25) * T(j%3 + 1)) : pwl->x[j - (points - 1)*3];
+            if (x < low || x > high) {continue;}
+            T t = (x - low) / step;
+            u_int p = (u_int)fuzzy_value(t);
+            p = (p < points - 1) ? p : points - 2;
+            T f = t - T(p);
+            T x0 = low + step * T(p);
+            T x1 = (p + 1 == points - 1) ? high : low + step * T(p + 1);
+            T mu = set->mu_func(x0) + f * (set->mu_func(x1) - set->mu_func(x0));
+            T diff = mu - set->mu_func(x);
+            diff = (diff < T(0)) ? -diff : diff;
+            error = (diff > error) ? diff : error;
+        }
+    }
+    return error;
+}
+
+template <typename T>
+u_int FuzzyFrameT<T>::table_row(T x, T* f)
+{
+    // Row of the table below x, and the fraction f of the way to the next one
+    T t = (x - this->_domain.low_bond) * this->_table_inv_step;
+    u_int p = (u_int)fuzzy_value(t);
+    p = (p < this->_table_points - 1) ? p : this->_table_points - 2;
+    *f = t - T(p);
+    return p * this->_ling_size;
+}
+
+template <typename T>
+void FuzzyFrameT<T>::detect_partition(void)
+{
+    /*
+    Check whether the FuzzySets of the frame form a regular strong partition:
+    all breakpoints evenly spaced, at most two adjacent sets active at a time
+    and their degrees of membership summing to one. The check compares the
+    O(1) lookup of get_active_terms with every FuzzySet of the frame at the
+    breakpoints and inside every interval.
+    */
+    this->_part_stride = 0;
+    u_int n = this->_ling_size;
+    if (n < 2) {return;}
+
+    // Only piecewise linear sets, and find the first and last breakpoints
+    T first = T(0), last = T(0);
+    for (u_int k=0; k<n; k++)
+    {
+        FS_type type = this->_ling_sets[k].get_param().mu_type;
+        FS_pwlT<T> breaks;
+        this->_ling_sets[k].get_pwl(&breaks);
+        const FS_pwlT<T>* pwl = &breaks;
+        if (type != TRP_L && type != TRP_C && type != TRP_R && type != TRI && type != PWL) {return;}
+        if (pwl->n < 1 || pwl->n > PWL_SIZE) {return;}
+        if (k == 0 || pwl->x[0] < first)        {first = pwl->x[0];}
+        if (k == 0 || pwl->x[pwl->n-1] > last)  {last = pwl->x[pwl->n-1];}
+    }
+    if (!(last > first)) {return;}
+
+    u_int idx[2] = {0, 0};
+    T mu[2] = {T(0), T(0)};
+    for (u_int stride=1; stride<=2; stride++)
+    {
+        u_int intervals = (stride == 1) ? n - 1 : 2*(n-1) - 1;
+        T step = (last - first) / T(intervals);
+        this->_part_origin = first;
+        this->_part_inv_step = T(1) / step;
+        this->_part_intervals = intervals;
+        this->_part_stride = stride;
+
+        bool regular = true;
+        for (u_int j=0; j<=intervals + 1 && regular; j++)
+        {
+            // Breakpoint j-1/2 ... j+3/4, including one step outside on both ends
+            for (u_int q=0; q<4 && regular; q++)
+            {
+                T x = first + step * (T(j) - T(0.5) + T(0.25) * T(q));
+                this->active_terms(x, idx, mu);
+                for (u_int k=0; k<n; k++)
+                {
+                    T expected = T(0);
+                    if (k == idx[0])        {expected = mu[0];}
+                    else if (k == idx[1])   {expected = mu[1];}
+                    T diff = this->_ling_sets[k].mu_func(x) - expected;
+                    if (diff > T(1e-4) || diff < T(-1e-4)) {regular = false; break;}
+                }
+            }
+        }
+        // Every FuzzySet must also be 0 outside of its own intervals (with an
+        // eighth of a step of margin), so that Fuzzify can skip the others
+        for (u_int k=0; k<n && regular; k++)
+        {
+            T low, high;
+            this->_ling_sets[k].get_support(&low, &high);
+            T left = (stride == 1) ? T(k) - T(1) : T(2*k) - T(2);
+            T right = (stride == 1) ? T(k) + T(1) : T(2*k) + T(1);
+            if (k > 0 && low < first + step * (left - T(0.125)))       {regular = false;}
+            if (k < n-1 && high > first + step * (right + T(0.125)))   {regular = false;}
+        }
+        if (regular) {return;}
+    }
+    this->_part_stride = 0;
+}
+
+template <typename T>
+bool FuzzyFrameT<T>::part_window(T x, u_int* first, u_int* last)
+{
+    /*
+    FuzzySets that can be non-zero at x in a partition: the two active ones,
+    and a neighbour when x is within a quarter step of its intervals, since
+    rounding can put x one interval off. The others are exactly 0 there (see
+    detect_partition).
+    */
+    if (this->_part_detect || this->_part_stride == 0) {return false;}
+    T t = (x - this->_part_origin) * this->_part_inv_step;
+    T t_max = T(this->_part_intervals);
+    t = (t > T(0)) ? t : T(0);
+    t = (t < t_max) ? t : t_max;
+    u_int j = (u_int)fuzzy_value(t);
+    j = (j < this->_part_intervals) ? j : this->_part_intervals - 1;
+    u_int low = (this->_part_stride == 2) ? (j + 1) >> 1 : j;
+    T left_end = (this->_part_stride == 2) ? T(2*low) - T(1) : T(low);
+    T right_start = (this->_part_stride == 2) ? T(2*low + 2) : T(low + 1);
+    *first = (low > 0 && t < left_end + T(0.25)) ? low - 1 : low;
+    *last = (low + 2 < this->_ling_size && t > right_start - T(0.25)) ? low + 2 : low + 1;
+    return true;
+}
+
+template <typename T>
+bool FuzzyFrameT<T>::is_partition(void)
+{
+    return !this->_part_detect && this->_part_stride != 0;
+}
+
+template <typename T>
+bool FuzzyFrameT<T>::get_active_terms(T x, u_int* indx, T* mu)
+{
+    /*
+    For a regular strong partition, give the (at most) two active FuzzySets
+    and their degrees of membership with one multiply and one floor, instead
+    of evaluating every FuzzySet. indx[0] < indx[1] and mu[0] + mu[1] = 1.
+    Return false (and leave indx/mu untouched) if the frame is not regular,
+    or Set_SetUp changed it since the last Frame_Refresh.
+    The degrees can differ from the FuzzySets by rounding; Fuzzify only uses
+    the indexes, to skip the FuzzySets that are 0.
+    */
+    if (!this->is_partition()) {return false;}
+    this->active_terms(x, indx, mu);
+    return true;
+}
+
+template <typename T>
+void FuzzyFrameT<T>::active_terms(T x, u_int* indx, T* mu)
+{
+    // The lookup of get_active_terms, for the partition in _part_*
+    T t = (x - this->_part_origin) * this->_part_inv_step;
+    T t_max = T(this->_part_intervals);
+    t = (t > T(0)) ? t : T(0);
+    t = (t < t_max) ? t : t_max;
+    u_int j = (u_int)fuzzy_value(t);
+    j = (j < this->_part_intervals) ? j : this->_part_intervals - 1;
+    T f = t - T(j);
+    u_int low = j;
+    if (this->_part_stride == 2)
+    {
+        // Even intervals are transitions, odd intervals are plateaus
+        low = (j + 1) >> 1;
+        f = (j & 1) ? T(0) : f;
+    }
+    indx[0] = low;
+    indx[1] = low + 1;
+    mu[0] = T(1) - f;
+    mu[1] = f;
+}
+
+template <typename T>
+void FuzzyFrameT<T>::Fuzzify(T x, T* mu)
+{
+    // Degree of membership of x in every FuzzySet of the frame, the same
+    // values as get_muvalue of each one
+    u_int first, last;
+    if (this->_table != 0 && !this->_stale && x >= this->_domain.low_bond && x <= this->_domain.up_bond)
+    {
+        // One index computation, then every FuzzySet from the same two rows
+        T f;
+        u_int n = this->_ling_size;
+        const T* row = &this->_table[this->table_row(x, &f)];
+        for (u_int k=0; k<n; k++) {mu[k] = row[k] + f * (row[n + k] - row[k]);}
+    }
+    else if (this->_ling_size > 3 && this->part_window(x, &first, &last))
+    {
+        // Two or three FuzzySets of a partition, the others are 0
+        for (u_int k=0; k<this->_ling_size; k++) {mu[k] = T(0);}
+        for (u_int k=first; k<=last; k++) {mu[k] = this->_ling_sets[k].mu_func(x);}
+    }
+    else
+    {
+        for (u_int k=0; k<this->_ling_size; k++) {mu[k] = this->_ling_sets[k].mu_func(x);}
+    }
+}
+
+template <typename T>
+T FuzzyFrameT<T>::get_muvalue(u_int indx, T x)
+{
+    if (this->_table != 0 && !this->_stale && x >= this->_domain.low_bond && x <= this->_domain.up_bond)
+    {
+        T f;
+        const T* row = &this->_table[this->table_row(x, &f) + indx];
+        return row[0] + f * (row[this->_ling_size] - row[0]);
+    }
+    return _ling_sets[indx].mu_func(x);
+}
+
+template <typename T>
+T FuzzyFrameT<T>::get_muvalue(u_int indx, T x, T* dmu)
+{
+    if (this->_table != 0 && !this->_stale && x >= this->_domain.low_bond && x <= this->_domain.up_bond)
+    {
+        // Derivative of the interpolation: slope between the two rows
+        T f;
+        const T* row = &this->_table[this->table_row(x, &f) + indx];
+        *dmu = (row[this->_ling_size] - row[0]) * this->_table_inv_step;
+        return row[0] + f * (row[this->_ling_size] - row[0]);
+    }
+    return _ling_sets[indx].mu_func(x, dmu);
+}
+
+template <typename T>
+FuzzySetT<T>* FuzzyFrameT<T>::getFSAddress(void)
+{
+    return this->_ling_sets;
+}
+
+template <typename T>
+int FuzzyFrameT<T>::get_size(void)
+{
+    return this->_ling_size;
+}
+template <typename T>
+UnivDiscT<T> FuzzyFrameT<T>::get_domain(void)
+{
+    return this->_domain;
+}
+template <typename T>
+u_int FuzzyFrameT<T>::get_table_points(void)
+{
+    return this->_table_points;
+}
+template <typename T>
+const T* FuzzyFrameT<T>::get_table(void)
+{
+    // 0 until Frame_Refresh fills it: get_muvalue does not use it either
+    return this->_stale ? 0 : this->_table;
+}
+template <typename T>
+T FuzzyFrameT<T>::get_table_error(void)
+{
+    return this->_stale ? T(0) : this->_table_error;
+}
+
+
+template <typename T>
+void FuzzyRuleT<T>::Rule_SetUp(FuzzyFrameT<T>* input_frames, u_int* input_rules, u_int FR_input_size, FuzzyFrameT<T>* output_frames, u_int* output_rules, u_int FR_output_size)
+{
+    this->_antecedent_frames = input_frames;
+    this->_consequent_frames = output_frames;
+    this->_antecedent_rules = input_rules;
+    this->_consequent_rules = output_rules;
+    this->_input_frame_size = FR_input_size;
+    this->_output_frame_size = FR_output_size;
+    this->_order = 0;
+}
+
+template <typename T>
+void FuzzyRuleT<T>::Order_SetUp(const u_int* order)
+{
+    /*
+    Evaluate the antecedents in the given order (a permutation of the input
+    indexes, kept by pointer) instead of 0, 1, 2, ... Since the evaluation
+    stops as soon as alpha is 0, the most selective antecedent should come
+    first (see FuzzyProfile). The input of the first one is also compared with
+    the support of its FuzzySet before anything is evaluated, widened by one
+    step of the lookup table of the frame if it has one, since interpolating
+    the table is not 0 up to one step outside of the support. The support is
+    taken now: call Order_SetUp again after changing the FuzzySets or the
+    table. Order_SetUp(0) restores the natural order without the check.
+    */
+    this->_order = order;
+    if (order == 0) {return;}
+    u_int first = order[0];
+    FuzzyFrameT<T>* frame = &this->_antecedent_frames[first];
+    frame->getFSAddress()[this->_antecedent_rules[first]].get_support(&this->_check_low, &this->_check_high);
+    u_int points = frame->get_table_points();
+    UnivDiscT<T> domain = frame->get_domain();
+    T widen = (points > 1) ? (domain.up_bond - domain.low_bond) / T(points - 1) : T(0);
+    this->_check_low = this->_check_low - widen;
+    this->_check_high = this->_check_high + widen;
+}
+
+template <typename T>
+T FuzzyRuleT<T>::Evaluate(T* input, T output, u_int output_id)
+{
+    // Default operators: minimum as AND and as implication (Mamdani)
+    return this->template Evaluate<TNormMin, ImpMamdani>(input, output, output_id);
+}
+
+template <typename T>
+template <class TNorm, class Implication>
+T FuzzyRuleT<T>::Evaluate(T* input, T output, u_int output_id)
+{
+    u_int evaluated;
+    T alpha = this->template fulfillment<TNorm>(input, &evaluated);
+    // Apply the implication between alpha and consequent mu_value of output
+    T dummy = this->_consequent_frames[output_id].get_muvalue(this->_consequent_rules[output_id], output);
+    return Implication::apply(alpha, dummy);
+}
+
+template <typename T>
+template <class TNorm>
+T FuzzyRuleT<T>::fulfillment(const T* input, u_int* evaluated)
+{
+    // Determine the degree of fulfillment. Every T-norm gives 0 once alpha is
+    // 0, so the remaining antecedents are not evaluated (and not counted)
+    T alpha = T(1);
+    *evaluated = 0;
+    if (this->_order != 0 && (input[this->_order[0]] < this->_check_low || input[this->_order[0]] > this->_check_high))
+    {
+        alpha = T(0);                                   // outside of the support of the first antecedent
+    }
+    for (u_int k=0; k < this->_input_frame_size && alpha != T(0); k++)
+    {
+        u_int atc = (this->_order == 0) ? k : this->_order[k];
+        T mu = this->_antecedent_frames[atc].get_muvalue(this->_antecedent_rules[atc], input[atc]);
+        alpha = TNorm::apply(mu, alpha);
+        *evaluated = *evaluated + 1;
+    }
+    return alpha;
+}
+
+template <typename T>
+u_int FuzzyRuleT<T>::get_evaluations(const T* input)
+{
+    // The same walk as Evaluate with minimum as AND: in the order of
+    // Order_SetUp, after the check of the support, until alpha is 0
+    u_int evaluated;
+    this->template fulfillment<TNormMin>(input, &evaluated);
+    return evaluated;
+}
+
+template <typename T>
+UnivDiscT<T> FuzzyRuleT<T>::get_output_domain(u_int output_id)
+{
+    return this->_consequent_frames[output_id].get_domain();
+}
+
+template <typename T>
+u_int FuzzyRuleT<T>::get_input_size(void)
+{
+    return this->_input_frame_size;
+}
+template <typename T>
+u_int FuzzyRuleT<T>::get_output_size(void)
+{
+    return this->_output_frame_size;
+}
+template <typename T>
+FuzzyFrameT<T>* FuzzyRuleT<T>::get_input_frames(void)
+{
+    return this->_antecedent_frames;
+}
+template <typename T>
+FuzzyFrameT<T>* FuzzyRuleT<T>::get_output_frames(void)
+{
+    return this->_consequent_frames;
+}
+template <typename T>
+const u_int* FuzzyRuleT<T>::get_input_rules(void)
+{
+    return this->_antecedent_rules;
+}
+template <typename T>
+const u_int* FuzzyRuleT<T>::get_output_rules(void)
+{
+    return this->_consequent_rules;
+}
+
+
+template <typename T>
+FuzzySystemT<T>::FuzzySystemT(FuzzyRuleT<T>* Rules, u_int total_rules)
+{
+    this->_rules = Rules;
+    this->_total_rules = total_rules;
+}
+
+template <typename T>
+FuzzyRuleT<T>* FuzzySystemT<T>::get_rules(void)
+{
+    return this->_rules;
+}
+template <typename T>
+u_int FuzzySystemT<T>::get_total_rules(void)
+{
+    return this->_total_rules;
+}
+
+template <typename T>
+T FuzzySystemT<T>::Evaluate(T* input_, T output_, u_int output_id_)
+{
+    // Agregatting fuzzy output with maximum over all rules
+    return this->template Evaluate<TNormMin, SNormMax, ImpMamdani>(input_, output_, output_id_);
+}
+
+template <typename T>
+T FuzzySystemT<T>::Defuzzyfication(T* input, u_int output_id)
+{
+    return this->template Defuzzyfication<TNormMin, SNormMax, ImpMamdani>(input, output_id);
+}
+
+template <typename T>
+template <class TNorm, class SNorm, class Implication>
+T FuzzySystemT<T>::Evaluate(T* input_, T output_, u_int output_id_)
+{
+    // Agregatting fuzzy output (degree of membership of output) over all rules
+    T result = T(0);
+    T dummy;
+    for (u_int rule_id=0; rule_id < this->_total_rules; rule_id++)
+    {
+        dummy = this->_rules[rule_id].template Evaluate<TNorm, Implication>(input_, output_, output_id_);
+        result = SNorm::apply(result, dummy);
+    }
+    return result;
+}
+
+template <typename T>
+template <class TNorm, class SNorm, class Implication>
+T FuzzySystemT<T>::Defuzzyfication(T* input, u_int output_id)
+{
+    // Finding crisp output of fuzzy output
+    // via centroid methods (weight is degree of membership)
+    T weight = T(0);
+    T weight_avg = T(0);
+    T mu_;
+    UnivDiscT<T> evaluated_domain = this->_rules[0].get_output_domain(output_id);
+
+    for (T y = evaluated_domain.low_bond; y <= evaluated_domain.up_bond; y = y+evaluated_domain.interval)
+    {
+        mu_ = this->template Evaluate<TNorm, SNorm, Implication>(input, y, output_id);
+        weight = weight + mu_;
+        weight_avg = weight_avg + mu_ * y;
+    }
+    if (weight == T(0)) {weight = T(1);}        // Precaution for weight = 0 (error division by 0)
+    return weight_avg / weight;
+}
+
+
+/* GRADIENT METHODS */
+/***
+ * [Derivative of the crisp output over every input, in the same pass as the output]
+ *
+ * Every step of Defuzzyfication is differentiated with the chain rule:
+ *    - membership functions : slope of the active segment for the piecewise
+ *                             linear sets (the left segment at a breakpoint),
+ *                             closed form for GAUSS, GBELL and SIGMOID
+ *    - operators            : partial() of the policies; for min and max the
+ *                             derivative of the operand they return (a subgradient)
+ *    - centroid             : y* = sum(mu*y)/sum(mu) gives
+ *                             dy* = sum((y - y*) dmu)/sum(mu)
+ *
+ * grad must hold one value per input. A system with more than GRAD_MAX_INPUT
+ * inputs only gives the crisp output, and NaN for every value of grad so that
+ * the missing gradient is not taken for a zero one (test it with grad[0] != grad[0]).
+***/
+template <typename T>
+T FuzzyRuleT<T>::Evaluate(T* input, T output, u_int output_id, T* grad)
+{
+    return this->template Evaluate<TNormMin, ImpMamdani>(input, output, output_id, grad);
+}
+
+template <typename T>
+template <class TNorm, class Implication>
+T FuzzyRuleT<T>::Evaluate(T* input, T output, u_int output_id, T* grad)
+{
+    // Degree of fulfillment with its gradient, each antecedent only depends on its own input
+    u_int n = this->_input_frame_size;
+    T alpha = T(1);
+    T mu, dmu, da, db;
+    for (u_int i=0; i<n; i++) {grad[i] = T(0);}
+    for (u_int atc=0; atc < n; atc++)
+    {
+        mu = this->_antecedent_frames[atc].get_muvalue(this->_antecedent_rules[atc], input[atc], &dmu);
+        TNorm::partial(mu, alpha, &da, &db);
+        alpha = TNorm::apply(mu, alpha);
+        for (u_int i=0; i<atc; i++) {grad[i] = db * grad[i];}
+        grad[atc] = da * dmu;
+    }
+    // The consequent does not depend on the inputs
+    mu = this->_consequent_frames[output_id].get_muvalue(this->_consequent_rules[output_id], output);
+    Implication::partial(alpha, mu, &da, &db);
+    for (u_int i=0; i<n; i++) {grad[i] = da * grad[i];}
+    return Implication::apply(alpha, mu);
+}
+
+template <typename T>
+T FuzzySystemT<T>::Evaluate(T* input_, T output_, u_int output_id_, T* grad)
+{
+    return this->template Evaluate<TNormMin, SNormMax, ImpMamdani>(input_, output_, output_id_, grad);
+}
+
+template <typename T>
+T FuzzySystemT<T>::Defuzzyfication(T* input, u_int output_id, T* grad)
+{
+    return this->template Defuzzyfication<TNormMin, SNormMax, ImpMamdani>(input, output_id, grad);
+}
+
+template <typename T>
+template <class TNorm, class SNorm, class Implication>
+T FuzzySystemT<T>::Evaluate(T* input_, T output_, u_int output_id_, T* grad)
+{
+    // Agregatting fuzzy output over all rules, grad receives its gradient
+    u_int n = this->_rules[0].get_input_size();
+    for (u_int i=0; i<n; i++) {grad[i] = (n > GRAD_MAX_INPUT) ? T(NAN) : T(0);}
+    if (n > GRAD_MAX_INPUT) {return this->template Evaluate<TNorm, SNorm, Implication>(input_, output_, output_id_);}
+
+    T rule_grad[GRAD_MAX_INPUT];
+    T result = T(0);
+    T dummy, da, db;
+    for (u_int rule_id=0; rule_id < this->_total_rules; rule_id++)
+    {
+        dummy = this->_rules[rule_id].template Evaluate<TNorm, Implication>(input_, output_, output_id_, rule_grad);
+        SNorm::partial(result, dummy, &da, &db);
+        result = SNorm::apply(result, dummy);
+        for (u_int i=0; i<n; i++) {grad[i] = da * grad[i] + db * rule_grad[i];}
+    }
+    return result;
+}
+
+template <typename T>
+template <class TNorm, class SNorm, class Implication>
+T FuzzySystemT<T>::Defuzzyfication(T* input, u_int output_id, T* grad)
+{
+    // Same centroid as Defuzzyfication, while summing the gradients
+    // of sum(mu*y) (into grad) and of sum(mu) (into weight_grad)
+    u_int n = this->_rules[0].get_input_size();
+    for (u_int i=0; i<n; i++) {grad[i] = (n > GRAD_MAX_INPUT) ? T(NAN) : T(0);}
+    if (n > GRAD_MAX_INPUT) {return this->template Defuzzyfication<TNorm, SNorm, Implication>(input, output_id);}
+
+    T mu_grad[GRAD_MAX_INPUT];
+    T weight_grad[GRAD_MAX_INPUT];
+    T weight = T(0);
+    T weight_avg = T(0);
+    T mu_;
+    UnivDiscT<T> evaluated_domain = this->_rules[0].get_output_domain(output_id);
+
+    for (u_int i=0; i<n; i++) {weight_grad[i] = T(0);}
+    for (T y = evaluated_domain.low_bond; y <= evaluated_domain.up_bond; y = y+evaluated_domain.interval)
+    {
+        mu_ = this->template Evaluate<TNorm, SNorm, Implication>(input, y, output_id, mu_grad);
+        weight = weight + mu_;
+        weight_avg = weight_avg + mu_ * y;
+        for (u_int i=0; i<n; i++)
+        {
+            grad[i] = grad[i] + mu_grad[i] * y;
+            weight_grad[i] = weight_grad[i] + mu_grad[i];
+        }
+    }
+    if (weight == T(0)) {weight = T(1);}        // Precaution for weight = 0 (error division by 0)
+    T crisp = weight_avg / weight;
+    for (u_int i=0; i<n; i++) {grad[i] = (grad[i] - crisp * weight_grad[i]) / weight;}
+    return crisp;
+}
+
 
 #endif // FUZZYLOGIC_H
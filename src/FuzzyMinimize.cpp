@@ -0,0 +1,356 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Implementation of FuzzyMinimizer (see FuzzyMinimize.h)
+***/
+
+#include <stdlib.h>
+#include "FuzzyMinimize.h"
+
+#define MINIMIZE_NONE   0xFFFFFFFFU
+
+FuzzyMinimizer::FuzzyMinimizer()
+{
+    this->_arena = 0;
+    this->_buckets = 0;
+    this->_fields = 0;
+    this->_input_size = 0;
+    this->_output_size = 0;
+    this->_total_rules = 0;
+    this->_kept = 0;
+    this->_duplicates = 0;
+    this->_silent = 0;
+    this->_covered = 0;
+}
+
+FuzzyMinimizer::~FuzzyMinimizer()
+{
+    this->release();
+}
+
+void FuzzyMinimizer::release(void)
+{
+    free(this->_arena);
+    this->_arena = 0;
+    this->_total_rules = 0;
+    this->_kept = 0;
+    this->_duplicates = 0;
+    this->_silent = 0;
+    this->_covered = 0;
+}
+
+bool FuzzyMinimizer::covers(FuzzyFrame* frame, u_int wide, u_int narrow)
+{
+    /*
+    True when FuzzySet wide is exactly 1 wherever FuzzySet narrow is not 0.
+    Only a piecewise linear set can be exactly 1 over an interval: every
+    segment of it that meets the support of narrow must be flat at 1 (the
+    slope is then exactly 0, so the computed value is exactly 1). A lookup
+    table interpolates between rows one step apart, so the support is widened
+    by one step.
+    */
+    FuzzySet* sets = frame->getFSAddress();
+    FS_type type = sets[wide].get_param().mu_type;
+    if (type != TRP_L && type != TRP_C && type != TRP_R && type != TRI && type != PWL) {return false;}
+    FS_pwl breaks;
+    sets[wide].get_pwl(&breaks);
+    const FS_pwl* pwl = &breaks;
+    if (pwl->n == 0) {return false;}
+
+    float low, high;
+    sets[narrow].get_support(&low, &high);
+    u_int points = frame->get_table_points();
+    if (points > 1)
+    {
+        UnivDisc domain = frame->get_domain();
+        float step = (domain.up_bond - domain.low_bond) / (float)(points - 1);
+        low = low - step;
+        high = high + step;
+    }
+    if (!(low < high)) {return sets[wide].mu_func(low) == 1.0F;}      // a singleton
+
+    // Segment k covers (x[k-1], x[k]], the first and the last one are unbounded
+    for (u_int k=0; k<=pwl->n; k++)
+    {
+        bool after_low = (k == pwl->n) || pwl->x[k] > low;
+        bool before_high = (k == 0) || pwl->x[k - 1] < high;
+        if (!(after_low && before_high)) {continue;}
+        float mu = (k == 0) ? pwl->mu[0] : pwl->mu[k - 1];
+        if (pwl->slope[k] != 0.0F || mu != 1.0F) {return false;}
+    }
+    return true;
+}
+
+u_int FuzzyMinimizer::hash(const u_int* key)
+{
+    // FNV-1a over the linguistic values
+    uint32_t h = 2166136261U;
+    for (u_int f=0; f<this->_fields; f++)
+    {
+        h = (h ^ key[f]) * 16777619U;
+    }
+    return (u_int)(h & (this->_buckets - 1));
+}
+
+u_int FuzzyMinimizer::find(const u_int* key)
+{
+    // First rule (lowest index) with these linguistic values, MINIMIZE_NONE if none
+    u_int found = MINIMIZE_NONE;
+    for (u_int r=this->_head[this->hash(key)]; r!=MINIMIZE_NONE; r=this->_next[r])
+    {
+        const u_int* other = &this->_keys[(size_t)r * this->_fields];
+        bool same = true;
+        for (u_int f=0; f<this->_fields && same; f++) {same = other[f] == key[f];}
+        if (same && r < found) {found = r;}
+    }
+    return found;
+}
+
+bool FuzzyMinimizer::is_wider(u_int field, u_int wide, u_int narrow)
+{
+    return this->_is_wider[this->_matrix_start[field] + wide * this->_terms[field] + narrow];
+}
+
+bool FuzzyMinimizer::dominates(u_int b_rule, u_int a_rule)
+{
+    // Every linguistic value of b is the one of a or a wider one
+    const u_int* a = &this->_keys[(size_t)a_rule * this->_fields];
+    const u_int* b = &this->_keys[(size_t)b_rule * this->_fields];
+    for (u_int f=0; f<this->_fields; f++)
+    {
+        if (a[f] != b[f] && !this->is_wider(f, b[f], a[f])) {return false;}
+    }
+    return true;
+}
+
+bool FuzzyMinimizer::is_covered(u_int rule_id)
+{
+    /*
+    Looks up every combination of the linguistic values of the rule or wider
+    ones (an odometer over the fields). Rules that cover each other have
+    equivalent linguistic values, and only the first one of them is kept.
+    */
+    const u_int* key = &this->_keys[(size_t)rule_id * this->_fields];
+    u_int digit[MINIMIZE_MAX_INPUT + MINIMIZE_MAX_OUTPUT];
+    u_int candidate[MINIMIZE_MAX_INPUT + MINIMIZE_MAX_OUTPUT];
+    bool any = false;
+    for (u_int f=0; f<this->_fields; f++)
+    {
+        digit[f] = 0;
+        candidate[f] = key[f];
+        any = any || this->_wider_count[this->_term_start[f] + key[f]] > 0;
+    }
+    if (!any) {return false;}
+
+    for (u_int tries=0; tries<MINIMIZE_MAX_CANDIDATES; tries++)
+    {
+        // Next combination, digit 0 being the linguistic value of the rule
+        u_int f = 0;
+        while (f < this->_fields)
+        {
+            u_int t = this->_term_start[f] + key[f];
+            if (digit[f] < this->_wider_count[t])
+            {
+                candidate[f] = this->_wider[this->_wider_offset[t] + digit[f]];
+                digit[f]++;
+                break;
+            }
+            digit[f] = 0;
+            candidate[f] = key[f];
+            f++;
+        }
+        if (f == this->_fields) {return false;}                 // every combination was looked up
+
+        u_int other = this->find(candidate);
+        if (other != MINIMIZE_NONE && (other < rule_id || !this->dominates(rule_id, other))) {return true;}
+    }
+    return false;
+}
+
+u_int FuzzyMinimizer::Minimize(FuzzySystem* system, FuzzyRule* kept_rules)
+{
+    this->release();
+    FlatSystem flat;
+    if (!flat_system(system, &flat)) {return 0;}
+    FuzzyRule* rules = flat.rules;
+    u_int total_rules = flat.total_rules;
+    u_int input_size = flat.input_size;
+    u_int output_size = flat.output_size;
+    FuzzyFrame* input_frames = flat.input_frames;
+    FuzzyFrame* output_frames = flat.output_frames;
+    if (input_size > MINIMIZE_MAX_INPUT || output_size == 0 || output_size > MINIMIZE_MAX_OUTPUT) {return 0;}
+
+    u_int fields = input_size + output_size;
+    u_int total_terms = 0;
+    u_int total_matrix = 0;
+    u_int max_mu = 0;
+    for (u_int f=0; f<fields; f++)
+    {
+        FuzzyFrame* frame = (f < input_size) ? &input_frames[f] : &output_frames[f - input_size];
+        this->_terms[f] = frame->get_size();
+        this->_term_start[f] = total_terms;
+        this->_matrix_start[f] = total_matrix;
+        total_terms = total_terms + this->_terms[f];
+        total_matrix = total_matrix + this->_terms[f] * this->_terms[f];
+        if (f < input_size) {continue;}
+        u_int samples = domain_samples(frame->get_domain());
+        if (samples == 0) {return 0;}
+        max_mu = (this->_terms[f] * samples > max_mu) ? this->_terms[f] * samples : max_mu;
+    }
+    u_int buckets = 1;
+    while (buckets < 2 * total_rules) {buckets = buckets * 2;}
+
+    size_t size = (size_t)total_rules * fields * sizeof(u_int)
+                + (size_t)total_matrix * sizeof(u_int)
+                + (size_t)total_terms * 2 * sizeof(u_int)
+                + (size_t)buckets * sizeof(u_int)
+                + (size_t)total_rules * 2 * sizeof(u_int)
+                + (size_t)max_mu * sizeof(float)
+                + (size_t)total_matrix * sizeof(bool)
+                + (size_t)total_terms * sizeof(bool);
+    char* p = (char*)malloc(size);
+    if (p == 0) {return 0;}
+    this->_arena = p;
+    this->_keys = (u_int*)p;            p = p + (size_t)total_rules * fields * sizeof(u_int);
+    this->_wider = (u_int*)p;           p = p + (size_t)total_matrix * sizeof(u_int);
+    this->_wider_offset = (u_int*)p;    p = p + (size_t)total_terms * sizeof(u_int);
+    this->_wider_count = (u_int*)p;     p = p + (size_t)total_terms * sizeof(u_int);
+    this->_head = (u_int*)p;            p = p + (size_t)buckets * sizeof(u_int);
+    this->_next = (u_int*)p;            p = p + (size_t)total_rules * sizeof(u_int);
+    this->_kept_id = (u_int*)p;         p = p + (size_t)total_rules * sizeof(u_int);
+    this->_mu_output = (float*)p;       p = p + (size_t)max_mu * sizeof(float);
+    this->_is_wider = (bool*)p;         p = p + (size_t)total_matrix * sizeof(bool);
+    this->_silent_term = (bool*)p;
+    this->_fields = fields;
+    this->_input_size = input_size;
+    this->_output_size = output_size;
+    this->_buckets = buckets;
+
+    // Wider linguistic values of the inputs
+    for (u_int f=0; f<input_size; f++)
+    {
+        u_int n = this->_terms[f];
+        for (u_int wide=0; wide<n; wide++)
+        {
+            for (u_int narrow=0; narrow<n; narrow++)
+            {
+                bool wider = wide != narrow && this->covers(&input_frames[f], wide, narrow);
+                this->_is_wider[this->_matrix_start[f] + wide * n + narrow] = wider;
+            }
+            this->_silent_term[this->_term_start[f] + wide] = false;
+        }
+    }
+    // Larger consequents, at the output samples of Defuzzyfication
+    for (u_int o=0; o<output_size; o++)
+    {
+        u_int f = input_size + o;
+        u_int n = this->_terms[f];
+        UnivDisc domain = output_frames[o].get_domain();
+        u_int samples = domain_samples(domain);
+        u_int s = 0;
+        for (float y = domain.low_bond; y <= domain.up_bond && s < samples; y = y+domain.interval)
+        {
+            for (u_int t=0; t<n; t++) {this->_mu_output[(size_t)t * samples + s] = output_frames[o].get_muvalue(t, y);}
+            s++;
+        }
+        for (u_int wide=0; wide<n; wide++)
+        {
+            const float* mu_wide = &this->_mu_output[(size_t)wide * samples];
+            bool silent = true;
+            for (s=0; s<samples && silent; s++) {silent = mu_wide[s] == 0.0F;}
+            this->_silent_term[this->_term_start[f] + wide] = silent;
+            for (u_int narrow=0; narrow<n; narrow++)
+            {
+                const float* mu_narrow = &this->_mu_output[(size_t)narrow * samples];
+                bool wider = wide != narrow;
+                for (s=0; s<samples && wider; s++) {wider = mu_wide[s] >= mu_narrow[s];}
+                this->_is_wider[this->_matrix_start[f] + wide * n + narrow] = wider;
+            }
+        }
+    }
+    // Lists of the wider linguistic values
+    u_int used = 0;
+    for (u_int f=0; f<fields; f++)
+    {
+        u_int n = this->_terms[f];
+        for (u_int narrow=0; narrow<n; narrow++)
+        {
+            u_int t = this->_term_start[f] + narrow;
+            this->_wider_offset[t] = used;
+            for (u_int wide=0; wide<n; wide++)
+            {
+                if (this->is_wider(f, wide, narrow)) {this->_wider[used++] = wide;}
+            }
+            this->_wider_count[t] = used - this->_wider_offset[t];
+        }
+    }
+
+    // Every rule into the hash table
+    for (u_int b=0; b<buckets; b++) {this->_head[b] = MINIMIZE_NONE;}
+    for (u_int r=0; r<total_rules; r++)
+    {
+        u_int* key = &this->_keys[(size_t)r * fields];
+        const u_int* antecedent = rules[r].get_input_rules();
+        const u_int* consequent = rules[r].get_output_rules();
+        for (u_int f=0; f<fields; f++)
+        {
+            key[f] = (f < input_size) ? antecedent[f] : consequent[f - input_size];
+            if (key[f] >= this->_terms[f])
+            {
+                this->release();
+                return 0;
+            }
+        }
+        u_int h = this->hash(key);
+        this->_next[r] = this->_head[h];
+        this->_head[h] = r;
+    }
+
+    // Which rules are kept, then their linguistic values packed in order
+    u_int kept = 0;
+    for (u_int r=0; r<total_rules; r++)
+    {
+        const u_int* key = &this->_keys[(size_t)r * fields];
+        bool silent = true;
+        for (u_int o=0; o<output_size && silent; o++) {silent = this->_silent_term[this->_term_start[input_size + o] + key[input_size + o]];}
+        if (silent) {this->_silent++;}
+        else if (this->find(key) < r) {this->_duplicates++;}
+        else if (this->is_covered(r)) {this->_covered++;}
+        else {this->_kept_id[kept++] = r;}
+    }
+    for (u_int k=0; k<kept; k++)
+    {
+        u_int r = this->_kept_id[k];
+        for (u_int f=0; f<fields; f++) {this->_keys[(size_t)k * fields + f] = this->_keys[(size_t)r * fields + f];}
+        u_int* key = &this->_keys[(size_t)k * fields];
+        kept_rules[k].Rule_SetUp(input_frames, key, input_size, output_frames, key + input_size, output_size);
+    }
+    this->_total_rules = total_rules;
+    this->_kept = kept;
+    return kept;
+}
+
+u_int FuzzyMinimizer::get_kept(void)
+{
+    return this->_kept;
+}
+
+u_int FuzzyMinimizer::get_removed(void)
+{
+    return this->_total_rules - this->_kept;
+}
+
+u_int FuzzyMinimizer::get_duplicates(void)
+{
+    return this->_duplicates;
+}
+
+u_int FuzzyMinimizer::get_silent(void)
+{
+    return this->_silent;
+}
+
+u_int FuzzyMinimizer::get_covered(void)
+{
+    return this->_covered;
+}
@@ -0,0 +1,112 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Offline minimization of a rule base without changing its output.
+  *
+  * Rule bases generated from data hold many redundant rules. With the maximum
+  * as S-norm, a rule A can be removed when another rule B gives, at every
+  * input and every output sample, a result at least as large:
+  *
+  *    min(alpha_A(x), mu_A(y)) <= min(alpha_B(x), mu_B(y))
+  *
+  * FuzzyMinimizer removes a rule only when this is proven for the values the
+  * library computes, bit for bit:
+  *
+  *    - duplicates   : the same antecedents and consequents (the first is kept)
+  *    - silent rules : every consequent is 0 at every output sample
+  *    - covered rules: every antecedent of B is the one of A or a FuzzySet
+  *                     that is exactly 1 wherever the one of A is not 0 (a
+  *                     wider linguistic value, "LOW" over "VERY LOW"), and
+  *                     every consequent of B is at least the one of A at every
+  *                     output sample of Defuzzyfication
+  *
+  * A wider antecedent can only raise alpha and the T-norm, the implication and
+  * the maximum are monotone, so the output of the system is identical for
+  * every T-norm and implication of the library, as long as the S-norm is the
+  * maximum (the probabilistic and bounded sums add up duplicates).
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    FuzzyRule smallRules[TOTAL_RULES];                 // at least as many as the system
+  *    FuzzyMinimizer minimizer;
+  *    u_int kept = minimizer.Minimize(&myGeneratedSystem, smallRules);
+  *    FuzzySystem smallSystem(smallRules, kept);          // same output, fewer rules
+  *    printf("%u rules removed\n", minimizer.get_removed());
+  *    ```
+  *
+  * The kept rules point to copies of their linguistic values held by the
+  * minimizer, so it has to live as long as they are used; kept_rules may be
+  * the array of rules of the system itself. A covered rule is looked for
+  * among at most MINIMIZE_MAX_CANDIDATES combinations of wider linguistic
+  * values, beyond that the rule is kept.
+***/
+
+#ifndef FUZZYMINIMIZE_H_
+#define FUZZYMINIMIZE_H_
+
+#include "FuzzyLogic.h"
+
+#ifndef MINIMIZE_MAX_INPUT
+#define MINIMIZE_MAX_INPUT      32      // Maximum number of inputs
+#endif
+
+#ifndef MINIMIZE_MAX_OUTPUT
+#define MINIMIZE_MAX_OUTPUT     8       // Maximum number of outputs
+#endif
+
+#ifndef MINIMIZE_MAX_CANDIDATES
+#define MINIMIZE_MAX_CANDIDATES 4096    // Combinations looked up per rule
+#endif
+
+class FuzzyMinimizer
+{
+private:
+    void* _arena;                               // every array below, one allocation
+    u_int* _keys;                               // per rule, input_size then output_size linguistic values
+                                                // (after Minimize, the kept rules first)
+    bool* _is_wider;                            // per field, [wide][narrow] matrix of its linguistic values
+    u_int* _wider;                              // per field and linguistic value: the wider ones
+    u_int* _wider_offset;                       // per field and linguistic value: first of its list in _wider
+    u_int* _wider_count;
+    bool* _silent_term;                         // per output linguistic value: 0 at every sample
+    float* _mu_output;                          // scratch: consequents at the output samples
+    u_int* _head;                               // hash table of the rules
+    u_int* _next;
+    u_int* _kept_id;                            // rules of the system that are kept
+    u_int _buckets;
+    u_int _fields, _input_size, _output_size;
+    u_int _terms[MINIMIZE_MAX_INPUT + MINIMIZE_MAX_OUTPUT];
+    u_int _term_start[MINIMIZE_MAX_INPUT + MINIMIZE_MAX_OUTPUT];    // first linguistic value of each field
+    u_int _matrix_start[MINIMIZE_MAX_INPUT + MINIMIZE_MAX_OUTPUT];  // of each field in _is_wider
+    u_int _total_rules, _kept;
+    u_int _duplicates, _silent, _covered;
+
+    void release(void);
+    bool covers(FuzzyFrame* frame, u_int wide, u_int narrow);
+    u_int hash(const u_int* key);
+    u_int find(const u_int* key);
+    bool is_wider(u_int field, u_int wide, u_int narrow);
+    bool dominates(u_int b_rule, u_int a_rule);
+    bool is_covered(u_int rule_id);
+
+    FuzzyMinimizer(const FuzzyMinimizer&);      // not copyable, the kept rules point to its arrays
+    FuzzyMinimizer& operator=(const FuzzyMinimizer&);
+public:
+    FuzzyMinimizer();
+    ~FuzzyMinimizer();
+
+    // Sets up kept_rules (as many as the system) with the rules of system that
+    // are kept, in their order, and returns their number. Returns 0 if the
+    // system has no rule, rules with different frames, too many inputs or
+    // outputs, an empty output domain or if the allocation fails
+    u_int Minimize(FuzzySystem* system, FuzzyRule* kept_rules);
+
+    u_int get_kept(void);
+    u_int get_removed(void);
+    u_int get_duplicates(void);
+    u_int get_silent(void);
+    u_int get_covered(void);
+};
+
+#endif // FUZZYMINIMIZE_H_
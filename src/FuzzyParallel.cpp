@@ -0,0 +1,144 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Implementation of FuzzyParallel (see FuzzyParallel.h)
+***/
+
+#include <stdlib.h>
+#include "FuzzyParallel.h"
+
+FuzzyParallel::FuzzyParallel()
+{
+    this->_system = 0;
+    this->_input_size = 0;
+    this->_output_size = 0;
+    this->_total_rules = 0;
+    this->_arena = 0;
+    this->_max_samples = 0;
+    this->_output_id = 0;
+}
+
+FuzzyParallel::~FuzzyParallel()
+{
+    this->release();
+}
+
+void FuzzyParallel::release(void)
+{
+    // Stop and join the pool before freeing what the workers read
+    this->_pool.Release();
+    free(this->_arena);
+    this->_arena = 0;
+    this->_total_rules = 0;
+}
+
+bool FuzzyParallel::Parallel_SetUp(FuzzySystem* system, u_int threads)
+{
+    this->release();
+    FlatSystem flat;
+    if (!flat_system(system, &flat)) {return false;}
+    FuzzyRule* rules = flat.rules;
+    u_int total_rules = flat.total_rules;
+    u_int input_size = flat.input_size;
+    u_int output_size = flat.output_size;
+    FuzzyFrame* input_frames = flat.input_frames;
+    FuzzyFrame* output_frames = flat.output_frames;
+    if (input_size > PARALLEL_MAX_INPUT || output_size == 0 || output_size > PARALLEL_MAX_OUTPUT) {return false;}
+    threads = FuzzyPool::thread_count(threads, PARALLEL_MAX_THREADS);
+
+    // Sizes of the input terms and of the output samples
+    u_int input_terms = 0;
+    for (u_int i=0; i<input_size; i++)
+    {
+        this->_input_offset[i] = input_terms;
+        input_terms = input_terms + input_frames[i].get_size();
+    }
+    u_int total_samples = 0;
+    u_int total_mu = 0;
+    u_int max_samples = 0;
+    for (u_int o=0; o<output_size; o++)
+    {
+        u_int samples = domain_samples(output_frames[o].get_domain());
+        if (samples == 0) {return false;}
+        this->_samples[o] = samples;
+        this->_terms[o] = output_frames[o].get_size();
+        this->_sample_offset[o] = total_samples;
+        this->_mu_offset[o] = total_mu;
+        total_samples = total_samples + samples;
+        total_mu = total_mu + this->_terms[o] * samples;
+        max_samples = (samples > max_samples) ? samples : max_samples;
+    }
+
+    size_t size = (size_t)total_rules * input_size * sizeof(u_int)
+                + (size_t)total_rules * output_size * sizeof(u_int)
+                + (size_t)(input_terms + 1) * sizeof(float)
+                + (size_t)total_samples * sizeof(float)
+                + (size_t)total_mu * sizeof(float)
+                + (size_t)threads * max_samples * sizeof(float);
+    char* p = (char*)malloc(size);
+    if (p == 0) {return false;}
+    this->_arena = p;
+    this->_antecedent = (u_int*)p;      p = p + (size_t)total_rules * input_size * sizeof(u_int);
+    this->_consequent = (u_int*)p;      p = p + (size_t)total_rules * output_size * sizeof(u_int);
+    this->_mu_input = (float*)p;        p = p + (size_t)(input_terms + 1) * sizeof(float);
+    this->_ys = (float*)p;              p = p + (size_t)total_samples * sizeof(float);
+    this->_mu_output = (float*)p;       p = p + (size_t)total_mu * sizeof(float);
+    this->_partial = (float*)p;
+
+    // Rules as indexes; an antecedent out of its frame points to the final 0
+    for (u_int r=0; r<total_rules; r++)
+    {
+        const u_int* antecedent = rules[r].get_input_rules();
+        const u_int* consequent = rules[r].get_output_rules();
+        for (u_int i=0; i<input_size; i++)
+        {
+            bool valid = antecedent[i] < (u_int)input_frames[i].get_size();
+            this->_antecedent[(size_t)r * input_size + i] = valid ? this->_input_offset[i] + antecedent[i] : input_terms;
+        }
+        for (u_int o=0; o<output_size; o++)
+        {
+            bool valid = consequent[o] < this->_terms[o];
+            this->_consequent[(size_t)r * output_size + o] = valid ? consequent[o] : this->_terms[o];
+        }
+    }
+    this->_mu_input[input_terms] = 0.0F;
+
+    // Output samples (the same float values as Defuzzyfication) and consequents
+    for (u_int o=0; o<output_size; o++)
+    {
+        UnivDisc domain = output_frames[o].get_domain();
+        float* ys = &this->_ys[this->_sample_offset[o]];
+        float* mu = &this->_mu_output[this->_mu_offset[o]];
+        u_int s = 0;
+        for (float y = domain.low_bond; y <= domain.up_bond && s < this->_samples[o]; y = y+domain.interval) {ys[s++] = y;}
+        for (u_int t=0; t<this->_terms[o]; t++)
+        {
+            for (s=0; s<this->_samples[o]; s++) {mu[(size_t)t * this->_samples[o] + s] = output_frames[o].get_muvalue(t, ys[s]);}
+        }
+    }
+
+    this->_system = system;
+    this->_input_size = input_size;
+    this->_output_size = output_size;
+    this->_total_rules = total_rules;
+    this->_max_samples = max_samples;
+    this->_pool.Pool_SetUp(threads);
+    return true;
+}
+
+void FuzzyParallel::fuzzify(const float* input)
+{
+    // Every FuzzySet of every input frame, once per query
+    FuzzyFrame* frames = this->_system->get_rules()[0].get_input_frames();
+    for (u_int i=0; i<this->_input_size; i++) {frames[i].Fuzzify(input[i], &this->_mu_input[this->_input_offset[i]]);}
+}
+
+float FuzzyParallel::Defuzzyfication(const float* input, u_int output_id)
+{
+    return this->Defuzzyfication<TNormMin, SNormMax, ImpMamdani>(input, output_id);
+}
+
+u_int FuzzyParallel::get_threads(void)
+{
+    return this->_pool.get_threads();
+}
@@ -0,0 +1,157 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Evaluation of one query of a very large FuzzySystem on several threads.
+  *
+  * With 10^5 to 10^6 rules a single Defuzzyfication takes milliseconds, and a
+  * query that can not wait for a batch can only be made faster by splitting
+  * the rules between threads. FuzzyParallel keeps a pool of worker threads
+  * and, for every query:
+  *
+  *    1. evaluates every FuzzySet of the input frames once (not once per rule
+  *       and per output sample as FuzzySystem::Evaluate does)
+  *    2. gives each thread (the calling thread included) a contiguous range of
+  *       rules; a thread computes the degree of fulfillment of each of its
+  *       rules from the values of 1 and aggregates its rules into a partial
+  *       fuzzy output, one value per output sample
+  *    3. merges the partial outputs with the S-norm (maximum by default, or
+  *       the probabilistic or bounded sum) and takes the centroid
+  *
+  * The degrees of membership of the consequents at the output samples are
+  * computed once in Parallel_SetUp. A rule whose degree of fulfillment is 0 is
+  * skipped, which is exact for the implications of the library (the result of
+  * the implication is 0 and 0 is the identity of every S-norm).
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    FuzzyParallel parallel;
+  *    parallel.Parallel_SetUp(&myBigSystem, 8);           // 8 threads (0: one per core)
+  *    output = parallel.Defuzzyfication(inputs, 0);       // same as myBigSystem.Defuzzyfication(inputs, 0)
+  *    output = parallel.Defuzzyfication<TNormProduct, SNormProbSum, ImpLarsen>(inputs, 0);
+  *    ```
+  *
+  * Waking the threads costs some microseconds, so it pays off for systems
+  * with thousands of rules or more. A FuzzyParallel runs one query at a time,
+  * and the FuzzySystem must not change after Parallel_SetUp.
+***/
+
+#ifndef FUZZYPARALLEL_H_
+#define FUZZYPARALLEL_H_
+
+#include "FuzzyLogic.h"
+#include "FuzzyPool.h"
+
+#ifndef PARALLEL_MAX_THREADS
+#define PARALLEL_MAX_THREADS    64      // Maximum number of threads of the pool
+#endif
+
+#ifndef PARALLEL_MAX_INPUT
+#define PARALLEL_MAX_INPUT      32      // Maximum number of inputs
+#endif
+
+#ifndef PARALLEL_MAX_OUTPUT
+#define PARALLEL_MAX_OUTPUT     8       // Maximum number of outputs
+#endif
+
+class FuzzyParallel
+{
+private:
+    FuzzySystem* _system;
+    u_int _input_size, _output_size, _total_rules;
+    void* _arena;                                   // every array below, one allocation
+    u_int* _antecedent;                             // per rule, index of each antecedent in _mu_input
+    u_int* _consequent;                             // per rule, term of each output (_terms[o] if it never fires)
+    float* _mu_input;                               // every FuzzySet of every input frame, then one 0
+    u_int _input_offset[PARALLEL_MAX_INPUT];
+    float* _ys;                                     // output samples of every output
+    float* _mu_output;                              // consequents at the output samples
+    u_int _samples[PARALLEL_MAX_OUTPUT];
+    u_int _terms[PARALLEL_MAX_OUTPUT];
+    u_int _sample_offset[PARALLEL_MAX_OUTPUT];
+    u_int _mu_offset[PARALLEL_MAX_OUTPUT];
+    float* _partial;                                // one fuzzy output per thread
+    u_int _max_samples;
+    u_int _output_id;                               // of the running query
+    FuzzyPool _pool;
+
+    void release(void);
+    void fuzzify(const float* input);
+    template <class TNorm, class SNorm, class Implication>
+    static void run_rules(void* owner, u_int worker, u_int threads);
+
+    FuzzyParallel(const FuzzyParallel&);            // not copyable, owns its threads
+    FuzzyParallel& operator=(const FuzzyParallel&);
+public:
+    FuzzyParallel();
+    ~FuzzyParallel();
+
+    // Returns false if the system has no rule, rules with different frames,
+    // too many inputs or outputs, an empty output domain or if the allocation
+    // fails
+    bool Parallel_SetUp(FuzzySystem* system, u_int threads);
+
+    float Defuzzyfication(const float* input, u_int output_id);
+    template <class TNorm, class SNorm, class Implication>
+    float Defuzzyfication(const float* input, u_int output_id);
+
+    u_int get_threads(void);
+};
+
+
+/* TEMPLATE METHODS */
+template <class TNorm, class SNorm, class Implication>
+void FuzzyParallel::run_rules(void* owner, u_int worker, u_int threads)
+{
+    // Partial fuzzy output of the rules first .. last-1
+    FuzzyParallel* self = (FuzzyParallel*)owner;
+    u_int o = self->_output_id;
+    u_int samples = self->_samples[o];
+    u_int input_size = self->_input_size;
+    u_int output_size = self->_output_size;
+    u_int first = (u_int)((uint64_t)self->_total_rules * worker / threads);
+    u_int last = (u_int)((uint64_t)self->_total_rules * (worker + 1) / threads);
+    const float* mu_input = self->_mu_input;
+    const float* mu_output = &self->_mu_output[self->_mu_offset[o]];
+    float* out = &self->_partial[(size_t)worker * self->_max_samples];
+    for (u_int s=0; s<samples; s++) {out[s] = 0.0F;}
+
+    for (u_int r=first; r<last; r++)
+    {
+        u_int term = self->_consequent[(size_t)r * output_size + o];
+        if (term >= self->_terms[o]) {continue;}
+        const u_int* antecedent = &self->_antecedent[(size_t)r * input_size];
+        float alpha = 1.0F;
+        for (u_int i=0; i<input_size; i++) {alpha = TNorm::apply(mu_input[antecedent[i]], alpha);}
+        if (alpha == 0.0F) {continue;}
+        const float* mu = &mu_output[(size_t)term * samples];
+        for (u_int s=0; s<samples; s++) {out[s] = SNorm::apply(out[s], Implication::apply(alpha, mu[s]));}
+    }
+}
+
+template <class TNorm, class SNorm, class Implication>
+float FuzzyParallel::Defuzzyfication(const float* input, u_int output_id)
+{
+    if (this->_total_rules == 0 || output_id >= this->_output_size) {return 0.0F;}
+    this->fuzzify(input);
+    this->_output_id = output_id;
+    u_int threads = this->_pool.get_threads();
+    this->_pool.Run(&FuzzyParallel::run_rules<TNorm, SNorm, Implication>, this, threads);
+
+    // Reduction of the partial outputs, then the centroid as Defuzzyfication
+    u_int samples = this->_samples[output_id];
+    const float* ys = &this->_ys[this->_sample_offset[output_id]];
+    float weight = 0.0F;
+    float weight_avg = 0.0F;
+    for (u_int s=0; s<samples; s++)
+    {
+        float mu = this->_partial[s];
+        for (u_int w=1; w<threads; w++) {mu = SNorm::apply(mu, this->_partial[(size_t)w * this->_max_samples + s]);}
+        weight = weight + mu;
+        weight_avg = weight_avg + mu * ys[s];
+    }
+    if (weight == 0.0F) {weight = 1.0F;}
+    return weight_avg / weight;
+}
+
+#endif // FUZZYPARALLEL_H_
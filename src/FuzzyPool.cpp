@@ -0,0 +1,103 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Implementation of FuzzyPool (see FuzzyPool.h)
+***/
+
+#include "FuzzyPool.h"
+
+FuzzyPool::FuzzyPool()
+{
+    this->_threads = 0;
+    this->_generation = 0;
+    this->_pending = 0;
+    this->_stop = false;
+    this->_job = 0;
+    this->_owner = 0;
+    this->_used = 0;
+}
+
+FuzzyPool::~FuzzyPool()
+{
+    this->Release();
+}
+
+u_int FuzzyPool::thread_count(u_int threads, u_int max_threads)
+{
+    if (threads == 0) {threads = std::thread::hardware_concurrency();}
+    if (threads == 0) {threads = 1;}
+    if (threads > max_threads) {threads = max_threads;}
+    if (threads > POOL_MAX_THREADS) {threads = POOL_MAX_THREADS;}
+    return (threads > 0) ? threads : 1;
+}
+
+void FuzzyPool::Pool_SetUp(u_int threads)
+{
+    this->Release();
+    threads = (threads > 0) ? threads : 1;
+    threads = (threads < POOL_MAX_THREADS) ? threads : POOL_MAX_THREADS;
+    this->_threads = threads;
+    for (u_int w=1; w<threads; w++) {this->_workers[w] = std::thread(&FuzzyPool::worker_loop, this, w, this->_generation);}
+}
+
+void FuzzyPool::Release(void)
+{
+    // Stop and join the workers; the owner frees what they read afterwards
+    {
+        std::lock_guard<std::mutex> lock(this->_lock);
+        this->_stop = true;
+    }
+    this->_start.notify_all();
+    for (u_int w=1; w<this->_threads; w++) {this->_workers[w].join();}
+    this->_threads = 0;
+    this->_stop = false;
+}
+
+void FuzzyPool::worker_loop(u_int worker, u_int generation)
+{
+    // generation: the last job before the worker was started
+    std::unique_lock<std::mutex> lock(this->_lock);
+    while (true)
+    {
+        while (!this->_stop && this->_generation == generation) {this->_start.wait(lock);}
+        if (this->_stop) {return;}
+        generation = this->_generation;
+        void (*job)(void*, u_int, u_int) = this->_job;
+        void* owner = this->_owner;
+        u_int used = this->_used;
+
+        lock.unlock();
+        if (worker < used) {job(owner, worker, used);}
+        lock.lock();
+        if (--this->_pending == 0) {this->_done.notify_one();}
+    }
+}
+
+void FuzzyPool::Run(void (*job)(void*, u_int, u_int), void* owner, u_int used)
+{
+    used = (used < this->_threads) ? used : this->_threads;
+    if (used <= 1)
+    {
+        job(owner, 0, 1);
+        return;
+    }
+
+    // Every worker takes its share, the calling thread being worker 0
+    {
+        std::lock_guard<std::mutex> lock(this->_lock);
+        this->_job = job;
+        this->_owner = owner;
+        this->_used = used;
+        this->_pending = this->_threads - 1;
+        this->_generation++;
+    }
+    this->_start.notify_all();
+    job(owner, 0, used);
+    std::unique_lock<std::mutex> lock(this->_lock);
+    while (this->_pending != 0) {this->_done.wait(lock);}
+}
+
+u_int FuzzyPool::get_threads(void)
+{
+    return this->_threads;
+}
@@ -0,0 +1,88 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Pool of worker threads shared by the host side modules.
+  *
+  * FuzzyParallel, FuzzyBatch, FuzzyTrainer, FuzzyTuner, FuzzyCMeans and
+  * FuzzyWangMendel split their work into one share per thread. Starting
+  * threads costs tens of microseconds, so every module keeps a FuzzyPool
+  * started in its set up, and every run wakes the same threads:
+  *
+  *    1. Pool_SetUp(threads) starts threads - 1 workers; the calling thread
+  *       is worker 0
+  *    2. Run(job, owner, used) calls job(owner, worker, used) on the workers
+  *       0 .. used-1 and returns when all of them are done; with used = 1 only
+  *       the calling thread runs the job and no worker is woken
+  *    3. Release() (or the destructor) stops and joins the workers
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    static void job(void* owner, u_int worker, u_int used)
+  *    {
+  *        MyModule* self = (MyModule*)owner;
+  *        size_t first = self->count * worker / used;
+  *        size_t last = self->count * (worker + 1) / used;
+  *        ...                                             // share first .. last-1
+  *    }
+  *
+  *    FuzzyPool pool;
+  *    u_int threads = FuzzyPool::thread_count(0, 16);     // one per core, at most 16
+  *    pool.Pool_SetUp(threads);
+  *    pool.Run(&job, &myModule, threads);
+  *    ```
+  *
+  * A FuzzyPool runs one job at a time, from one calling thread.
+***/
+
+#ifndef FUZZYPOOL_H_
+#define FUZZYPOOL_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "FuzzyLogic.h"
+
+#ifndef POOL_MAX_THREADS
+#define POOL_MAX_THREADS        64      // Maximum number of threads of a pool
+#endif
+
+class FuzzyPool
+{
+private:
+    // The calling thread is worker 0, the pool runs workers 1..threads-1
+    std::thread _workers[POOL_MAX_THREADS];
+    u_int _threads;
+    std::mutex _lock;
+    std::condition_variable _start, _done;
+    u_int _generation, _pending;
+    bool _stop;
+
+    // The running job
+    void (*_job)(void*, u_int, u_int);
+    void* _owner;
+    u_int _used;
+
+    void worker_loop(u_int worker, u_int generation);
+
+    FuzzyPool(const FuzzyPool&);                    // not copyable, owns its threads
+    FuzzyPool& operator=(const FuzzyPool&);
+public:
+    FuzzyPool();
+    ~FuzzyPool();
+
+    // Number of threads for a request of threads (0: one per core), at least
+    // 1 and at most max_threads and POOL_MAX_THREADS
+    static u_int thread_count(u_int threads, u_int max_threads);
+
+    // Stops the previous workers and starts threads - 1 new ones
+    void Pool_SetUp(u_int threads);
+    void Release(void);
+
+    // job(owner, worker, used) on the workers 0 .. used-1 (at most threads)
+    void Run(void (*job)(void*, u_int, u_int), void* owner, u_int used);
+
+    u_int get_threads(void);
+};
+
+#endif // FUZZYPOOL_H_
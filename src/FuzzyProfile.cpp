@@ -0,0 +1,162 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Implementation of FuzzyProfile (see FuzzyProfile.h)
+***/
+
+#include <stdlib.h>
+#include "FuzzyProfile.h"
+
+FuzzyProfile::FuzzyProfile()
+{
+    this->_system = 0;
+    this->_arena = 0;
+    this->_input_size = 0;
+    this->_input_terms = 0;
+    this->_total_rules = 0;
+    this->_records = 0;
+    this->_evaluations = 0;
+    this->_applied = false;
+}
+
+FuzzyProfile::~FuzzyProfile()
+{
+    this->release();
+}
+
+void FuzzyProfile::release(void)
+{
+    this->Remove();
+    free(this->_arena);
+    this->_arena = 0;
+    this->_total_rules = 0;
+}
+
+bool FuzzyProfile::Profile_SetUp(FuzzySystem* system)
+{
+    this->release();
+    FlatSystem flat;
+    if (!flat_system(system, &flat)) {return false;}
+    u_int total_rules = flat.total_rules;
+    u_int input_size = flat.input_size;
+    FuzzyFrame* frames = flat.input_frames;
+    if (input_size > PROFILE_MAX_INPUT) {return false;}
+    u_int input_terms = 0;
+    for (u_int i=0; i<input_size; i++)
+    {
+        this->_input_offset[i] = input_terms;
+        input_terms = input_terms + frames[i].get_size();
+    }
+
+    size_t size = (size_t)input_terms * sizeof(uint64_t)
+                + (size_t)total_rules * input_size * sizeof(u_int)
+                + (size_t)input_terms * sizeof(float);
+    char* p = (char*)malloc(size);
+    if (p == 0) {return false;}
+    this->_arena = p;
+    this->_active = (uint64_t*)p;       p = p + (size_t)input_terms * sizeof(uint64_t);
+    this->_order = (u_int*)p;           p = p + (size_t)total_rules * input_size * sizeof(u_int);
+    this->_mu = (float*)p;
+
+    this->_system = system;
+    this->_input_size = input_size;
+    this->_input_terms = input_terms;
+    this->_total_rules = total_rules;
+    this->Reset();
+    return true;
+}
+
+void FuzzyProfile::Reset(void)
+{
+    for (u_int k=0; k<this->_input_terms; k++) {this->_active[k] = 0;}
+    this->_records = 0;
+    this->_evaluations = 0;
+}
+
+void FuzzyProfile::Record(const float* input)
+{
+    if (this->_total_rules == 0) {return;}
+    FuzzyRule* rules = this->_system->get_rules();
+    FuzzyFrame* frames = rules[0].get_input_frames();
+
+    // Which linguistic values are active for this input
+    for (u_int i=0; i<this->_input_size; i++)
+    {
+        float* mu = &this->_mu[this->_input_offset[i]];
+        frames[i].Fuzzify(input[i], mu);
+        for (u_int t=0; t<(u_int)frames[i].get_size(); t++)
+        {
+            u_int k = this->_input_offset[i] + t;
+            this->_active[k] = this->_active[k] + ((mu[t] > 0.0F) ? 1 : 0);
+        }
+    }
+
+    // What Evaluate computes for this input, in the current order of each rule
+    for (u_int r=0; r<this->_total_rules; r++) {this->_evaluations = this->_evaluations + rules[r].get_evaluations(input);}
+    this->_records++;
+}
+
+void FuzzyProfile::Record(const float* input, u_int batch)
+{
+    for (u_int q=0; q<batch; q++) {this->Record(&input[(size_t)q * this->_input_size]);}
+}
+
+float FuzzyProfile::rate(uint64_t count)
+{
+    return (this->_records == 0) ? 1.0F : (float)count / (float)this->_records;
+}
+
+float FuzzyProfile::get_activation(u_int input_id, u_int term)
+{
+    if (input_id >= this->_input_size) {return 0.0F;}
+    FuzzyFrame* frames = this->_system->get_rules()[0].get_input_frames();
+    if (term >= (u_int)frames[input_id].get_size()) {return 0.0F;}
+    return this->rate(this->_active[this->_input_offset[input_id] + term]);
+}
+
+bool FuzzyProfile::Apply(void)
+{
+    if (this->_total_rules == 0) {return false;}
+    FuzzyRule* rules = this->_system->get_rules();
+    u_int n = this->_input_size;
+    for (u_int r=0; r<this->_total_rules; r++)
+    {
+        // Least often active antecedent first (insertion sort, inputs are few)
+        const u_int* antecedent = rules[r].get_input_rules();
+        u_int* order = &this->_order[(size_t)r * n];
+        float p[PROFILE_MAX_INPUT];
+        for (u_int i=0; i<n; i++)
+        {
+            p[i] = this->get_activation(i, antecedent[i]);
+            u_int k = i;
+            while (k > 0 && p[order[k - 1]] > p[i])
+            {
+                order[k] = order[k - 1];
+                k--;
+            }
+            order[k] = i;
+        }
+        rules[r].Order_SetUp(order);
+    }
+    this->_applied = true;
+    return true;
+}
+
+void FuzzyProfile::Remove(void)
+{
+    if (!this->_applied) {return;}
+    FuzzyRule* rules = this->_system->get_rules();
+    for (u_int r=0; r<this->_total_rules; r++) {rules[r].Order_SetUp(0);}
+    this->_applied = false;
+}
+
+float FuzzyProfile::get_evaluations(void)
+{
+    if (this->_records == 0 || this->_total_rules == 0) {return 0.0F;}
+    return (float)((double)this->_evaluations / ((double)this->_records * this->_total_rules));
+}
+
+uint64_t FuzzyProfile::get_records(void)
+{
+    return this->_records;
+}
@@ -0,0 +1,92 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Profile-guided order of evaluation of the antecedents of the rules.
+  *
+  * FuzzyRule::Evaluate stops as soon as the degree of fulfillment is 0, so the
+  * fewer antecedents are evaluated the sooner an inactive rule is found to be
+  * 0. A FuzzyProfile records, on real inputs, how often every linguistic value
+  * of every input is active (degree of membership above 0), and counts the
+  * membership functions the rules evaluate for them. Apply() then gives each
+  * rule the order that evaluates its most selective antecedent first (the
+  * least often active one), and the rule compares that input with the support
+  * of its FuzzySet before evaluating any membership function (see
+  * FuzzyRule::Order_SetUp).
+  *
+  * The result of the system is unchanged: minimum is commutative (a product
+  * T-norm may differ in the last bit, since the factors are multiplied in a
+  * different order).
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    FuzzyProfile profile;
+  *    profile.Profile_SetUp(&mySystem);
+  *    for (...) {profile.Record(inputs);}                  // inputs from real traffic
+  *    float before = profile.get_evaluations();             // per rule, in the natural order
+  *    profile.Apply();                                      // reorders every rule of mySystem
+  *    profile.Reset();
+  *    for (...) {profile.Record(inputs);}                  // counted again, in the new order
+  *    printf("%f -> %f evaluations per rule\n", before, profile.get_evaluations());
+  *    ...
+  *    profile.Remove();                                     // back to the natural order
+  *    ```
+  *
+  * The rules keep a pointer to the orders of the profile, so the profile has
+  * to live as long as they use it (its destructor calls Remove()).
+***/
+
+#ifndef FUZZYPROFILE_H_
+#define FUZZYPROFILE_H_
+
+#include "FuzzyLogic.h"
+
+#ifndef PROFILE_MAX_INPUT
+#define PROFILE_MAX_INPUT       32      // Maximum number of inputs
+#endif
+
+class FuzzyProfile
+{
+private:
+    FuzzySystem* _system;
+    void* _arena;                       // every array below, one allocation
+    uint64_t* _active;                  // per linguistic value of every input, records where mu > 0
+    u_int* _order;                      // per rule, input_size indexes
+    float* _mu;                         // degrees of the linguistic values for the recorded input
+    u_int _input_offset[PROFILE_MAX_INPUT];
+    u_int _input_size, _input_terms, _total_rules;
+    uint64_t _records;
+    uint64_t _evaluations;              // membership functions evaluated by the rules for the records
+    bool _applied;
+
+    void release(void);
+    float rate(uint64_t count);
+    FuzzyProfile(const FuzzyProfile&);                  // not copyable, the rules point to its orders
+    FuzzyProfile& operator=(const FuzzyProfile&);
+public:
+    FuzzyProfile();
+    ~FuzzyProfile();
+
+    // Returns false if the system has no rule, rules with different frames,
+    // too many inputs or if the allocation fails
+    bool Profile_SetUp(FuzzySystem* system);
+
+    void Record(const float* input);
+    void Record(const float* input, u_int batch);
+    void Reset(void);
+
+    // Orders every rule of the system by the recorded statistics
+    bool Apply(void);
+    void Remove(void);
+
+    // Fraction of the recorded inputs
+    float get_activation(u_int input_id, u_int term);
+
+    // Membership functions the rules evaluated per rule evaluation for the
+    // recorded inputs (FuzzyRule::get_evaluations), in the order the rules
+    // had when they were recorded
+    float get_evaluations(void);
+    uint64_t get_records(void);
+};
+
+#endif // FUZZYPROFILE_H_
@@ -0,0 +1,242 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Implementation of FuzzyQuantized (see FuzzyQuantized.h)
+***/
+
+#include <stdlib.h>
+#include "FuzzyQuantized.h"
+
+static u_int pad_lanes(u_int n)
+{
+    return (n + QUANT_LANES - 1) / QUANT_LANES * QUANT_LANES;
+}
+
+static uint8_t quantize(float mu)
+{
+    // 0..1 to 0..255, rounded to nearest
+    float q = mu * 255.0F + 0.5F;
+    if (!(q > 0.0F)) {return 0;}
+    if (q >= 255.0F) {return 255;}
+    return (uint8_t)q;
+}
+
+static void min_row(uint8_t* __restrict out, const uint8_t* __restrict row, u_int n)
+{
+    // n is a multiple of QUANT_LANES, no epilogue and no branch: packed uint8 minimum
+    for (u_int j=0; j<n; j++) {out[j] = (row[j] < out[j]) ? row[j] : out[j];}
+}
+
+static void max_min_row(uint8_t* __restrict out, const uint8_t* __restrict row, uint8_t w, u_int n)
+{
+    // out = max(out, min(w, row)), packed uint8 minimum and maximum
+    for (u_int j=0; j<n; j++)
+    {
+        uint8_t v = (row[j] < w) ? row[j] : w;
+        out[j] = (out[j] > v) ? out[j] : v;
+    }
+}
+
+
+FuzzyQuantized::FuzzyQuantized()
+{
+    this->_arena = 0;
+    this->_consequent = 0;
+    this->_rule_term = 0;
+    this->_input_size = 0;
+    this->_total_rules = 0;
+    this->_rule_stride = 0;
+    this->_terms = 0;
+    this->_samples = 0;
+    this->_sample_stride = 0;
+    this->_y_low = 0.0;
+    this->_y_step = 0.0;
+    this->_table_size = 0;
+}
+
+FuzzyQuantized::~FuzzyQuantized()
+{
+    this->release();
+}
+
+void FuzzyQuantized::release(void)
+{
+    free(this->_arena);
+    this->_arena = 0;
+    this->_consequent = 0;
+    this->_rule_term = 0;
+    this->_input_size = 0;
+    this->_total_rules = 0;
+    this->_samples = 0;
+    this->_table_size = 0;
+}
+
+bool FuzzyQuantized::Quantized_SetUp(FuzzySystem* system, u_int output_id, const u_int* bits, const float* offset, const float* gain)
+{
+    this->release();
+    FlatSystem flat;
+    if (!flat_system(system, &flat) || flat.total_rules > QUANT_MAX_RULES) {return false;}
+    FuzzyRule* rules = flat.rules;
+    u_int total_rules = flat.total_rules;
+    u_int input_size = flat.input_size;
+    FuzzyFrame* input_frames = flat.input_frames;
+    FuzzyFrame* output_frames = flat.output_frames;
+    if (input_size > QUANT_MAX_INPUT || output_id >= flat.output_size) {return false;}
+    for (u_int i=0; i<input_size; i++)
+    {
+        if (bits[i] == 0 || bits[i] > QUANT_MAX_BITS) {return false;}
+    }
+
+    // Output samples, the same loop as Defuzzyfication
+    UnivDisc domain = output_frames[output_id].get_domain();
+    u_int samples = domain_samples(domain);
+    if (samples == 0 || samples > QUANT_MAX_SAMPLES) {return false;}
+    u_int terms = output_frames[output_id].get_size();
+    if (terms == 0 || terms > 256) {return false;}      // the consequent of a rule is a uint8_t
+
+    // One allocation: the input tables, the consequents and the rule terms
+    u_int rule_stride = pad_lanes(total_rules);
+    u_int sample_stride = pad_lanes(samples);
+    size_t size = (size_t)terms * sample_stride + total_rules;
+    for (u_int i=0; i<input_size; i++) {size = size + ((size_t)1 << bits[i]) * rule_stride;}
+    this->_arena = (uint8_t*)calloc(size, 1);
+    if (this->_arena == 0) {return false;}
+
+    uint8_t* p = this->_arena;
+    for (u_int i=0; i<input_size; i++)
+    {
+        this->_tables[i] = p;
+        p = p + ((size_t)1 << bits[i]) * rule_stride;
+    }
+    this->_consequent = p;
+    p = p + (size_t)terms * sample_stride;
+    this->_rule_term = p;
+
+    this->_input_size = input_size;
+    this->_total_rules = total_rules;
+    this->_rule_stride = rule_stride;
+    this->_terms = terms;
+    this->_samples = samples;
+    this->_sample_stride = sample_stride;
+    this->_y_low = domain.low_bond;
+    this->_y_step = domain.interval;
+    this->_table_size = size;
+    for (u_int i=0; i<input_size; i++) {this->_bits[i] = bits[i];}
+
+    // A rule with a term out of its frame never fires: its lanes stay 0
+    u_int max_terms = 0;
+    for (u_int i=0; i<input_size; i++) {if ((u_int)input_frames[i].get_size() > max_terms) {max_terms = input_frames[i].get_size();}}
+    bool* live = (bool*)malloc(total_rules * sizeof(bool));
+    float* mu = (float*)malloc((max_terms + 1) * sizeof(float));
+    if (live == 0 || mu == 0)
+    {
+        free(live);
+        free(mu);
+        this->release();
+        return false;
+    }
+    for (u_int r=0; r<total_rules; r++)
+    {
+        const u_int* antecedent = rules[r].get_input_rules();
+        u_int term = rules[r].get_output_rules()[output_id];
+        live[r] = (term < terms);
+        for (u_int i=0; i<input_size; i++) {live[r] = live[r] && (antecedent[i] < (u_int)input_frames[i].get_size());}
+        this->_rule_term[r] = (uint8_t)(live[r] ? term : 0);
+    }
+
+    // Degree of membership of the antecedent of every rule, for every code
+    for (u_int i=0; i<input_size; i++)
+    {
+        float x_offset = (offset == 0) ? 0.0F : offset[i];
+        float x_gain = (gain == 0) ? 1.0F : gain[i];
+        u_int codes = 1u << bits[i];
+        for (u_int code=0; code<codes; code++)
+        {
+            float x = x_offset + x_gain * (float)code;
+            uint8_t* row = &this->_tables[i][(size_t)code * rule_stride];
+            input_frames[i].Fuzzify(x, mu);
+            for (u_int r=0; r<total_rules; r++)
+            {
+                if (live[r]) {row[r] = quantize(mu[rules[r].get_input_rules()[i]]);}
+            }
+        }
+    }
+    free(live);
+    free(mu);
+
+    // Consequents at the output samples; padding samples stay 0
+    u_int s = 0;
+    for (float y = domain.low_bond; y <= domain.up_bond && s < samples; y = y+domain.interval)
+    {
+        for (u_int c=0; c<terms; c++) {this->_consequent[(size_t)c * sample_stride + s] = quantize(output_frames[output_id].get_muvalue(c, y));}
+        s++;
+    }
+    return true;
+}
+
+void FuzzyQuantized::Evaluate(const u_int* codes, uint8_t* fuzzy_output)
+{
+    // 1. alpha of every rule: packed minimum of one table row per input
+    uint8_t alpha[QUANT_MAX_RULES];
+    u_int rule_stride = this->_rule_stride;
+    for (u_int r=0; r<rule_stride; r++) {alpha[r] = 255;}
+    for (u_int i=0; i<this->_input_size; i++)
+    {
+        u_int code = codes[i];
+        u_int top = (1u << this->_bits[i]) - 1;
+        code = (code > top) ? top : code;
+        min_row(alpha, &this->_tables[i][(size_t)code * rule_stride], rule_stride);
+    }
+
+    // 2. rules with the same consequent share one maximum
+    uint8_t weight[256];
+    for (u_int c=0; c<this->_terms; c++) {weight[c] = 0;}
+    for (u_int r=0; r<this->_total_rules; r++)
+    {
+        uint8_t c = this->_rule_term[r];
+        weight[c] = (alpha[r] > weight[c]) ? alpha[r] : weight[c];
+    }
+
+    // 3. output sweep, packed over the samples
+    uint8_t mu[QUANT_MAX_SAMPLES];
+    u_int sample_stride = this->_sample_stride;
+    for (u_int s=0; s<sample_stride; s++) {mu[s] = 0;}
+    for (u_int c=0; c<this->_terms; c++)
+    {
+        if (weight[c] == 0) {continue;}
+        max_min_row(mu, &this->_consequent[(size_t)c * sample_stride], weight[c], sample_stride);
+    }
+    for (u_int s=0; s<this->_samples; s++) {fuzzy_output[s] = mu[s];}
+}
+
+float FuzzyQuantized::Defuzzyfication(const u_int* codes)
+{
+    uint8_t mu[QUANT_MAX_SAMPLES];
+    this->Evaluate(codes, mu);
+
+    // 4. integer centroid: sum(mu) and sum(mu * sample index)
+    uint32_t weight = 0;
+    uint32_t moment = 0;
+    for (u_int s=0; s<this->_samples; s++)
+    {
+        weight = weight + mu[s];
+        moment = moment + (uint32_t)mu[s] * s;
+    }
+    if (weight == 0) {return 0.0;}     // as Defuzzyfication when no rule fires
+    return this->_y_low + this->_y_step * ((float)moment / (float)weight);
+}
+
+void FuzzyQuantized::Defuzzyfication(const u_int* codes, u_int batch, float* output)
+{
+    for (u_int q=0; q<batch; q++) {output[q] = this->Defuzzyfication(&codes[(size_t)q * this->_input_size]);}
+}
+
+u_int FuzzyQuantized::get_samples(void)
+{
+    return this->_samples;
+}
+
+size_t FuzzyQuantized::get_table_size(void)
+{
+    return this->_table_size;
+}
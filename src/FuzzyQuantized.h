@@ -0,0 +1,103 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Quantized inference on integer inputs with 8-bit degrees of membership.
+  *
+  * Inputs coming from an ADC are already integer codes of 8 to 12 bits. The
+  * FuzzyQuantized engine precomputes, for every input and every possible code,
+  * the degree of membership of the antecedent of every rule, scaled to
+  * 0..255 (uint8_t). A query is then:
+  *
+  *    1. alpha[rule] = min over inputs of table[input][code][rule]: one row per
+  *       input, a packed uint8 minimum over the rules
+  *    2. alpha of the rules with the same consequent are combined by maximum
+  *    3. mu[sample] = max over consequents of min(alpha, consequent[sample]),
+  *       packed uint8 minimum and maximum over the output samples
+  *    4. integer centroid of mu over the output samples
+  *
+  * The loops of 1 and 3 work on uint8_t arrays padded to QUANT_LANES, so the
+  * compiler turns them into 16 (SSE2, NEON) or 32 (AVX2) lanes per instruction.
+  * Since rounding to 8 bits keeps the order of the degrees of membership, min
+  * and max are exact on the quantized values: the only error is the rounding
+  * of the tables (1/510 at most for each degree of membership).
+  *
+  * The default operators are used (minimum, maximum and Mamdani implication).
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    u_int bits[2] = {10, 8};                     // 10-bit and 8-bit ADC
+  *    float gain[2] = {100.0/1023, 100.0/255};     // physical value = offset + gain*code
+  *    FuzzyQuantized quantized;
+  *    quantized.Quantized_SetUp(&mySystem, 0, bits, 0, gain);  // offset 0
+  *
+  *    u_int codes[2] = {adc_temperature, adc_humidity};
+  *    output = quantized.Defuzzyfication(codes);
+  *    ```
+  *
+  * Without offset and gain (0 pointers) the code is the physical value itself,
+  * as in FuzzySet::mu_func(int).
+***/
+
+#ifndef FUZZYQUANTIZED_H_
+#define FUZZYQUANTIZED_H_
+
+#include <stddef.h>
+#include "FuzzyLogic.h"
+
+#ifndef QUANT_MAX_INPUT
+#define QUANT_MAX_INPUT         8       // Maximum number of inputs
+#endif
+
+#ifndef QUANT_MAX_BITS
+#define QUANT_MAX_BITS          12      // Maximum resolution of an input code
+#endif
+
+#ifndef QUANT_MAX_RULES
+#define QUANT_MAX_RULES         256     // Maximum number of rules
+#endif
+
+#ifndef QUANT_MAX_SAMPLES
+#define QUANT_MAX_SAMPLES       256     // Maximum number of output samples
+#endif
+
+#define QUANT_LANES             32      // Padding of the uint8_t rows (one AVX2 register)
+
+class FuzzyQuantized
+{
+private:
+    uint8_t* _arena;                        // every table, one allocation
+    uint8_t* _tables[QUANT_MAX_INPUT];      // (1 << bits) rows of _rule_stride degrees of membership
+    uint8_t* _consequent;                   // _terms rows of _sample_stride degrees of membership
+    uint8_t* _rule_term;                    // consequent of each rule
+    u_int _input_size;
+    u_int _bits[QUANT_MAX_INPUT];
+    u_int _total_rules, _rule_stride;
+    u_int _terms;
+    u_int _samples, _sample_stride;
+    float _y_low, _y_step;
+    size_t _table_size;
+
+    void release(void);
+    FuzzyQuantized(const FuzzyQuantized&);              // not copyable, owns its tables
+    FuzzyQuantized& operator=(const FuzzyQuantized&);
+public:
+    FuzzyQuantized();
+    ~FuzzyQuantized();
+
+    // offset and gain may be 0 (code = physical value). Returns false if the
+    // system exceeds the QUANT_MAX_* limits or if the allocation fails
+    bool Quantized_SetUp(FuzzySystem* system, u_int output_id, const u_int* bits, const float* offset, const float* gain);
+
+    // Codes are clamped to 0 .. 2^bits - 1
+    float Defuzzyfication(const u_int* codes);
+    void Defuzzyfication(const u_int* codes, u_int batch, float* output);
+
+    // Quantized fuzzy output (get_samples() values of 0..255) of a query
+    void Evaluate(const u_int* codes, uint8_t* fuzzy_output);
+
+    u_int get_samples(void);
+    size_t get_table_size(void);            // bytes
+};
+
+#endif // FUZZYQUANTIZED_H_
@@ -0,0 +1,252 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Implementation of FuzzyRelation (see FuzzyRelation.h)
+***/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include "FuzzyRelation.h"
+
+static void max_min_row(float* __restrict out, const float* __restrict row, float w, u_int n)
+{
+    // out = max(out, min(w, row)), no branch so the compiler can vectorize it
+    for (u_int j=0; j<n; j++)
+    {
+        float v = (row[j] < w) ? row[j] : w;
+        out[j] = (out[j] > v) ? out[j] : v;
+    }
+}
+
+
+FuzzyRelation::FuzzyRelation()
+{
+    this->_matrix = 0;
+    this->_ys = 0;
+    this->_xs = 0;
+    this->_input_size = 0;
+    this->_input_length = 0;
+    this->_rows = 0;
+    this->_columns = 0;
+}
+
+FuzzyRelation::~FuzzyRelation()
+{
+    this->release();
+}
+
+void FuzzyRelation::release(void)
+{
+    free(this->_matrix);
+    free(this->_ys);
+    free(this->_xs);
+    this->_matrix = 0;
+    this->_ys = 0;
+    this->_xs = 0;
+    this->_rows = 0;
+    this->_columns = 0;
+}
+
+bool FuzzyRelation::Relation_SetUp(FuzzySystem* system, u_int output_id)
+{
+    this->release();
+    if (system->get_total_rules() == 0) {return false;}
+    FuzzyRule* rule = &system->get_rules()[0];
+    u_int input_size = rule->get_input_size();
+    if (input_size == 0 || input_size > RELATION_MAX_INPUT) {return false;}
+    UnivDisc out_domain = rule->get_output_domain(output_id);
+
+    // Grid of every input
+    u_int rows = 1;
+    u_int length = 0;
+    for (u_int i=0; i<input_size; i++)
+    {
+        UnivDisc domain = rule->get_input_frames()[i].get_domain();
+        this->_grid[i] = domain_samples(domain);
+        this->_low[i] = domain.low_bond;
+        this->_step[i] = domain.interval;
+        if (this->_grid[i] == 0) {return false;}
+        if (this->_grid[i] > UINT_MAX / rows) {return false;}  // rows are counted in u_int
+        rows = rows * this->_grid[i];
+        length = length + this->_grid[i];
+    }
+    u_int columns = domain_samples(out_domain);
+    if (columns == 0 || rows > SIZE_MAX / sizeof(float) / columns) {return false;}
+
+    this->_matrix = (float*)malloc((size_t)rows * columns * sizeof(float));
+    this->_ys = (float*)malloc(columns * sizeof(float));
+    this->_xs = (float*)malloc((length + 1) * sizeof(float));
+    if (this->_matrix == 0 || this->_ys == 0 || this->_xs == 0)
+    {
+        this->release();
+        return false;
+    }
+    this->_input_size = input_size;
+    this->_input_length = length;
+    this->_rows = rows;
+    this->_columns = columns;
+
+    // The same float values as the loops of the library
+    u_int k = 0;
+    for (float y = out_domain.low_bond; y <= out_domain.up_bond && k < columns; y = y+out_domain.interval) {this->_ys[k++] = y;}
+    float* xs = this->_xs;
+    for (u_int i=0; i<input_size; i++)
+    {
+        UnivDisc domain = rule->get_input_frames()[i].get_domain();
+        k = 0;
+        for (float x = domain.low_bond; x <= domain.up_bond && k < this->_grid[i]; x = x+domain.interval) {xs[k++] = x;}
+        xs = xs + this->_grid[i];
+    }
+
+    // R(x, y) from the rules, row by row (the last input varies fastest)
+    float input[RELATION_MAX_INPUT];
+    u_int digit[RELATION_MAX_INPUT];
+    for (u_int i=0; i<input_size; i++) {digit[i] = 0;}
+    for (u_int row=0; row<rows; row++)
+    {
+        xs = this->_xs;
+        for (u_int i=0; i<input_size; i++)
+        {
+            input[i] = xs[digit[i]];
+            xs = xs + this->_grid[i];
+        }
+        float* r = &this->_matrix[(size_t)row * columns];
+        for (u_int j=0; j<columns; j++) {r[j] = system->Evaluate(input, this->_ys[j], output_id);}
+
+        for (u_int i=input_size; i>0; i--)
+        {
+            if (++digit[i-1] < this->_grid[i-1]) {break;}
+            digit[i-1] = 0;
+        }
+    }
+    return true;
+}
+
+void FuzzyRelation::Compose(const float* fuzzy_input, float* fuzzy_output)
+{
+    this->Compose(fuzzy_input, 1, fuzzy_output);
+}
+
+void FuzzyRelation::Compose(const float* fuzzy_input, u_int batch, float* fuzzy_output)
+{
+    /*
+    B(y) = max over rows of min(A(row), R(row, y)) for every query, where A(row)
+    is the minimum of the fuzzy inputs at the grid points of the row.
+
+    The rows sharing the grid points of all inputs but the last one are
+    consecutive (a block). Each block is composed with every query of the
+    batch while it is in cache, and skipped at once for a query whose first
+    inputs give A = 0, so sparse fuzzy inputs cost less.
+    */
+    if (this->_matrix == 0) {return;}
+    u_int columns = this->_columns;
+    u_int last = this->_input_size - 1;
+    u_int block = this->_grid[last];
+    u_int last_base = this->_input_length - block;
+    for (size_t i=0; i<(size_t)batch * columns; i++) {fuzzy_output[i] = 0.0;}
+
+    u_int digit[RELATION_MAX_INPUT];
+    for (u_int i=0; i<this->_input_size; i++) {digit[i] = 0;}
+    for (u_int first=0; first<this->_rows; first=first+block)
+    {
+        const float* rows = &this->_matrix[(size_t)first * columns];
+        for (u_int q=0; q<batch; q++)
+        {
+            const float* a = &fuzzy_input[(size_t)q * this->_input_length];
+            float* out = &fuzzy_output[(size_t)q * columns];
+            float w_block = 1.0;
+            u_int base = 0;
+            for (u_int i=0; i<last; i++)
+            {
+                float v = a[base + digit[i]];
+                w_block = (v < w_block) ? v : w_block;
+                base = base + this->_grid[i];
+            }
+            if (!(w_block > 0.0F)) {continue;}
+            for (u_int k=0; k<block; k++)
+            {
+                float v = a[last_base + k];
+                float w = (v < w_block) ? v : w_block;
+                if (!(w > 0.0F)) {continue;}
+                max_min_row(out, &rows[(size_t)k * columns], w, columns);
+            }
+        }
+        // Next grid point of the first inputs
+        for (u_int i=last; i>0; i--)
+        {
+            if (++digit[i-1] < this->_grid[i-1]) {break;}
+            digit[i-1] = 0;
+        }
+    }
+}
+
+u_int FuzzyRelation::get_row(const float* input)
+{
+    // Nearest grid point of every input (clamped to the universe of discourse)
+    u_int row = 0;
+    for (u_int i=0; i<this->_input_size; i++)
+    {
+        float t = (input[i] - this->_low[i]) / this->_step[i] + 0.5F;
+        float t_max = (float)(this->_grid[i] - 1);
+        t = (t > 0.0F) ? t : 0.0F;
+        t = (t < t_max) ? t : t_max;
+        row = row * this->_grid[i] + (u_int)t;
+    }
+    return row;
+}
+
+float FuzzyRelation::Centroid(const float* fuzzy_output)
+{
+    // Same sums, in the same order, as FuzzySystem::Defuzzyfication
+    float weight = 0;
+    float weight_avg = 0;
+    for (u_int j=0; j<this->_columns; j++)
+    {
+        weight = weight + fuzzy_output[j];
+        weight_avg = weight_avg + fuzzy_output[j] * this->_ys[j];
+    }
+    if (weight == 0) {weight = 1.0;}            // Precaution for weight = 0 (error division by 0)
+    return weight_avg / weight;
+}
+
+float FuzzyRelation::Defuzzyfication(const float* input)
+{
+    // The composition with a singleton selects one row of R
+    if (this->_matrix == 0) {return 0.0;}
+    return this->Centroid(&this->_matrix[(size_t)this->get_row(input) * this->_columns]);
+}
+
+void FuzzyRelation::Defuzzyfication(const float* input, u_int batch, float* output)
+{
+    for (u_int q=0; q<batch; q++) {output[q] = this->Defuzzyfication(&input[(size_t)q * this->_input_size]);}
+}
+
+u_int FuzzyRelation::get_input_size(void)
+{
+    return this->_input_size;
+}
+u_int FuzzyRelation::get_input_length(void)
+{
+    return this->_input_length;
+}
+u_int FuzzyRelation::get_grid_size(u_int input_id)
+{
+    return this->_grid[input_id];
+}
+u_int FuzzyRelation::get_rows(void)
+{
+    return this->_rows;
+}
+u_int FuzzyRelation::get_columns(void)
+{
+    return this->_columns;
+}
+const float* FuzzyRelation::get_matrix(void)
+{
+    return this->_matrix;
+}
+size_t FuzzyRelation::get_matrix_size(void)
+{
+    return (size_t)this->_rows * this->_columns * sizeof(float);
+}
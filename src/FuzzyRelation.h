@@ -0,0 +1,103 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Compositional rule of inference over a discretized fuzzy relation.
+  *
+  * For small discrete universes, the rules of a FuzzySystem can be compiled
+  * once into a single relation matrix
+  *
+  *    R(x_1, ..., x_n, y) = max over rules of min(alpha(x_1, ..., x_n), mu_consequent(y))
+  *
+  * where every x_i runs over the grid of its input frame and y over the output
+  * samples. A query is then Zadeh's max-min composition of the fuzzy inputs
+  * with R, B(y) = max over x of min(A_1(x_1), ..., A_n(x_n), R(x, y)), which
+  * only reads the matrix row by row, instead of evaluating the rules one at a
+  * time. This is the classic approach of fuzzy logic controllers in hardware.
+  *
+  * The grids are the universe of discourse of each frame (UnivDisc): from
+  * low_bond to up_bond with step interval, the same samples as Defuzzyfication
+  * uses for the output. domainSetUp() of an input frame sets its resolution.
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    FuzzyRelation relation;
+  *    relation.Relation_SetUp(&mySystem, 0);          // builds R once (the only allocation)
+  *
+  *    output = relation.Defuzzyfication(inputs);       // crisp inputs, see below
+  *    relation.Defuzzyfication(inputs, 64, outputs);   // 64 queries of input_size values each
+  *
+  *    relation.Compose(fuzzy_inputs, 64, fuzzy_outputs); // fuzzy inputs: one vector per input
+  *    ```
+  *
+  * A crisp input is a fuzzy singleton at the nearest grid point, so its output
+  * is one row of R: it equals Defuzzyfication of the library for inputs on the
+  * grid. A fuzzy input is the concatenation of the degrees of membership at
+  * the grid points of every input (get_input_length() values per query).
+  *
+  * Queries are batched: the matrix is read in blocks (the rows of one grid
+  * point of the first inputs, for every grid point of the last input) and each
+  * block is composed with every query of the batch while it is in cache, so
+  * memory bandwidth is shared by the batch. A block is skipped for a query
+  * whose fuzzy inputs are zero there. The inner loop over the output samples
+  * is a plain min/max loop the compiler vectorizes.
+***/
+
+#ifndef FUZZYRELATION_H_
+#define FUZZYRELATION_H_
+
+#include <stddef.h>
+#include "FuzzyLogic.h"
+
+#ifndef RELATION_MAX_INPUT
+#define RELATION_MAX_INPUT      8       // Maximum number of inputs of the relation
+#endif
+
+class FuzzyRelation
+{
+private:
+    float* _matrix;                         // _rows x _columns, the last input varies fastest
+    float* _ys;                             // output samples
+    float* _xs;                             // grid points of every input, one after the other
+    u_int _input_size;
+    u_int _grid[RELATION_MAX_INPUT];        // number of grid points of each input
+    float _low[RELATION_MAX_INPUT];
+    float _step[RELATION_MAX_INPUT];
+    u_int _input_length;                    // sum of _grid
+    u_int _rows;
+    u_int _columns;
+
+    void release(void);
+    FuzzyRelation(const FuzzyRelation&);                // not copyable, owns its matrix
+    FuzzyRelation& operator=(const FuzzyRelation&);
+public:
+    FuzzyRelation();
+    ~FuzzyRelation();
+
+    // Returns false if the system has no input or too many inputs, an empty
+    // universe of discourse, a grid too large to count or if the allocation
+    // fails. Compose does nothing before a successful Relation_SetUp
+    bool Relation_SetUp(FuzzySystem* system, u_int output_id);
+
+    // Max-min composition of fuzzy inputs, batch queries at a time
+    void Compose(const float* fuzzy_input, float* fuzzy_output);
+    void Compose(const float* fuzzy_input, u_int batch, float* fuzzy_output);
+
+    // Crisp inputs, singleton at the nearest grid point of each input
+    u_int get_row(const float* input);
+    float Defuzzyfication(const float* input);
+    void Defuzzyfication(const float* input, u_int batch, float* output);
+
+    // Centroid of a fuzzy output (get_columns() values)
+    float Centroid(const float* fuzzy_output);
+
+    u_int get_input_size(void);
+    u_int get_input_length(void);
+    u_int get_grid_size(u_int input_id);
+    u_int get_rows(void);
+    u_int get_columns(void);
+    const float* get_matrix(void);
+    size_t get_matrix_size(void);           // bytes
+};
+
+#endif // FUZZYRELATION_H_
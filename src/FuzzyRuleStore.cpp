@@ -0,0 +1,479 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Implementation of FuzzyRuleWriter and FuzzyRuleStore (see FuzzyRuleStore.h)
+***/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <chrono>
+#include "FuzzyRuleStore.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define STORE_HAS_MMAP
+#endif
+
+// The file is little endian whatever the host is
+static bool write_u32(FILE* file, uint32_t value)
+{
+    uint8_t b[4] = {(uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+    return fwrite(b, 1, 4, file) == 4;
+}
+
+static uint32_t get_u32(const uint8_t* b)
+{
+    return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+static bool read_u32(FILE* file, uint32_t* value)
+{
+    uint8_t b[4];
+    if (fread(b, 1, 4, file) != 4) {return false;}
+    *value = get_u32(b);
+    return true;
+}
+
+static u_int field_bits(u_int terms)
+{
+    // Bits to store an index 0 .. terms-1 (at least one)
+    u_int bits = 1;
+    while (bits < 32 && (1U << bits) < terms) {bits++;}
+    return bits;
+}
+
+
+FuzzyRuleWriter::FuzzyRuleWriter()
+{
+    this->_file = 0;
+    this->_block = 0;
+    this->_input_size = 0;
+    this->_output_size = 0;
+    this->_rules_per_block = 0;
+    this->_rules = 0;
+    this->_block_rules = 0;
+    this->_block_bits = 0;
+}
+
+FuzzyRuleWriter::~FuzzyRuleWriter()
+{
+    this->Close();
+}
+
+bool FuzzyRuleWriter::Writer_SetUp(const char* path, FuzzyFrame* input_frames, u_int input_size, FuzzyFrame* output_frames, u_int output_size, u_int rules_per_block)
+{
+    this->Close();
+    if (input_size == 0 || input_size > STORE_MAX_INPUT || output_size == 0 || output_size > STORE_MAX_OUTPUT || rules_per_block == 0) {return false;}
+    u_int rule_bits = 0;
+    for (u_int f=0; f<input_size + output_size; f++)
+    {
+        FuzzyFrame* frame = (f < input_size) ? &input_frames[f] : &output_frames[f - input_size];
+        this->_terms[f] = frame->get_size();
+        this->_bits[f] = field_bits(this->_terms[f]);
+        rule_bits = rule_bits + this->_bits[f];
+    }
+    this->_block = (uint8_t*)calloc(((size_t)rules_per_block * rule_bits + 7) / 8 + 1, 1);
+    if (this->_block == 0) {return false;}
+    this->_file = fopen(path, "wb");
+    if (this->_file == 0)
+    {
+        free(this->_block);
+        this->_block = 0;
+        return false;
+    }
+    this->_input_size = input_size;
+    this->_output_size = output_size;
+    this->_rules_per_block = rules_per_block;
+    this->_rules = 0;
+    this->_block_rules = 0;
+    this->_block_bits = 0;
+
+    // The number of rules is written again by Close
+    bool ok = fwrite("FZRS", 1, 4, this->_file) == 4;
+    ok = ok && write_u32(this->_file, STORE_VERSION);
+    ok = ok && write_u32(this->_file, input_size);
+    ok = ok && write_u32(this->_file, output_size);
+    ok = ok && write_u32(this->_file, 0);
+    ok = ok && write_u32(this->_file, rules_per_block);
+    for (u_int f=0; f<input_size + output_size; f++) {ok = ok && write_u32(this->_file, this->_terms[f]);}
+    return ok;
+}
+
+bool FuzzyRuleWriter::Add_Rule(const u_int* input_rule, const u_int* output_rule)
+{
+    if (this->_file == 0) {return false;}
+    for (u_int f=0; f<this->_input_size + this->_output_size; f++)
+    {
+        u_int value = (f < this->_input_size) ? input_rule[f] : output_rule[f - this->_input_size];
+        if (value >= this->_terms[f]) {return false;}
+    }
+    // Fields one after the other, least significant bit first
+    for (u_int f=0; f<this->_input_size + this->_output_size; f++)
+    {
+        u_int value = (f < this->_input_size) ? input_rule[f] : output_rule[f - this->_input_size];
+        for (u_int b=0; b<this->_bits[f]; b++)
+        {
+            if ((value >> b) & 1U) {this->_block[this->_block_bits >> 3] |= (uint8_t)(1U << (this->_block_bits & 7));}
+            this->_block_bits++;
+        }
+    }
+    this->_rules++;
+    this->_block_rules++;
+    if (this->_block_rules == this->_rules_per_block) {return this->flush();}
+    return true;
+}
+
+bool FuzzyRuleWriter::Add_Rules(FuzzySystem* system)
+{
+    FuzzyRule* rules = system->get_rules();
+    for (u_int r=0; r<system->get_total_rules(); r++)
+    {
+        if (rules[r].get_input_size() != this->_input_size || rules[r].get_output_size() != this->_output_size) {return false;}
+        if (!this->Add_Rule(rules[r].get_input_rules(), rules[r].get_output_rules())) {return false;}
+    }
+    return true;
+}
+
+bool FuzzyRuleWriter::flush(void)
+{
+    if (this->_block_rules == 0) {return true;}
+    size_t bytes = (this->_block_bits + 7) / 8;
+    bool ok = write_u32(this->_file, this->_block_rules);
+    ok = ok && write_u32(this->_file, (uint32_t)bytes);
+    ok = ok && fwrite(this->_block, 1, bytes, this->_file) == bytes;
+    memset(this->_block, 0, bytes);
+    this->_block_rules = 0;
+    this->_block_bits = 0;
+    return ok;
+}
+
+bool FuzzyRuleWriter::Close(void)
+{
+    if (this->_file == 0) {return false;}
+    bool ok = this->flush();
+    ok = ok && fseek(this->_file, 16, SEEK_SET) == 0;          // number of rules in the header
+    ok = ok && write_u32(this->_file, this->_rules);
+    ok = (fclose(this->_file) == 0) && ok;
+    this->_file = 0;
+    free(this->_block);
+    this->_block = 0;
+    return ok;
+}
+
+u_int FuzzyRuleWriter::get_rules(void)
+{
+    return this->_rules;
+}
+
+
+FuzzyRuleStore::FuzzyRuleStore()
+{
+    this->_file = 0;
+    this->_map = 0;
+    this->_map_size = 0;
+    this->_input_frames = 0;
+    this->_output_frames = 0;
+    this->_input_size = 0;
+    this->_output_size = 0;
+    this->_fields = 0;
+    this->_input_terms = 0;
+    this->_rule_bits = 0;
+    this->_rules = 0;
+    this->_rules_per_block = 0;
+    this->_data_start = 0;
+    this->_block = 0;
+    this->_block_capacity = 0;
+    this->_decoded = 0;
+    this->_bytes_read = 0;
+    this->_inferences = 0;
+    this->_seconds = 0.0;
+}
+
+FuzzyRuleStore::~FuzzyRuleStore()
+{
+    this->release();
+}
+
+void FuzzyRuleStore::release(void)
+{
+#ifdef STORE_HAS_MMAP
+    if (this->_map != 0) {munmap(this->_map, this->_map_size);}
+#endif
+    this->_map = 0;
+    if (this->_file != 0) {fclose(this->_file);}
+    this->_file = 0;
+    free(this->_block);
+    free(this->_decoded);
+    this->_block = 0;
+    this->_decoded = 0;
+    this->_rules = 0;
+}
+
+bool FuzzyRuleStore::Store_SetUp(const char* path, FuzzyFrame* input_frames, u_int FR_input_size, FuzzyFrame* output_frames, u_int FR_output_size, bool map)
+{
+    this->release();
+    this->_bytes_read = 0;
+    this->_inferences = 0;
+    this->_seconds = 0.0;
+    this->_file = fopen(path, "rb");
+    if (this->_file == 0) {return false;}
+
+    // Header
+    char magic[4];
+    uint32_t version, input_size, output_size, rules, rules_per_block;
+    bool ok = fread(magic, 1, 4, this->_file) == 4 && memcmp(magic, "FZRS", 4) == 0;
+    ok = ok && read_u32(this->_file, &version) && version == STORE_VERSION;
+    ok = ok && read_u32(this->_file, &input_size) && read_u32(this->_file, &output_size);
+    ok = ok && input_size == FR_input_size && output_size == FR_output_size;       // the frames the caller has
+    ok = ok && read_u32(this->_file, &rules) && read_u32(this->_file, &rules_per_block);
+    ok = ok && input_size > 0 && input_size <= STORE_MAX_INPUT && output_size > 0 && output_size <= STORE_MAX_OUTPUT && rules_per_block > 0;
+    ok = ok && rules_per_block <= SIZE_MAX / ((input_size + output_size) * sizeof(u_int));
+    u_int rule_bits = 0;
+    u_int input_terms = 0;
+    for (u_int f=0; ok && f<input_size + output_size; f++)
+    {
+        uint32_t terms = 0;
+        ok = read_u32(this->_file, &terms);
+        FuzzyFrame* frame = (f < input_size) ? &input_frames[f] : &output_frames[f - input_size];
+        ok = ok && terms == (uint32_t)frame->get_size();
+        this->_terms[f] = terms;
+        this->_bits[f] = field_bits(terms);
+        rule_bits = rule_bits + this->_bits[f];
+        this->_field_offset[f] = (f < input_size) ? input_terms : 0;
+        if (f < input_size)
+        {
+            this->_input_offset[f] = input_terms;
+            input_terms = input_terms + terms;
+        }
+    }
+    if (!ok)
+    {
+        this->release();
+        return false;
+    }
+    this->_input_frames = input_frames;
+    this->_output_frames = output_frames;
+    this->_input_size = input_size;
+    this->_output_size = output_size;
+    this->_fields = input_size + output_size;
+    this->_input_terms = input_terms;
+    this->_rule_bits = rule_bits;
+    this->_rules = rules;
+    this->_rules_per_block = rules_per_block;
+    this->_data_start = ftell(this->_file);
+
+    this->_block_capacity = ((size_t)rules_per_block * rule_bits + 7) / 8;
+    this->_decoded = (u_int*)malloc((size_t)rules_per_block * this->_fields * sizeof(u_int));
+    if (this->_decoded == 0)
+    {
+        this->release();
+        return false;
+    }
+#ifdef STORE_HAS_MMAP
+    if (map && fseek(this->_file, 0, SEEK_END) == 0)
+    {
+        this->_map_size = (size_t)ftell(this->_file);
+        void* address = mmap(0, this->_map_size, PROT_READ, MAP_PRIVATE, fileno(this->_file), 0);
+        this->_map = (address == MAP_FAILED) ? 0 : (uint8_t*)address;
+    }
+#else
+    (void)map;
+#endif
+    if (this->_map == 0)
+    {
+        this->_block = (uint8_t*)malloc(this->_block_capacity + 1);
+        if (this->_block == 0)
+        {
+            this->release();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FuzzyRuleStore::decode(const uint8_t* block, size_t bytes, u_int rules)
+{
+    // Unpack the fields, the antecedents as indexes of the fuzzified inputs.
+    // The bit buffer is refilled a byte at a time up to 56 bits, which holds
+    // every field of 32 bits at most. A field holds up to 2^bits-1, so every
+    // value is checked against the linguistic values of its frame (without a
+    // branch, the block is rejected at the end)
+    const uint8_t* end = block + bytes;
+    const u_int fields = this->_fields;
+    u_int bits[STORE_MAX_INPUT + STORE_MAX_OUTPUT];         // local copies, the output can not alias them
+    u_int offset[STORE_MAX_INPUT + STORE_MAX_OUTPUT];
+    u_int terms[STORE_MAX_INPUT + STORE_MAX_OUTPUT];
+    for (u_int f=0; f<fields; f++)
+    {
+        bits[f] = this->_bits[f];
+        offset[f] = this->_field_offset[f];
+        terms[f] = this->_terms[f];
+    }
+    uint64_t acc = 0;
+    u_int count = 0;
+    u_int invalid = 0;
+    u_int* out = this->_decoded;
+    for (u_int r=0; r<rules; r++)
+    {
+        for (u_int f=0; f<fields; f++)
+        {
+            if (count < bits[f])
+            {
+                while (count <= 56 && block < end)
+                {
+                    acc = acc | ((uint64_t)(*block++) << count);
+                    count = count + 8;
+                }
+            }
+            u_int value = (u_int)(acc & ((1ULL << bits[f]) - 1));
+            invalid = invalid | (u_int)(value >= terms[f]);
+            out[f] = value + offset[f];
+            acc = acc >> bits[f];
+            count = count - bits[f];
+        }
+        out = out + fields;
+    }
+    return invalid == 0;
+}
+
+bool FuzzyRuleStore::Defuzzyfication(const float* input, u_int batch, u_int output_id, float* output)
+{
+    if (this->_decoded == 0 || output_id >= this->_output_size) {return false;}
+    FuzzyFrame* out_frame = &this->_output_frames[output_id];
+    UnivDisc domain = out_frame->get_domain();
+    u_int samples = domain_samples(domain);
+    if (samples == 0) {return false;}
+    u_int terms = this->_terms[this->_input_size + output_id];
+    u_int input_terms = this->_input_terms;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    float* mu_input = (float*)malloc((size_t)batch * input_terms * sizeof(float));
+    float* weight = (float*)calloc((size_t)batch * terms + 1, sizeof(float));
+    float* mu_output = (float*)malloc(((size_t)terms * samples + samples) * sizeof(float));
+    if (mu_input == 0 || weight == 0 || mu_output == 0)
+    {
+        free(mu_input); free(weight); free(mu_output);
+        return false;
+    }
+
+    // Fuzzified inputs of the batch, and the consequents at the output samples
+    for (u_int q=0; q<batch; q++)
+    {
+        for (u_int i=0; i<this->_input_size; i++)
+        {
+            float* mu = &mu_input[(size_t)q * input_terms + this->_input_offset[i]];
+            this->_input_frames[i].Fuzzify(input[(size_t)q * this->_input_size + i], mu);
+        }
+    }
+    float* ys = &mu_output[(size_t)terms * samples];
+    u_int s = 0;
+    for (float y = domain.low_bond; y <= domain.up_bond && s < samples; y = y+domain.interval) {ys[s++] = y;}
+    for (u_int t=0; t<terms; t++)
+    {
+        for (s=0; s<samples; s++) {mu_output[(size_t)t * samples + s] = out_frame->get_muvalue(t, ys[s]);}
+    }
+
+    // Every block against the whole batch
+    bool ok = true;
+    const uint8_t* position = (this->_map != 0) ? this->_map + this->_data_start : 0;
+    if (this->_map == 0) {ok = fseek(this->_file, this->_data_start, SEEK_SET) == 0;}
+    u_int left = this->_rules;
+    u_int consequent = this->_input_size + output_id;
+    while (ok && left > 0)
+    {
+        uint32_t rules, bytes;
+        const uint8_t* block;
+        // A block has exactly the bytes of its rules, and is within the file
+        if (this->_map != 0)
+        {
+            size_t at = (size_t)(position - this->_map);
+            ok = at <= this->_map_size && this->_map_size - at >= 8;
+            if (!ok) {break;}
+            rules = get_u32(position);
+            bytes = get_u32(position + 4);
+            ok = bytes <= this->_map_size - at - 8;
+            block = position + 8;
+        }
+        else
+        {
+            ok = read_u32(this->_file, &rules) && read_u32(this->_file, &bytes);
+            block = this->_block;
+        }
+        ok = ok && rules > 0 && rules <= this->_rules_per_block && rules <= left;
+        ok = ok && bytes == ((size_t)rules * this->_rule_bits + 7) / 8;
+        if (!ok) {break;}
+        if (this->_map != 0)    {position = block + bytes;}
+        else                    {ok = fread(this->_block, 1, bytes, this->_file) == bytes;}
+        ok = ok && this->decode(block, bytes, rules);
+        if (!ok) {break;}
+        this->_bytes_read = this->_bytes_read + 8 + bytes;
+        left = left - rules;
+
+        for (u_int q=0; q<batch; q++)
+        {
+            const float* mu = &mu_input[(size_t)q * input_terms];
+            float* w = &weight[(size_t)q * terms];
+            const u_int* rule = this->_decoded;
+            for (u_int r=0; r<rules; r++, rule = rule + this->_fields)
+            {
+                // No early exit: a branch per antecedent costs more than the loads
+                float alpha = 1.0F;
+                for (u_int i=0; i<this->_input_size; i++) {alpha = (mu[rule[i]] < alpha) ? mu[rule[i]] : alpha;}
+                u_int c = rule[consequent];
+                w[c] = (alpha > w[c]) ? alpha : w[c];
+            }
+        }
+    }
+
+    // Output sweep and centroid, as Defuzzyfication
+    for (u_int q=0; q<batch && ok; q++)
+    {
+        const float* w = &weight[(size_t)q * terms];
+        float sum = 0.0F;
+        float sum_y = 0.0F;
+        for (s=0; s<samples; s++)
+        {
+            float mu = 0.0F;
+            for (u_int t=0; t<terms; t++) {mu = maximum(mu, minimum(w[t], mu_output[(size_t)t * samples + s]));}
+            sum = sum + mu;
+            sum_y = sum_y + mu * ys[s];
+        }
+        if (sum == 0.0F) {sum = 1.0F;}
+        output[q] = sum_y / sum;
+    }
+    if (ok)
+    {
+        this->_inferences = this->_inferences + batch;
+        this->_seconds = this->_seconds + std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    free(mu_input);
+    free(weight);
+    free(mu_output);
+    return ok;
+}
+
+u_int FuzzyRuleStore::get_rules(void)
+{
+    return this->_rules;
+}
+
+uint64_t FuzzyRuleStore::get_bytes_read(void)
+{
+    return this->_bytes_read;
+}
+
+uint64_t FuzzyRuleStore::get_inferences(void)
+{
+    return this->_inferences;
+}
+
+float FuzzyRuleStore::get_bytes_per_inference(void)
+{
+    return (this->_inferences == 0) ? 0.0F : (float)this->_bytes_read / (float)this->_inferences;
+}
+
+double FuzzyRuleStore::get_inferences_per_second(void)
+{
+    return (this->_seconds > 0.0) ? (double)this->_inferences / this->_seconds : 0.0;
+}
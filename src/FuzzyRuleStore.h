@@ -0,0 +1,140 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Rule bases stored on disk and evaluated block by block.
+  *
+  * Rules extracted from data can be too many to keep as FuzzyRule objects
+  * (each one holds pointers and two arrays of u_int). A rule is only a list
+  * of linguistic value indexes, so FuzzyRuleWriter packs each index in as
+  * few bits as its frame needs (2 bits for 3 linguistic values) and writes the
+  * rules as blocks to a file:
+  *
+  *    header : "FZRS", version, input_size, output_size, rules, rules per
+  *             block, number of linguistic values of every frame
+  *    blocks : rules in the block, bytes of the block, the packed rules
+  *
+  * FuzzyRuleStore evaluates a batch of queries against such a file with the
+  * default operators (minimum, maximum, Mamdani). Only the FuzzyFrames are in
+  * memory: the blocks are read (or mapped with mmap) one after the other and
+  * every block is evaluated for the whole batch before the next one is read,
+  * so reading the rules is shared by all queries of the batch. For every query
+  * the rules with the same consequent share one maximum, and the output sweep
+  * is done once at the end:
+  *
+  *    w[consequent] = max over rules of min(antecedents)   (block by block)
+  *    mu(y) = max over consequents of min(w, mu_consequent(y))
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    FuzzyRuleWriter writer;
+  *    writer.Writer_SetUp("rules.fzr", Antecedent, 8, Consequent, 1, 65536);
+  *    writer.Add_Rule(input_rule, output_rule);          // as many as needed
+  *    writer.Close();
+  *
+  *    FuzzyRuleStore store;
+  *    store.Store_SetUp("rules.fzr", Antecedent, 8, Consequent, 1, false);  // true: mmap
+  *    store.Defuzzyfication(inputs, 4096, 0, outputs);   // 4096 queries at once
+  *    printf("%f bytes per inference\n", store.get_bytes_per_inference());
+  *    printf("%f inferences per second\n", store.get_inferences_per_second());
+  *    ```
+***/
+
+#ifndef FUZZYRULESTORE_H_
+#define FUZZYRULESTORE_H_
+
+#include <stdio.h>
+#include <stddef.h>
+#include "FuzzyLogic.h"
+
+#ifndef STORE_MAX_INPUT
+#define STORE_MAX_INPUT         32      // Maximum number of inputs
+#endif
+
+#ifndef STORE_MAX_OUTPUT
+#define STORE_MAX_OUTPUT        8       // Maximum number of outputs
+#endif
+
+#define STORE_VERSION           1
+
+class FuzzyRuleWriter
+{
+private:
+    FILE* _file;
+    u_int _input_size, _output_size;
+    u_int _bits[STORE_MAX_INPUT + STORE_MAX_OUTPUT];   // width of each field
+    u_int _terms[STORE_MAX_INPUT + STORE_MAX_OUTPUT];
+    u_int _rules_per_block;
+    u_int _rules, _block_rules;
+    uint8_t* _block;                                    // packed rules of the current block
+    size_t _block_bits;
+
+    bool flush(void);
+    FuzzyRuleWriter(const FuzzyRuleWriter&);
+    FuzzyRuleWriter& operator=(const FuzzyRuleWriter&);
+public:
+    FuzzyRuleWriter();
+    ~FuzzyRuleWriter();
+
+    bool Writer_SetUp(const char* path, FuzzyFrame* input_frames, u_int input_size, FuzzyFrame* output_frames, u_int output_size, u_int rules_per_block);
+    // Returns false for a linguistic value out of its frame or an error of the file
+    bool Add_Rule(const u_int* input_rule, const u_int* output_rule);
+    bool Add_Rules(FuzzySystem* system);
+    bool Close(void);
+
+    u_int get_rules(void);
+};
+
+class FuzzyRuleStore
+{
+private:
+    FILE* _file;
+    uint8_t* _map;                              // whole file when mapped, 0 otherwise
+    size_t _map_size;
+    FuzzyFrame* _input_frames;
+    FuzzyFrame* _output_frames;
+    u_int _input_size, _output_size;
+    u_int _fields;
+    u_int _bits[STORE_MAX_INPUT + STORE_MAX_OUTPUT];
+    u_int _terms[STORE_MAX_INPUT + STORE_MAX_OUTPUT];
+    u_int _input_offset[STORE_MAX_INPUT];
+    u_int _field_offset[STORE_MAX_INPUT + STORE_MAX_OUTPUT];    // added to the decoded fields
+    u_int _input_terms;
+    u_int _rule_bits;
+    u_int _rules, _rules_per_block;
+    long _data_start;                           // offset of the first block
+
+    uint8_t* _block;                            // one packed block (read mode)
+    size_t _block_capacity;
+    u_int* _decoded;                            // per rule: input_size offsets, then output_size terms
+
+    uint64_t _bytes_read;
+    uint64_t _inferences;
+    double _seconds;                            // spent in Defuzzyfication
+
+    void release(void);
+    bool decode(const uint8_t* block, size_t bytes, u_int rules);
+    FuzzyRuleStore(const FuzzyRuleStore&);
+    FuzzyRuleStore& operator=(const FuzzyRuleStore&);
+public:
+    FuzzyRuleStore();
+    ~FuzzyRuleStore();
+
+    // The file must have input_size inputs and output_size outputs, and the
+    // frames as many linguistic values as when the file was written. map: use
+    // mmap where available instead of reading the blocks
+    bool Store_SetUp(const char* path, FuzzyFrame* input_frames, u_int input_size, FuzzyFrame* output_frames, u_int output_size, bool map);
+
+    // batch queries of input_size values each, one output per query. Returns
+    // false if a block is truncated, has a size that does not match its
+    // number of rules or holds a linguistic value out of its frame
+    bool Defuzzyfication(const float* input, u_int batch, u_int output_id, float* output);
+
+    u_int get_rules(void);
+    uint64_t get_bytes_read(void);              // blocks only, since Store_SetUp
+    uint64_t get_inferences(void);
+    float get_bytes_per_inference(void);
+    double get_inferences_per_second(void);     // of the successful calls to Defuzzyfication
+};
+
+#endif // FUZZYRULESTORE_H_
@@ -0,0 +1,489 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Implementation of FuzzyTrainer (see FuzzyTrainer.h)
+***/
+
+#include <stdlib.h>
+#include <chrono>
+#include "FuzzyTrainer.h"
+
+#define TRAINER_NONE    0xFFFFFFFFU
+
+
+static void param_gradient(FS_param p, float x, float* d)
+{
+    /*
+    Derivative of the degree of membership over thr1 .. thr4. On the segment
+    from (x0, m0) to (x1, m1), mu = m0 + (m1 - m0)(x - x0)/(x1 - x0), so
+        dmu/dx0 = (m1 - m0)(x - x1)/(x1 - x0)^2
+        dmu/dx1 = -(m1 - m0)(x - x0)/(x1 - x0)^2
+    and the breakpoints are the thresholds in order (see pwl_from_param).
+    The segments are found as piecewise_linear does.
+    */
+    d[0] = 0.0F; d[1] = 0.0F; d[2] = 0.0F; d[3] = 0.0F;
+    float bx[4] = {p.thr1, p.thr2, p.thr3, p.thr4};
+    float bm[4];
+    u_int n = 0;
+    switch (p.mu_type)
+    {
+    case TRP_L:
+        bm[0] = 1.0F; bm[1] = 0.0F; n = 2;
+        break;
+    case TRP_R:
+        bm[0] = 0.0F; bm[1] = 1.0F; n = 2;
+        break;
+    case TRI:
+        bm[0] = 0.0F; bm[1] = 1.0F; bm[2] = 0.0F; n = 3;
+        break;
+    case TRP_C:
+        bm[0] = 0.0F; bm[1] = 1.0F; bm[2] = 1.0F; bm[3] = 0.0F; n = 4;
+        break;
+    case GAUSS:
+    {
+        float u = (x - p.thr1) / p.thr2;
+        float f = gaussian(p.thr1, p.thr2, x);
+        d[0] = f * u / p.thr2;
+        d[1] = f * u * u / p.thr2;
+        return;
+    }
+    default:
+        return;
+    }
+    u_int k = 0;
+    for (u_int i=0; i<n; i++) {k = k + (u_int)(x > bx[i]);}
+    if (k == 0 || k == n) {return;}                 // flat outside of the breakpoints
+    float dx = bx[k] - bx[k - 1];
+    if (!(dx > 0.0F)) {return;}
+    float dm = bm[k] - bm[k - 1];
+    d[k - 1] = dm * (x - bx[k]) / (dx * dx);
+    d[k] = -dm * (x - bx[k - 1]) / (dx * dx);
+}
+
+
+FuzzyTrainer::FuzzyTrainer()
+{
+    this->_system = 0;
+    this->_input_size = 0;
+    this->_total_rules = 0;
+    this->_output_id = 0;
+    this->_input_terms = 0;
+    this->_output_terms = 0;
+    this->_samples = 0;
+    this->_arena = 0;
+    this->_params = 0;
+    this->_steps = 0;
+    this->_threads = 0;
+    this->_worker_size = 0;
+    this->_inputs = 0;
+    this->_targets = 0;
+    this->_first = 0;
+    this->_count = 0;
+    this->_scale = 0.0F;
+    this->_samples_per_second = 0.0;
+}
+
+FuzzyTrainer::~FuzzyTrainer()
+{
+    this->release();
+}
+
+void FuzzyTrainer::release(void)
+{
+    this->_pool.Release();
+    free(this->_arena);
+    this->_arena = 0;
+    this->_total_rules = 0;
+    this->_params = 0;
+    this->_threads = 0;
+}
+
+bool FuzzyTrainer::Trainer_SetUp(FuzzySystem* system, u_int output_id, u_int threads)
+{
+    this->release();
+    FlatSystem flat;
+    if (!flat_system(system, &flat)) {return false;}
+    FuzzyRule* rules = flat.rules;
+    u_int total_rules = flat.total_rules;
+    u_int input_size = flat.input_size;
+    FuzzyFrame* input_frames = flat.input_frames;
+    FuzzyFrame* output_frames = flat.output_frames;
+    if (input_size > TRAINER_MAX_INPUT || output_id >= flat.output_size) {return false;}
+    threads = FuzzyPool::thread_count(threads, TRAINER_MAX_THREADS);
+
+    FuzzyFrame* out_frame = &output_frames[output_id];
+    UnivDisc domain = out_frame->get_domain();
+    u_int samples = domain_samples(domain);
+    if (samples == 0) {return false;}
+    u_int input_terms = 0;
+    for (u_int i=0; i<input_size; i++) {input_terms = input_terms + input_frames[i].get_size();}
+    u_int output_terms = out_frame->get_size();
+    u_int terms = input_terms + output_terms;
+
+    // Parameters of every FuzzySet of a trained type
+    u_int params = 0;
+    for (u_int i=0; i<=input_size; i++)
+    {
+        FuzzyFrame* frame = (i < input_size) ? &input_frames[i] : out_frame;
+        for (u_int t=0; t<(u_int)frame->get_size(); t++) {params = params + param_count(frame->getFSAddress()[t].get_param().mu_type);}
+    }
+
+    size_t worker_size = (size_t)input_terms * sizeof(float)
+                       + (size_t)output_terms * (2 * sizeof(float) + sizeof(u_int))
+                       + (size_t)samples * sizeof(u_int)
+                       + (size_t)params * sizeof(float);
+    worker_size = align_64(worker_size);            // one cache line apart
+    size_t size = (size_t)total_rules * (input_size + 1) * sizeof(u_int)
+                + (size_t)input_terms * sizeof(u_int)
+                + (size_t)terms * (sizeof(FuzzySet*) + sizeof(FuzzyFrame*) + 3 * sizeof(u_int))
+                + (size_t)samples * sizeof(float)
+                + (size_t)output_terms * samples * 5 * sizeof(float)
+                + (size_t)params * 3 * sizeof(float)
+                + (size_t)threads * worker_size + 64;
+    char* p = (char*)malloc(size);
+    if (p == 0) {return false;}
+    this->_arena = p;
+    this->_term_set = (FuzzySet**)p;        p = p + (size_t)terms * sizeof(FuzzySet*);
+    this->_term_frame = (FuzzyFrame**)p;    p = p + (size_t)terms * sizeof(FuzzyFrame*);
+    this->_antecedent = (u_int*)p;          p = p + (size_t)total_rules * input_size * sizeof(u_int);
+    this->_consequent = (u_int*)p;          p = p + (size_t)total_rules * sizeof(u_int);
+    this->_term_input = (u_int*)p;          p = p + (size_t)input_terms * sizeof(u_int);
+    this->_term_index = (u_int*)p;          p = p + (size_t)terms * sizeof(u_int);
+    this->_param_offset = (u_int*)p;        p = p + (size_t)terms * sizeof(u_int);
+    this->_param_count = (u_int*)p;         p = p + (size_t)terms * sizeof(u_int);
+    this->_ys = (float*)p;                  p = p + (size_t)samples * sizeof(float);
+    this->_mu_output = (float*)p;           p = p + (size_t)output_terms * samples * sizeof(float);
+    this->_dmu_output = (float*)p;          p = p + (size_t)output_terms * samples * 4 * sizeof(float);
+    this->_theta = (float*)p;               p = p + (size_t)params * sizeof(float);
+    this->_moment1 = (float*)p;             p = p + (size_t)params * sizeof(float);
+    this->_moment2 = (float*)p;             p = p + (size_t)params * sizeof(float);
+    p = p + (64 - (size_t)p % 64) % 64;
+    this->_workers = p;
+
+    // Linguistic values and their parameters
+    u_int k = 0;
+    params = 0;
+    for (u_int i=0; i<=input_size; i++)
+    {
+        FuzzyFrame* frame = (i < input_size) ? &input_frames[i] : out_frame;
+        for (u_int t=0; t<(u_int)frame->get_size(); t++, k++)
+        {
+            FuzzySet* set = &frame->getFSAddress()[t];
+            FS_param param = set->get_param();
+            u_int count = param_count(param.mu_type);
+            this->_term_set[k] = set;
+            this->_term_frame[k] = frame;
+            this->_term_index[k] = t;
+            if (i < input_size) {this->_term_input[k] = i;}
+            this->_param_offset[k] = (count > 0) ? params : TRAINER_NONE;
+            this->_param_count[k] = count;
+            float thr[4] = {param.thr1, param.thr2, param.thr3, param.thr4};
+            for (u_int j=0; j<count; j++) {this->_theta[params + j] = thr[j];}
+            params = params + count;
+        }
+    }
+    for (u_int j=0; j<params; j++)
+    {
+        this->_moment1[j] = 0.0F;
+        this->_moment2[j] = 0.0F;
+    }
+    // Rules as indexes of the linguistic values
+    u_int offset[TRAINER_MAX_INPUT];
+    k = 0;
+    for (u_int i=0; i<input_size; i++)
+    {
+        offset[i] = k;
+        k = k + input_frames[i].get_size();
+    }
+    for (u_int r=0; r<total_rules; r++)
+    {
+        const u_int* antecedent = rules[r].get_input_rules();
+        for (u_int i=0; i<input_size; i++)
+        {
+            if (antecedent[i] >= (u_int)input_frames[i].get_size())
+            {
+                this->release();
+                return false;
+            }
+            this->_antecedent[(size_t)r * input_size + i] = offset[i] + antecedent[i];
+        }
+        this->_consequent[r] = rules[r].get_output_rules()[output_id];
+        if (this->_consequent[r] >= output_terms)
+        {
+            this->release();
+            return false;
+        }
+    }
+    u_int s = 0;
+    for (float y = domain.low_bond; y <= domain.up_bond && s < samples; y = y+domain.interval) {this->_ys[s++] = y;}
+
+    this->_system = system;
+    this->_input_size = input_size;
+    this->_total_rules = total_rules;
+    this->_output_id = output_id;
+    this->_input_terms = input_terms;
+    this->_output_terms = output_terms;
+    this->_samples = samples;
+    this->_params = params;
+    this->_steps = 0;
+    this->_threads = threads;
+    this->_worker_size = worker_size;
+    this->_pool.Pool_SetUp(threads);
+    return true;
+}
+
+float* FuzzyTrainer::worker_grad(u_int worker)
+{
+    // Worker layout: values of the inputs | w | gradient of w | argmin of w | pick per sample | gradient
+    char* p = this->_workers + (size_t)worker * this->_worker_size;
+    p = p + (size_t)this->_input_terms * sizeof(float)
+          + (size_t)this->_output_terms * (2 * sizeof(float) + sizeof(u_int))
+          + (size_t)this->_samples * sizeof(u_int);
+    return (float*)p;
+}
+
+void FuzzyTrainer::prepare_output(void)
+{
+    // The consequents at the output samples, with the parameters of this batch
+    u_int base = this->_input_terms;
+    for (u_int t=0; t<this->_output_terms; t++)
+    {
+        FuzzyFrame* frame = this->_term_frame[base + t];
+        FS_param param = this->_term_set[base + t]->get_param();
+        for (u_int s=0; s<this->_samples; s++)
+        {
+            size_t at = (size_t)t * this->_samples + s;
+            this->_mu_output[at] = frame->get_muvalue(t, this->_ys[s]);
+            param_gradient(param, this->_ys[s], &this->_dmu_output[at * 4]);
+        }
+    }
+}
+
+void FuzzyTrainer::run_samples(u_int worker, size_t first, size_t last)
+{
+    // scale: 2 / samples of the batch for the gradient of the mean squared error, 0: forward only
+    const float* inputs = this->_inputs;
+    const float* targets = this->_targets;
+    float scale = this->_scale;
+    bool backward = scale != 0.0F;
+    u_int n = this->_input_size;
+    u_int terms = this->_output_terms;
+    u_int samples = this->_samples;
+    char* p = this->_workers + (size_t)worker * this->_worker_size;
+    float* mu = (float*)p;              p = p + (size_t)this->_input_terms * sizeof(float);
+    float* w = (float*)p;               p = p + (size_t)terms * sizeof(float);
+    float* gw = (float*)p;              p = p + (size_t)terms * sizeof(float);
+    u_int* wk = (u_int*)p;              p = p + (size_t)terms * sizeof(u_int);
+    u_int* pick = (u_int*)p;            p = p + (size_t)samples * sizeof(u_int);
+    float* grad = (float*)p;
+    for (u_int j=0; j<this->_params; j++) {grad[j] = 0.0F;}
+    double loss = 0.0;
+
+    for (size_t q=first; q<last; q++)
+    {
+        const float* x = &inputs[q * n];
+        for (u_int k=0; k<this->_input_terms; k++)
+        {
+            mu[k] = this->_term_frame[k]->get_muvalue(this->_term_index[k], x[this->_term_input[k]]);
+        }
+        // Rules: alpha and the antecedent that made it, the largest per consequent
+        for (u_int t=0; t<terms; t++)
+        {
+            w[t] = 0.0F;
+            wk[t] = TRAINER_NONE;
+        }
+        for (u_int r=0; r<this->_total_rules; r++)
+        {
+            const u_int* antecedent = &this->_antecedent[(size_t)r * n];
+            float alpha = 1.0F;
+            u_int arg = TRAINER_NONE;
+            for (u_int i=0; i<n; i++)
+            {
+                if (mu[antecedent[i]] < alpha)
+                {
+                    alpha = mu[antecedent[i]];
+                    arg = antecedent[i];
+                }
+            }
+            u_int c = this->_consequent[r];
+            if (alpha > w[c])
+            {
+                w[c] = alpha;
+                wk[c] = arg;
+            }
+        }
+        // Output sweep and centroid, as Defuzzyfication
+        float weight = 0.0F;
+        float weight_avg = 0.0F;
+        for (u_int s=0; s<samples; s++)
+        {
+            float best = 0.0F;
+            u_int chosen = TRAINER_NONE;
+            for (u_int t=0; t<terms; t++)
+            {
+                float c = this->_mu_output[(size_t)t * samples + s];
+                bool by_alpha = w[t] < c;
+                float m = by_alpha ? w[t] : c;
+                if (m > best)
+                {
+                    best = m;
+                    chosen = 2 * t + (by_alpha ? 1 : 0);
+                }
+            }
+            pick[s] = chosen;
+            weight = weight + best;
+            weight_avg = weight_avg + best * this->_ys[s];
+        }
+        float output = (weight == 0.0F) ? weight_avg : weight_avg / weight;
+        float error = output - targets[q];
+        loss = loss + (double)error * error;
+        if (!backward || weight == 0.0F) {continue;}
+
+        // Backward: every sample to one consequent or, through w, to one antecedent
+        float g = scale * error / weight;
+        for (u_int t=0; t<terms; t++) {gw[t] = 0.0F;}
+        for (u_int s=0; s<samples; s++)
+        {
+            if (pick[s] == TRAINER_NONE) {continue;}
+            float gs = g * (this->_ys[s] - output);
+            u_int t = pick[s] >> 1;
+            if (pick[s] & 1U) {gw[t] = gw[t] + gs; continue;}
+            u_int offset = this->_param_offset[this->_input_terms + t];
+            if (offset == TRAINER_NONE) {continue;}
+            const float* dmu = &this->_dmu_output[((size_t)t * samples + s) * 4];
+            u_int count = this->_param_count[this->_input_terms + t];
+            for (u_int j=0; j<count; j++) {grad[offset + j] = grad[offset + j] + gs * dmu[j];}
+        }
+        for (u_int t=0; t<terms; t++)
+        {
+            if (gw[t] == 0.0F || wk[t] == TRAINER_NONE) {continue;}
+            u_int k = wk[t];
+            u_int offset = this->_param_offset[k];
+            if (offset == TRAINER_NONE) {continue;}
+            float d[4];
+            param_gradient(this->_term_set[k]->get_param(), x[this->_term_input[k]], d);
+            u_int count = this->_param_count[k];
+            for (u_int j=0; j<count; j++) {grad[offset + j] = grad[offset + j] + gw[t] * d[j];}
+        }
+    }
+    this->_loss[worker] = loss;
+}
+
+void FuzzyTrainer::run_shard(void* owner, u_int worker, u_int threads)
+{
+    // Share of worker of the running batch, into its own gradient
+    FuzzyTrainer* self = (FuzzyTrainer*)owner;
+    size_t first = self->_first + self->_count * worker / threads;
+    size_t last = self->_first + self->_count * (worker + 1) / threads;
+    self->run_samples(worker, first, last);
+}
+
+double FuzzyTrainer::run(const float* inputs, const float* targets, size_t first, size_t count, bool backward)
+{
+    // One shard per thread, the calling thread runs shard 0
+    u_int threads = this->_threads;
+    if (count < (size_t)threads) {threads = 1;}
+    this->_inputs = inputs;
+    this->_targets = targets;
+    this->_first = first;
+    this->_count = count;
+    this->_scale = backward ? 2.0F / (float)count : 0.0F;
+    this->_pool.Run(&FuzzyTrainer::run_shard, this, threads);
+
+    double loss = this->_loss[0];
+    float* grad = this->worker_grad(0);
+    for (u_int w=1; w<threads; w++)
+    {
+        loss = loss + this->_loss[w];
+        const float* other = this->worker_grad(w);
+        for (u_int j=0; j<this->_params && backward; j++) {grad[j] = grad[j] + other[j];}
+    }
+    return loss;
+}
+
+void FuzzyTrainer::apply(float rate)
+{
+    // Adam step, then the thresholds back into the FuzzySets
+    const float beta1 = 0.9F;
+    const float beta2 = 0.999F;
+    this->_steps++;
+    float correction1 = 1.0F - (float)pow(beta1, (double)this->_steps);
+    float correction2 = 1.0F - (float)pow(beta2, (double)this->_steps);
+    const float* grad = this->worker_grad(0);
+    for (u_int j=0; j<this->_params; j++)
+    {
+        this->_moment1[j] = beta1 * this->_moment1[j] + (1.0F - beta1) * grad[j];
+        this->_moment2[j] = beta2 * this->_moment2[j] + (1.0F - beta2) * grad[j] * grad[j];
+        float m = this->_moment1[j] / correction1;
+        float v = this->_moment2[j] / correction2;
+        this->_theta[j] = this->_theta[j] - rate * m / (sqrtf(v) + 1e-8F);
+    }
+    for (u_int k=0; k<this->_input_terms + this->_output_terms; k++)
+    {
+        u_int offset = this->_param_offset[k];
+        if (offset == TRAINER_NONE) {continue;}
+        FuzzyFrame* frame = this->_term_frame[k];
+        FS_type type = this->_term_set[k]->get_param().mu_type;
+        float* thr = &this->_theta[offset];
+        u_int t = this->_term_index[k];
+        if (type == GAUSS)
+        {
+            UnivDisc domain = frame->get_domain();
+            float least = 1e-3F * (domain.up_bond - domain.low_bond);
+            thr[1] = (thr[1] > least) ? thr[1] : least;
+            frame->Set_SetUp(t, type, thr[0], thr[1]);
+            continue;
+        }
+        u_int count = this->_param_count[k];
+        for (u_int j=1; j<count; j++) {thr[j] = (thr[j] > thr[j - 1]) ? thr[j] : thr[j - 1];}
+        if (count == 2) {frame->Set_SetUp(t, type, thr[0], thr[1]);}
+        else if (count == 3) {frame->Set_SetUp(t, type, thr[0], thr[1], thr[2]);}
+        else {frame->Set_SetUp(t, type, thr[0], thr[1], thr[2], thr[3]);}
+    }
+
+    // The workers share the frames: their tables are filled again before the next batch
+    for (u_int k=0; k<this->_input_terms + this->_output_terms; k++) {this->_term_frame[k]->Frame_Refresh();}
+}
+
+float FuzzyTrainer::Train(const float* inputs, const float* targets, size_t samples, u_int epochs, u_int batch, float rate)
+{
+    if (this->_total_rules == 0 || samples == 0 || batch == 0) {return 0.0F;}
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double loss = 0.0;
+    for (u_int e=0; e<epochs; e++)
+    {
+        loss = 0.0;
+        for (size_t first=0; first<samples; first=first+batch)
+        {
+            size_t count = (samples - first < batch) ? samples - first : batch;
+            this->prepare_output();
+            loss = loss + this->run(inputs, targets, first, count, true);
+            this->apply(rate);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    this->_samples_per_second = (seconds > 0.0) ? (double)samples * epochs / seconds : 0.0;
+    return (float)(loss / (double)samples);
+}
+
+float FuzzyTrainer::Error(const float* inputs, const float* targets, size_t samples)
+{
+    if (this->_total_rules == 0 || samples == 0) {return 0.0F;}
+    this->prepare_output();
+    return (float)(this->run(inputs, targets, 0, samples, false) / (double)samples);
+}
+
+u_int FuzzyTrainer::get_parameters(void)
+{
+    return this->_params;
+}
+
+u_int FuzzyTrainer::get_threads(void)
+{
+    return this->_threads;
+}
+
+double FuzzyTrainer::get_samples_per_second(void)
+{
+    return this->_samples_per_second;
+}
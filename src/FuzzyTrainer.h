@@ -0,0 +1,131 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Fitting of the membership functions of a FuzzySystem to a dataset.
+  *
+  * The thresholds of the FuzzySets (FS_param) are usually tuned by hand.
+  * FuzzyTrainer fits them to pairs (input vector, target output) by gradient
+  * descent on the mean squared error, as ANFIS does, for the default operators
+  * (minimum, maximum, Mamdani) and the centroid of Defuzzyfication:
+  *
+  *    alpha_r = min_i mu_ri(x_i)                    (the smallest antecedent)
+  *    w_t     = max over the rules of consequent t of alpha_r
+  *    mu(y_s) = max_t min(w_t, mu_t(y_s))           at the output samples
+  *    output  = sum mu(y_s) y_s / sum mu(y_s)
+  *
+  * The backward pass follows the operand chosen by every min and max, so each
+  * output sample sends its gradient either to one consequent or, through w_t,
+  * to the one antecedent that made alpha. The derivatives over the thresholds
+  * are closed forms (segments of TRP_L, TRP_C, TRP_R and TRI, and GAUSS); the
+  * FuzzySets of other types are left as they are.
+  *
+  * A batch is split into one shard per thread of a FuzzyPool started by
+  * Trainer_SetUp. Every thread runs the forward
+  * and backward pass of its samples in its own part of the arena, the
+  * gradients are summed and the parameters updated with Adam, then written
+  * back with FuzzyFrame::Set_SetUp (which also refreshes partitions and lookup
+  * tables). Nothing is allocated after Trainer_SetUp.
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    FuzzyTrainer trainer;
+  *    trainer.Trainer_SetUp(&mySystem, 0, 8);             // output 0, 8 threads (0: one per core)
+  *    float mse = trainer.Train(inputs, targets, 1000000, 5, 4096, 0.05);   // 5 epochs, batches of 4096
+  *    printf("%f samples per second\n", trainer.get_samples_per_second());
+  *    ```
+  *
+  * inputs holds input_size values per sample. The rate is in the units of the
+  * domains (Adam moves a threshold by about rate per batch). The thresholds of
+  * a piecewise linear set are kept in ascending order and sigma of a GAUSS
+  * set positive.
+***/
+
+#ifndef FUZZYTRAINER_H_
+#define FUZZYTRAINER_H_
+
+#include <stddef.h>
+#include "FuzzyLogic.h"
+#include "FuzzyPool.h"
+
+#ifndef TRAINER_MAX_THREADS
+#define TRAINER_MAX_THREADS     64      // Maximum number of threads
+#endif
+
+#ifndef TRAINER_MAX_INPUT
+#define TRAINER_MAX_INPUT       32      // Maximum number of inputs
+#endif
+
+class FuzzyTrainer
+{
+private:
+    FuzzySystem* _system;
+    u_int _input_size, _total_rules, _output_id;
+    u_int _input_terms, _output_terms, _samples;
+    void* _arena;                                   // every array below, one allocation
+
+    // Flattened system: linguistic values of the inputs, then of the output
+    u_int* _antecedent;                             // per rule, index of each antecedent in the values
+    u_int* _consequent;                             // per rule, linguistic value of the output
+    u_int* _term_input;                             // per input linguistic value, its input
+    FuzzySet** _term_set;                           // per linguistic value, its FuzzySet
+    FuzzyFrame** _term_frame;
+    u_int* _term_index;                             // per linguistic value, its index in the frame
+    u_int* _param_offset;                           // per linguistic value, first parameter (or none)
+    u_int* _param_count;                            // per linguistic value, number of parameters
+    float* _ys;                                     // output samples
+    float* _mu_output;                              // per output linguistic value and sample, for the batch
+    float* _dmu_output;                             // and its derivatives over the 4 thresholds
+
+    // Parameters and Adam
+    u_int _params;
+    float* _theta;
+    float* _moment1;
+    float* _moment2;
+    uint64_t _steps;
+
+    // Per thread: values, scratch and gradient
+    u_int _threads;
+    size_t _worker_size;                            // bytes of one worker
+    char* _workers;
+    double _loss[TRAINER_MAX_THREADS];
+    FuzzyPool _pool;
+
+    // The running batch
+    const float* _inputs;
+    const float* _targets;
+    size_t _first, _count;
+    float _scale;
+
+    double _samples_per_second;
+
+    void release(void);
+    float* worker_grad(u_int worker);
+    void prepare_output(void);
+    void run_samples(u_int worker, size_t first, size_t last);
+    static void run_shard(void* owner, u_int worker, u_int threads);
+    double run(const float* inputs, const float* targets, size_t first, size_t count, bool backward);
+    void apply(float rate);
+
+    FuzzyTrainer(const FuzzyTrainer&);              // not copyable
+    FuzzyTrainer& operator=(const FuzzyTrainer&);
+public:
+    FuzzyTrainer();
+    ~FuzzyTrainer();
+
+    // Returns false if the system has no rule, rules with different frames,
+    // too many inputs, an empty output domain or if the allocation fails
+    bool Trainer_SetUp(FuzzySystem* system, u_int output_id, u_int threads);
+
+    // Runs epochs over the samples in batches and returns the mean squared
+    // error of the last epoch (measured while training)
+    float Train(const float* inputs, const float* targets, size_t samples, u_int epochs, u_int batch, float rate);
+    // Mean squared error of the system as it is (same output as Defuzzyfication)
+    float Error(const float* inputs, const float* targets, size_t samples);
+
+    u_int get_parameters(void);                     // thresholds being trained
+    u_int get_threads(void);
+    double get_samples_per_second(void);            // of the last Train, forward and backward
+};
+
+#endif // FUZZYTRAINER_H_
@@ -0,0 +1,441 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Implementation of FuzzyTuner (see FuzzyTuner.h)
+***/
+
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <chrono>
+#include "FuzzyTuner.h"
+
+FuzzyTuner::FuzzyTuner()
+{
+    this->_system = 0;
+    this->_input_size = 0;
+    this->_output_size = 0;
+    this->_total_rules = 0;
+    this->_frames = 0;
+    this->_arena = 0;
+    this->_sets = 0;
+    this->_param_genes = 0;
+    this->_genes = 0;
+    this->_tune_consequents = false;
+    this->_population = 0;
+    this->_best_cost = FLT_MAX;
+    this->_mutation_rate = 0.1F;
+    this->_mutation_sigma = 0.05F;
+    this->_random = 0x9E3779B97F4A7C15ULL;
+    this->_threads = 0;
+    this->_model_size = 0;
+    this->_evaluations = 0;
+    this->_evaluations_per_second = 0.0;
+    this->_cost_function = 0;
+    this->_user = 0;
+    this->_first = 0;
+    this->_count = 0;
+}
+
+FuzzyTuner::~FuzzyTuner()
+{
+    this->release();
+}
+
+void FuzzyTuner::release(void)
+{
+    // The copies of the system hold nothing outside of the arena, the pool
+    // is stopped before it is freed
+    this->_pool.Release();
+    free(this->_arena);
+    this->_arena = 0;
+    this->_total_rules = 0;
+    this->_population = 0;
+    this->_threads = 0;
+}
+
+bool FuzzyTuner::Tuner_SetUp(FuzzySystem* system, u_int population, u_int threads, bool consequents)
+{
+    this->release();
+    FlatSystem flat;
+    if (!flat_system(system, &flat) || population < TUNER_ELITE + 1) {return false;}
+    FuzzyRule* rules = flat.rules;
+    u_int total_rules = flat.total_rules;
+    u_int input_size = flat.input_size;
+    u_int output_size = flat.output_size;
+    FuzzyFrame* input_frames = flat.input_frames;
+    FuzzyFrame* output_frames = flat.output_frames;
+    if (input_size + output_size > TUNER_MAX_FRAMES) {return false;}
+    threads = FuzzyPool::thread_count(threads, TUNER_MAX_THREADS);
+
+    u_int frames = input_size + output_size;
+    u_int sets = 0, param_genes = 0, terms = 0;
+    size_t table_size = 0;
+    for (u_int f=0; f<frames; f++)
+    {
+        FuzzyFrame* frame = (f < input_size) ? &input_frames[f] : &output_frames[f - input_size];
+        this->_source[f] = frame;
+        this->_terms[f] = (u_int)frame->get_size();
+        terms = terms + this->_terms[f];
+        table_size = table_size + (size_t)frame->get_table_points() * this->_terms[f] * sizeof(float);
+        for (u_int t=0; t<this->_terms[f]; t++)
+        {
+            u_int count = param_count(frame->getFSAddress()[t].get_param().mu_type);
+            sets = sets + (u_int)(count > 0);
+            param_genes = param_genes + count;
+        }
+    }
+    u_int genes = param_genes + (consequents ? total_rules * output_size : 0);
+    if (genes == 0) {return false;}
+
+    // One copy of the system per thread and one for the best candidate
+    FuzzySystemBuilder builder(input_size, this->_terms, output_size, &this->_terms[input_size], total_rules);
+    size_t system_size = align_64(builder.arena_size());
+    size_t model_size = align_64(system_size + (size_t)terms * sizeof(FS_pwl) + table_size);
+    size_t size = (size_t)sets * 3 * sizeof(u_int)
+                + (size_t)param_genes * sizeof(float)
+                + (size_t)total_rules * (input_size + output_size) * sizeof(u_int)
+                + (size_t)population * genes * 2 * sizeof(float)
+                + (size_t)population * (2 * sizeof(float) + sizeof(u_int))
+                + 64 + (size_t)(threads + 1) * model_size;
+    char* p = (char*)malloc(size);
+    if (p == 0) {return false;}
+    this->_arena = p;
+    this->_genome = (float*)p;              p = p + (size_t)population * genes * sizeof(float);
+    this->_offspring = (float*)p;           p = p + (size_t)population * genes * sizeof(float);
+    this->_cost = (float*)p;                p = p + (size_t)population * sizeof(float);
+    this->_offspring_cost = (float*)p;      p = p + (size_t)population * sizeof(float);
+    this->_gene_width = (float*)p;          p = p + (size_t)param_genes * sizeof(float);
+    this->_rank = (u_int*)p;                p = p + (size_t)population * sizeof(u_int);
+    this->_set_frame = (u_int*)p;           p = p + (size_t)sets * sizeof(u_int);
+    this->_set_index = (u_int*)p;           p = p + (size_t)sets * sizeof(u_int);
+    this->_set_gene = (u_int*)p;            p = p + (size_t)sets * sizeof(u_int);
+    this->_antecedent = (u_int*)p;          p = p + (size_t)total_rules * input_size * sizeof(u_int);
+    this->_consequent = (u_int*)p;          p = p + (size_t)total_rules * output_size * sizeof(u_int);
+    p = p + (64 - (size_t)p % 64) % 64;
+    this->_models = p;
+
+    this->_system = system;
+    this->_input_size = input_size;
+    this->_output_size = output_size;
+    this->_total_rules = total_rules;
+    this->_frames = frames;
+    this->_sets = sets;
+    this->_param_genes = param_genes;
+    this->_genes = genes;
+    this->_tune_consequents = consequents;
+    this->_population = population;
+    this->_threads = threads;
+    this->_model_size = model_size;
+
+    // FuzzySets in the genome
+    u_int k = 0, gene = 0;
+    for (u_int f=0; f<frames; f++)
+    {
+        UnivDisc domain = this->_source[f]->get_domain();
+        for (u_int t=0; t<this->_terms[f]; t++)
+        {
+            u_int count = param_count(this->_source[f]->getFSAddress()[t].get_param().mu_type);
+            if (count == 0) {continue;}
+            this->_set_frame[k] = f;
+            this->_set_index[k] = t;
+            this->_set_gene[k] = gene;
+            for (u_int j=0; j<count; j++) {this->_gene_width[gene + j] = domain.up_bond - domain.low_bond;}
+            gene = gene + count;
+            k++;
+        }
+    }
+    for (u_int r=0; r<total_rules; r++)
+    {
+        memcpy(&this->_antecedent[r * input_size], rules[r].get_input_rules(), input_size * sizeof(u_int));
+        memcpy(&this->_consequent[r * output_size], rules[r].get_output_rules(), output_size * sizeof(u_int));
+    }
+
+    // Copies of the system, each with its own breakpoints and lookup tables
+    for (u_int m=0; m<=threads; m++)
+    {
+        char* base = this->_models + (size_t)m * model_size;
+        FuzzyModel* model = builder.Build(base, system_size);
+        FS_pwl* pwl = (FS_pwl*)(base + system_size);
+        float* table = (float*)(pwl + terms);
+        for (u_int f=0; f<frames; f++)
+        {
+            FuzzyFrame* source = this->_source[f];
+            FuzzyFrame* frame = (f < input_size) ? &model->input(f) : &model->output(f - input_size);
+            UnivDisc domain = source->get_domain();
+            model->Frame_SetUp((f < input_size) ? INPUT : OUTPUT, (f < input_size) ? f : f - input_size, domain.low_bond, domain.up_bond);
+            frame->domainSetUp(domain.low_bond, domain.up_bond, domain.interval);
+            frame->Pwl_SetUp(pwl);
+            pwl = pwl + this->_terms[f];
+            for (u_int t=0; t<this->_terms[f]; t++)
+            {
+                FuzzySet* set = &source->getFSAddress()[t];
+                FS_param param = set->get_param();
+                FS_pwl breaks;
+                set->get_pwl(&breaks);
+                if (param.mu_type == PWL) {frame->Set_SetUp(t, breaks.x, breaks.mu, breaks.n);}
+                else {frame->Set_SetUp(t, param.mu_type, param.thr1, param.thr2, param.thr3, param.thr4);}
+            }
+            u_int points = source->get_table_points();
+            if (points > 0)
+            {
+                frame->Table_SetUp(table, points);
+                table = table + (size_t)points * this->_terms[f];
+            }
+        }
+        for (u_int r=0; r<total_rules; r++) {model->Rule_SetUp(r, &this->_antecedent[r * input_size], &this->_consequent[r * output_size]);}
+        this->_model[m] = model;
+    }
+    this->_pool.Pool_SetUp(threads);
+    return true;
+}
+
+void FuzzyTuner::Mutation_SetUp(float rate, float sigma)
+{
+    this->_mutation_rate = rate;
+    this->_mutation_sigma = sigma;
+}
+
+uint64_t FuzzyTuner::next_random(void)
+{
+    // xorshift64*
+    this->_random ^= this->_random >> 12;
+    this->_random ^= this->_random << 25;
+    this->_random ^= this->_random >> 27;
+    return this->_random * 2685821657736338717ULL;
+}
+
+float FuzzyTuner::uniform(void)
+{
+    // In [0, 1)
+    return (float)(this->next_random() >> 40) * (1.0F / 16777216.0F);
+}
+
+float FuzzyTuner::normal(void)
+{
+    // Box-Muller
+    float u1 = 1.0F - this->uniform();
+    float u2 = this->uniform();
+    return sqrtf(-2.0F * logf(u1)) * cosf(6.2831853F * u2);
+}
+
+void FuzzyTuner::read_genome(float* genome)
+{
+    // Genome of the system as it is
+    for (u_int k=0; k<this->_sets; k++)
+    {
+        FS_param param = this->_source[this->_set_frame[k]]->getFSAddress()[this->_set_index[k]].get_param();
+        float thr[4] = {param.thr1, param.thr2, param.thr3, param.thr4};
+        u_int count = param_count(param.mu_type);
+        for (u_int j=0; j<count; j++) {genome[this->_set_gene[k] + j] = thr[j];}
+    }
+    if (!this->_tune_consequents) {return;}
+    FuzzyRule* rules = this->_system->get_rules();
+    float* consequent = &genome[this->_param_genes];
+    for (u_int r=0; r<this->_total_rules; r++)
+    {
+        for (u_int o=0; o<this->_output_size; o++) {consequent[r * this->_output_size + o] = (float)rules[r].get_output_rules()[o];}
+    }
+}
+
+void FuzzyTuner::write_genome(FuzzyModel* model, float* genome)
+{
+    /*
+    Sets up the frames of model (of the system if model is 0) with the
+    genome, after making it valid: ascending thresholds, sigma of a GAUSS set
+    not below 1/1000 of the domain and consequents among the linguistic values.
+    The valid genome is kept, so the offspring inherit it.
+    */
+    for (u_int k=0; k<this->_sets; k++)
+    {
+        u_int f = this->_set_frame[k];
+        u_int t = this->_set_index[k];
+        FuzzyFrame* frame = (model == 0) ? this->_source[f]
+                          : ((f < this->_input_size) ? &model->input(f) : &model->output(f - this->_input_size));
+        FS_type type = this->_source[f]->getFSAddress()[t].get_param().mu_type;
+        float* thr = &genome[this->_set_gene[k]];
+        if (type == GAUSS)
+        {
+            float low = 0.001F * this->_gene_width[this->_set_gene[k]];
+            thr[1] = (thr[1] > low) ? thr[1] : low;
+            frame->Set_SetUp(t, GAUSS, thr[0], thr[1]);
+            continue;
+        }
+        u_int count = param_count(type);
+        for (u_int j=1; j<count; j++)
+        {
+            for (u_int i=j; i>0 && thr[i - 1] > thr[i]; i--) {float swap = thr[i]; thr[i] = thr[i - 1]; thr[i - 1] = swap;}
+        }
+        if (count == 2) {frame->Set_SetUp(t, type, thr[0], thr[1]);}
+        else if (count == 3) {frame->Set_SetUp(t, type, thr[0], thr[1], thr[2]);}
+        else {frame->Set_SetUp(t, type, thr[0], thr[1], thr[2], thr[3]);}
+    }
+    for (u_int f=0; f<this->_input_size + this->_output_size; f++)
+    {
+        FuzzyFrame* frame = (model == 0) ? this->_source[f]
+                          : ((f < this->_input_size) ? &model->input(f) : &model->output(f - this->_input_size));
+        frame->Frame_Refresh();
+    }
+    if (!this->_tune_consequents || model == 0) {return;}
+    float* consequent = &genome[this->_param_genes];
+    u_int output[TUNER_MAX_FRAMES];
+    for (u_int r=0; r<this->_total_rules; r++)
+    {
+        for (u_int o=0; o<this->_output_size; o++)
+        {
+            float c = consequent[r * this->_output_size + o];
+            float last = (float)(this->_terms[this->_input_size + o] - 1);
+            c = (c > 0.0F) ? c : 0.0F;
+            c = (c < last) ? c : last;
+            consequent[r * this->_output_size + o] = c;
+            output[o] = (u_int)c;
+        }
+        model->Rule_SetUp(r, &this->_antecedent[r * this->_input_size], output);
+    }
+}
+
+void FuzzyTuner::evaluate(void* owner, u_int worker, u_int threads)
+{
+    // Share of worker of the new candidates, on its copy of the system
+    FuzzyTuner* self = (FuzzyTuner*)owner;
+    u_int first = self->_first + (u_int)((uint64_t)self->_count * worker / threads);
+    u_int last = self->_first + (u_int)((uint64_t)self->_count * (worker + 1) / threads);
+    FuzzyModel* model = self->_model[worker];
+    for (u_int c=first; c<last; c++)
+    {
+        self->write_genome(model, &self->_genome[(size_t)c * self->_genes]);
+        float value = self->_cost_function(&model->system(), worker, self->_user);
+        self->_cost[c] = (value == value) ? value : FLT_MAX;     // NaN is the worst cost
+    }
+}
+
+u_int FuzzyTuner::tournament(void)
+{
+    // Best of TUNER_TOURNAMENT candidates drawn at random
+    u_int best = (u_int)(this->next_random() % this->_population);
+    for (u_int i=1; i<TUNER_TOURNAMENT; i++)
+    {
+        u_int c = (u_int)(this->next_random() % this->_population);
+        if (this->_cost[c] < this->_cost[best]) {best = c;}
+    }
+    return best;
+}
+
+void FuzzyTuner::breed(float* child, const float* a, const float* b)
+{
+    // Blend crossover (BLX-0.25) and gaussian mutation of the thresholds
+    for (u_int j=0; j<this->_param_genes; j++)
+    {
+        float t = -0.25F + 1.5F * this->uniform();
+        child[j] = a[j] + t * (b[j] - a[j]);
+        if (this->uniform() < this->_mutation_rate) {child[j] = child[j] + this->normal() * this->_mutation_sigma * this->_gene_width[j];}
+    }
+    // Uniform crossover and random reset of the consequents
+    for (u_int j=this->_param_genes; j<this->_genes; j++)
+    {
+        child[j] = (this->uniform() < 0.5F) ? a[j] : b[j];
+        if (this->uniform() < this->_mutation_rate)
+        {
+            u_int o = (j - this->_param_genes) % this->_output_size;
+            child[j] = (float)(this->next_random() % this->_terms[this->_input_size + o]);
+        }
+    }
+}
+
+float FuzzyTuner::Tune(FuzzyCost cost, void* user, u_int generations)
+{
+    if (this->_population == 0) {return FLT_MAX;}
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    u_int population = this->_population;
+    u_int genes = this->_genes;
+
+    // First generation: the system and mutants of it
+    this->read_genome(this->_genome);
+    for (u_int c=1; c<population; c++) {this->breed(&this->_genome[(size_t)c * genes], this->_genome, this->_genome);}
+    this->_evaluations = 0;
+    u_int first = 0;
+    for (u_int g=0; ; g++)
+    {
+        // Candidates from first on are new: split them between the threads
+        u_int count = population - first;
+        this->_cost_function = cost;
+        this->_user = user;
+        this->_first = first;
+        this->_count = count;
+        this->_pool.Run(&FuzzyTuner::evaluate, this, (count < this->_threads) ? count : this->_threads);
+        this->_evaluations = this->_evaluations + count;
+
+        // Ranking (insertion sort, the population is small)
+        for (u_int c=0; c<population; c++)
+        {
+            u_int i = c;
+            for (; i>0 && this->_cost[this->_rank[i - 1]] > this->_cost[c]; i--) {this->_rank[i] = this->_rank[i - 1];}
+            this->_rank[i] = c;
+        }
+        if (g == generations) {break;}
+
+        // Next generation: the elite, then the offspring
+        for (u_int c=0; c<TUNER_ELITE; c++)
+        {
+            memcpy(&this->_offspring[(size_t)c * genes], &this->_genome[(size_t)this->_rank[c] * genes], genes * sizeof(float));
+            this->_offspring_cost[c] = this->_cost[this->_rank[c]];
+        }
+        for (u_int c=TUNER_ELITE; c<population; c++)
+        {
+            const float* a = &this->_genome[(size_t)this->tournament() * genes];
+            const float* b = &this->_genome[(size_t)this->tournament() * genes];
+            this->breed(&this->_offspring[(size_t)c * genes], a, b);
+        }
+        float* swap = this->_genome; this->_genome = this->_offspring; this->_offspring = swap;
+        swap = this->_cost; this->_cost = this->_offspring_cost; this->_offspring_cost = swap;
+        first = TUNER_ELITE;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    this->_evaluations_per_second = (seconds > 0.0) ? (double)this->_evaluations / seconds : 0.0;
+
+    // The best candidate into its copy and into the system
+    float* best = &this->_genome[(size_t)this->_rank[0] * genes];
+    this->_best_cost = this->_cost[this->_rank[0]];
+    this->write_genome(this->_model[this->_threads], best);
+    this->write_genome(0, best);
+    if (this->_tune_consequents)
+    {
+        FuzzyRule* rules = this->_system->get_rules();
+        FuzzyFrame* input_frames = rules[0].get_input_frames();
+        FuzzyFrame* output_frames = rules[0].get_output_frames();
+        for (u_int r=0; r<this->_total_rules; r++)
+        {
+            u_int* consequent = &this->_consequent[r * this->_output_size];
+            for (u_int o=0; o<this->_output_size; o++) {consequent[o] = (u_int)best[this->_param_genes + r * this->_output_size + o];}
+            rules[r].Rule_SetUp(input_frames, &this->_antecedent[r * this->_input_size], this->_input_size,
+                                output_frames, consequent, this->_output_size);
+        }
+    }
+    return this->_best_cost;
+}
+
+u_int FuzzyTuner::get_genes(void)
+{
+    return this->_genes;
+}
+u_int FuzzyTuner::get_threads(void)
+{
+    return this->_threads;
+}
+float FuzzyTuner::get_best_cost(void)
+{
+    return this->_best_cost;
+}
+FuzzyModel* FuzzyTuner::get_best_model(void)
+{
+    return (this->_threads > 0) ? this->_model[this->_threads] : 0;
+}
+uint64_t FuzzyTuner::get_evaluations(void)
+{
+    return this->_evaluations;
+}
+double FuzzyTuner::get_evaluations_per_second(void)
+{
+    return this->_evaluations_per_second;
+}
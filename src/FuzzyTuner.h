@@ -0,0 +1,161 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Evolutionary tuning of a FuzzySystem for any cost.
+  *
+  * FuzzyTrainer needs targets and a gradient. The cost of a controller is
+  * often only known by running it (a closed loop simulation, a count of
+  * failures, a penalty), so FuzzyTuner searches with a genetic algorithm that
+  * only needs the cost of a candidate. The genome of a candidate is:
+  *
+  *    - the thresholds of every FuzzySet of type TRP_L, TRP_C, TRP_R, TRI
+  *      and GAUSS of the frames of the system (in the units of their domain)
+  *    - optionally, the consequent of every rule (one linguistic value per
+  *      rule and output, the table given to Rule_SetUp)
+  *
+  * Every generation keeps the TUNER_ELITE best candidates and makes the others
+  * from two parents picked by tournament: blend crossover of the thresholds,
+  * uniform crossover of the consequents, then gaussian mutation (sigma is a
+  * fraction of the width of the domain) or a random linguistic value. The
+  * thresholds of a set are kept in ascending order and sigma of a GAUSS set
+  * positive.
+  *
+  * The candidates of a generation are evaluated in parallel. Every thread owns
+  * a copy of the system placed by FuzzySystemBuilder in its part of the arena
+  * (with its own lookup tables), writes the genome of its candidate into it
+  * and calls the cost function. Nothing is allocated after Tuner_SetUp.
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    float cost(FuzzySystem* system, u_int worker, void* user)
+  *    {
+  *        // simulate the closed loop with system->Defuzzyfication, lower is better
+  *    }
+  *
+  *    FuzzyTuner tuner;
+  *    tuner.Tuner_SetUp(&myController, 64, 0, true);     // 64 candidates, one thread per core, with consequents
+  *    float best = tuner.Tune(cost, &myPlant, 100);       // 100 generations
+  *    printf("%f evaluations per second\n", tuner.get_evaluations_per_second());
+  *    ```
+  *
+  * The cost function is called from several threads at once (worker tells
+  * which one, from 0 to get_threads() - 1) and must give the same cost for
+  * the same system, since the elite keep their cost. Tune starts from the
+  * system as it is and writes the best candidate back into it: the frames are
+  * set up again and, with the consequents, the rules are set up on arrays held
+  * by the tuner, which then has to live as long as the system is used.
+***/
+
+#ifndef FUZZYTUNER_H_
+#define FUZZYTUNER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "FuzzyLogic.h"
+#include "FuzzyBuilder.h"
+#include "FuzzyPool.h"
+
+#ifndef TUNER_MAX_THREADS
+#define TUNER_MAX_THREADS       64      // Maximum number of threads
+#endif
+
+#ifndef TUNER_MAX_FRAMES
+#define TUNER_MAX_FRAMES        40      // Maximum number of inputs and outputs
+#endif
+
+#ifndef TUNER_ELITE
+#define TUNER_ELITE             2       // Best candidates kept by every generation
+#endif
+
+#ifndef TUNER_TOURNAMENT
+#define TUNER_TOURNAMENT        3       // Candidates drawn to pick one parent
+#endif
+
+// Cost of a candidate (lower is better), called from the worker threads
+typedef float (*FuzzyCost)(FuzzySystem* system, u_int worker, void* user);
+
+class FuzzyTuner
+{
+private:
+    FuzzySystem* _system;
+    u_int _input_size, _output_size, _total_rules;
+    u_int _frames;                                  // inputs then outputs
+    u_int _terms[TUNER_MAX_FRAMES];
+    FuzzyFrame* _source[TUNER_MAX_FRAMES];          // frames of the system
+    void* _arena;                                   // every array below, one allocation
+
+    // Genome: thresholds, then the consequents
+    u_int _sets;                                    // FuzzySets with thresholds in the genome
+    u_int* _set_frame;                              // per such set, its frame
+    u_int* _set_index;                              // and its index in the frame
+    u_int* _set_gene;                               // first gene
+    u_int _param_genes, _genes;
+    float* _gene_width;                             // per threshold gene, width of the domain
+    u_int* _antecedent;                             // copy of the antecedents of the rules
+    u_int* _consequent;                             // consequents of the best candidate
+    bool _tune_consequents;
+
+    // Population
+    u_int _population;
+    float* _genome;                                 // current generation, _genes per candidate
+    float* _offspring;                              // next generation
+    float* _cost;
+    float* _offspring_cost;
+    u_int* _rank;
+    float _best_cost;
+    float _mutation_rate, _mutation_sigma;
+    uint64_t _random;
+
+    // Per thread: a copy of the system and its lookup tables
+    u_int _threads;
+    size_t _model_size;                             // bytes of one copy, tables included
+    char* _models;
+    FuzzyModel* _model[TUNER_MAX_THREADS + 1];      // the last one holds the best candidate
+    FuzzyPool _pool;
+
+    // The running generation
+    FuzzyCost _cost_function;
+    void* _user;
+    u_int _first, _count;                           // candidates first .. first+count-1
+
+    uint64_t _evaluations;
+    double _evaluations_per_second;
+
+    void release(void);
+    uint64_t next_random(void);
+    float uniform(void);
+    float normal(void);
+    void read_genome(float* genome);
+    void write_genome(FuzzyModel* model, float* genome);
+    static void evaluate(void* owner, u_int worker, u_int threads);
+    u_int tournament(void);
+    void breed(float* child, const float* a, const float* b);
+
+    FuzzyTuner(const FuzzyTuner&);                  // not copyable, the system may point to its arrays
+    FuzzyTuner& operator=(const FuzzyTuner&);
+public:
+    FuzzyTuner();
+    ~FuzzyTuner();
+
+    // Returns false if the system has no rule, rules with different frames,
+    // too many frames, a population smaller than TUNER_ELITE + 1 or if the
+    // allocation fails
+    bool Tuner_SetUp(FuzzySystem* system, u_int population, u_int threads, bool consequents);
+    // Probability of mutation of each gene (0.1 by default) and sigma as a
+    // fraction of the width of the domain (0.05 by default)
+    void Mutation_SetUp(float rate, float sigma);
+
+    // Runs the generations and returns the cost of the best candidate,
+    // which is written into the system
+    float Tune(FuzzyCost cost, void* user, u_int generations);
+
+    u_int get_genes(void);
+    u_int get_threads(void);
+    float get_best_cost(void);
+    FuzzyModel* get_best_model(void);               // copy of the system with the best candidate
+    uint64_t get_evaluations(void);                 // of the last Tune
+    double get_evaluations_per_second(void);
+};
+
+#endif // FUZZYTUNER_H_
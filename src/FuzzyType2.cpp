@@ -0,0 +1,304 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Implementation of Interval Type-2 Fuzzy Logic (see FuzzyType2.h)
+***/
+
+#include "FuzzyType2.h"
+
+/* TYPE REDUCERS */
+//
+static u_int switch_point(const float* x, u_int n, float y)
+{
+    // Largest k in [1, n-1] such that x[k-1] <= y (k counts the samples on the left of y)
+    u_int low = 1, high = n - 1;
+    while (low < high)
+    {
+        u_int mid = (low + high + 1) / 2;
+        if (x[mid-1] <= y)  {low = mid;}
+        else                {high = mid - 1;}
+    }
+    return low;
+}
+
+static float ekm_left(const float* x, const float* lower, const float* upper, u_int n)
+{
+    /*
+    Enhanced Karnik-Mendel for the left end point c_l: the first k samples
+    take the upper membership and the others the lower membership, k is
+    moved until it brackets the weighted average.
+    */
+    u_int k = (u_int)(n / 2.4F + 0.5F);
+    if (k < 1) {k = 1;}
+    if (k > n - 1) {k = n - 1;}
+    float a = 0.0, b = 0.0;
+    for (u_int i=0; i<n; i++)
+    {
+        float w = (i < k) ? upper[i] : lower[i];
+        a = a + x[i] * w;
+        b = b + w;
+    }
+    float y = (b > 0.0F) ? a / b : x[0];
+    for (u_int iter=0; iter<n; iter++)
+    {
+        u_int k_new = switch_point(x, n, y);
+        if (k_new == k) {break;}
+        float s = (k_new > k) ? 1.0F : -1.0F;
+        u_int from = (k_new > k) ? k : k_new;
+        u_int to = (k_new > k) ? k_new : k;
+        for (u_int i=from; i<to; i++)
+        {
+            a = a + s * x[i] * (upper[i] - lower[i]);
+            b = b + s * (upper[i] - lower[i]);
+        }
+        y = (b > 0.0F) ? a / b : x[0];
+        k = k_new;
+    }
+    return y;
+}
+
+static float ekm_right(const float* x, const float* lower, const float* upper, u_int n)
+{
+    // Same as ekm_left, but the first k samples take the lower membership
+    u_int k = (u_int)(n / 1.7F + 0.5F);
+    if (k < 1) {k = 1;}
+    if (k > n - 1) {k = n - 1;}
+    float a = 0.0, b = 0.0;
+    for (u_int i=0; i<n; i++)
+    {
+        float w = (i < k) ? lower[i] : upper[i];
+        a = a + x[i] * w;
+        b = b + w;
+    }
+    float y = (b > 0.0F) ? a / b : x[n-1];
+    for (u_int iter=0; iter<n; iter++)
+    {
+        u_int k_new = switch_point(x, n, y);
+        if (k_new == k) {break;}
+        float s = (k_new > k) ? 1.0F : -1.0F;
+        u_int from = (k_new > k) ? k : k_new;
+        u_int to = (k_new > k) ? k_new : k;
+        for (u_int i=from; i<to; i++)
+        {
+            a = a - s * x[i] * (upper[i] - lower[i]);
+            b = b - s * (upper[i] - lower[i]);
+        }
+        y = (b > 0.0F) ? a / b : x[n-1];
+        k = k_new;
+    }
+    return y;
+}
+
+float ekm_centroid(const float* x, const float* lower, const float* upper, u_int n, float* c_left, float* c_right)
+{
+    // Centroid interval [c_left, c_right] of the sampled FOU, returns its middle
+    float upper_sum = 0.0;
+    for (u_int i=0; i<n; i++) {upper_sum = upper_sum + upper[i];}
+    if (n == 0 || upper_sum == 0)
+    {
+        // Precaution for empty output (same result as type-1 Defuzzyfication)
+        *c_left = 0.0;
+        *c_right = 0.0;
+        return 0.0;
+    }
+    if (n == 1)
+    {
+        *c_left = x[0];
+        *c_right = x[0];
+        return x[0];
+    }
+    *c_left = ekm_left(x, lower, upper, n);
+    *c_right = ekm_right(x, lower, upper, n);
+    return (*c_left + *c_right) / 2.0F;
+}
+
+float nie_tan_centroid(const float* x, const float* lower, const float* upper, u_int n)
+{
+    // Closed form: centroid of the average of lower and upper membership
+    float weight = 0.0;
+    float weight_avg = 0.0;
+    for (u_int i=0; i<n; i++)
+    {
+        float w = lower[i] + upper[i];
+        weight = weight + w;
+        weight_avg = weight_avg + w * x[i];
+    }
+    if (weight == 0) {weight = 1.0;}            // Precaution for weight = 0 (error division by 0)
+    return weight_avg / weight;
+}
+
+float wu_mendel_centroid(const float* x, const float* lower, const float* upper, u_int n, float* c_left, float* c_right)
+{
+    /*
+    Wu-Mendel uncertainty bounds. The inner bounds are the centroids of the
+    lower and of the upper membership, the outer bounds are derived from them
+    in closed form. c_left and c_right are the middle of the bounds.
+    */
+    if (n == 0)
+    {
+        *c_left = 0.0;
+        *c_right = 0.0;
+        return 0.0;
+    }
+    float x_first = x[0];
+    float x_last = x[n-1];
+    float sum_lo = 0.0, sum_up = 0.0, avg_lo = 0.0, avg_up = 0.0;
+    float lo_left = 0.0, up_left = 0.0, lo_right = 0.0, up_right = 0.0;
+    for (u_int i=0; i<n; i++)
+    {
+        sum_lo = sum_lo + lower[i];
+        sum_up = sum_up + upper[i];
+        avg_lo = avg_lo + lower[i] * x[i];
+        avg_up = avg_up + upper[i] * x[i];
+        lo_left = lo_left + lower[i] * (x[i] - x_first);
+        up_left = up_left + upper[i] * (x[i] - x_first);
+        lo_right = lo_right + lower[i] * (x_last - x[i]);
+        up_right = up_right + upper[i] * (x_last - x[i]);
+    }
+    if (sum_lo == 0 || sum_up == 0)
+    {
+        // Bounds are not defined without lower membership, use Nie-Tan
+        *c_left = nie_tan_centroid(x, lower, upper, n);
+        *c_right = *c_left;
+        return *c_left;
+    }
+    float y_lo = avg_lo / sum_lo;
+    float y_up = avg_up / sum_up;
+    float inner_left = minimum(y_lo, y_up);
+    float inner_right = maximum(y_lo, y_up);
+
+    float factor = (sum_up - sum_lo) / (sum_up * sum_lo);
+    float den_left = lo_left + up_right;
+    float den_right = up_left + lo_right;
+    float outer_left = inner_left;
+    float outer_right = inner_right;
+    if (den_left > 0.0F)  {outer_left = inner_left - factor * (lo_left * up_right) / den_left;}
+    if (den_right > 0.0F) {outer_right = inner_right + factor * (up_left * lo_right) / den_right;}
+
+    *c_left = (outer_left + inner_left) / 2.0F;
+    *c_right = (inner_right + outer_right) / 2.0F;
+    return (*c_left + *c_right) / 2.0F;
+}
+
+
+/* CLASSES */
+//
+FuzzySet2::FuzzySet2()
+{
+    this->_lower_height = 1.0;
+}
+
+FuzzySet& FuzzySet2::upper(void)
+{
+    return this->_upper;
+}
+
+FuzzySet& FuzzySet2::lower(void)
+{
+    return this->_lower;
+}
+
+void FuzzySet2::set_height(float lower_height)
+{
+    this->_lower_height = lower_height;
+}
+
+void FuzzySet2::mu_func(float x, float* mu_lower, float* mu_upper)
+{
+    // The lower membership never exceeds the upper one
+    float up = this->_upper.mu_func(x);
+    float lo = this->_lower_height * this->_lower.mu_func(x);
+    *mu_lower = minimum(lo, up);
+    *mu_upper = up;
+}
+
+void FuzzyFrame2::Frame_SetUp(FuzzySet2* sets, u_int _ling_size, float x_left, float x_right, FrameType FF_type)
+{
+    this->_domain.low_bond = x_left;
+    this->_domain.up_bond = x_right;
+    this->_domain.interval = (x_right - x_left)/(1.0*(DISC_SIZE - 1));
+    this->_ling_sets = sets;
+    this->_ling_size = _ling_size;
+    this->_type = FF_type;
+}
+void FuzzyFrame2::domainSetUp(float x_left, float x_right, float interval)
+{
+    this->_domain.low_bond = x_left;
+    this->_domain.up_bond = x_right;
+    this->_domain.interval = interval;
+}
+FuzzySet& FuzzyFrame2::upper(u_int indx)
+{
+    return this->_ling_sets[indx].upper();
+}
+FuzzySet& FuzzyFrame2::lower(u_int indx)
+{
+    return this->_ling_sets[indx].lower();
+}
+void FuzzyFrame2::Height_SetUp(u_int indx, float lower_height)
+{
+    this->_ling_sets[indx].set_height(lower_height);
+}
+
+void FuzzyFrame2::get_muvalue(u_int indx, float x, float* mu_lower, float* mu_upper)
+{
+    this->_ling_sets[indx].mu_func(x, mu_lower, mu_upper);
+}
+
+FuzzySet2* FuzzyFrame2::getFSAddress(void)
+{
+    return this->_ling_sets;
+}
+
+int FuzzyFrame2::get_size(void)
+{
+    return this->_ling_size;
+}
+UnivDisc FuzzyFrame2::get_domain(void)
+{
+    return this->_domain;
+}
+
+
+void FuzzyRule2::Rule_SetUp(FuzzyFrame2* input_frames, u_int* input_rules, u_int FR_input_size, FuzzyFrame2* output_frames, u_int* output_rules, u_int FR_output_size)
+{
+    this->_antecedent_frames = input_frames;
+    this->_consequent_frames = output_frames;
+    this->_antecedent_rules = input_rules;
+    this->_consequent_rules = output_rules;
+    this->_input_frame_size = FR_input_size;
+    this->_output_frame_size = FR_output_size;
+}
+
+void FuzzyRule2::Evaluate(float* input, float output, u_int output_id, float* mu_lower, float* mu_upper)
+{
+    // Default operators: minimum as AND and as implication (Mamdani)
+    this->Evaluate<TNormMin, ImpMamdani>(input, output, output_id, mu_lower, mu_upper);
+}
+UnivDisc FuzzyRule2::get_output_domain(u_int output_id)
+{
+    return this->_consequent_frames[output_id].get_domain();
+}
+
+
+FuzzySystem2::FuzzySystem2(FuzzyRule2* Rules, u_int total_rules, TR_type reducer)
+{
+    this->_rules = Rules;
+    this->_total_rules = total_rules;
+    this->_reducer = reducer;
+}
+
+void FuzzySystem2::TypeReducer_SetUp(TR_type reducer)
+{
+    this->_reducer = reducer;
+}
+
+void FuzzySystem2::Evaluate(float* input_, float output_, u_int output_id_, float* mu_lower, float* mu_upper)
+{
+    this->Evaluate<TNormMin, SNormMax, ImpMamdani>(input_, output_, output_id_, mu_lower, mu_upper);
+}
+
+float FuzzySystem2::Defuzzyfication(float* input, u_int output_id)
+{
+    return this->Defuzzyfication<TNormMin, SNormMax, ImpMamdani>(input, output_id);
+}
@@ -0,0 +1,215 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Interval Type-2 Fuzzy Logic on top of FuzzyLogic.h
+  *
+  * An interval type-2 Fuzzy Set is described by two ordinary membership
+  * functions: the upper one (UMF) and the lower one (LMF). The area between
+  * them is the Footprint Of Uncertainty (FOU), useful for noisy inputs where
+  * the exact shape of a membership function is not known. Each of UMF and LMF
+  * is a normal FuzzySet, so every FS_type of FuzzyLogic.h can be used.
+  *
+  * The objects are used the same way as their type-1 counterparts:
+  * FuzzySet2 -> FuzzyFrame2 -> FuzzyRule2 -> FuzzySystem2.
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    FuzzySet2 Temperature[3];
+  *    FuzzyFrame2 FramesInput[2];
+  *    ...
+  *    FramesInput[TEMP].Frame_SetUp(Temperature, 3, 0.0, 100.0, INPUT);
+  *    FramesInput[TEMP].upper(COLD).set_up(TRP_L, 12.0, 32.0);        // UMF
+  *    FramesInput[TEMP].lower(COLD).set_up(TRP_L, 8.0, 28.0);         // LMF
+  *    FramesInput[TEMP].Height_SetUp(COLD, 0.9);                      // LMF height (optional)
+  *    ...
+  *    FuzzySystem2 mySystem(myRules, 6, TR_NIE_TAN);
+  *    output = mySystem.Defuzzyfication(inputs, 0);
+  *    ```
+  *
+  * // TYPE REDUCTION
+  *
+  * The aggregated output FOU is sampled over the output universe of discourse
+  * (the same samples as the type-1 Defuzzyfication) and reduced to a crisp
+  * value by one of:
+  *
+  *    TR_EKM       : Enhanced Karnik-Mendel, exact centroid interval [c_l, c_r].
+  *                   Iterative, usually converges in 2-3 iterations.
+  *    TR_NIE_TAN   : Nie-Tan closed form, centroid of (LMF + UMF)/2. One pass.
+  *    TR_WU_MENDEL : Wu-Mendel uncertainty bounds of [c_l, c_r]. One pass.
+  *
+  * At most T2_DISC_MAX output samples are used by the type reducer.
+***/
+
+#ifndef FUZZYTYPE2_H_
+#define FUZZYTYPE2_H_
+
+#include "FuzzyLogic.h"
+
+#ifndef T2_DISC_MAX
+#define T2_DISC_MAX             256     // Maximum number of output samples for type reduction
+#endif
+
+typedef enum
+{
+    // Type reducer of interval type-2 Fuzzy System
+    TR_EKM,             // Enhanced Karnik-Mendel
+    TR_NIE_TAN,         // Nie-Tan closed form
+    TR_WU_MENDEL        // Wu-Mendel uncertainty bounds
+} TR_type;
+
+/* PROTOTYPES */
+// Type reducers over samples x[0..n-1] (ascending) with membership interval [lower, upper]
+float ekm_centroid(const float* x, const float* lower, const float* upper, u_int n, float* c_left, float* c_right);
+float nie_tan_centroid(const float* x, const float* lower, const float* upper, u_int n);
+float wu_mendel_centroid(const float* x, const float* lower, const float* upper, u_int n, float* c_left, float* c_right);
+
+// Classes
+class FuzzySet2
+{
+private:
+    FuzzySet _upper;
+    FuzzySet _lower;
+    float _lower_height;
+public:
+    FuzzySet2();
+
+    FuzzySet& upper(void);
+    FuzzySet& lower(void);
+    void set_height(float lower_height);
+
+    // Membership interval [mu_lower, mu_upper]
+    void mu_func(float x, float* mu_lower, float* mu_upper);
+};
+
+class FuzzyFrame2
+{
+private:
+    FuzzySet2* _ling_sets;
+    u_int _ling_size;
+    UnivDisc _domain;
+    FrameType _type;
+public:
+    void Frame_SetUp(FuzzySet2* sets, u_int _ling_size, float x_left, float x_right, FrameType FF_type);
+    void domainSetUp(float x_left, float x_right, float interval);
+    FuzzySet& upper(u_int indx);
+    FuzzySet& lower(u_int indx);
+    void Height_SetUp(u_int indx, float lower_height);
+
+    void get_muvalue(u_int indx, float x, float* mu_lower, float* mu_upper);
+    FuzzySet2* getFSAddress(void);
+    int get_size(void);
+    UnivDisc get_domain(void);
+};
+
+class FuzzyRule2
+{
+/***
+ * [Same as FuzzyRule, but the degree of fulfillment is an interval]
+***/
+private:
+    FuzzyFrame2* _antecedent_frames;
+    FuzzyFrame2* _consequent_frames;
+    u_int* _antecedent_rules;
+    u_int* _consequent_rules;
+
+    u_int _input_frame_size;
+    u_int _output_frame_size;
+
+public:
+    void Rule_SetUp(FuzzyFrame2* input_frames, u_int* input_rules, u_int FR_input_size, FuzzyFrame2* output_frames, u_int* output_rules, u_int FR_output_size);
+    void Evaluate(float* input, float output, u_int output_id, float* mu_lower, float* mu_upper);
+    template <class TNorm, class Implication>
+    void Evaluate(float* input, float output, u_int output_id, float* mu_lower, float* mu_upper);
+    UnivDisc get_output_domain(u_int output_id);
+};
+
+class FuzzySystem2
+{
+private:
+    FuzzyRule2* _rules;
+    u_int _total_rules;
+    TR_type _reducer;
+public:
+    FuzzySystem2(FuzzyRule2* Rules, u_int total_rules, TR_type reducer);
+    void TypeReducer_SetUp(TR_type reducer);
+
+    void Evaluate(float* input, float output, u_int output_id, float* mu_lower, float* mu_upper);
+    float Defuzzyfication(float* input, u_int output_id);
+
+    // Same as above, but with operators chosen at compile time (see OPERATOR POLICIES)
+    template <class TNorm, class SNorm, class Implication>
+    void Evaluate(float* input, float output, u_int output_id, float* mu_lower, float* mu_upper);
+    template <class TNorm, class SNorm, class Implication>
+    float Defuzzyfication(float* input, u_int output_id);
+};
+
+
+/* TEMPLATE METHODS */
+//
+template <class TNorm, class Implication>
+void FuzzyRule2::Evaluate(float* input, float output, u_int output_id, float* mu_lower, float* mu_upper)
+{
+    // Interval of degree of fulfillment [alpha_lower, alpha_upper]
+    float alpha_lower = 1.0;
+    float alpha_upper = 1.0;
+    float lo, up;
+    for (u_int atc=0; atc < this->_input_frame_size; atc++)
+    {
+        this->_antecedent_frames[atc].get_muvalue(this->_antecedent_rules[atc], input[atc], &lo, &up);
+        alpha_lower = TNorm::apply(lo, alpha_lower);
+        alpha_upper = TNorm::apply(up, alpha_upper);
+    }
+    this->_consequent_frames[output_id].get_muvalue(this->_consequent_rules[output_id], output, &lo, &up);
+    *mu_lower = Implication::apply(alpha_lower, lo);
+    *mu_upper = Implication::apply(alpha_upper, up);
+}
+
+template <class TNorm, class SNorm, class Implication>
+void FuzzySystem2::Evaluate(float* input_, float output_, u_int output_id_, float* mu_lower, float* mu_upper)
+{
+    // Agregatting lower and upper fuzzy output over all rules
+    float result_lower = 0.0;
+    float result_upper = 0.0;
+    float lo, up;
+    for (u_int rule_id=0; rule_id < this->_total_rules; rule_id++)
+    {
+        this->_rules[rule_id].template Evaluate<TNorm, Implication>(input_, output_, output_id_, &lo, &up);
+        result_lower = SNorm::apply(result_lower, lo);
+        result_upper = SNorm::apply(result_upper, up);
+    }
+    *mu_lower = result_lower;
+    *mu_upper = result_upper;
+}
+
+template <class TNorm, class SNorm, class Implication>
+float FuzzySystem2::Defuzzyfication(float* input, u_int output_id)
+{
+    // Sample the output FOU, then reduce it into a crisp value
+    float ys[T2_DISC_MAX];
+    float lower[T2_DISC_MAX];
+    float upper[T2_DISC_MAX];
+    u_int n = 0;
+    UnivDisc evaluated_domain = this->_rules[0].get_output_domain(output_id);
+
+    for (float y = evaluated_domain.low_bond; y <= evaluated_domain.up_bond && n < T2_DISC_MAX; y = y+evaluated_domain.interval)
+    {
+        ys[n] = y;
+        this->Evaluate<TNorm, SNorm, Implication>(input, y, output_id, &lower[n], &upper[n]);
+        n++;
+    }
+
+    float c_left, c_right;
+    switch (this->_reducer)
+    {
+    case TR_NIE_TAN:
+        return nie_tan_centroid(ys, lower, upper, n);
+    case TR_WU_MENDEL:
+        return wu_mendel_centroid(ys, lower, upper, n, &c_left, &c_right);
+    case TR_EKM:
+    default:
+        return ekm_centroid(ys, lower, upper, n, &c_left, &c_right);
+    }
+}
+
+#endif // FUZZYTYPE2_H_
@@ -0,0 +1,492 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Implementation of FuzzyWangMendel (see FuzzyWangMendel.h)
+***/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FuzzyWangMendel.h"
+#include "FuzzyCSV.h"
+
+static int compare_order(const void* a, const void* b)
+{
+    uint64_t x = ((const WM_Order*)a)->sample;
+    uint64_t y = ((const WM_Order*)b)->sample;
+    return (x > y) - (x < y);
+}
+
+static u_int table_slots(u_int cells)
+{
+    // Power of 2 with room for cells at a load of at most one half
+    u_int slots = 16;
+    while (slots < 2 * cells) {slots = slots * 2;}
+    return slots;
+}
+
+static size_t table_size(u_int slots, u_int input_size, u_int output_size)
+{
+    return (size_t)slots * (sizeof(uint64_t) + sizeof(float) + (input_size + output_size) * sizeof(u_int));
+}
+
+static char* table_set_up(WM_Table* table, char* p, u_int slots, u_int input_size, u_int output_size)
+{
+    // Carves the arrays of table from p (aligned for uint64_t) and returns the end
+    table->sample = (uint64_t*)p;       p = p + (size_t)slots * sizeof(uint64_t);
+    table->degree = (float*)p;          p = p + (size_t)slots * sizeof(float);
+    table->key = (u_int*)p;             p = p + (size_t)slots * input_size * sizeof(u_int);
+    table->consequent = (u_int*)p;      p = p + (size_t)slots * output_size * sizeof(u_int);
+    table->mask = slots - 1;
+    table->count = 0;
+    for (u_int s=0; s<slots; s++) {table->degree[s] = -1.0F;}
+    return p;
+}
+
+
+FuzzyWangMendel::FuzzyWangMendel()
+{
+    this->_input_frames = 0;
+    this->_output_frames = 0;
+    this->_input_size = 0;
+    this->_output_size = 0;
+    this->_fields = 0;
+    this->_max_rules = 0;
+    this->_threads = 0;
+    this->_arena = 0;
+    this->_total_cells = 0;
+    this->_order = 0;
+    this->_block = 0;
+    this->_lines = 0;
+    this->_samples = 0;
+    this->_rejected = 0;
+    this->_uncovered = 0;
+    this->_dropped = 0;
+    this->_records = 0;
+    this->_record_count = 0;
+}
+
+FuzzyWangMendel::~FuzzyWangMendel()
+{
+    this->release();
+}
+
+void FuzzyWangMendel::release(void)
+{
+    // Stop and join the pool before freeing what the workers read
+    this->_pool.Release();
+    free(this->_arena);
+    this->_arena = 0;
+    this->_threads = 0;
+    this->_max_rules = 0;
+}
+
+bool FuzzyWangMendel::WangMendel_SetUp(FuzzyFrame* input_frames, u_int input_size, FuzzyFrame* output_frames, u_int output_size,
+                                       u_int max_rules, u_int threads)
+{
+    this->release();
+    if (input_size == 0 || input_size + output_size > WM_MAX_FIELDS || max_rules == 0) {return false;}
+    u_int max_terms = 0;
+    for (u_int f=0; f<input_size + output_size; f++)
+    {
+        FuzzyFrame* frame = (f < input_size) ? &input_frames[f] : &output_frames[f - input_size];
+        if (frame->get_size() <= 0) {return false;}
+        frame->Frame_Refresh();                     // the threads share the frames
+        if ((u_int)frame->get_size() > max_terms) {max_terms = frame->get_size();}
+    }
+    threads = FuzzyPool::thread_count(threads, WM_MAX_THREADS);
+
+    u_int shard_slots = table_slots(max_rules / WM_SHARDS + 8);
+    u_int local_slots = table_slots(WM_LOCAL_CELLS);
+    size_t size = (size_t)WM_SHARDS * table_size(shard_slots, input_size, output_size)
+                + (size_t)threads * (table_size(local_slots, input_size, output_size) + WM_LOCAL_CELLS * sizeof(u_int)
+                                     + (size_t)max_terms * sizeof(float) + 8)
+                + (size_t)max_rules * sizeof(WM_Order)
+                + WM_BLOCK_SIZE + 64;
+    char* p = (char*)malloc(size);
+    if (p == 0) {return false;}
+    this->_arena = p;
+    this->_block = p;                       p = p + WM_BLOCK_SIZE;
+    for (u_int s=0; s<WM_SHARDS; s++) {p = table_set_up(&this->_shard[s], p, shard_slots, input_size, output_size);}
+    for (u_int w=0; w<threads; w++)
+    {
+        p = table_set_up(&this->_local[w], p, local_slots, input_size, output_size);
+        this->_touched[w] = (u_int*)p;      p = p + WM_LOCAL_CELLS * sizeof(u_int);
+        this->_mu[w] = (float*)p;           p = p + (size_t)max_terms * sizeof(float);
+        p = p + (8 - (size_t)p % 8) % 8;
+    }
+    this->_order = (WM_Order*)p;
+
+    this->_input_frames = input_frames;
+    this->_output_frames = output_frames;
+    this->_input_size = input_size;
+    this->_output_size = output_size;
+    this->_fields = input_size + output_size;
+    this->_max_rules = max_rules;
+    this->_threads = threads;
+    this->Clear();
+    this->_pool.Pool_SetUp(threads);
+    return true;
+}
+
+void FuzzyWangMendel::Clear(void)
+{
+    for (u_int s=0; s<WM_SHARDS && this->_max_rules > 0; s++)
+    {
+        WM_Table* table = &this->_shard[s];
+        for (u_int k=0; k<=table->mask; k++) {table->degree[k] = -1.0F;}
+        table->count = 0;
+    }
+    this->_total_cells = 0;
+    this->_lines = 0;
+    this->_samples = 0;
+    this->_rejected = 0;
+    this->_uncovered = 0;
+    this->_dropped = 0;
+    for (u_int w=0; w<WM_MAX_THREADS; w++)
+    {
+        this->_worker_samples[w] = 0;
+        this->_worker_rejected[w] = 0;
+        this->_worker_uncovered[w] = 0;
+        this->_worker_dropped[w] = 0;
+    }
+}
+
+uint32_t FuzzyWangMendel::hash(const u_int* key, u_int n)
+{
+    // FNV-1a over the linguistic values
+    uint32_t h = 2166136261U;
+    for (u_int i=0; i<n; i++) {h = (h ^ key[i]) * 16777619U;}
+    return h ^ (h >> 15);
+}
+
+void FuzzyWangMendel::learn(u_int worker, const float* values, uint64_t index)
+{
+    // Rule of one sample into the table of worker
+    u_int key[WM_MAX_FIELDS];
+    float degree = 1.0F;
+    float* mu = this->_mu[worker];
+    for (u_int f=0; f<this->_fields; f++)
+    {
+        FuzzyFrame* frame = (f < this->_input_size) ? &this->_input_frames[f] : &this->_output_frames[f - this->_input_size];
+        u_int terms = (u_int)frame->get_size();
+        u_int best = 0;
+        frame->Fuzzify(values[f], mu);
+        float best_mu = mu[0];
+        for (u_int t=1; t<terms; t++)
+        {
+            if (mu[t] > best_mu) {best_mu = mu[t]; best = t;}
+        }
+        key[f] = best;
+        degree = degree * best_mu;
+    }
+    if (!(degree > 0.0F))
+    {
+        this->_worker_uncovered[worker]++;
+        return;
+    }
+    this->_worker_samples[worker]++;
+
+    WM_Table* table = &this->_local[worker];
+    u_int in = this->_input_size, out = this->_output_size;
+    u_int slot = hash(key, in) & table->mask;
+    for (;; slot = (slot + 1) & table->mask)
+    {
+        if (table->degree[slot] < 0.0F) {break;}
+        if (memcmp(&table->key[slot * in], key, in * sizeof(u_int)) == 0)
+        {
+            if (degree > table->degree[slot] || (degree == table->degree[slot] && index < table->sample[slot]))
+            {
+                memcpy(&table->consequent[slot * out], &key[in], out * sizeof(u_int));
+                table->degree[slot] = degree;
+                table->sample[slot] = index;
+            }
+            return;
+        }
+    }
+    if (table->count == WM_LOCAL_CELLS)
+    {
+        // Full: into the shared table, then from an empty one
+        this->merge(worker);
+        slot = hash(key, in) & table->mask;
+    }
+    memcpy(&table->key[slot * in], key, in * sizeof(u_int));
+    memcpy(&table->consequent[slot * out], &key[in], out * sizeof(u_int));
+    table->degree[slot] = degree;
+    table->sample[slot] = index;
+    this->_touched[worker][table->count] = slot;
+    table->count++;
+}
+
+void FuzzyWangMendel::merge(u_int worker)
+{
+    // Cells of worker into the shared table, one shard lock at a time
+    WM_Table* local = &this->_local[worker];
+    u_int in = this->_input_size, out = this->_output_size;
+    for (u_int c=0; c<local->count; c++)
+    {
+        u_int from = this->_touched[worker][c];
+        const u_int* key = &local->key[from * in];
+        uint32_t h = hash(key, in);
+        u_int s = h % WM_SHARDS;
+        WM_Table* table = &this->_shard[s];
+        std::lock_guard<std::mutex> guard(this->_locks[s]);
+        u_int slot = (h / WM_SHARDS) & table->mask;
+        for (;; slot = (slot + 1) & table->mask)
+        {
+            if (table->degree[slot] < 0.0F || memcmp(&table->key[slot * in], key, in * sizeof(u_int)) == 0) {break;}
+        }
+        if (table->degree[slot] < 0.0F)
+        {
+            // A new cell, if the table and the shard have room
+            bool room = (table->count + 1) * 8 < (table->mask + 1) * 7;
+            u_int total = this->_total_cells.fetch_add(1);
+            if (!room || total >= this->_max_rules)
+            {
+                this->_total_cells.fetch_sub(1);
+                this->_worker_dropped[worker]++;
+                local->degree[from] = -1.0F;
+                continue;
+            }
+            memcpy(&table->key[slot * in], key, in * sizeof(u_int));
+            table->count++;
+        }
+        else if (!(local->degree[from] > table->degree[slot] ||
+                   (local->degree[from] == table->degree[slot] && local->sample[from] < table->sample[slot])))
+        {
+            local->degree[from] = -1.0F;
+            continue;
+        }
+        memcpy(&table->consequent[slot * out], &local->consequent[from * out], out * sizeof(u_int));
+        table->degree[slot] = local->degree[from];
+        table->sample[slot] = local->sample[from];
+        local->degree[from] = -1.0F;
+    }
+    local->count = 0;
+}
+
+void FuzzyWangMendel::parse_lines(u_int worker, const char* text, const char* end, uint64_t index)
+{
+    // Lines of text, the first one being line number index
+    float values[WM_MAX_FIELDS];
+    while (text < end)
+    {
+        const char* eol = (const char*)memchr(text, '\n', end - text);
+        if (eol == 0) {eol = end;}
+        int n = csv_parse_line(text, eol, values, this->_fields);
+        if (n == (int)this->_fields) {this->learn(worker, values, index);}
+        else if (n != 0) {this->_worker_rejected[worker]++;}       // empty lines are skipped
+        text = eol + 1;
+        index++;
+    }
+    this->merge(worker);
+}
+
+void FuzzyWangMendel::learn_records(u_int worker, const float* records, size_t count, uint64_t index)
+{
+    for (size_t r=0; r<count; r++) {this->learn(worker, &records[r * this->_fields], index + r);}
+    this->merge(worker);
+}
+
+void FuzzyWangMendel::collect(void)
+{
+    // Counters of the threads into the totals
+    for (u_int w=0; w<this->_threads; w++)
+    {
+        this->_samples = this->_samples + this->_worker_samples[w];
+        this->_rejected = this->_rejected + this->_worker_rejected[w];
+        this->_uncovered = this->_uncovered + this->_worker_uncovered[w];
+        this->_dropped = this->_dropped + this->_worker_dropped[w];
+        this->_worker_samples[w] = 0;
+        this->_worker_rejected[w] = 0;
+        this->_worker_uncovered[w] = 0;
+        this->_worker_dropped[w] = 0;
+    }
+}
+
+void FuzzyWangMendel::parse_share(void* owner, u_int worker, u_int /* threads */)
+{
+    FuzzyWangMendel* self = (FuzzyWangMendel*)owner;
+    self->parse_lines(worker, self->_part[worker], self->_part[worker + 1], self->_part_index[worker]);
+}
+
+void FuzzyWangMendel::learn_share(void* owner, u_int worker, u_int threads)
+{
+    FuzzyWangMendel* self = (FuzzyWangMendel*)owner;
+    size_t first = self->_record_count * worker / threads;
+    size_t last = self->_record_count * (worker + 1) / threads;
+    self->learn_records(worker, &self->_records[first * self->_fields], last - first, self->_lines + first);
+}
+
+void FuzzyWangMendel::parse_block(const char* text, size_t size)
+{
+    // Whole lines, split between the threads at line boundaries
+    const char** part = this->_part;
+    uint64_t* index = this->_part_index;
+    const char* end = text + size;
+    u_int threads = this->_threads;
+    part[0] = text;
+    index[0] = this->_lines;
+    for (u_int w=1; w<=threads; w++)
+    {
+        const char* cut = end;
+        if (w < threads)
+        {
+            cut = text + size * w / threads;
+            cut = (cut > part[w - 1]) ? cut : part[w - 1];
+            const char* eol = (const char*)memchr(cut, '\n', end - cut);
+            cut = (eol == 0) ? end : eol + 1;
+        }
+        part[w] = cut;
+        uint64_t lines = 0;
+        for (const char* p = part[w - 1]; p < cut; lines++)
+        {
+            const char* eol = (const char*)memchr(p, '\n', cut - p);
+            p = (eol == 0) ? cut : eol + 1;
+        }
+        index[w] = index[w - 1] + lines;
+    }
+    this->_pool.Run(&FuzzyWangMendel::parse_share, this, threads);
+    this->_lines = index[threads];
+    this->collect();
+}
+
+bool FuzzyWangMendel::Add_Samples(const float* samples, size_t count)
+{
+    if (this->_max_rules == 0) {return false;}
+    this->_records = samples;
+    this->_record_count = count;
+    this->_pool.Run(&FuzzyWangMendel::learn_share, this, (count < (size_t)this->_threads) ? 1 : this->_threads);
+    this->_lines = this->_lines + count;
+    this->collect();
+    return true;
+}
+
+bool FuzzyWangMendel::Read_CSV(const char* path, bool header)
+{
+    if (this->_max_rules == 0) {return false;}
+    FILE* file = fopen(path, "rb");
+    if (file == 0) {return false;}
+    size_t kept = 0;                    // bytes of an unfinished line at the beginning of the block
+    bool skip = header;                 // the text up to the next '\n' is skipped
+    for (;;)
+    {
+        size_t n = fread(this->_block + kept, 1, WM_BLOCK_SIZE - kept, file);
+        size_t total = kept + n;
+        if (total == 0) {break;}
+        size_t start = 0;
+        if (skip)
+        {
+            const char* eol = (const char*)memchr(this->_block, '\n', total);
+            if (eol == 0)
+            {
+                kept = 0;
+                if (n == 0) {break;}
+                continue;
+            }
+            start = (size_t)(eol - this->_block) + 1;
+            skip = false;
+        }
+        size_t end = total;
+        if (n > 0)
+        {
+            // More may follow: stop after the last complete line
+            while (end > start && this->_block[end - 1] != '\n') {end--;}
+            if (end == start)
+            {
+                if (total < WM_BLOCK_SIZE)
+                {
+                    memmove(this->_block, this->_block + start, total - start);
+                    kept = total - start;
+                    continue;
+                }
+                // A line longer than a block can not be read
+                this->_rejected++;
+                this->_lines++;
+                skip = true;
+                kept = 0;
+                continue;
+            }
+        }
+        this->parse_block(this->_block + start, end - start);
+        kept = total - end;
+        memmove(this->_block, this->_block + end, kept);
+        if (n == 0) {break;}
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+bool FuzzyWangMendel::Read_Binary(const char* path)
+{
+    if (this->_max_rules == 0) {return false;}
+    FILE* file = fopen(path, "rb");
+    if (file == 0) {return false;}
+    size_t record = this->_fields * sizeof(float);
+    size_t records = WM_BLOCK_SIZE / record;
+    for (;;)
+    {
+        // Bytes rather than records, so that a partial record at the end is seen
+        size_t n = fread(this->_block, 1, records * record, file);
+        if (n >= record) {this->Add_Samples((const float*)this->_block, n / record);}
+        if (n % record != 0) {this->_rejected++;}          // the file ends inside a record
+        if (n < records * record) {break;}
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+u_int FuzzyWangMendel::Rules_SetUp(FuzzyRule* rules)
+{
+    // Cells in the order of the samples that made them
+    if (this->_max_rules == 0) {return 0;}
+    WM_Order* order = this->_order;
+    u_int n = 0;
+    for (u_int s=0; s<WM_SHARDS; s++)
+    {
+        WM_Table* table = &this->_shard[s];
+        for (u_int k=0; k<=table->mask; k++)
+        {
+            if (table->degree[k] < 0.0F) {continue;}
+            order[n].sample = table->sample[k];
+            order[n].shard = s;
+            order[n].slot = k;
+            n++;
+        }
+    }
+    qsort(order, n, sizeof(WM_Order), compare_order);
+    for (u_int r=0; r<n; r++)
+    {
+        WM_Table* table = &this->_shard[order[r].shard];
+        rules[r].Rule_SetUp(this->_input_frames, &table->key[order[r].slot * this->_input_size], this->_input_size,
+                            this->_output_frames, &table->consequent[order[r].slot * this->_output_size], this->_output_size);
+    }
+    return n;
+}
+
+u_int FuzzyWangMendel::get_total_rules(void)
+{
+    return this->_total_cells;
+}
+uint64_t FuzzyWangMendel::get_samples(void)
+{
+    return this->_samples;
+}
+uint64_t FuzzyWangMendel::get_rejected(void)
+{
+    return this->_rejected;
+}
+uint64_t FuzzyWangMendel::get_uncovered(void)
+{
+    return this->_uncovered;
+}
+uint64_t FuzzyWangMendel::get_dropped(void)
+{
+    return this->_dropped;
+}
+u_int FuzzyWangMendel::get_threads(void)
+{
+    return this->_threads;
+}
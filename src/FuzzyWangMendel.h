@@ -0,0 +1,172 @@
+/***
+  * Author          : Berlian Oka Irvianto  (Indonesia)
+  *
+  * Generation of the rules of a FuzzySystem from data (Wang-Mendel).
+  *
+  * Writing the rule table by hand (u_int input_rules[6][2] ...) does not scale
+  * beyond a few inputs. Given the frames of the inputs and outputs, the
+  * Wang-Mendel method makes one rule per sample:
+  *
+  *    1. every value of the sample takes its linguistic value of highest
+  *       degree of membership (the first one at a tie)
+  *    2. the degree of the rule is the product of those degrees
+  *    3. of the rules with the same antecedents (the same cell of the input
+  *       space), the one of highest degree is kept (the first sample at a tie)
+  *
+  * FuzzyWangMendel reads the samples in one pass, from memory, a CSV file or a
+  * binary file of floats, and only keeps one entry per cell, so the memory
+  * does not depend on the number of samples. A file is read in blocks of
+  * WM_BLOCK_SIZE bytes; every block is parsed by all the threads at once,
+  * each one on its own lines. A thread first merges its samples into a small
+  * table of its own (WM_LOCAL_CELLS cells), then into the shared table, which
+  * is split into WM_SHARDS shards with one lock each.
+  *
+  * // HOW TO USE IT
+  *
+  *    ```
+  *    FuzzyWangMendel generator;
+  *    generator.WangMendel_SetUp(myInputFrames, 6, myOutputFrames, 1, 100000, 0);   // at most 100000 rules, one thread per core
+  *    generator.Read_CSV("samples.csv", true);            // 6 inputs then 1 output per line, after a header line
+  *    FuzzyRule myRules[100000];
+  *    u_int total_rules = generator.Rules_SetUp(myRules);
+  *    FuzzySystem mySystem(myRules, total_rules);
+  *    ```
+  *
+  * Every line (or record of the binary file) holds the inputs then the
+  * outputs, separated by ',', ';', tabs or spaces; numbers are read with a
+  * point as decimal separator whatever the locale (see FuzzyCSV.h). The rules
+  * are the same for any number of threads (as long as no cell is dropped for
+  * lack of room) and are given in the order of the samples that made them.
+  * They point to the arrays of the generator, which must live as long as they
+  * are used. The frames must not change while samples are read.
+***/
+
+#ifndef FUZZYWANGMENDEL_H_
+#define FUZZYWANGMENDEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <atomic>
+#include "FuzzyLogic.h"
+#include "FuzzyPool.h"
+
+#ifndef WM_MAX_THREADS
+#define WM_MAX_THREADS      64          // Maximum number of threads
+#endif
+
+#ifndef WM_MAX_FIELDS
+#define WM_MAX_FIELDS       64          // Maximum number of inputs and outputs
+#endif
+
+#ifndef WM_SHARDS
+#define WM_SHARDS           64          // Shards (and locks) of the shared table
+#endif
+
+#ifndef WM_LOCAL_CELLS
+#define WM_LOCAL_CELLS      4096        // Cells of a thread before it merges them
+#endif
+
+#ifndef WM_BLOCK_SIZE
+#define WM_BLOCK_SIZE       (4 << 20)   // Bytes of a file read at once
+#endif
+
+// Cells of a rule base: open addressing, the key is the antecedent
+struct WM_Table
+{
+    u_int* key;                 // per slot, input_size linguistic values
+    u_int* consequent;          // per slot, output_size linguistic values
+    float* degree;              // per slot, -1 if empty
+    uint64_t* sample;           // per slot, index of the sample
+    u_int mask;                 // slots - 1
+    u_int count;
+};
+
+// A cell of the shared table, to give the rules in the order of the samples
+struct WM_Order
+{
+    uint64_t sample;
+    u_int shard, slot;
+};
+
+class FuzzyWangMendel
+{
+private:
+    FuzzyFrame* _input_frames;
+    FuzzyFrame* _output_frames;
+    u_int _input_size, _output_size, _fields;
+    u_int _max_rules;
+    u_int _threads;
+    void* _arena;                                   // every array below, one allocation
+
+    WM_Table _shard[WM_SHARDS];
+    std::mutex _locks[WM_SHARDS];
+    std::atomic<u_int> _total_cells;                // in the shared table
+    WM_Order* _order;                               // scratch of Rules_SetUp
+
+    WM_Table _local[WM_MAX_THREADS];                // per thread
+    u_int* _touched[WM_MAX_THREADS];                // per thread, the slots used in _local
+    float* _mu[WM_MAX_THREADS];                     // per thread, the degrees of one frame
+    char* _block;                                   // WM_BLOCK_SIZE bytes of the file
+
+    // Per thread, summed after every block
+    uint64_t _worker_samples[WM_MAX_THREADS];
+    uint64_t _worker_rejected[WM_MAX_THREADS];
+    uint64_t _worker_uncovered[WM_MAX_THREADS];
+    uint64_t _worker_dropped[WM_MAX_THREADS];
+
+    uint64_t _lines;                                // samples and lines read so far
+    uint64_t _samples, _rejected, _uncovered, _dropped;
+    FuzzyPool _pool;
+
+    // The running block: lines of each thread and their first index, or records
+    const char* _part[WM_MAX_THREADS + 1];
+    uint64_t _part_index[WM_MAX_THREADS + 1];
+    const float* _records;
+    size_t _record_count;
+
+    void release(void);
+    static uint32_t hash(const u_int* key, u_int n);
+    void learn(u_int worker, const float* values, uint64_t index);
+    void merge(u_int worker);
+    void parse_lines(u_int worker, const char* text, const char* end, uint64_t index);
+    void learn_records(u_int worker, const float* records, size_t count, uint64_t index);
+    static void parse_share(void* owner, u_int worker, u_int threads);
+    static void learn_share(void* owner, u_int worker, u_int threads);
+    void parse_block(const char* text, size_t size);
+    void collect(void);
+
+    FuzzyWangMendel(const FuzzyWangMendel&);        // not copyable, the rules point to its arrays
+    FuzzyWangMendel& operator=(const FuzzyWangMendel&);
+public:
+    FuzzyWangMendel();
+    ~FuzzyWangMendel();
+
+    // Returns false if there are too many inputs and outputs, a frame without
+    // linguistic value or if the allocation fails
+    bool WangMendel_SetUp(FuzzyFrame* input_frames, u_int input_size, FuzzyFrame* output_frames, u_int output_size,
+                          u_int max_rules, u_int threads);
+    void Clear(void);
+
+    // count samples of input_size then output_size values
+    bool Add_Samples(const float* samples, size_t count);
+    // header: the first line is skipped. Lines that are not input_size +
+    // output_size numbers are counted as rejected. Returns false if the file
+    // can not be read
+    bool Read_CSV(const char* path, bool header);
+    // Records of input_size + output_size floats in the byte order of the
+    // host. A partial record at the end of the file is counted as rejected
+    bool Read_Binary(const char* path);
+
+    // Sets up rules (at least get_total_rules() of them) and returns their number
+    u_int Rules_SetUp(FuzzyRule* rules);
+
+    u_int get_total_rules(void);
+    uint64_t get_samples(void);                     // samples used
+    uint64_t get_rejected(void);                    // lines (or records) that could not be read
+    uint64_t get_uncovered(void);                   // samples of degree 0
+    uint64_t get_dropped(void);                     // new cells beyond max_rules
+    u_int get_threads(void);
+};
+
+#endif // FUZZYWANGMENDEL_H_